@@ -3,7 +3,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <assert.h>
 
 #include "globbing.h"
@@ -28,84 +27,30 @@
  */
 
 
-static int matchesPattern(const char *fname, const char *wildcard,
-                          int caseSensitive)
+/*
+ * The matching itself is done by PHYSFS_enumerateFiltered(), which can skip
+ *  most of a big directory without looking at it, instead of us checking
+ *  every name that PHYSFS_enumerateFiles() hands back.
+ */
+static PHYSFS_Filter *compileWildcard(const char *wildcard, int caseSensitive)
 {
-    char x, y;
-    const char *fnameptr = fname;
-    const char *wildptr = wildcard;
-
-    while ((*wildptr) && (*fnameptr))
-    {
-        y = *wildptr;
-        if (y == '*')
-        {
-            do
-            {
-                wildptr++;  /* skip multiple '*' in a row... */
-            } while (*wildptr == '*');
-
-            y = (caseSensitive) ? *wildptr : (char) tolower(*wildptr);
-
-            while (1)
-            {
-                x = (caseSensitive) ? *fnameptr : (char) tolower(*fnameptr);
-                if ((!x) || (x == y))
-                    break;
-                else
-                    fnameptr++;
-            } /* while */
-        } /* if */
-
-        else if (y == '?')
-        {
-            wildptr++;
-            fnameptr++;
-        } /* else if */
+    return PHYSFS_compileFilter(PHYSFS_FILTER_GLOB, &wildcard, 1, caseSensitive);
+} /* compileWildcard */
 
-        else
-        {
-            if (caseSensitive)
-                x = *fnameptr;
-            else
-            {
-                x = tolower(*fnameptr);
-                y = tolower(y);
-            } /* if */
-
-            wildptr++;
-            fnameptr++;
-
-            if (x != y)
-                return 0;
-        } /* else */
-    } /* while */
-
-    while (*wildptr == '*')
-        wildptr++;
-
-    return (*fnameptr == *wildptr);
-} /* matchesPattern */
 
 typedef struct
 {
-    const PHYSFS_Allocator *allocator;
-    const char *wildcard;
-    int caseSensitive;
     PHYSFS_EnumFilesCallback callback;
     void *origData;
 } WildcardCallbackData;
 
 
-/*
- * This callback sits between the enumerator and the enduser callback,
- *  filtering out files that don't match the wildcard pattern.
- */
-static void wildcardCallback(void *_d, const char *origdir, const char *fname)
+static PHYSFS_EnumerateCallbackResult wildcardCallback(void *_d,
+                                        const char *origdir, const char *fname)
 {
     const WildcardCallbackData *data = (const WildcardCallbackData *) _d;
-    if (matchesPattern(fname, data->wildcard, data->caseSensitive))
-        data->callback(data->origData, origdir, fname);
+    data->callback(data->origData, origdir, fname);
+    return PHYSFS_ENUM_OK;
 } /* wildcardCallback */
 
 
@@ -115,13 +60,14 @@ void PHYSFSEXT_enumerateFilesCallbackWildcard(const char *dir,
                                               PHYSFS_EnumFilesCallback c,
                                               void *d)
 {
+    PHYSFS_Filter *filter = compileWildcard(wildcard, caseSensitive);
     WildcardCallbackData data;
-    data.allocator = PHYSFS_getAllocator();
-    data.wildcard = wildcard;
-    data.caseSensitive = caseSensitive;
+    if (filter == NULL)
+        return;
     data.callback = c;
     data.origData = d;
-    PHYSFS_enumerateFilesCallback(dir, wildcardCallback, &data);
+    PHYSFS_enumerateFiltered(dir, filter, wildcardCallback, &data);
+    PHYSFS_freeFilter(filter);
 } /* PHYSFSEXT_enumerateFilesCallbackWildcard */
 
 
@@ -142,42 +88,37 @@ char **PHYSFSEXT_enumerateFilesWildcard(const char *dir, const char *wildcard,
                                         int caseSensitive)
 {
     const PHYSFS_Allocator *allocator = PHYSFS_getAllocator();
-    char **list = PHYSFS_enumerateFiles(dir);
+    PHYSFS_Filter *filter = compileWildcard(wildcard, caseSensitive);
+    char **list = filter ? PHYSFS_enumerateFilesFiltered(dir, filter) : NULL;
     char **retval = NULL;
     int totalmatches = 0;
     int matches = 0;
     char **i;
 
+    PHYSFS_freeFilter(filter);
+    if (list == NULL)
+        return NULL;
+
     for (i = list; *i != NULL; i++)
-    {
-        #if 0
-        printf("matchesPattern: '%s' vs '%s' (%s) ... %s\n", *i, wildcard,
-               caseSensitive ? "case" : "nocase",
-               matchesPattern(*i, wildcard, caseSensitive) ? "true" : "false");
-        #endif
-        if (matchesPattern(*i, wildcard, caseSensitive))
-            totalmatches++;
-    } /* for */
+        totalmatches++;
 
+    /* PHYSFSEXT_freeEnumeration() frees each string, so copy them out. */
     retval = (char **) allocator->Malloc(sizeof (char *) * (totalmatches+1));
     if (retval != NULL)
     {
         for (i = list; ((matches < totalmatches) && (*i != NULL)); i++)
         {
-            if (matchesPattern(*i, wildcard, caseSensitive))
+            retval[matches] = (char *) allocator->Malloc(strlen(*i) + 1);
+            if (retval[matches] == NULL)
             {
-                retval[matches] = (char *) allocator->Malloc(strlen(*i) + 1);
-                if (retval[matches] == NULL)
-                {
-                    while (matches--)
-                        allocator->Free(retval[matches]);
-                    allocator->Free(retval);
-                    retval = NULL;
-                    break;
-                } /* if */
-                strcpy(retval[matches], *i);
-                matches++;
+                while (matches--)
+                    allocator->Free(retval[matches]);
+                allocator->Free(retval);
+                retval = NULL;
+                break;
             } /* if */
+            strcpy(retval[matches], *i);
+            matches++;
         } /* for */
 
         if (retval != NULL)
@@ -44,12 +44,23 @@ typedef struct __PHYSFS_DIRHANDLE__
     void *opaque;  /* Instance data unique to the archiver. */
     char *dirName;  /* Path to archive in platform-dependent notation. */
     char *mountPoint; /* Mountpoint in virtual file tree. */
+    size_t mountPointLen;  /* strlen(mountPoint), trailing '/' and all. */
     char *root;  /* subdirectory of archiver to use as root of archive (NULL for actual root) */
     size_t rootlen;  /* subdirectory of archiver to use as root of archive (NULL for actual root) */
     const PHYSFS_Archiver *funcs;  /* Ptr to archiver info for this handle. */
+    PHYSFS_uint8 *filter;  /* Bloom filter over archive paths (or NULL). */
+    PHYSFS_uint32 filterbits;  /* number of bits in (filter). */
+    PHYSFS_uint32 filterhashes;  /* bits set/tested per path. */
+    int filterstate;  /* LOOKUP_FILTER_* */
+    size_t searchidx;  /* position in the search path, for the mount tree. */
+    int ignorecase;  /* non-zero to find paths in any case; see fixCase(). */
     struct __PHYSFS_DIRHANDLE__ *next;  /* linked list stuff. */
 } DirHandle;
 
+#define LOOKUP_FILTER_NONE 0  /* not built yet. */
+#define LOOKUP_FILTER_READY 1  /* built and usable. */
+#define LOOKUP_FILTER_UNUSABLE 2  /* can't be trusted for this archive. */
+
 
 typedef struct __PHYSFS_FILEHANDLE__
 {
@@ -79,18 +90,37 @@ static DirHandle *searchPath = NULL;
 static DirHandle *writeDir = NULL;
 static FileHandle *openWriteList = NULL;
 static FileHandle *openReadList = NULL;
+static PHYSFS_DirIter *openDirIters = NULL;
 static char *baseDir = NULL;
 static char *userDir = NULL;
 static char *prefDir = NULL;
 static int allowSymLinks = 0;
+static int verifyChecksums = 0;
+static int verifyingArchive = 0;
+static PHYSFS_IndexingMode indexingMode = PHYSFS_INDEX_AT_MOUNT;
+static int dirCaching = 0;
+static int ignoreCase = 0;
 static PHYSFS_Archiver **archivers = NULL;
 static PHYSFS_ArchiveInfo **archiveInfo = NULL;
 static volatile size_t numArchivers = 0;
 static size_t longest_root = 0;
+static PHYSFS_uint32 lookupFilterBits = 0;
+static PHYSFS_uint64 lookupFilterSkipped = 0;
+static PHYSFS_uint64 lookupFilterChecked = 0;
 
 /* mutexes ... */
 static void *errorLock = NULL;     /* protects error message list.        */
 static void *stateLock = NULL;     /* protects other PhysFS static state. */
+static void *bgTaskLock = NULL;    /* protects the background task queue. */
+static void *bgRunLock = NULL;     /* held while a background task runs.  */
+static void *nativeIoLock = NULL;  /* protects the native handle pool.    */
+
+/* background tasks ... */
+static __PHYSFS_BackgroundTask *bgTaskHead = NULL;
+static __PHYSFS_BackgroundTask *bgTaskTail = NULL;
+static __PHYSFS_BackgroundTask *bgRunning = NULL;
+static void *bgThread = NULL;
+static int bgThreadDone = 0;
 
 /* allocator ... */
 static int externalAllocator = 0;
@@ -123,61 +153,277 @@ int __PHYSFS_ATOMIC_DECR(int *ptrval)
 
 /* PHYSFS_Io implementation for i/o to physical filesystem... */
 
+/*
+ * Read handles opened while PHYSFS_setNativeHandleLimit() has a limit set
+ *  are "pooled": when too many are open, the least-recently-used one that
+ *  isn't in the middle of an operation gets closed, and it's reopened (and
+ *  checked against its __PHYSFS_FileId, in case the file was replaced) the
+ *  next time it's needed. Fields marked "(pool)" are protected by
+ *  nativeIoLock for pooled handles.
+ */
 /* !!! FIXME: maybe refcount the paths in a string pool? */
 typedef struct __PHYSFS_NativeIoInfo
 {
-    void *handle;
+    void *handle;  /* NULL while the pool has it closed. (pool) */
     const char *path;
     int mode;   /* 'r', 'w', or 'a' */
+    int pooled;  /* non-zero if the pool manages (handle). */
+    int busy;  /* non-zero while an operation uses (handle). (pool) */
+    PHYSFS_uint64 pos;  /* file position while (handle) is closed. (pool) */
+    __PHYSFS_FileId id;  /* the file we opened first, if (pooled). */
+    struct __PHYSFS_NativeIoInfo *prev;  /* more recently used. (pool) */
+    struct __PHYSFS_NativeIoInfo *next;  /* less recently used. (pool) */
 } NativeIoInfo;
 
+static NativeIoInfo *nativeIoMru = NULL;  /* open pooled handles, newest. */
+static NativeIoInfo *nativeIoLru = NULL;  /* open pooled handles, oldest. */
+static PHYSFS_uint32 nativeIoLimit = 0;  /* zero for no pooling. */
+static PHYSFS_NativeHandleStats nativeIoStats;
+
+/* MAKE SURE you hold nativeIoLock before calling any of these! */
+static void nativeIoUnlink(NativeIoInfo *info)
+{
+    if (info->prev != NULL)
+        info->prev->next = info->next;
+    else
+        nativeIoMru = info->next;
+
+    if (info->next != NULL)
+        info->next->prev = info->prev;
+    else
+        nativeIoLru = info->prev;
+
+    info->prev = info->next = NULL;
+} /* nativeIoUnlink */
+
+static void nativeIoLinkFirst(NativeIoInfo *info)
+{
+    info->prev = NULL;
+    info->next = nativeIoMru;
+    if (nativeIoMru != NULL)
+        nativeIoMru->prev = info;
+    else
+        nativeIoLru = info;
+    nativeIoMru = info;
+} /* nativeIoLinkFirst */
+
+static void nativeIoAddOpen(NativeIoInfo *info, void *handle)
+{
+    info->handle = handle;
+    nativeIoLinkFirst(info);
+    nativeIoStats.open++;
+    if (nativeIoStats.open > nativeIoStats.peakopen)
+        nativeIoStats.peakopen = nativeIoStats.open;
+} /* nativeIoAddOpen */
+
+/* Close idle pooled handles, oldest first, until (keep) or fewer are open. */
+static void nativeIoTrim(const PHYSFS_uint32 keep)
+{
+    NativeIoInfo *i = nativeIoLru;
+    while ((i != NULL) && (nativeIoStats.open > keep))
+    {
+        NativeIoInfo *prev = i->prev;
+        if (!i->busy)
+        {
+            const PHYSFS_sint64 pos = __PHYSFS_platformTell(i->handle);
+            if (pos >= 0)  /* if we can't tell, we can't reopen; leave it. */
+            {
+                nativeIoUnlink(i);
+                __PHYSFS_platformClose(i->handle);
+                i->handle = NULL;
+                i->pos = (PHYSFS_uint64) pos;
+                nativeIoStats.open--;
+                nativeIoStats.evictions++;
+            } /* if */
+        } /* if */
+        i = prev;
+    } /* while */
+} /* nativeIoTrim */
+
+static void nativeIoMakeRoom(void)
+{
+    if (nativeIoLimit > 0)
+        nativeIoTrim(nativeIoLimit - 1);
+} /* nativeIoMakeRoom */
+
+static int nativeIoSameFile(const __PHYSFS_FileId *a, const __PHYSFS_FileId *b)
+{
+    return ( (a->device == b->device) && (a->inode == b->inode) &&
+             (a->modtime == b->modtime) && (a->size == b->size) );
+} /* nativeIoSameFile */
+
+static int nativeIoReopen(NativeIoInfo *info)
+{
+    __PHYSFS_FileId id;
+    void *handle;
+
+    nativeIoMakeRoom();
+    handle = __PHYSFS_platformOpenRead(info->path);
+    BAIL_IF_ERRPASS(!handle, 0);
+
+    if (!__PHYSFS_platformFileId(handle, &id))
+        goto nativeIoReopen_failed;
+    else if (!nativeIoSameFile(&id, &info->id))
+    {
+        nativeIoStats.mismatches++;
+        PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);  /* replaced under us! */
+        goto nativeIoReopen_failed;
+    } /* else if */
+    else if (!__PHYSFS_platformSeek(handle, info->pos))
+        goto nativeIoReopen_failed;
+
+    nativeIoAddOpen(info, handle);
+    nativeIoStats.reopens++;
+    return 1;
+
+nativeIoReopen_failed:
+    __PHYSFS_platformClose(handle);
+    return 0;
+} /* nativeIoReopen */
+
+
+/*
+ * Get (info)'s OS handle for one operation, reopening it if the pool had
+ *  closed it. The pool won't close it again until nativeIoRelease().
+ */
+static void *nativeIoAcquire(NativeIoInfo *info)
+{
+    void *retval = NULL;
+
+    if (!info->pooled)
+        return info->handle;
+
+    __PHYSFS_platformGrabMutex(nativeIoLock);
+    if ((info->handle != NULL) || (nativeIoReopen(info)))
+    {
+        if (info != nativeIoMru)
+        {
+            nativeIoUnlink(info);
+            nativeIoLinkFirst(info);
+        } /* if */
+        info->busy = 1;
+        retval = info->handle;
+    } /* if */
+    __PHYSFS_platformReleaseMutex(nativeIoLock);
+
+    return retval;
+} /* nativeIoAcquire */
+
+static void nativeIoRelease(NativeIoInfo *info)
+{
+    if (info->pooled)
+    {
+        __PHYSFS_platformGrabMutex(nativeIoLock);
+        info->busy = 0;
+        __PHYSFS_platformReleaseMutex(nativeIoLock);
+    } /* if */
+} /* nativeIoRelease */
+
 static PHYSFS_sint64 nativeIo_read(PHYSFS_Io *io, void *buf, PHYSFS_uint64 len)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_platformRead(info->handle, buf, len);
+    void *handle = nativeIoAcquire(info);
+    PHYSFS_sint64 retval;
+    BAIL_IF_ERRPASS(!handle, -1);
+    retval = __PHYSFS_platformRead(handle, buf, len);
+    nativeIoRelease(info);
+    return retval;
 } /* nativeIo_read */
 
 static PHYSFS_sint64 nativeIo_write(PHYSFS_Io *io, const void *buffer,
                                     PHYSFS_uint64 len)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_platformWrite(info->handle, buffer, len);
+    void *handle = nativeIoAcquire(info);
+    PHYSFS_sint64 retval;
+    BAIL_IF_ERRPASS(!handle, -1);
+    retval = __PHYSFS_platformWrite(handle, buffer, len);
+    nativeIoRelease(info);
+    return retval;
 } /* nativeIo_write */
 
 static int nativeIo_seek(PHYSFS_Io *io, PHYSFS_uint64 offset)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_platformSeek(info->handle, offset);
+    void *handle = nativeIoAcquire(info);
+    int retval;
+    BAIL_IF_ERRPASS(!handle, 0);
+    retval = __PHYSFS_platformSeek(handle, offset);
+    nativeIoRelease(info);
+    return retval;
 } /* nativeIo_seek */
 
 static PHYSFS_sint64 nativeIo_tell(PHYSFS_Io *io)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_platformTell(info->handle);
+    void *handle = nativeIoAcquire(info);
+    PHYSFS_sint64 retval;
+    BAIL_IF_ERRPASS(!handle, -1);
+    retval = __PHYSFS_platformTell(handle);
+    nativeIoRelease(info);
+    return retval;
 } /* nativeIo_tell */
 
 static PHYSFS_sint64 nativeIo_length(PHYSFS_Io *io)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_platformFileLength(info->handle);
+    void *handle = nativeIoAcquire(info);
+    PHYSFS_sint64 retval;
+    BAIL_IF_ERRPASS(!handle, -1);
+    retval = __PHYSFS_platformFileLength(handle);
+    nativeIoRelease(info);
+    return retval;
 } /* nativeIo_length */
 
 static PHYSFS_Io *nativeIo_duplicate(PHYSFS_Io *io)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    return __PHYSFS_createNativeIo(info->path, info->mode);
+    PHYSFS_Io *retval = __PHYSFS_createNativeIo(info->path, info->mode);
+    BAIL_IF_ERRPASS(!retval, NULL);
+
+    if (info->pooled)
+    {
+        /* make sure the file wasn't replaced since we first opened it. */
+        const NativeIoInfo *dupe = (const NativeIoInfo *) retval->opaque;
+        if ((dupe->pooled) && (!nativeIoSameFile(&dupe->id, &info->id)))
+        {
+            retval->destroy(retval);
+            __PHYSFS_platformGrabMutex(nativeIoLock);
+            nativeIoStats.mismatches++;
+            __PHYSFS_platformReleaseMutex(nativeIoLock);
+            BAIL(PHYSFS_ERR_CORRUPT, NULL);
+        } /* if */
+    } /* if */
+
+    return retval;
 } /* nativeIo_duplicate */
 
 static int nativeIo_flush(PHYSFS_Io *io)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
+    if (info->pooled)
+        return 1;  /* only read handles are pooled; nothing to flush. */
     return __PHYSFS_platformFlush(info->handle);
 } /* nativeIo_flush */
 
 static void nativeIo_destroy(PHYSFS_Io *io)
 {
     NativeIoInfo *info = (NativeIoInfo *) io->opaque;
-    __PHYSFS_platformClose(info->handle);
+
+    if (info->pooled)
+    {
+        __PHYSFS_platformGrabMutex(nativeIoLock);
+        if (info->handle != NULL)
+        {
+            nativeIoUnlink(info);
+            nativeIoStats.open--;
+        } /* if */
+        nativeIoStats.pooled--;
+        __PHYSFS_platformReleaseMutex(nativeIoLock);
+    } /* if */
+
+    if (info->handle != NULL)
+        __PHYSFS_platformClose(info->handle);
     allocator.Free((void *) info->path);
     allocator.Free(info);
     allocator.Free(io);
@@ -196,11 +442,55 @@ static const PHYSFS_Io __PHYSFS_nativeIoInterface =
     nativeIo_destroy
 };
 
+/* Open (info)'s file for reading, as a pooled handle if there's a limit. */
+static int nativeIoOpenRead(NativeIoInfo *info, void *dirhandle,
+                            const char *relpath)
+{
+    void *handle;
+
+    if (nativeIoLimit == 0)  /* no pooling? Just open it. */
+    {
+        if (dirhandle != NULL)
+            info->handle = __PHYSFS_platformOpenAt(dirhandle, relpath, 'r');
+        else
+            info->handle = __PHYSFS_platformOpenRead(info->path);
+        return (info->handle != NULL);
+    } /* if */
+
+    __PHYSFS_platformGrabMutex(nativeIoLock);
+    nativeIoMakeRoom();
+    if (dirhandle != NULL)
+        handle = __PHYSFS_platformOpenAt(dirhandle, relpath, 'r');
+    else
+        handle = __PHYSFS_platformOpenRead(info->path);
+    if ((handle != NULL) && (!__PHYSFS_platformFileId(handle, &info->id)))
+    {
+        __PHYSFS_platformClose(handle);
+        handle = NULL;
+    } /* if */
+
+    if (handle != NULL)
+    {
+        info->pooled = 1;
+        nativeIoAddOpen(info, handle);
+        nativeIoStats.pooled++;
+    } /* if */
+    __PHYSFS_platformReleaseMutex(nativeIoLock);
+
+    return (handle != NULL);
+} /* nativeIoOpenRead */
+
 PHYSFS_Io *__PHYSFS_createNativeIo(const char *path, const int mode)
+{
+    return __PHYSFS_createNativeIoAt(NULL, NULL, path, mode);
+} /* __PHYSFS_createNativeIo */
+
+
+PHYSFS_Io *__PHYSFS_createNativeIoAt(void *dirhandle, const char *relpath,
+                                     const char *path, const int mode)
 {
     PHYSFS_Io *io = NULL;
     NativeIoInfo *info = NULL;
-    void *handle = NULL;
     char *pathdup = NULL;
 
     assert((mode == 'r') || (mode == 'w') || (mode == 'a'));
@@ -212,30 +502,69 @@ PHYSFS_Io *__PHYSFS_createNativeIo(const char *path, const int mode)
     pathdup = (char *) allocator.Malloc(strlen(path) + 1);
     GOTO_IF(!pathdup, PHYSFS_ERR_OUT_OF_MEMORY, createNativeIo_failed);
 
+    strcpy(pathdup, path);
+    memset(info, '\0', sizeof (NativeIoInfo));
+    info->path = pathdup;
+    info->mode = mode;
+
+    /* a pooled handle is live as soon as this succeeds; nothing can fail after it. */
     if (mode == 'r')
-        handle = __PHYSFS_platformOpenRead(path);
+    {
+        GOTO_IF_ERRPASS(!nativeIoOpenRead(info, dirhandle, relpath),
+                        createNativeIo_failed);
+    } /* if */
+    else if (dirhandle != NULL)
+        info->handle = __PHYSFS_platformOpenAt(dirhandle, relpath, mode);
     else if (mode == 'w')
-        handle = __PHYSFS_platformOpenWrite(path);
+        info->handle = __PHYSFS_platformOpenWrite(path);
     else if (mode == 'a')
-        handle = __PHYSFS_platformOpenAppend(path);
+        info->handle = __PHYSFS_platformOpenAppend(path);
 
-    GOTO_IF_ERRPASS(!handle, createNativeIo_failed);
+    GOTO_IF_ERRPASS(!info->pooled && !info->handle, createNativeIo_failed);
 
-    strcpy(pathdup, path);
-    info->handle = handle;
-    info->path = pathdup;
-    info->mode = mode;
     memcpy(io, &__PHYSFS_nativeIoInterface, sizeof (*io));
     io->opaque = info;
     return io;
 
 createNativeIo_failed:
-    if (handle != NULL) __PHYSFS_platformClose(handle);
     if (pathdup != NULL) allocator.Free(pathdup);
     if (info != NULL) allocator.Free(info);
     if (io != NULL) allocator.Free(io);
     return NULL;
-} /* __PHYSFS_createNativeIo */
+} /* __PHYSFS_createNativeIoAt */
+
+
+void PHYSFS_setNativeHandleLimit(PHYSFS_uint32 limit)
+{
+    if (!initialized)  /* no lock yet, but no open handles either. */
+    {
+        nativeIoLimit = limit;
+        return;
+    } /* if */
+
+    __PHYSFS_platformGrabMutex(nativeIoLock);
+    nativeIoLimit = limit;
+    if (limit > 0)
+        nativeIoTrim(limit);
+    __PHYSFS_platformReleaseMutex(nativeIoLock);
+} /* PHYSFS_setNativeHandleLimit */
+
+
+PHYSFS_uint32 PHYSFS_getNativeHandleLimit(void)
+{
+    return nativeIoLimit;
+} /* PHYSFS_getNativeHandleLimit */
+
+
+int PHYSFS_getNativeHandleStats(PHYSFS_NativeHandleStats *stats)
+{
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!stats, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    __PHYSFS_platformGrabMutex(nativeIoLock);
+    memcpy(stats, &nativeIoStats, sizeof (*stats));
+    __PHYSFS_platformReleaseMutex(nativeIoLock);
+    return 1;
+} /* PHYSFS_getNativeHandleStats */
 
 
 /* PHYSFS_Io implementation for i/o to a memory buffer... */
@@ -536,38 +865,145 @@ static PHYSFS_Io *__PHYSFS_createHandleIo(PHYSFS_File *f)
 
 /* functions ... */
 
+/*
+ * Lists we hand to the app are built here. Strings are packed into one
+ *  growing arena and we only track offsets into it, so adding one is
+ *  amortized O(1) no matter how long the list gets. finishStringList()
+ *  then puts the pointers and the strings in a single allocation, which is
+ *  all PHYSFS_freeList() has to release.
+ */
 typedef struct
 {
-    char **list;
-    PHYSFS_uint32 size;
+    size_t *offsets;  /* where each string starts in (arena). */
+    PHYSFS_uint32 size;  /* strings in the list so far. */
+    PHYSFS_uint32 capacity;  /* slots allocated in (offsets). */
+    char *arena;
+    size_t arenaused;
+    size_t arenasize;
     PHYSFS_ErrorCode errcode;
 } EnumStringListCallbackData;
 
-static void enumStringListCallback(void *data, const char *str)
+static int addToStringList(EnumStringListCallbackData *pecd, const char *str)
 {
-    void *ptr;
-    char *newstr;
-    EnumStringListCallbackData *pecd = (EnumStringListCallbackData *) data;
+    const size_t len = strlen(str) + 1;
 
-    if (pecd->errcode)
-        return;
+    if (pecd->size == pecd->capacity)
+    {
+        const PHYSFS_uint32 newcap = pecd->capacity ? pecd->capacity * 2 : 64;
+        void *ptr = allocator.Realloc(pecd->offsets, newcap * sizeof (size_t));
+        if (!ptr)
+        {
+            pecd->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+            return 0;
+        } /* if */
+        pecd->offsets = (size_t *) ptr;
+        pecd->capacity = newcap;
+    } /* if */
 
-    ptr = allocator.Realloc(pecd->list, (pecd->size + 2) * sizeof (char *));
-    newstr = (char *) allocator.Malloc(strlen(str) + 1);
-    if (ptr != NULL)
-        pecd->list = (char **) ptr;
+    if ((pecd->arenasize - pecd->arenaused) < len)
+    {
+        size_t newsize = pecd->arenasize ? pecd->arenasize * 2 : 1024;
+        void *ptr;
+        while ((newsize - pecd->arenaused) < len)
+            newsize *= 2;
+        ptr = allocator.Realloc(pecd->arena, newsize);
+        if (!ptr)
+        {
+            pecd->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+            return 0;
+        } /* if */
+        pecd->arena = (char *) ptr;
+        pecd->arenasize = newsize;
+    } /* if */
+
+    memcpy(pecd->arena + pecd->arenaused, str, len);
+    pecd->offsets[pecd->size++] = pecd->arenaused;
+    pecd->arenaused += len;
+    return 1;
+} /* addToStringList */
+
+
+static void freeStringListData(EnumStringListCallbackData *pecd)
+{
+    allocator.Free(pecd->offsets);
+    allocator.Free(pecd->arena);
+    pecd->offsets = NULL;
+    pecd->arena = NULL;
+} /* freeStringListData */
+
+
+static int stringListCmp(void *_a, size_t one, size_t two)
+{
+    const EnumStringListCallbackData *pecd = (EnumStringListCallbackData *) _a;
+    return strcmp(pecd->arena + pecd->offsets[one],
+                  pecd->arena + pecd->offsets[two]);
+} /* stringListCmp */
 
-    if ((ptr == NULL) || (newstr == NULL))
+
+static void stringListSwap(void *_a, size_t one, size_t two)
+{
+    EnumStringListCallbackData *pecd = (EnumStringListCallbackData *) _a;
+    const size_t tmp = pecd->offsets[one];
+    pecd->offsets[one] = pecd->offsets[two];
+    pecd->offsets[two] = tmp;
+} /* stringListSwap */
+
+
+/* sort and dedupe the list first if (sorted). Frees (pecd)'s buffers. */
+static char **finishStringList(EnumStringListCallbackData *pecd,
+                               const int sorted)
+{
+    char **retval;
+    char *strs;
+    PHYSFS_uint32 i;
+
+    if ((sorted) && (pecd->size > 1))
     {
-        pecd->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
-        pecd->list[pecd->size] = NULL;
-        PHYSFS_freeList(pecd->list);
-        return;
+        PHYSFS_uint32 total = 1;
+
+        /* one archive's names usually arrive in order already. */
+        for (i = 1; i < pecd->size; i++)
+        {
+            if (stringListCmp(pecd, i - 1, i) > 0)
+            {
+                __PHYSFS_sort(pecd, pecd->size, stringListCmp, stringListSwap);
+                break;
+            } /* if */
+        } /* for */
+
+        for (i = 1; i < pecd->size; i++)
+        {
+            if (stringListCmp(pecd, total - 1, i) != 0)
+                pecd->offsets[total++] = pecd->offsets[i];
+        } /* for */
+        pecd->size = total;
     } /* if */
 
-    strcpy(newstr, str);
-    pecd->list[pecd->size] = newstr;
-    pecd->size++;
+    retval = (char **) allocator.Malloc(((pecd->size + 1) * sizeof (char *)) +
+                                        pecd->arenaused);
+    if (!retval)
+    {
+        freeStringListData(pecd);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    } /* if */
+
+    strs = (char *) (retval + pecd->size + 1);
+    if (pecd->arenaused > 0)
+        memcpy(strs, pecd->arena, pecd->arenaused);
+    for (i = 0; i < pecd->size; i++)
+        retval[i] = strs + pecd->offsets[i];
+    retval[pecd->size] = NULL;
+
+    freeStringListData(pecd);
+    return retval;
+} /* finishStringList */
+
+
+static void enumStringListCallback(void *data, const char *str)
+{
+    EnumStringListCallbackData *pecd = (EnumStringListCallbackData *) data;
+    if (!pecd->errcode)
+        addToStringList(pecd, str);
 } /* enumStringListCallback */
 
 
@@ -575,18 +1011,16 @@ static char **doEnumStringList(void (*func)(PHYSFS_StringCallback, void *))
 {
     EnumStringListCallbackData ecd;
     memset(&ecd, '\0', sizeof (ecd));
-    ecd.list = (char **) allocator.Malloc(sizeof (char *));
-    BAIL_IF(!ecd.list, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
     func(enumStringListCallback, &ecd);
 
     if (ecd.errcode)
     {
+        freeStringListData(&ecd);
         PHYSFS_setErrorCode(ecd.errcode);
         return NULL;
     } /* if */
 
-    ecd.list[ecd.size] = NULL;
-    return ecd.list;
+    return finishStringList(&ecd, 0);
 } /* doEnumStringList */
 
 
@@ -757,6 +1191,8 @@ void PHYSFS_setErrorCode(PHYSFS_ErrorCode errcode)
 
     if (!errcode)
         return;
+    else if (allocator.Malloc == NULL)
+        return;  /* before PHYSFS_init(), there's nowhere to keep it. */
 
     err = findErrorForCurrentThread();
     if (err == NULL)
@@ -1021,7 +1457,7 @@ static int partOfMountPoint(DirHandle *h, char *fname)
     if ((len + 1) == mntpntlen)
         return 0;
 
-    rc = strncmp(fname, h->mountPoint, len); /* !!! FIXME: case insensitive? */
+    rc = strncmp(fname, h->mountPoint, len);  /* case-sensitive. */
     if (rc != 0)
         return 0;  /* not a match. */
 
@@ -1030,1602 +1466,4806 @@ static int partOfMountPoint(DirHandle *h, char *fname)
 } /* partOfMountPoint */
 
 
-static DirHandle *createDirHandle(PHYSFS_Io *io, const char *newDir,
-                                  const char *mountPoint, int forWriting)
-{
-    DirHandle *dirHandle = NULL;
-    char *tmpmntpnt = NULL;
+/*
+ * Lookup filters: a Bloom filter per archive over every path in it, so
+ *  lookups can skip archives that definitely don't have a file without
+ *  asking the archiver. Paths are hashed with ASCII case folding, so
+ *  case-insensitive archivers don't get false negatives. Archives with
+ *  non-ASCII paths don't get a filter: full UTF-8 case folding can match
+ *  strings of different lengths, which a hash of the path can't see.
+ */
+#define LOOKUP_FILTER_HASH_INIT ((PHYSFS_uint64) 0xCBF29CE484222325ULL)
 
-    assert(newDir != NULL);  /* should have caught this higher up. */
+/* 64-bit FNV-1a over (len) bytes of (str), folding ASCII to lowercase.
+    Clears (*ascii) if it sees a byte that isn't 7-bit ASCII. */
+static PHYSFS_uint64 lookupFilterHash(PHYSFS_uint64 hash, const char *str,
+                                      size_t len, int *ascii)
+{
+    const PHYSFS_uint8 *ptr = (const PHYSFS_uint8 *) str;
+    const PHYSFS_uint8 *end = ptr + len;
+    PHYSFS_uint8 orbits = 0;
 
-    if (mountPoint != NULL)
+    while (ptr < end)
     {
-        const size_t len = strlen(mountPoint) + 1;
-        tmpmntpnt = (char *) __PHYSFS_smallAlloc(len);
-        GOTO_IF(!tmpmntpnt, PHYSFS_ERR_OUT_OF_MEMORY, badDirHandle);
-        if (!sanitizePlatformIndependentPath(mountPoint, tmpmntpnt))
-            goto badDirHandle;
-        mountPoint = tmpmntpnt;  /* sanitized version. */
-    } /* if */
+        PHYSFS_uint8 ch = *(ptr++);
+        orbits |= ch;
+        if ((ch >= 'A') && (ch <= 'Z'))
+            ch += 'a' - 'A';
+        hash ^= ch;
+        hash *= (PHYSFS_uint64) 0x100000001B3ULL;
+    } /* while */
 
-    dirHandle = openDirectory(io, newDir, forWriting);
-    GOTO_IF_ERRPASS(!dirHandle, badDirHandle);
+    if (orbits & 0x80)
+        *ascii = 0;
 
-    dirHandle->dirName = (char *) allocator.Malloc(strlen(newDir) + 1);
-    GOTO_IF(!dirHandle->dirName, PHYSFS_ERR_OUT_OF_MEMORY, badDirHandle);
-    strcpy(dirHandle->dirName, newDir);
+    return hash;
+} /* lookupFilterHash */
 
-    if ((mountPoint != NULL) && (*mountPoint != '\0'))
+
+/* Double hashing: bit (i) is h1 + i*h2, mapped into range without a divide. */
+#define LOOKUP_FILTER_BIT(dh, h1, h2, i) \
+    ((PHYSFS_uint32) ((((PHYSFS_uint64) ((PHYSFS_uint32) ((h1) + (i) * (h2)))) \
+        * (dh)->filterbits) >> 32))
+
+static void lookupFilterSet(DirHandle *dh, const PHYSFS_uint64 hash)
+{
+    const PHYSFS_uint32 h1 = (PHYSFS_uint32) hash;
+    const PHYSFS_uint32 h2 = ((PHYSFS_uint32) (hash >> 32)) | 1;
+    PHYSFS_uint32 i;
+
+    for (i = 0; i < dh->filterhashes; i++)
     {
-        dirHandle->mountPoint = (char *)allocator.Malloc(strlen(mountPoint)+2);
-        if (!dirHandle->mountPoint)
-            GOTO(PHYSFS_ERR_OUT_OF_MEMORY, badDirHandle);
-        strcpy(dirHandle->mountPoint, mountPoint);
-        strcat(dirHandle->mountPoint, "/");
-    } /* if */
+        const PHYSFS_uint32 bit = LOOKUP_FILTER_BIT(dh, h1, h2, i);
+        dh->filter[bit >> 3] |= (PHYSFS_uint8) (1 << (bit & 7));
+    } /* for */
+} /* lookupFilterSet */
 
-    __PHYSFS_smallFree(tmpmntpnt);
-    return dirHandle;
 
-badDirHandle:
-    if (dirHandle != NULL)
+static int lookupFilterTest(const DirHandle *dh, const PHYSFS_uint64 hash)
+{
+    const PHYSFS_uint32 h1 = (PHYSFS_uint32) hash;
+    const PHYSFS_uint32 h2 = ((PHYSFS_uint32) (hash >> 32)) | 1;
+    PHYSFS_uint32 i;
+
+    for (i = 0; i < dh->filterhashes; i++)
     {
-        dirHandle->funcs->closeArchive(dirHandle->opaque);
-        allocator.Free(dirHandle->dirName);
-        allocator.Free(dirHandle->mountPoint);
-        allocator.Free(dirHandle);
-    } /* if */
+        const PHYSFS_uint32 bit = LOOKUP_FILTER_BIT(dh, h1, h2, i);
+        if ((dh->filter[bit >> 3] & (1 << (bit & 7))) == 0)
+            return 0;
+    } /* for */
 
-    __PHYSFS_smallFree(tmpmntpnt);
-    return NULL;
-} /* createDirHandle */
+    return 1;
+} /* lookupFilterTest */
 
 
-/* MAKE SURE you've got the stateLock held before calling this! */
-static int freeDirHandle(DirHandle *dh, FileHandle *openList)
+typedef struct
 {
-    FileHandle *i;
+    DirHandle *dh;
+    PHYSFS_uint64 *hashes;
+    size_t count;
+    size_t allocated;
+    int unusable;
+} LookupFilterBuildData;
+
+static PHYSFS_EnumerateCallbackResult lookupFilterBuildCallback(void *_data,
+                                        const char *origdir, const char *fname)
+{
+    LookupFilterBuildData *data = (LookupFilterBuildData *) _data;
+    const PHYSFS_Archiver *funcs = data->dh->funcs;
+    const size_t dirlen = strlen(origdir);
+    const size_t len = dirlen + strlen(fname) + 2;
+    PHYSFS_EnumerateCallbackResult rc;
+    int ascii = 1;
+    char *path;
+
+    if (data->count == data->allocated)
+    {
+        const size_t newalloc = data->allocated ? data->allocated * 2 : 128;
+        void *ptr = allocator.Realloc(data->hashes,
+                                      newalloc * sizeof (PHYSFS_uint64));
+        if (!ptr)
+        {
+            data->unusable = 1;
+            BAIL(PHYSFS_ERR_OUT_OF_MEMORY, PHYSFS_ENUM_ERROR);
+        } /* if */
+        data->hashes = (PHYSFS_uint64 *) ptr;
+        data->allocated = newalloc;
+    } /* if */
 
-    if (dh == NULL)
-        return 1;
+    path = (char *) __PHYSFS_smallAlloc(len);
+    if (!path)
+    {
+        data->unusable = 1;
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, PHYSFS_ENUM_ERROR);
+    } /* if */
 
-    for (i = openList; i != NULL; i = i->next)
-        BAIL_IF(i->dirHandle == dh, PHYSFS_ERR_FILES_STILL_OPEN, 0);
+    if (dirlen == 0)
+        strcpy(path, fname);
+    else
+        snprintf(path, len, "%s/%s", origdir, fname);
 
-    dh->funcs->closeArchive(dh->opaque);
+    data->hashes[data->count++] = lookupFilterHash(LOOKUP_FILTER_HASH_INIT,
+                                                   path, strlen(path), &ascii);
+    if (!ascii)
+    {
+        __PHYSFS_smallFree(path);
+        data->unusable = 1;
+        return PHYSFS_ENUM_STOP;
+    } /* if */
 
-    if (dh->root) allocator.Free(dh->root);
-    allocator.Free(dh->dirName);
-    allocator.Free(dh->mountPoint);
-    allocator.Free(dh);
-    return 1;
-} /* freeDirHandle */
+    /* files enumerate to nothing, so this doesn't need a stat() per entry. */
+    rc = funcs->enumerate(data->dh->opaque, path, lookupFilterBuildCallback,
+                          path, data);
+    __PHYSFS_smallFree(path);
 
+    if (rc == PHYSFS_ENUM_ERROR)
+        data->unusable = 1;  /* a missing subtree means false negatives. */
 
-static char *calculateBaseDir(const char *argv0)
-{
-    const char dirsep = __PHYSFS_platformDirSeparator;
-    char *retval = NULL;
-    char *ptr = NULL;
+    return data->unusable ? PHYSFS_ENUM_STOP : PHYSFS_ENUM_OK;
+} /* lookupFilterBuildCallback */
 
-    /* Give the platform layer first shot at this. */
-    retval = __PHYSFS_platformCalcBaseDir(argv0);
-    if (retval != NULL)
-        return retval;
 
-    /* We need argv0 to go on. */
-    BAIL_IF(argv0 == NULL, PHYSFS_ERR_ARGV0_IS_NULL, NULL);
+/*
+ * Build (dh)'s lookup filter, sized for the current lookupFilterBits. Real
+ *  directories aren't filtered, since their contents can change under us.
+ *  If anything goes wrong, (dh) is marked unusable and lookups just skip the
+ *  filter; this never fails the caller.
+ */
+static void buildLookupFilter(DirHandle *dh)
+{
+    LookupFilterBuildData data;
+    const PHYSFS_uint32 bitsPerEntry = lookupFilterBits;
+    PHYSFS_uint64 bits;
+    PHYSFS_uint32 hashes;
+    size_t i;
 
-    ptr = strrchr(argv0, dirsep);
-    if (ptr != NULL)
-    {
-        const size_t size = ((size_t) (ptr - argv0)) + 1;
-        retval = (char *) allocator.Malloc(size + 1);
-        BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
-        memcpy(retval, argv0, size);
-        retval[size] = '\0';
-        return retval;
-    } /* if */
+    assert(dh->filterstate == LOOKUP_FILTER_NONE);
+    dh->filterstate = LOOKUP_FILTER_UNUSABLE;  /* until proven otherwise. */
 
-    /* argv0 wasn't helpful. */
-    BAIL(PHYSFS_ERR_INVALID_ARGUMENT, NULL);
-} /* calculateBaseDir */
+    if ((bitsPerEntry == 0) || (dh->funcs == &__PHYSFS_Archiver_DIR))
+        return;
 
+    memset(&data, '\0', sizeof (data));
+    data.dh = dh;
+    if (dh->funcs->enumerate(dh->opaque, "", lookupFilterBuildCallback,
+                             "", &data) == PHYSFS_ENUM_ERROR)
+        data.unusable = 1;
 
-static int initializeMutexes(void)
-{
-    errorLock = __PHYSFS_platformCreateMutex();
-    if (errorLock == NULL)
-        goto initializeMutexes_failed;
+    bits = ((PHYSFS_uint64) data.count) * bitsPerEntry;
+    bits = (bits + 63) & ~((PHYSFS_uint64) 63);
+    if (bits < 64)
+        bits = 64;
+    else if (bits > 0xFFFFFFC0)
+        data.unusable = 1;  /* absurdly large archive; don't bother. */
 
-    stateLock = __PHYSFS_platformCreateMutex();
-    if (stateLock == NULL)
-        goto initializeMutexes_failed;
+    if (!data.unusable)
+    {
+        dh->filter = (PHYSFS_uint8 *) allocator.Malloc((size_t) (bits / 8));
+        if (dh->filter != NULL)
+        {
+            /* k = bits-per-entry * ln(2) minimizes the false positive rate. */
+            hashes = (PHYSFS_uint32) ((bitsPerEntry * 693 + 500) / 1000);
+            if (hashes < 1)
+                hashes = 1;
+            else if (hashes > 16)
+                hashes = 16;
+
+            memset(dh->filter, '\0', (size_t) (bits / 8));
+            dh->filterbits = (PHYSFS_uint32) bits;
+            dh->filterhashes = hashes;
+            for (i = 0; i < data.count; i++)
+                lookupFilterSet(dh, data.hashes[i]);
+            dh->filterstate = LOOKUP_FILTER_READY;
+        } /* if */
+    } /* if */
 
-    return 1;  /* success. */
+    allocator.Free(data.hashes);
+} /* buildLookupFilter */
 
-initializeMutexes_failed:
-    if (errorLock != NULL)
-        __PHYSFS_platformDestroyMutex(errorLock);
 
-    if (stateLock != NULL)
-        __PHYSFS_platformDestroyMutex(stateLock);
+static void freeLookupFilter(DirHandle *dh)
+{
+    allocator.Free(dh->filter);
+    dh->filter = NULL;
+    dh->filterbits = 0;
+    dh->filterhashes = 0;
+    dh->filterstate = LOOKUP_FILTER_NONE;
+} /* freeLookupFilter */
 
-    errorLock = stateLock = NULL;
-    return 0;  /* failed. */
-} /* initializeMutexes */
 
+/* One lookup's state across the search path, so a path is hashed once. */
+typedef struct
+{
+    const char *hashed;  /* archive path (hash) is for, NULL if none yet. */
+    PHYSFS_uint64 hash;
+    int ascii;
+    int skippedlast;  /* non-zero if the last archive tried was skipped. */
+} LookupFilterKey;
 
-static int doRegisterArchiver(const PHYSFS_Archiver *_archiver);
+static void initLookupFilterKey(LookupFilterKey *key)
+{
+    key->hashed = NULL;
+    key->hash = 0;
+    key->ascii = 1;
+    key->skippedlast = 0;
+} /* initLookupFilterKey */
 
-static int initStaticArchivers(void)
+
+/* Start (key) off with (fname)'s hash, if PHYSFS_compilePath() has it. */
+static void primeLookupFilterKey(LookupFilterKey *key, const char *fname,
+                                 const PHYSFS_uint64 hash, const int ascii)
 {
-    #define REGISTER_STATIC_ARCHIVER(arc) { \
-        if (!doRegisterArchiver(&__PHYSFS_Archiver_##arc)) { \
-            return 0; \
-        } \
-    }
+    key->hashed = fname;
+    key->hash = hash;
+    key->ascii = ascii;
+} /* primeLookupFilterKey */
 
-    #if PHYSFS_SUPPORTS_ZIP
-        REGISTER_STATIC_ARCHIVER(ZIP);
-    #endif
-    #if PHYSFS_SUPPORTS_7Z
-        SZIP_global_init();
-        REGISTER_STATIC_ARCHIVER(7Z);
-    #endif
-    #if PHYSFS_SUPPORTS_GRP
-        REGISTER_STATIC_ARCHIVER(GRP);
-    #endif
-    #if PHYSFS_SUPPORTS_QPAK
-        REGISTER_STATIC_ARCHIVER(QPAK);
-    #endif
-    #if PHYSFS_SUPPORTS_HOG
-        REGISTER_STATIC_ARCHIVER(HOG);
-    #endif
-    #if PHYSFS_SUPPORTS_MVL
-        REGISTER_STATIC_ARCHIVER(MVL);
-    #endif
-    #if PHYSFS_SUPPORTS_WAD
-        REGISTER_STATIC_ARCHIVER(WAD);
-    #endif
-    #if PHYSFS_SUPPORTS_CSM
-        REGISTER_STATIC_ARCHIVER(CSM);
-    #endif
-    #if PHYSFS_SUPPORTS_TAR
-        REGISTER_STATIC_ARCHIVER(TAR);
-    #endif
-    #if PHYSFS_SUPPORTS_SLB
-        REGISTER_STATIC_ARCHIVER(SLB);
-    #endif
-    #if PHYSFS_SUPPORTS_ISO9660
-        REGISTER_STATIC_ARCHIVER(ISO9660);
-    #endif
-    #if PHYSFS_SUPPORTS_VDF
-        REGISTER_STATIC_ARCHIVER(VDF)
-    #endif
-    #if PHYSFS_SUPPORTS_LECARCHIVES
-        REGISTER_STATIC_ARCHIVER(GOB)
-        REGISTER_STATIC_ARCHIVER(LFD)
-        REGISTER_STATIC_ARCHIVER(LAB)
-    #endif
 
-    #undef REGISTER_STATIC_ARCHIVER
+/*
+ * Returns zero if (h) definitely doesn't have (fname), a sanitized path in
+ *  the virtual tree, so the caller can skip it without touching the archiver.
+ *  Non-zero if it might. Builds (h)'s filter first if it doesn't have one yet.
+ *  MAKE SURE you've got the stateLock held before calling this!
+ */
+static int lookupFilterMightHave(DirHandle *h, const char *fname,
+                                 LookupFilterKey *key)
+{
+    const char *dollar;
+    PHYSFS_uint64 prefix = LOOKUP_FILTER_HASH_INIT;
+    PHYSFS_uint64 hash;
+    int ascii = 1;
 
-    return 1;
-} /* initStaticArchivers */
+    key->skippedlast = 0;
 
+    if (lookupFilterBits == 0)
+        return 1;  /* filters are off. */
+    else if (h->filterstate == LOOKUP_FILTER_NONE)
+        buildLookupFilter(h);
 
-static void setDefaultAllocator(void);
-static int doDeinit(void);
+    if (h->filterstate != LOOKUP_FILTER_READY)
+        return 1;
 
-int PHYSFS_init(const char *argv0)
-{
-    BAIL_IF(initialized, PHYSFS_ERR_IS_INITIALIZED, 0);
+    if (h->mountPoint != NULL)  /* same checks as verifyPath(). */
+    {
+        const size_t mntpntlen = h->mountPointLen - 1;
+        if (strncmp(h->mountPoint, fname, mntpntlen) != 0)
+            return 1;  /* not under the mountpoint; let verifyPath() say so. */
+        fname += mntpntlen;
+        if (*fname == '/')
+            fname++;
+        else if (*fname != '\0')
+            return 1;
+    } /* if */
 
-    if (!externalAllocator)
-        setDefaultAllocator();
+    if (h->root)
+    {
+        prefix = lookupFilterHash(prefix, h->root, h->rootlen, &ascii);
+        if (*fname)
+            prefix = lookupFilterHash(prefix, "/", 1, &ascii);
+        hash = lookupFilterHash(prefix, fname, strlen(fname), &ascii);
+    } /* if */
+    else if (*fname == '\0')
+    {
+        return 1;  /* the archive's root directory is always there. */
+    } /* else if */
+    else if (key->hashed == fname)  /* same archive path as last time. */
+    {
+        hash = key->hash;
+        ascii = key->ascii;
+    } /* else if */
+    else
+    {
+        hash = lookupFilterHash(prefix, fname, strlen(fname), &ascii);
+        key->hashed = fname;
+        key->hash = hash;
+        key->ascii = ascii;
+    } /* else */
 
-    if ((allocator.Init != NULL) && (!allocator.Init())) return 0;
+    if (!ascii)
+        return 1;  /* might case-fold to an ASCII path; see above. */
 
-    if (!__PHYSFS_platformInit(argv0))
+    if (!lookupFilterTest(h, hash))
     {
-        if (allocator.Deinit != NULL) allocator.Deinit();
-        return 0;
+        /* zip takes "file$password" for encrypted files; try "file" too. */
+        dollar = strrchr(fname, '$');
+        if (dollar != NULL)
+            hash = lookupFilterHash(prefix, fname, dollar - fname, &ascii);
+        if ((dollar == NULL) || !lookupFilterTest(h, hash))
+        {
+            lookupFilterSkipped++;
+            key->skippedlast = 1;
+            return 0;
+        } /* if */
     } /* if */
 
-    /* everything below here can be cleaned up safely by doDeinit(). */
+    lookupFilterChecked++;
+    return 1;
+} /* lookupFilterMightHave */
 
-    if (!initializeMutexes()) goto initFailed;
 
-    baseDir = calculateBaseDir(argv0);
-    if (!baseDir) goto initFailed;
+/*
+ * The mount tree has one node per path element of every mount point, and
+ *  each node lists the archives mounted exactly there, in search path order.
+ *  A lookup walks its path down the tree and only visits archives mounted at
+ *  or above that path, instead of checking every archive's mount point.
+ *  The tree is rebuilt on the first lookup after the search path changes.
+ *  If that fails, or mount points nest absurdly deep, lookups scan the
+ *  whole search path like they always have.
+ */
+#define MOUNT_TREE_MAX_DEPTH 32
 
-    userDir = __PHYSFS_platformCalcUserDir();
-    if (!userDir) goto initFailed;
+typedef struct MountNode
+{
+    const char *name;  /* path element (points into a mountPoint string). */
+    size_t namelen;  /* (name) isn't null-terminated. */
+    DirHandle **handles;  /* mounted exactly here, in search path order. */
+    size_t numhandles;
+    DirHandle *firstbelow;  /* first archive searched that's mounted below. */
+    struct MountNode **kids;  /* sorted by name. */
+    size_t numkids;
+} MountNode;
 
-    /* Platform layer is required to append a dirsep. */
-    #ifndef __ANDROID__  /* it's an APK file, not a directory, on Android. */
-    assert(baseDir[strlen(baseDir) - 1] == __PHYSFS_platformDirSeparator);
-    #endif
-    assert(userDir[strlen(userDir) - 1] == __PHYSFS_platformDirSeparator);
+static MountNode *mountTree = NULL;
+static int mountTreeDirty = 1;
+static PHYSFS_uint32 mountTreeGeneration = 0;  /* bumped on every rebuild. */
 
-    if (!initStaticArchivers()) goto initFailed;
+static void freeMountNode(MountNode *node)
+{
+    size_t i;
+    for (i = 0; i < node->numkids; i++)
+        freeMountNode(node->kids[i]);
+    allocator.Free(node->kids);
+    allocator.Free(node->handles);
+    allocator.Free(node);
+} /* freeMountNode */
 
-    initialized = 1;
 
-    /* This makes sure that the error subsystem is initialized. */
-    PHYSFS_setErrorCode(PHYSFS_getLastErrorCode());
+/* MAKE SURE you hold stateLock before calling this! */
+static void invalidateMountTree(void)
+{
+    if (mountTree != NULL)
+        freeMountNode(mountTree);
+    mountTree = NULL;
+    mountTreeDirty = 1;
+} /* invalidateMountTree */
 
-    return 1;
 
-initFailed:
-    doDeinit();
-    return 0;
-} /* PHYSFS_init */
+/* Binary search; if not found, (*_pos) is where (name) would go. */
+static MountNode *findMountNodeKid(const MountNode *node, const char *name,
+                                   const size_t len, size_t *_pos)
+{
+    size_t lo = 0;
+    size_t hi = node->numkids;
 
+    while (lo < hi)
+    {
+        const size_t middle = lo + ((hi - lo) / 2);
+        const MountNode *kid = node->kids[middle];
+        int rc = memcmp(kid->name, name, (kid->namelen < len) ? kid->namelen : len);
+        if (rc == 0)
+            rc = (kid->namelen < len) ? -1 : (kid->namelen > len) ? 1 : 0;
+
+        if (rc == 0)
+            return node->kids[middle];
+        else if (rc < 0)
+            lo = middle + 1;
+        else
+            hi = middle;
+    } /* while */
 
-/* MAKE SURE you hold stateLock before calling this! */
-static int closeFileHandleList(FileHandle **list)
+    if (_pos != NULL)
+        *_pos = lo;
+    return NULL;
+} /* findMountNodeKid */
+
+
+static int addToMountTree(MountNode *node, DirHandle *dh)
 {
-    FileHandle *i;
-    FileHandle *next = NULL;
+    const char *ptr = dh->mountPoint;  /* "a/b/" form, NULL for root. */
+    size_t depth = 0;
+    void *newptr;
 
-    for (i = *list; i != NULL; i = next)
+    while ((ptr != NULL) && (*ptr != '\0'))
     {
-        PHYSFS_Io *io = i->io;
-        next = i->next;
+        const char *end = strchr(ptr, '/');  /* always there; see above. */
+        const size_t len = (size_t) (end - ptr);
+        MountNode *kid;
+        size_t pos = 0;
 
-        if (io->flush && !io->flush(io))
+        if (++depth > MOUNT_TREE_MAX_DEPTH)
+            return 0;  /* caller falls back to scanning the search path. */
+
+        if (node->firstbelow == NULL)
+            node->firstbelow = dh;
+
+        kid = findMountNodeKid(node, ptr, len, &pos);
+        if (kid == NULL)
         {
-            *list = i;
-            return 0;
+            newptr = allocator.Realloc(node->kids,
+                                (node->numkids + 1) * sizeof (MountNode *));
+            BAIL_IF(!newptr, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+            node->kids = (MountNode **) newptr;
+
+            kid = (MountNode *) allocator.Malloc(sizeof (MountNode));
+            BAIL_IF(!kid, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+            memset(kid, '\0', sizeof (MountNode));
+            kid->name = ptr;
+            kid->namelen = len;
+
+            memmove(&node->kids[pos + 1], &node->kids[pos],
+                    (node->numkids - pos) * sizeof (MountNode *));
+            node->kids[pos] = kid;
+            node->numkids++;
         } /* if */
 
-        io->destroy(io);
-        allocator.Free(i);
-    } /* for */
+        node = kid;
+        ptr = end + 1;
+    } /* while */
 
-    *list = NULL;
+    newptr = allocator.Realloc(node->handles,
+                               (node->numhandles + 1) * sizeof (DirHandle *));
+    BAIL_IF(!newptr, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    node->handles = (DirHandle **) newptr;
+    node->handles[node->numhandles++] = dh;
     return 1;
-} /* closeFileHandleList */
+} /* addToMountTree */
 
 
-/* MAKE SURE you hold the stateLock before calling this! */
-static void freeSearchPath(void)
+/* Returns NULL if there's no usable tree. Hold stateLock to call this! */
+static MountNode *getMountTree(void)
 {
-    DirHandle *i;
-    DirHandle *next = NULL;
-
-    closeFileHandleList(&openReadList);
-
-    if (searchPath != NULL)
+    if (mountTreeDirty)
     {
-        for (i = searchPath; i != NULL; i = next)
+        MountNode *root = (MountNode *) allocator.Malloc(sizeof (MountNode));
+        mountTreeDirty = 0;  /* don't retry until the search path changes. */
+        if (++mountTreeGeneration == 0)
+            mountTreeGeneration = 1;  /* zero means "never walked" below. */
+        if (root != NULL)
         {
-            next = i->next;
-            freeDirHandle(i, openReadList);
-        } /* for */
-        searchPath = NULL;
+            size_t idx = 0;
+            DirHandle *i;
+
+            memset(root, '\0', sizeof (MountNode));
+            for (i = searchPath; i != NULL; i = i->next)
+            {
+                i->searchidx = idx++;
+                if (!addToMountTree(root, i))
+                {
+                    freeMountNode(root);
+                    root = NULL;
+                    break;
+                } /* if */
+            } /* for */
+        } /* if */
+        mountTree = root;
     } /* if */
-} /* freeSearchPath */
 
+    return mountTree;
+} /* getMountTree */
 
-/* MAKE SURE you hold stateLock before calling this! */
-static int archiverInUse(const PHYSFS_Archiver *arc, const DirHandle *list)
+
+typedef struct
 {
-    const DirHandle *i;
-    for (i = list; i != NULL; i = i->next)
+    MountNode *nodes[MOUNT_TREE_MAX_DEPTH + 1];  /* root first. */
+    size_t pos[MOUNT_TREE_MAX_DEPTH + 1];  /* next handle in each node. */
+    size_t numnodes;  /* zero if there's no mount tree. */
+    DirHandle *below;  /* first archive mounted below the path itself. */
+    DirHandle *linear;  /* next archive, if there's no mount tree. */
+    DirHandle *last;  /* last archive returned. */
+    int lastmatched;  /* non-zero if the tree matched (last)'s mount point. */
+} MountCursor;
+
+
+/* What PHYSFS_compilePath() works out once, so lookups don't redo it. */
+struct PHYSFS_Path
+{
+    char *path;  /* sanitized, points past (nodes). */
+    size_t len;  /* strlen(path). */
+    PHYSFS_uint64 hash;  /* lookup filter hash of (path). */
+    int ascii;  /* lookup filter hash's (ascii) flag. */
+    PHYSFS_uint32 treegen;  /* mountTreeGeneration the walk is from, or 0. */
+    size_t numnodes;  /* the last mount tree walk; see firstMountCandidate(). */
+    DirHandle *below;
+    MountNode **nodes;  /* room for one node per path element, plus root. */
+};
+
+static DirHandle *nextMountCandidate(MountCursor *c)
+{
+    DirHandle *retval = NULL;
+    size_t best = 0;
+    size_t i;
+
+    c->lastmatched = 0;
+
+    if (c->numnodes == 0)  /* no mount tree, visit everything. */
     {
-        if (i->funcs == arc)
-            return 1;
-    } /* for */
+        retval = c->linear;
+        if (retval != NULL)
+            c->linear = retval->next;
+    } /* if */
 
-    return 0;  /* not in use */
-} /* archiverInUse */
+    else
+    {
+        /* merge the nodes' lists; there's one per path element at most. */
+        for (i = 0; i < c->numnodes; i++)
+        {
+            if (c->pos[i] < c->nodes[i]->numhandles)
+            {
+                DirHandle *h = c->nodes[i]->handles[c->pos[i]];
+                if ((retval == NULL) || (h->searchidx < retval->searchidx))
+                {
+                    retval = h;
+                    best = i;
+                } /* if */
+            } /* if */
+        } /* for */
+
+        if ((c->below != NULL) &&
+            ((retval == NULL) || (c->below->searchidx < retval->searchidx)))
+        {
+            retval = c->below;
+            c->below = NULL;
+        } /* if */
+        else if (retval != NULL)
+        {
+            /* mounted at a node we walked, so fname starts with it. */
+            c->pos[best]++;
+            c->lastmatched = 1;
+        } /* else if */
+    } /* else */
+
+    if (retval != NULL)
+        c->last = retval;
+    return retval;
+} /* nextMountCandidate */
 
 
-/* MAKE SURE you hold stateLock before calling this! */
-static int doDeregisterArchiver(const size_t idx)
+/*
+ * Start walking the archives that might have (fname), a sanitized path, in
+ *  search path order. That's everything mounted at or above (fname), plus
+ *  the first archive mounted below it, for partOfMountPoint(). The others
+ *  would fail verifyPath() anyhow. Returns the first archive, or NULL.
+ *  MAKE SURE you hold stateLock before calling this!
+ */
+static DirHandle *firstMountCandidate(MountCursor *c, const char *fname,
+                                      PHYSFS_Path *compiled)
 {
-    const size_t len = (numArchivers - idx) * sizeof (void *);
-    PHYSFS_ArchiveInfo *info = archiveInfo[idx];
-    PHYSFS_Archiver *arc = archivers[idx];
+    MountNode *node = getMountTree();
+    size_t i;
 
-    /* make sure nothing is still using this archiver */
-    if (archiverInUse(arc, searchPath) || archiverInUse(arc, writeDir))
-        BAIL(PHYSFS_ERR_FILES_STILL_OPEN, 0);
+    c->numnodes = 0;
+    c->below = NULL;
+    c->linear = NULL;
+    c->last = NULL;
+    c->lastmatched = 0;
 
-    allocator.Free((void *) info->extension);
-    allocator.Free((void *) info->description);
-    allocator.Free((void *) info->author);
-    allocator.Free((void *) info->url);
-    allocator.Free((void *) arc);
+    /* verifyPath() passes "" for every archive, wherever it's mounted. */
+    if ((node == NULL) || (*fname == '\0'))
+        c->linear = searchPath;
 
-    memmove(&archiveInfo[idx], &archiveInfo[idx+1], len);
-    memmove(&archivers[idx], &archivers[idx+1], len);
+    /* a compiled path remembers its walk until the tree is rebuilt. */
+    else if ((compiled != NULL) && (compiled->treegen == mountTreeGeneration))
+    {
+        for (i = 0; i < compiled->numnodes; i++)
+        {
+            c->pos[i] = 0;
+            c->nodes[i] = compiled->nodes[i];
+        } /* for */
+        c->numnodes = compiled->numnodes;
+        c->below = compiled->below;
+    } /* else if */
 
-    assert(numArchivers > 0);
-    numArchivers--;
+    else
+    {
+        while (1)
+        {
+            const char *end;
+            size_t len;
 
-    return 1;
-} /* doDeregisterArchiver */
+            c->pos[c->numnodes] = 0;
+            c->nodes[c->numnodes++] = node;
 
+            end = strchr(fname, '/');
+            len = end ? (size_t) (end - fname) : strlen(fname);
+            node = findMountNodeKid(node, fname, len, NULL);
+            if (node == NULL)
+                break;  /* nothing is mounted any deeper than this. */
 
-/* Does NOT hold the state lock; we're shutting down. */
-static void freeArchivers(void)
-{
-    while (numArchivers > 0)
-    {
-        if (!doDeregisterArchiver(numArchivers - 1))
-            assert(!"nothing should be mounted during shutdown.");
-    } /* while */
+            fname += len;
+            if (*fname == '\0')
+            {
+                c->pos[c->numnodes] = 0;
+                c->nodes[c->numnodes++] = node;
+                c->below = node->firstbelow;
+                break;
+            } /* if */
+            fname++;  /* skip the '/'. */
+        } /* while */
 
-    allocator.Free(archivers);
-    allocator.Free(archiveInfo);
-    archivers = NULL;
-    archiveInfo = NULL;
-} /* freeArchivers */
+        if (compiled != NULL)
+        {
+            for (i = 0; i < c->numnodes; i++)
+                compiled->nodes[i] = c->nodes[i];
+            compiled->numnodes = c->numnodes;
+            compiled->below = c->below;
+            compiled->treegen = mountTreeGeneration;
+        } /* if */
+    } /* else */
 
+    return nextMountCandidate(c);
+} /* firstMountCandidate */
 
-static int doDeinit(void)
+
+/*
+ * Call this when a lookup walked every candidate and found nothing.
+ *  Archives that were skipped (by the mount tree or a lookup filter) don't
+ *  set an error, since that's a mutex per archive, so make sure a skipped
+ *  last archive still leaves PHYSFS_ERR_NOT_FOUND, like verifyPath() would.
+ */
+static void finishLookup(const MountCursor *c, const LookupFilterKey *key)
 {
-    closeFileHandleList(&openWriteList);
-    BAIL_IF(!PHYSFS_setWriteDir(NULL), PHYSFS_ERR_FILES_STILL_OPEN, 0);
+    const int skippedtail = (c->last == NULL) ? (searchPath != NULL) :
+                                                (c->last->next != NULL);
+    if ((skippedtail) || (key->skippedlast))
+        PHYSFS_setErrorCode(PHYSFS_ERR_NOT_FOUND);
+} /* finishLookup */
 
-    freeSearchPath();
-    freeArchivers();
-    freeErrorStates();
 
-    if (baseDir != NULL)
-    {
-        allocator.Free(baseDir);
-        baseDir = NULL;
-    } /* if */
+static DirHandle *createDirHandle(PHYSFS_Io *io, const char *newDir,
+                                  const char *mountPoint, int forWriting)
+{
+    DirHandle *dirHandle = NULL;
+    char *tmpmntpnt = NULL;
 
-    if (userDir != NULL)
+    assert(newDir != NULL);  /* should have caught this higher up. */
+
+    if (mountPoint != NULL)
     {
-        allocator.Free(userDir);
-        userDir = NULL;
+        const size_t len = strlen(mountPoint) + 1;
+        tmpmntpnt = (char *) __PHYSFS_smallAlloc(len);
+        GOTO_IF(!tmpmntpnt, PHYSFS_ERR_OUT_OF_MEMORY, badDirHandle);
+        if (!sanitizePlatformIndependentPath(mountPoint, tmpmntpnt))
+            goto badDirHandle;
+        mountPoint = tmpmntpnt;  /* sanitized version. */
     } /* if */
 
-    if (prefDir != NULL)
+    dirHandle = openDirectory(io, newDir, forWriting);
+    GOTO_IF_ERRPASS(!dirHandle, badDirHandle);
+
+    dirHandle->dirName = (char *) allocator.Malloc(strlen(newDir) + 1);
+    GOTO_IF(!dirHandle->dirName, PHYSFS_ERR_OUT_OF_MEMORY, badDirHandle);
+    strcpy(dirHandle->dirName, newDir);
+
+    if ((mountPoint != NULL) && (*mountPoint != '\0'))
     {
-        allocator.Free(prefDir);
-        prefDir = NULL;
+        dirHandle->mountPoint = (char *)allocator.Malloc(strlen(mountPoint)+2);
+        if (!dirHandle->mountPoint)
+            GOTO(PHYSFS_ERR_OUT_OF_MEMORY, badDirHandle);
+        strcpy(dirHandle->mountPoint, mountPoint);
+        strcat(dirHandle->mountPoint, "/");
+        dirHandle->mountPointLen = strlen(dirHandle->mountPoint);
     } /* if */
 
-    if (archiveInfo != NULL)
+    /* the write dir creates files, so it can't pick their case for you. */
+    dirHandle->ignorecase = (!forWriting) && (ignoreCase);
+
+    /* deferred indexing builds this on first lookup instead. */
+    if ((!forWriting) && (lookupFilterBits > 0) &&
+        (indexingMode == PHYSFS_INDEX_AT_MOUNT))
     {
-        allocator.Free(archiveInfo);
-        archiveInfo = NULL;
+        buildLookupFilter(dirHandle);
     } /* if */
 
-    if (archivers != NULL)
+    __PHYSFS_smallFree(tmpmntpnt);
+    return dirHandle;
+
+badDirHandle:
+    if (dirHandle != NULL)
     {
-        allocator.Free(archivers);
-        archivers = NULL;
+        dirHandle->funcs->closeArchive(dirHandle->opaque);
+        allocator.Free(dirHandle->dirName);
+        allocator.Free(dirHandle->mountPoint);
+        allocator.Free(dirHandle);
     } /* if */
 
-    longest_root = 0;
-    allowSymLinks = 0;
-    initialized = 0;
+    __PHYSFS_smallFree(tmpmntpnt);
+    return NULL;
+} /* createDirHandle */
 
-    if (errorLock) __PHYSFS_platformDestroyMutex(errorLock);
-    if (stateLock) __PHYSFS_platformDestroyMutex(stateLock);
 
-    if (allocator.Deinit != NULL)
-        allocator.Deinit();
+static int dirIterInUse(const DirHandle *dh);
+static void closeDirIters(void);
+
+/* MAKE SURE you've got the stateLock held before calling this! */
+static int freeDirHandle(DirHandle *dh, FileHandle *openList)
+{
+    FileHandle *i;
 
-    errorLock = stateLock = NULL;
+    if (dh == NULL)
+        return 1;
 
-    __PHYSFS_platformDeinit();
+    for (i = openList; i != NULL; i = i->next)
+        BAIL_IF(i->dirHandle == dh, PHYSFS_ERR_FILES_STILL_OPEN, 0);
+
+    BAIL_IF(dirIterInUse(dh), PHYSFS_ERR_FILES_STILL_OPEN, 0);
+
+    dh->funcs->closeArchive(dh->opaque);
 
+    freeLookupFilter(dh);
+    if (dh->root) allocator.Free(dh->root);
+    allocator.Free(dh->dirName);
+    allocator.Free(dh->mountPoint);
+    allocator.Free(dh);
     return 1;
-} /* doDeinit */
+} /* freeDirHandle */
 
 
-int PHYSFS_deinit(void)
+static char *calculateBaseDir(const char *argv0)
 {
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
-    return doDeinit();
-} /* PHYSFS_deinit */
+    const char dirsep = __PHYSFS_platformDirSeparator;
+    char *retval = NULL;
+    char *ptr = NULL;
 
+    /* Give the platform layer first shot at this. */
+    retval = __PHYSFS_platformCalcBaseDir(argv0);
+    if (retval != NULL)
+        return retval;
 
-int PHYSFS_isInit(void)
+    /* We need argv0 to go on. */
+    BAIL_IF(argv0 == NULL, PHYSFS_ERR_ARGV0_IS_NULL, NULL);
+
+    ptr = strrchr(argv0, dirsep);
+    if (ptr != NULL)
+    {
+        const size_t size = ((size_t) (ptr - argv0)) + 1;
+        retval = (char *) allocator.Malloc(size + 1);
+        BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        memcpy(retval, argv0, size);
+        retval[size] = '\0';
+        return retval;
+    } /* if */
+
+    /* argv0 wasn't helpful. */
+    BAIL(PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+} /* calculateBaseDir */
+
+
+static int initializeMutexes(void)
 {
-    return initialized;
-} /* PHYSFS_isInit */
+    errorLock = __PHYSFS_platformCreateMutex();
+    if (errorLock == NULL)
+        goto initializeMutexes_failed;
 
+    stateLock = __PHYSFS_platformCreateMutex();
+    if (stateLock == NULL)
+        goto initializeMutexes_failed;
 
-char *__PHYSFS_strdup(const char *str)
+    bgTaskLock = __PHYSFS_platformCreateMutex();
+    if (bgTaskLock == NULL)
+        goto initializeMutexes_failed;
+
+    bgRunLock = __PHYSFS_platformCreateMutex();
+    if (bgRunLock == NULL)
+        goto initializeMutexes_failed;
+
+    nativeIoLock = __PHYSFS_platformCreateMutex();
+    if (nativeIoLock == NULL)
+        goto initializeMutexes_failed;
+
+    return 1;  /* success. */
+
+initializeMutexes_failed:
+    if (errorLock != NULL)
+        __PHYSFS_platformDestroyMutex(errorLock);
+
+    if (stateLock != NULL)
+        __PHYSFS_platformDestroyMutex(stateLock);
+
+    if (bgTaskLock != NULL)
+        __PHYSFS_platformDestroyMutex(bgTaskLock);
+
+    if (bgRunLock != NULL)
+        __PHYSFS_platformDestroyMutex(bgRunLock);
+
+    if (nativeIoLock != NULL)
+        __PHYSFS_platformDestroyMutex(nativeIoLock);
+
+    errorLock = stateLock = bgTaskLock = bgRunLock = nativeIoLock = NULL;
+    return 0;  /* failed. */
+} /* initializeMutexes */
+
+
+static int doRegisterArchiver(const PHYSFS_Archiver *_archiver);
+
+static int initStaticArchivers(void)
 {
-    char *retval = (char *) allocator.Malloc(strlen(str) + 1);
-    if (retval)
-        strcpy(retval, str);
+    #define REGISTER_STATIC_ARCHIVER(arc) { \
+        if (!doRegisterArchiver(&__PHYSFS_Archiver_##arc)) { \
+            return 0; \
+        } \
+    }
+
+    #if PHYSFS_SUPPORTS_ZIP
+        REGISTER_STATIC_ARCHIVER(ZIP);
+    #endif
+    #if PHYSFS_SUPPORTS_7Z
+        SZIP_global_init();
+        REGISTER_STATIC_ARCHIVER(7Z);
+    #endif
+    #if PHYSFS_SUPPORTS_GRP
+        REGISTER_STATIC_ARCHIVER(GRP);
+    #endif
+    #if PHYSFS_SUPPORTS_QPAK
+        REGISTER_STATIC_ARCHIVER(QPAK);
+    #endif
+    #if PHYSFS_SUPPORTS_HOG
+        REGISTER_STATIC_ARCHIVER(HOG);
+    #endif
+    #if PHYSFS_SUPPORTS_MVL
+        REGISTER_STATIC_ARCHIVER(MVL);
+    #endif
+    #if PHYSFS_SUPPORTS_WAD
+        REGISTER_STATIC_ARCHIVER(WAD);
+    #endif
+    #if PHYSFS_SUPPORTS_CSM
+        REGISTER_STATIC_ARCHIVER(CSM);
+    #endif
+    #if PHYSFS_SUPPORTS_TAR
+        REGISTER_STATIC_ARCHIVER(TAR);
+    #endif
+    #if PHYSFS_SUPPORTS_SLB
+        REGISTER_STATIC_ARCHIVER(SLB);
+    #endif
+    #if PHYSFS_SUPPORTS_ISO9660
+        REGISTER_STATIC_ARCHIVER(ISO9660);
+    #endif
+    #if PHYSFS_SUPPORTS_VDF
+        REGISTER_STATIC_ARCHIVER(VDF)
+    #endif
+    #if PHYSFS_SUPPORTS_LECARCHIVES
+        REGISTER_STATIC_ARCHIVER(GOB)
+        REGISTER_STATIC_ARCHIVER(LFD)
+        REGISTER_STATIC_ARCHIVER(LAB)
+    #endif
+
+    #undef REGISTER_STATIC_ARCHIVER
+
+    return 1;
+} /* initStaticArchivers */
+
+
+static void setDefaultAllocator(void);
+static int doDeinit(void);
+
+int PHYSFS_init(const char *argv0)
+{
+    BAIL_IF(initialized, PHYSFS_ERR_IS_INITIALIZED, 0);
+
+    if (!externalAllocator)
+        setDefaultAllocator();
+
+    if ((allocator.Init != NULL) && (!allocator.Init())) return 0;
+
+    if (!__PHYSFS_platformInit(argv0))
+    {
+        if (allocator.Deinit != NULL) allocator.Deinit();
+        return 0;
+    } /* if */
+
+    /* everything below here can be cleaned up safely by doDeinit(). */
+
+    if (!initializeMutexes()) goto initFailed;
+
+    baseDir = calculateBaseDir(argv0);
+    if (!baseDir) goto initFailed;
+
+    userDir = __PHYSFS_platformCalcUserDir();
+    if (!userDir) goto initFailed;
+
+    /* Platform layer is required to append a dirsep. */
+    #ifndef __ANDROID__  /* it's an APK file, not a directory, on Android. */
+    assert(baseDir[strlen(baseDir) - 1] == __PHYSFS_platformDirSeparator);
+    #endif
+    assert(userDir[strlen(userDir) - 1] == __PHYSFS_platformDirSeparator);
+
+    if (!initStaticArchivers()) goto initFailed;
+
+    initialized = 1;
+
+    /* This makes sure that the error subsystem is initialized. */
+    PHYSFS_setErrorCode(PHYSFS_getLastErrorCode());
+
+    return 1;
+
+initFailed:
+    doDeinit();
+    return 0;
+} /* PHYSFS_init */
+
+
+/* MAKE SURE you hold stateLock before calling this! */
+static int closeFileHandleList(FileHandle **list)
+{
+    FileHandle *i;
+    FileHandle *next = NULL;
+
+    for (i = *list; i != NULL; i = next)
+    {
+        PHYSFS_Io *io = i->io;
+        next = i->next;
+
+        if (io->flush && !io->flush(io))
+        {
+            *list = i;
+            return 0;
+        } /* if */
+
+        io->destroy(io);
+        allocator.Free(i);
+    } /* for */
+
+    *list = NULL;
+    return 1;
+} /* closeFileHandleList */
+
+
+/* MAKE SURE you hold the stateLock before calling this! */
+static void freeSearchPath(void)
+{
+    DirHandle *i;
+    DirHandle *next = NULL;
+
+    closeFileHandleList(&openReadList);
+    closeDirIters();
+
+    if (searchPath != NULL)
+    {
+        for (i = searchPath; i != NULL; i = next)
+        {
+            next = i->next;
+            freeDirHandle(i, openReadList);
+        } /* for */
+        searchPath = NULL;
+    } /* if */
+
+    invalidateMountTree();
+} /* freeSearchPath */
+
+
+/* MAKE SURE you hold stateLock before calling this! */
+static int archiverInUse(const PHYSFS_Archiver *arc, const DirHandle *list)
+{
+    const DirHandle *i;
+    for (i = list; i != NULL; i = i->next)
+    {
+        if (i->funcs == arc)
+            return 1;
+    } /* for */
+
+    return 0;  /* not in use */
+} /* archiverInUse */
+
+
+/* MAKE SURE you hold stateLock before calling this! */
+static int doDeregisterArchiver(const size_t idx)
+{
+    const size_t len = (numArchivers - idx) * sizeof (void *);
+    PHYSFS_ArchiveInfo *info = archiveInfo[idx];
+    PHYSFS_Archiver *arc = archivers[idx];
+
+    /* make sure nothing is still using this archiver */
+    if (archiverInUse(arc, searchPath) || archiverInUse(arc, writeDir))
+        BAIL(PHYSFS_ERR_FILES_STILL_OPEN, 0);
+
+    allocator.Free((void *) info->extension);
+    allocator.Free((void *) info->description);
+    allocator.Free((void *) info->author);
+    allocator.Free((void *) info->url);
+    allocator.Free((void *) arc);
+
+    memmove(&archiveInfo[idx], &archiveInfo[idx+1], len);
+    memmove(&archivers[idx], &archivers[idx+1], len);
+
+    assert(numArchivers > 0);
+    numArchivers--;
+
+    return 1;
+} /* doDeregisterArchiver */
+
+
+/* Does NOT hold the state lock; we're shutting down. */
+static void freeArchivers(void)
+{
+    while (numArchivers > 0)
+    {
+        if (!doDeregisterArchiver(numArchivers - 1))
+            assert(!"nothing should be mounted during shutdown.");
+    } /* while */
+
+    allocator.Free(archivers);
+    allocator.Free(archiveInfo);
+    archivers = NULL;
+    archiveInfo = NULL;
+} /* freeArchivers */
+
+
+/*
+ * Runs background tasks in the order they were queued, until the queue is
+ *  empty. Then it marks itself done and exits; the next queued task starts
+ *  a new thread. (bgRunLock) is held for the whole time a task runs, so
+ *  __PHYSFS_cancelBackgroundTask() can wait for it.
+ */
+static void backgroundTaskWorker(void *unused)
+{
+    while (1)
+    {
+        __PHYSFS_BackgroundTask *task;
+
+        __PHYSFS_platformGrabMutex(bgTaskLock);
+        task = bgTaskHead;
+        if (task == NULL)
+        {
+            bgThreadDone = 1;
+            __PHYSFS_platformReleaseMutex(bgTaskLock);
+            return;
+        } /* if */
+
+        bgTaskHead = task->next;
+        if (bgTaskHead == NULL)
+            bgTaskTail = NULL;
+        task->next = NULL;
+        bgRunning = task;
+        __PHYSFS_platformGrabMutex(bgRunLock);
+        __PHYSFS_platformReleaseMutex(bgTaskLock);
+
+        task->run(task->data);
+        __PHYSFS_platformReleaseMutex(bgRunLock);
+
+        __PHYSFS_platformGrabMutex(bgTaskLock);
+        bgRunning = NULL;
+        __PHYSFS_platformReleaseMutex(bgTaskLock);
+    } /* while */
+} /* backgroundTaskWorker */
+
+
+int __PHYSFS_queueBackgroundTask(__PHYSFS_BackgroundTask *task)
+{
+    void *finished = NULL;
+    int retval = 1;
+
+    __PHYSFS_platformGrabMutex(bgTaskLock);
+
+    if ((bgThread != NULL) && (bgThreadDone))
+    {
+        finished = bgThread;  /* it's out of the loop; join it below. */
+        bgThread = NULL;
+    } /* if */
+
+    task->next = NULL;
+    if (bgTaskTail != NULL)
+        bgTaskTail->next = task;
+    else
+        bgTaskHead = task;
+    bgTaskTail = task;
+
+    if (bgThread == NULL)
+    {
+        /* the platform layer reports a failed thread start; we don't. */
+        const PHYSFS_ErrorCode err = PHYSFS_getLastErrorCode();
+        bgThreadDone = 0;
+        bgThread = __PHYSFS_platformCreateThread(backgroundTaskWorker, NULL);
+        PHYSFS_getLastErrorCode();  /* clear anything it set... */
+        PHYSFS_setErrorCode(err);  /* ...and put back what the caller had. */
+        if (bgThread == NULL)
+        {
+            /* no thread means nothing else could have been queued. */
+            assert(bgTaskHead == task);
+            bgTaskHead = bgTaskTail = NULL;
+            retval = 0;
+        } /* if */
+    } /* if */
+
+    __PHYSFS_platformReleaseMutex(bgTaskLock);
+
+    if (finished != NULL)
+        __PHYSFS_platformJoinThread(finished);
+
+    return retval;
+} /* __PHYSFS_queueBackgroundTask */
+
+
+int __PHYSFS_cancelBackgroundTask(__PHYSFS_BackgroundTask *task)
+{
+    __PHYSFS_BackgroundTask *prev = NULL;
+    __PHYSFS_BackgroundTask *i;
+
+    __PHYSFS_platformGrabMutex(bgTaskLock);
+
+    for (i = bgTaskHead; i != NULL; i = i->next)
+    {
+        if (i == task)
+        {
+            if (prev != NULL)
+                prev->next = task->next;
+            else
+                bgTaskHead = task->next;
+            if (bgTaskTail == task)
+                bgTaskTail = prev;
+            task->next = NULL;
+            __PHYSFS_platformReleaseMutex(bgTaskLock);
+            return 1;  /* never ran, and now it never will. */
+        } /* if */
+        prev = i;
+    } /* for */
+
+    if (bgRunning != task)
+    {
+        __PHYSFS_platformReleaseMutex(bgTaskLock);
+        return 0;  /* already finished (or never queued). */
+    } /* if */
+
+    /* it's running right now; wait for it to finish. */
+    __PHYSFS_platformReleaseMutex(bgTaskLock);
+    __PHYSFS_platformGrabMutex(bgRunLock);
+    __PHYSFS_platformReleaseMutex(bgRunLock);
+    return 0;
+} /* __PHYSFS_cancelBackgroundTask */
+
+
+/* Call this once nothing can queue or be running a task anymore. */
+static void joinBackgroundThread(void)
+{
+    void *thread;
+
+    if (bgTaskLock == NULL)
+        return;  /* PHYSFS_init() failed before we got that far. */
+
+    __PHYSFS_platformGrabMutex(bgTaskLock);
+    assert(bgTaskHead == NULL);
+    thread = bgThread;
+    bgThread = NULL;
+    __PHYSFS_platformReleaseMutex(bgTaskLock);
+
+    if (thread != NULL)
+        __PHYSFS_platformJoinThread(thread);
+} /* joinBackgroundThread */
+
+
+static int doDeinit(void)
+{
+    closeFileHandleList(&openWriteList);
+    BAIL_IF(!PHYSFS_setWriteDir(NULL), PHYSFS_ERR_FILES_STILL_OPEN, 0);
+
+    freeSearchPath();
+    freeArchivers();
+    joinBackgroundThread();  /* closing the archives cancelled its tasks. */
+    freeErrorStates();
+
+    if (baseDir != NULL)
+    {
+        allocator.Free(baseDir);
+        baseDir = NULL;
+    } /* if */
+
+    if (userDir != NULL)
+    {
+        allocator.Free(userDir);
+        userDir = NULL;
+    } /* if */
+
+    if (prefDir != NULL)
+    {
+        allocator.Free(prefDir);
+        prefDir = NULL;
+    } /* if */
+
+    if (archiveInfo != NULL)
+    {
+        allocator.Free(archiveInfo);
+        archiveInfo = NULL;
+    } /* if */
+
+    if (archivers != NULL)
+    {
+        allocator.Free(archivers);
+        archivers = NULL;
+    } /* if */
+
+    longest_root = 0;
+    allowSymLinks = 0;
+    verifyChecksums = 0;
+    indexingMode = PHYSFS_INDEX_AT_MOUNT;
+    dirCaching = 0;
+    ignoreCase = 0;
+    lookupFilterBits = 0;
+    lookupFilterSkipped = 0;
+    lookupFilterChecked = 0;
+    nativeIoLimit = 0;
+    memset(&nativeIoStats, '\0', sizeof (nativeIoStats));
+    initialized = 0;
+
+    if (errorLock) __PHYSFS_platformDestroyMutex(errorLock);
+    if (stateLock) __PHYSFS_platformDestroyMutex(stateLock);
+    if (bgTaskLock) __PHYSFS_platformDestroyMutex(bgTaskLock);
+    if (bgRunLock) __PHYSFS_platformDestroyMutex(bgRunLock);
+    if (nativeIoLock) __PHYSFS_platformDestroyMutex(nativeIoLock);
+
+    if (allocator.Deinit != NULL)
+        allocator.Deinit();
+
+    errorLock = stateLock = bgTaskLock = bgRunLock = nativeIoLock = NULL;
+
+    __PHYSFS_platformDeinit();
+
+    return 1;
+} /* doDeinit */
+
+
+int PHYSFS_deinit(void)
+{
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    return doDeinit();
+} /* PHYSFS_deinit */
+
+
+int PHYSFS_isInit(void)
+{
+    return initialized;
+} /* PHYSFS_isInit */
+
+
+char *__PHYSFS_strdup(const char *str)
+{
+    char *retval = (char *) allocator.Malloc(strlen(str) + 1);
+    if (retval)
+        strcpy(retval, str);
+    return retval;
+} /* __PHYSFS_strdup */
+
+
+PHYSFS_uint32 __PHYSFS_hashString(const char *str)
+{
+    PHYSFS_uint32 hash = 5381;
+    while (1)
+    {
+        const char ch = *(str++);
+        if (ch == 0)
+            break;
+        hash = ((hash << 5) + hash) ^ ch;
+    } /* while */
+    return hash;
+} /* __PHYSFS_hashString */
+
+
+/*
+ * An ASCII char folds to one codepoint with three zero bytes, so hashing its
+ *  four bytes reduces to this. Must stay in sync with hashCodepointCaseFold().
+ */
+#if PHYSFS_BYTEORDER == PHYSFS_LIL_ENDIAN
+#define HASH_ASCII_CASEFOLDED(hash, ch) ((((hash) * 33) ^ (ch)) * 35937)
+#else
+#define HASH_ASCII_CASEFOLDED(hash, ch) (((hash) * 1185921) ^ (ch))
+#endif
+
+static PHYSFS_uint32 hashCodepointCaseFold(PHYSFS_uint32 hash,
+                                           const PHYSFS_uint32 cp)
+{
+    PHYSFS_uint32 folded[3];
+    const int numbytes = (int) (PHYSFS_caseFold(cp, folded) * sizeof (PHYSFS_uint32));
+    const char *bytes = (const char *) folded;
+    int i;
+    for (i = 0; i < numbytes; i++)
+        hash = ((hash << 5) + hash) ^ *(bytes++);
+    return hash;
+} /* hashCodepointCaseFold */
+
+
+/* __PHYSFS_hashStringCaseFold(), picking up where (hash) left off. */
+static PHYSFS_uint32 hashStringCaseFoldFrom(PHYSFS_uint32 hash, const char *str)
+{
+    const char *end = str + strlen(str);
+
+    /* fold 16 ASCII bytes at a time; mixed blocks take the long way. */
+    while ((end - str) >= 16)
+    {
+        char lower[16];
+        if (__PHYSFS_utf8LowerAscii16(str, lower))
+        {
+            int i;
+            for (i = 0; i < 16; i++)
+                hash = HASH_ASCII_CASEFOLDED(hash, lower[i]);
+            str += 16;
+        } /* if */
+        else
+        {
+            const char *blockend = str + 16;
+            while (str < blockend)
+                hash = hashCodepointCaseFold(hash, __PHYSFS_utf8codepoint(&str));
+        } /* else */
+    } /* while */
+
+    while (str < end)
+    {
+        const char ch = *str;
+        if ((ch & 0x80) == 0)
+        {
+            str++;
+            if ((ch >= 'A') && (ch <= 'Z'))
+                hash = HASH_ASCII_CASEFOLDED(hash, ch - ('A' - 'a'));
+            else
+                hash = HASH_ASCII_CASEFOLDED(hash, ch);
+        } /* if */
+        else
+        {
+            hash = hashCodepointCaseFold(hash, __PHYSFS_utf8codepoint(&str));
+        } /* else */
+    } /* while */
+
+    return hash;
+} /* hashStringCaseFoldFrom */
+
+
+PHYSFS_uint32 __PHYSFS_hashStringCaseFold(const char *str)
+{
+    return hashStringCaseFoldFrom(5381, str);
+} /* __PHYSFS_hashStringCaseFold */
+
+
+PHYSFS_uint32 __PHYSFS_hashStringCaseFoldUSAscii(const char *str)
+{
+    PHYSFS_uint32 hash = 5381;
+    while (1)
+    {
+        char ch = *(str++);
+        if (ch == 0)
+            break;
+        else if ((ch >= 'A') && (ch <= 'Z'))
+            ch -= ('A' - 'a');
+
+        hash = ((hash << 5) + hash) ^ ch;
+    } /* while */
+    return hash;
+} /* __PHYSFS_hashStringCaseFoldUSAscii */
+
+
+/* MAKE SURE you hold stateLock before calling this! */
+static int doRegisterArchiver(const PHYSFS_Archiver *_archiver)
+{
+    const PHYSFS_uint32 maxver = CURRENT_PHYSFS_ARCHIVER_API_VERSION;
+    const size_t len = (numArchivers + 2) * sizeof (void *);
+    PHYSFS_Archiver *archiver = NULL;
+    PHYSFS_ArchiveInfo *info = NULL;
+    const char *ext = NULL;
+    void *ptr = NULL;
+    size_t i;
+
+    BAIL_IF(!_archiver, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(_archiver->version > maxver, PHYSFS_ERR_UNSUPPORTED, 0);
+    BAIL_IF(!_archiver->info.extension, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->info.description, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->info.author, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->info.url, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->openArchive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->enumerate, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->openRead, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->openWrite, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->openAppend, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->remove, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->mkdir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->closeArchive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_archiver->stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    ext = _archiver->info.extension;
+    for (i = 0; i < numArchivers; i++)
+    {
+        if (PHYSFS_utf8stricmp(archiveInfo[i]->extension, ext) == 0)
+            BAIL(PHYSFS_ERR_DUPLICATE, 0);
+    } /* for */
+
+    /* make a copy of the data. */
+    archiver = (PHYSFS_Archiver *) allocator.Malloc(sizeof (*archiver));
+    GOTO_IF(!archiver, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
+
+    /* Must copy sizeof (OLD_VERSION_OF_STRUCT) when version changes! */
+    memcpy(archiver, _archiver, sizeof (*archiver));
+
+    info = (PHYSFS_ArchiveInfo *) &archiver->info;
+    memset(info, '\0', sizeof (*info));  /* NULL in case an alloc fails. */
+    #define CPYSTR(item) \
+        info->item = __PHYSFS_strdup(_archiver->info.item); \
+        GOTO_IF(!info->item, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
+    CPYSTR(extension);
+    CPYSTR(description);
+    CPYSTR(author);
+    CPYSTR(url);
+    info->supportsSymlinks = _archiver->info.supportsSymlinks;
+    #undef CPYSTR
+
+    ptr = allocator.Realloc(archiveInfo, len);
+    GOTO_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
+    archiveInfo = (PHYSFS_ArchiveInfo **) ptr;
+
+    ptr = allocator.Realloc(archivers, len);
+    GOTO_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
+    archivers = (PHYSFS_Archiver **) ptr;
+
+    archiveInfo[numArchivers] = info;
+    archiveInfo[numArchivers + 1] = NULL;
+
+    archivers[numArchivers] = archiver;
+    archivers[numArchivers + 1] = NULL;
+
+    numArchivers++;
+
+    return 1;
+
+regfailed:
+    if (info != NULL)
+    {
+        allocator.Free((void *) info->extension);
+        allocator.Free((void *) info->description);
+        allocator.Free((void *) info->author);
+        allocator.Free((void *) info->url);
+    } /* if */
+    allocator.Free(archiver);
+
+    return 0;
+} /* doRegisterArchiver */
+
+
+int PHYSFS_registerArchiver(const PHYSFS_Archiver *archiver)
+{
+    int retval;
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    __PHYSFS_platformGrabMutex(stateLock);
+    retval = doRegisterArchiver(archiver);
+    __PHYSFS_platformReleaseMutex(stateLock);
+    return retval;
+} /* PHYSFS_registerArchiver */
+
+
+int PHYSFS_deregisterArchiver(const char *ext)
+{
+    size_t i;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!ext, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = 0; i < numArchivers; i++)
+    {
+        if (PHYSFS_utf8stricmp(archiveInfo[i]->extension, ext) == 0)
+        {
+            const int retval = doDeregisterArchiver(i);
+            __PHYSFS_platformReleaseMutex(stateLock);
+            return retval;
+        } /* if */
+    } /* for */
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    BAIL(PHYSFS_ERR_NOT_FOUND, 0);
+} /* PHYSFS_deregisterArchiver */
+
+
+const PHYSFS_ArchiveInfo **PHYSFS_supportedArchiveTypes(void)
+{
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, NULL);
+    return (const PHYSFS_ArchiveInfo **) archiveInfo;
+} /* PHYSFS_supportedArchiveTypes */
+
+
+void PHYSFS_freeList(void *list)
+{
+    /* the strings live in the same block; see finishStringList(). */
+    if (list != NULL)
+        allocator.Free(list);
+} /* PHYSFS_freeList */
+
+
+const char *PHYSFS_getDirSeparator(void)
+{
+    static char retval[2] = { __PHYSFS_platformDirSeparator, '\0' };
+    return retval;
+} /* PHYSFS_getDirSeparator */
+
+
+char **PHYSFS_getCdRomDirs(void)
+{
+    return doEnumStringList(__PHYSFS_platformDetectAvailableCDs);
+} /* PHYSFS_getCdRomDirs */
+
+
+void PHYSFS_getCdRomDirsCallback(PHYSFS_StringCallback callback, void *data)
+{
+    __PHYSFS_platformDetectAvailableCDs(callback, data);
+} /* PHYSFS_getCdRomDirsCallback */
+
+
+const char *PHYSFS_getPrefDir(const char *org, const char *app)
+{
+    const char dirsep = __PHYSFS_platformDirSeparator;
+    PHYSFS_Stat statbuf;
+    char *ptr = NULL;
+    char *endstr = NULL;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!org, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(*org == '\0', PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(!app, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(*app == '\0', PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+
+    allocator.Free(prefDir);
+    prefDir = __PHYSFS_platformCalcPrefDir(org, app);
+    BAIL_IF_ERRPASS(!prefDir, NULL);
+
+    assert(strlen(prefDir) > 0);
+    endstr = prefDir + (strlen(prefDir) - 1);
+    assert(*endstr == dirsep);
+    *endstr = '\0';  /* mask out the final dirsep for now. */
+
+    if (!__PHYSFS_platformStat(prefDir, &statbuf, 1))
+    {
+        for (ptr = strchr(prefDir, dirsep); ptr; ptr = strchr(ptr+1, dirsep))
+        {
+            *ptr = '\0';
+            __PHYSFS_platformMkDir(prefDir);
+            *ptr = dirsep;
+        } /* for */
+
+        if (!__PHYSFS_platformMkDir(prefDir))
+        {
+            allocator.Free(prefDir);
+            prefDir = NULL;
+        } /* if */
+    } /* if */
+
+    *endstr = dirsep;  /* readd the final dirsep. */
+
+    return prefDir;
+} /* PHYSFS_getPrefDir */
+
+
+const char *PHYSFS_getBaseDir(void)
+{
+    return baseDir;   /* this is calculated in PHYSFS_init()... */
+} /* PHYSFS_getBaseDir */
+
+
+const char *__PHYSFS_getUserDir(void)  /* not deprecated internal version. */
+{
+    return userDir;   /* this is calculated in PHYSFS_init()... */
+} /* __PHYSFS_getUserDir */
+
+
+const char *PHYSFS_getUserDir(void)
+{
+    return __PHYSFS_getUserDir();
+} /* PHYSFS_getUserDir */
+
+
+const char *PHYSFS_getWriteDir(void)
+{
+    const char *retval = NULL;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    if (writeDir != NULL)
+        retval = writeDir->dirName;
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    return retval;
+} /* PHYSFS_getWriteDir */
+
+
+int PHYSFS_setWriteDir(const char *newDir)
+{
+    int retval = 1;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    if (writeDir != NULL)
+    {
+        BAIL_IF_MUTEX_ERRPASS(!freeDirHandle(writeDir, openWriteList),
+                            stateLock, 0);
+        writeDir = NULL;
+    } /* if */
+
+    if (newDir != NULL)
+    {
+        writeDir = createDirHandle(NULL, newDir, NULL, 1);
+        retval = (writeDir != NULL);
+    } /* if */
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    return retval;
+} /* PHYSFS_setWriteDir */
+
+
+int PHYSFS_setRoot(const char *archive, const char *subdir)
+{
+    DirHandle *i;
+
+    BAIL_IF(!archive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        if ((i->dirName != NULL) && (strcmp(archive, i->dirName) == 0))
+        {
+            if (!subdir || (strcmp(subdir, "/") == 0))
+            {
+                if (i->root)
+                    allocator.Free(i->root);
+                i->root = NULL;
+                i->rootlen = 0;
+            } /* if */
+            else
+            {
+                const size_t len = strlen(subdir) + 1;
+                char *ptr = (char *) allocator.Malloc(len);
+                BAIL_IF_MUTEX(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+                if (!sanitizePlatformIndependentPath(subdir, ptr))
+                {
+                    allocator.Free(ptr);
+                    BAIL_MUTEX_ERRPASS(stateLock, 0);
+                } /* if */
+
+                if (i->root)
+                    allocator.Free(i->root);
+                i->root = ptr;
+                i->rootlen = strlen(i->root);  /* in case sanitizePlatformIndependentPath changed subdir */
+
+                if (longest_root < i->rootlen)
+                    longest_root = i->rootlen;
+            } /* else */
+
+            break;
+        } /* if */
+    } /* for */
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    return 1;
+} /* PHYSFS_setRoot */
+
+
+/* read this much at a time when verifying archives. */
+#define VERIFY_BUFSIZE (64 * 1024)
+
+/* upper bound on threads PHYSFS_verifyArchive() will start. */
+#define VERIFY_MAX_THREADS 32
+
+typedef struct
+{
+    DirHandle *dh;
+    char **names;  /* archive-relative path of every file. */
+    size_t count;  /* number of items in (names). */
+    size_t allocated;  /* number of slots allocated in (names). */
+    char *failed;  /* non-zero for each item in (names) that failed. */
+    size_t next;  /* next item in (names) to check. */
+    PHYSFS_ErrorCode errcode;  /* error from the first failure. */
+    void *lock;  /* protects (next), (failed), (errcode) and archiver calls. */
+} VerifyArchiveData;
+
+
+static PHYSFS_EnumerateCallbackResult verifyArchiveCollect(void *_data,
+                                        const char *origdir, const char *fname)
+{
+    VerifyArchiveData *data = (VerifyArchiveData *) _data;
+    DirHandle *dh = data->dh;
+    const size_t dirlen = strlen(origdir);
+    const size_t len = dirlen + strlen(fname) + 2;
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    PHYSFS_Stat statbuf;
+    char *path;
+
+    path = (char *) allocator.Malloc(len);
+    BAIL_IF(!path, PHYSFS_ERR_OUT_OF_MEMORY, PHYSFS_ENUM_ERROR);
+    if (dirlen == 0)
+        strcpy(path, fname);
+    else
+    {
+        memcpy(path, origdir, dirlen);
+        path[dirlen] = '/';
+        strcpy(path + dirlen + 1, fname);
+    } /* else */
+
+    /* let the read fail on anything we can't even stat. */
+    if (!dh->funcs->stat(dh->opaque, path, &statbuf))
+        statbuf.filetype = PHYSFS_FILETYPE_REGULAR;
+
+    if (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY)
+    {
+        retval = dh->funcs->enumerate(dh->opaque, path, verifyArchiveCollect,
+                                      path, data);
+        if (retval != PHYSFS_ENUM_ERROR)
+            retval = PHYSFS_ENUM_OK;
+    } /* if */
+
+    else if (statbuf.filetype != PHYSFS_FILETYPE_SYMLINK)
+    {
+        if (data->count == data->allocated)
+        {
+            const size_t newalloc = data->allocated ? data->allocated * 2 : 64;
+            void *ptr = allocator.Realloc(data->names, newalloc * sizeof (char *));
+            if (!ptr)
+            {
+                allocator.Free(path);
+                BAIL(PHYSFS_ERR_OUT_OF_MEMORY, PHYSFS_ENUM_ERROR);
+            } /* if */
+            data->names = (char **) ptr;
+            data->allocated = newalloc;
+        } /* if */
+
+        data->names[data->count++] = path;
+        path = NULL;  /* (names) owns it now. */
+    } /* else if */
+
+    if (path != NULL)
+        allocator.Free(path);
+
+    return retval;
+} /* verifyArchiveCollect */
+
+
+/*
+ * Every thread, including the one that called PHYSFS_verifyArchive(),
+ *  runs this until there aren't any files left to check. Archivers expect
+ *  opens and closes to be serialized (normally by stateLock), so those
+ *  happen under (data->lock), and only the reads run in parallel.
+ */
+static void verifyArchiveWorker(void *_data)
+{
+    VerifyArchiveData *data = (VerifyArchiveData *) _data;
+    DirHandle *dh = data->dh;
+    PHYSFS_uint8 *buf = (PHYSFS_uint8 *) allocator.Malloc(VERIFY_BUFSIZE);
+
+    while (1)
+    {
+        PHYSFS_ErrorCode errcode = PHYSFS_ERR_OK;
+        PHYSFS_Io *io = NULL;
+        size_t idx;
+
+        __PHYSFS_platformGrabMutex(data->lock);
+        idx = data->next;
+        if (idx < data->count)
+        {
+            data->next++;
+            if (buf != NULL)
+                io = dh->funcs->openRead(dh->opaque, data->names[idx]);
+        } /* if */
+        __PHYSFS_platformReleaseMutex(data->lock);
+
+        if (idx >= data->count)
+            break;  /* all done. */
+
+        if (buf == NULL)
+            errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+        else if (io == NULL)
+            errcode = PHYSFS_getLastErrorCode();
+        else
+        {
+            PHYSFS_sint64 br;
+            while ((br = io->read(io, buf, VERIFY_BUFSIZE)) > 0) { /* spin. */ }
+            if (br < 0)
+                errcode = PHYSFS_getLastErrorCode();
+        } /* else */
+
+        __PHYSFS_platformGrabMutex(data->lock);
+        if (io != NULL)
+            io->destroy(io);
+        if ((io == NULL) || (errcode != PHYSFS_ERR_OK))
+        {
+            if (errcode == PHYSFS_ERR_OK)
+                errcode = PHYSFS_ERR_OTHER_ERROR;
+            data->failed[idx] = 1;
+            if (data->errcode == PHYSFS_ERR_OK)
+                data->errcode = errcode;
+        } /* if */
+        __PHYSFS_platformReleaseMutex(data->lock);
+    } /* while */
+
+    if (buf != NULL)
+        allocator.Free(buf);
+} /* verifyArchiveWorker */
+
+
+int PHYSFS_verifyArchive(const char *archive, PHYSFS_StringCallback badfile,
+                         void *cbdata)
+{
+    void *threads[VERIFY_MAX_THREADS];
+    VerifyArchiveData data;
+    int numthreads = 0;
+    int retval = 0;
+    DirHandle *i;
+    size_t j;
+
+    BAIL_IF(!archive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    memset(&data, '\0', sizeof (data));
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        if (strcmp(i->dirName, archive) == 0)
+            break;
+    } /* for */
+
+    GOTO_IF(!i, PHYSFS_ERR_NOT_MOUNTED, verifyArchive_failed);
+    data.dh = i;
+
+    data.lock = __PHYSFS_platformCreateMutex();
+    GOTO_IF_ERRPASS(!data.lock, verifyArchive_failed);
+
+    if (i->funcs->enumerate(i->opaque, "", verifyArchiveCollect, "", &data) == PHYSFS_ENUM_ERROR)
+        goto verifyArchive_failed;
+
+    data.failed = (char *) allocator.Malloc(data.count + 1);
+    GOTO_IF(!data.failed, PHYSFS_ERR_OUT_OF_MEMORY, verifyArchive_failed);
+    memset(data.failed, '\0', data.count + 1);
+
+    /* we hold stateLock, so nothing else can open a file while this is set. */
+    verifyingArchive = 1;
+
+    if (data.count > 1)
+    {
+        size_t wanted = (size_t) __PHYSFS_platformCPUCount();
+        if (wanted > data.count)
+            wanted = data.count;
+        if (wanted > VERIFY_MAX_THREADS)
+            wanted = VERIFY_MAX_THREADS;
+
+        /* this thread does its share too, so start one fewer. */
+        while ((size_t) (numthreads + 1) < wanted)
+        {
+            threads[numthreads] = __PHYSFS_platformCreateThread(verifyArchiveWorker, &data);
+            if (!threads[numthreads])
+                break;  /* that's okay, we'll manage with what we have. */
+            numthreads++;
+        } /* while */
+    } /* if */
+
+    verifyArchiveWorker(&data);
+
+    while (numthreads > 0)
+        __PHYSFS_platformJoinThread(threads[--numthreads]);
+
+    verifyingArchive = 0;
+
+    for (j = 0; j < data.count; j++)
+    {
+        if ((data.failed[j]) && (badfile != NULL))
+            badfile(cbdata, data.names[j]);
+    } /* for */
+
+    if (data.errcode != PHYSFS_ERR_OK)
+        PHYSFS_setErrorCode(data.errcode);
+    else
+        retval = 1;
+
+verifyArchive_failed:
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    if (data.lock)
+        __PHYSFS_platformDestroyMutex(data.lock);
+
+    for (j = 0; j < data.count; j++)
+        allocator.Free(data.names[j]);
+
+    if (data.names)
+        allocator.Free(data.names);
+
+    if (data.failed)
+        allocator.Free(data.failed);
+
+    return retval;
+} /* PHYSFS_verifyArchive */
+
+
+static int doMount(PHYSFS_Io *io, const char *fname,
+                   const char *mountPoint, int appendToPath)
+{
+    DirHandle *dh;
+    DirHandle *prev = NULL;
+    DirHandle *i;
+
+    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    if (mountPoint == NULL)
+        mountPoint = "/";
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        /* already in search path? */
+        if ((i->dirName != NULL) && (strcmp(fname, i->dirName) == 0))
+            BAIL_MUTEX_ERRPASS(stateLock, 1);
+        prev = i;
+    } /* for */
+
+    dh = createDirHandle(io, fname, mountPoint, 0);
+    BAIL_IF_MUTEX_ERRPASS(!dh, stateLock, 0);
+
+    if (appendToPath)
+    {
+        if (prev == NULL)
+            searchPath = dh;
+        else
+            prev->next = dh;
+    } /* if */
+    else
+    {
+        dh->next = searchPath;
+        searchPath = dh;
+    } /* else */
+
+    invalidateMountTree();
+    __PHYSFS_platformReleaseMutex(stateLock);
+    return 1;
+} /* doMount */
+
+
+int PHYSFS_mountIo(PHYSFS_Io *io, const char *fname,
+                   const char *mountPoint, int appendToPath)
+{
+    BAIL_IF(!io, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(io->version != 0, PHYSFS_ERR_UNSUPPORTED, 0);
+    return doMount(io, fname, mountPoint, appendToPath);
+} /* PHYSFS_mountIo */
+
+
+int PHYSFS_mountMemory(const void *buf, PHYSFS_uint64 len, void (*del)(void *),
+                       const char *fname, const char *mountPoint,
+                       int appendToPath)
+{
+    int retval = 0;
+    PHYSFS_Io *io = NULL;
+
+    BAIL_IF(!buf, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    io = __PHYSFS_createMemoryIo(buf, len, del);
+    BAIL_IF_ERRPASS(!io, 0);
+    retval = doMount(io, fname, mountPoint, appendToPath);
+    if (!retval)
+    {
+        /* docs say not to call (del) in case of failure, so cheat. */
+        MemoryIoInfo *info = (MemoryIoInfo *) io->opaque;
+        info->destruct = NULL;
+        io->destroy(io);
+    } /* if */
+
+    return retval;
+} /* PHYSFS_mountMemory */
+
+
+int PHYSFS_mountHandle(PHYSFS_File *file, const char *fname,
+                       const char *mountPoint, int appendToPath)
+{
+    int retval = 0;
+    PHYSFS_Io *io = NULL;
+
+    BAIL_IF(!file, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    io = __PHYSFS_createHandleIo(file);
+    BAIL_IF_ERRPASS(!io, 0);
+    retval = doMount(io, fname, mountPoint, appendToPath);
+    if (!retval)
+    {
+        /* docs say not to destruct in case of failure, so cheat. */
+        io->opaque = NULL;
+        io->destroy(io);
+    } /* if */
+
+    return retval;
+} /* PHYSFS_mountHandle */
+
+
+int PHYSFS_mount(const char *newDir, const char *mountPoint, int appendToPath)
+{
+    BAIL_IF(!newDir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    return doMount(NULL, newDir, mountPoint, appendToPath);
+} /* PHYSFS_mount */
+
+
+/* upper bound on threads PHYSFS_mountMany() will start. */
+#define MOUNT_MAX_THREADS 32
+
+typedef struct
+{
+    PHYSFS_MountSpec *specs;
+    DirHandle **handles;  /* what each item in (specs) opened, or NULL. */
+    PHYSFS_uint32 count;  /* number of items in (specs) and (handles). */
+    PHYSFS_uint32 next;  /* next item in (specs) to open. */
+    void *lock;  /* protects (next). */
+} MountManyData;
+
+
+/*
+ * Every thread, including the one that called PHYSFS_mountMany(), runs
+ *  this until there's nothing left to open. The caller holds stateLock the
+ *  whole time, so the search path and archiver list can't change under us,
+ *  and each thread only touches its own items in (specs) and (handles).
+ */
+static void mountManyWorker(void *_data)
+{
+    MountManyData *data = (MountManyData *) _data;
+
+    while (1)
+    {
+        PHYSFS_MountSpec *spec;
+        const char *mntpnt;
+        PHYSFS_uint32 idx;
+        DirHandle *i;
+
+        __PHYSFS_platformGrabMutex(data->lock);
+        idx = data->next;
+        if (idx < data->count)
+            data->next++;
+        __PHYSFS_platformReleaseMutex(data->lock);
+
+        if (idx >= data->count)
+            break;  /* all done. */
+
+        spec = &data->specs[idx];
+        if (spec->error != PHYSFS_ERR_OK)
+            continue;  /* bogus arguments. */
+
+        for (i = searchPath; i != NULL; i = i->next)
+        {
+            if ((i->dirName != NULL) && (strcmp(spec->newDir, i->dirName) == 0))
+                break;
+        } /* for */
+
+        if (i != NULL)
+            continue;  /* already in search path. */
+
+        mntpnt = spec->mountPoint ? spec->mountPoint : "/";
+        data->handles[idx] = createDirHandle(NULL, spec->newDir, mntpnt, 0);
+        if (data->handles[idx] == NULL)
+        {
+            spec->error = PHYSFS_getLastErrorCode();
+            if (spec->error == PHYSFS_ERR_OK)
+                spec->error = PHYSFS_ERR_OTHER_ERROR;
+        } /* if */
+    } /* while */
+} /* mountManyWorker */
+
+
+int PHYSFS_mountMany(PHYSFS_MountSpec *specs, PHYSFS_uint32 count)
+{
+    void *threads[MOUNT_MAX_THREADS];
+    PHYSFS_ErrorCode errcode = PHYSFS_ERR_OK;
+    MountManyData data;
+    int numthreads = 0;
+    PHYSFS_uint32 j;
+
+    BAIL_IF(!specs && count, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    for (j = 0; j < count; j++)
+    {
+        const int bogus = (specs[j].newDir == NULL);
+        specs[j].error = bogus ? PHYSFS_ERR_INVALID_ARGUMENT : PHYSFS_ERR_OK;
+    } /* for */
+
+    memset(&data, '\0', sizeof (data));
+    data.specs = specs;
+    data.count = count;
+
+    if (count > 0)
+    {
+        data.handles = (DirHandle **) allocator.Malloc(count * sizeof (DirHandle *));
+        BAIL_IF(!data.handles, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        memset(data.handles, '\0', count * sizeof (DirHandle *));
+    } /* if */
+
+    data.lock = __PHYSFS_platformCreateMutex();
+    if (!data.lock)
+    {
+        allocator.Free(data.handles);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    } /* if */
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    if (count > 1)
+    {
+        PHYSFS_uint32 wanted = (PHYSFS_uint32) __PHYSFS_platformCPUCount();
+        if (wanted > count)
+            wanted = count;
+        if (wanted > MOUNT_MAX_THREADS)
+            wanted = MOUNT_MAX_THREADS;
+
+        /* this thread does its share too, so start one fewer. */
+        while ((PHYSFS_uint32) (numthreads + 1) < wanted)
+        {
+            threads[numthreads] = __PHYSFS_platformCreateThread(mountManyWorker, &data);
+            if (!threads[numthreads])
+                break;  /* that's okay, we'll manage with what we have. */
+            numthreads++;
+        } /* while */
+    } /* if */
+
+    mountManyWorker(&data);
+
+    while (numthreads > 0)
+        __PHYSFS_platformJoinThread(threads[--numthreads]);
+
+    /* Everything is open; link it all in, as if mounted one at a time. */
+    for (j = 0; j < count; j++)
+    {
+        DirHandle *dh = data.handles[j];
+        DirHandle *prev = NULL;
+        DirHandle *i;
+
+        if (specs[j].error != PHYSFS_ERR_OK)
+        {
+            if (errcode == PHYSFS_ERR_OK)
+                errcode = specs[j].error;
+            continue;
+        } /* if */
+
+        else if (dh == NULL)
+            continue;  /* was already mounted. */
+
+        for (i = searchPath; i != NULL; i = i->next)
+        {
+            if ((i->dirName != NULL) && (strcmp(dh->dirName, i->dirName) == 0))
+                break;  /* listed twice in (specs); keep the first one. */
+            prev = i;
+        } /* for */
+
+        if (i != NULL)
+            freeDirHandle(dh, NULL);
+        else if (!specs[j].appendToPath)
+        {
+            dh->next = searchPath;
+            searchPath = dh;
+        } /* else if */
+        else if (prev == NULL)
+            searchPath = dh;
+        else
+            prev->next = dh;
+    } /* for */
+
+    invalidateMountTree();
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    __PHYSFS_platformDestroyMutex(data.lock);
+    if (data.handles)
+        allocator.Free(data.handles);
+
+    BAIL_IF(errcode != PHYSFS_ERR_OK, errcode, 0);
+    return 1;
+} /* PHYSFS_mountMany */
+
+
+int PHYSFS_addToSearchPath(const char *newDir, int appendToPath)
+{
+    return PHYSFS_mount(newDir, NULL, appendToPath);
+} /* PHYSFS_addToSearchPath */
+
+
+int PHYSFS_removeFromSearchPath(const char *oldDir)
+{
+    return PHYSFS_unmount(oldDir);
+} /* PHYSFS_removeFromSearchPath */
+
+
+int PHYSFS_unmount(const char *oldDir)
+{
+    DirHandle *i;
+    DirHandle *prev = NULL;
+    DirHandle *next = NULL;
+
+    BAIL_IF(oldDir == NULL, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        if (strcmp(i->dirName, oldDir) == 0)
+        {
+            next = i->next;
+            BAIL_IF_MUTEX_ERRPASS(!freeDirHandle(i, openReadList),
+                                stateLock, 0);
+
+            if (prev == NULL)
+                searchPath = next;
+            else
+                prev->next = next;
+
+            invalidateMountTree();
+            BAIL_MUTEX_ERRPASS(stateLock, 1);
+        } /* if */
+        prev = i;
+    } /* for */
+
+    BAIL_MUTEX(PHYSFS_ERR_NOT_MOUNTED, stateLock, 0);
+} /* PHYSFS_unmount */
+
+
+char **PHYSFS_getSearchPath(void)
+{
+    return doEnumStringList(PHYSFS_getSearchPathCallback);
+} /* PHYSFS_getSearchPath */
+
+
+const char *PHYSFS_getMountPoint(const char *dir)
+{
+    DirHandle *i;
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        if (strcmp(i->dirName, dir) == 0)
+        {
+            const char *retval = ((i->mountPoint) ? i->mountPoint : "/");
+            __PHYSFS_platformReleaseMutex(stateLock);
+            return retval;
+        } /* if */
+    } /* for */
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    BAIL(PHYSFS_ERR_NOT_MOUNTED, NULL);
+} /* PHYSFS_getMountPoint */
+
+
+void PHYSFS_getSearchPathCallback(PHYSFS_StringCallback callback, void *data)
+{
+    DirHandle *i;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    for (i = searchPath; i != NULL; i = i->next)
+        callback(data, i->dirName);
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+} /* PHYSFS_getSearchPathCallback */
+
+
+typedef struct setSaneCfgEnumData
+{
+    const char *archiveExt;
+    size_t archiveExtLen;
+    int archivesFirst;
+    PHYSFS_ErrorCode errcode;
+} setSaneCfgEnumData;
+
+static PHYSFS_EnumerateCallbackResult setSaneCfgEnumCallback(void *_data,
+                                                const char *dir, const char *f)
+{
+    setSaneCfgEnumData *data = (setSaneCfgEnumData *) _data;
+    const size_t extlen = data->archiveExtLen;
+    const size_t l = strlen(f);
+    const char *ext;
+
+    if ((l > extlen) && (f[l - extlen - 1] == '.'))
+    {
+        ext = f + (l - extlen);
+        if (PHYSFS_utf8stricmp(ext, data->archiveExt) == 0)
+        {
+            const char dirsep = __PHYSFS_platformDirSeparator;
+            const char *d = PHYSFS_getRealDir(f);
+            const size_t allocsize = strlen(d) + l + 2;
+            char *str = (char *) __PHYSFS_smallAlloc(allocsize);
+            if (str == NULL)
+                data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+            else
+            {
+                snprintf(str, allocsize, "%s%c%s", d, dirsep, f);
+                if (!PHYSFS_mount(str, NULL, data->archivesFirst == 0))
+                    data->errcode = currentErrorCode();
+                __PHYSFS_smallFree(str);
+            } /* else */
+        } /* if */
+    } /* if */
+
+    /* !!! FIXME: if we want to abort on errors... */
+    /*return (data->errcode != PHYSFS_ERR_OK) ? PHYSFS_ENUM_ERROR : PHYSFS_ENUM_OK;*/
+
+    return PHYSFS_ENUM_OK;  /* keep going */
+} /* setSaneCfgEnumCallback */
+
+
+int PHYSFS_setSaneConfig(const char *organization, const char *appName,
+                         const char *archiveExt, int includeCdRoms,
+                         int archivesFirst)
+{
+    const char *basedir;
+    const char *prefdir;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+
+    prefdir = PHYSFS_getPrefDir(organization, appName);
+    BAIL_IF_ERRPASS(!prefdir, 0);
+
+    basedir = PHYSFS_getBaseDir();
+    BAIL_IF_ERRPASS(!basedir, 0);
+
+    BAIL_IF(!PHYSFS_setWriteDir(prefdir), PHYSFS_ERR_NO_WRITE_DIR, 0);
+
+    /* !!! FIXME: these can fail and we should report that... */
+
+    /* Put write dir first in search path... */
+    PHYSFS_mount(prefdir, NULL, 0);
+
+    /* Put base path on search path... */
+    PHYSFS_mount(basedir, NULL, 1);
+
+    /* handle CD-ROMs... */
+    if (includeCdRoms)
+    {
+        char **cds = PHYSFS_getCdRomDirs();
+        char **i;
+        for (i = cds; *i != NULL; i++)
+            PHYSFS_mount(*i, NULL, 1);
+        PHYSFS_freeList(cds);
+    } /* if */
+
+    /* Root out archives, and add them to search path... */
+    if (archiveExt != NULL)
+    {
+        setSaneCfgEnumData data;
+        memset(&data, '\0', sizeof (data));
+        data.archiveExt = archiveExt;
+        data.archiveExtLen = strlen(archiveExt);
+        data.archivesFirst = archivesFirst;
+        data.errcode = PHYSFS_ERR_OK;
+        if (!PHYSFS_enumerate("/", setSaneCfgEnumCallback, &data))
+        {
+            /* !!! FIXME: use this if we're reporting errors.
+            PHYSFS_ErrorCode errcode = currentErrorCode();
+            if (errcode == PHYSFS_ERR_APP_CALLBACK)
+                errcode = data->errcode; */
+        } /* if */
+    } /* if */
+
+    return 1;
+} /* PHYSFS_setSaneConfig */
+
+
+void PHYSFS_permitSymbolicLinks(int allow)
+{
+    allowSymLinks = allow;
+} /* PHYSFS_permitSymbolicLinks */
+
+
+int PHYSFS_symbolicLinksPermitted(void)
+{
+    return allowSymLinks;
+} /* PHYSFS_symbolicLinksPermitted */
+
+
+void PHYSFS_setChecksumVerification(int enable)
+{
+    verifyChecksums = enable;
+} /* PHYSFS_setChecksumVerification */
+
+
+int PHYSFS_getChecksumVerification(void)
+{
+    return verifyChecksums;
+} /* PHYSFS_getChecksumVerification */
+
+
+int __PHYSFS_checksumsEnabled(void)
+{
+    return verifyChecksums || verifyingArchive;
+} /* __PHYSFS_checksumsEnabled */
+
+
+void PHYSFS_setIndexingMode(PHYSFS_IndexingMode mode)
+{
+    indexingMode = mode;
+} /* PHYSFS_setIndexingMode */
+
+
+PHYSFS_IndexingMode PHYSFS_getIndexingMode(void)
+{
+    return indexingMode;
+} /* PHYSFS_getIndexingMode */
+
+
+void PHYSFS_setDirCaching(int enable)
+{
+    dirCaching = enable;
+} /* PHYSFS_setDirCaching */
+
+
+int PHYSFS_getDirCaching(void)
+{
+    return dirCaching;
+} /* PHYSFS_getDirCaching */
+
+
+int __PHYSFS_dirCachingEnabled(void)
+{
+    return dirCaching;
+} /* __PHYSFS_dirCachingEnabled */
+
+
+void PHYSFS_setIgnoreCase(int enable)
+{
+    ignoreCase = enable;
+} /* PHYSFS_setIgnoreCase */
+
+
+int PHYSFS_getIgnoreCase(void)
+{
+    return ignoreCase;
+} /* PHYSFS_getIgnoreCase */
+
+
+int __PHYSFS_ignoreCaseEnabled(void)
+{
+    return ignoreCase;
+} /* __PHYSFS_ignoreCaseEnabled */
+
+
+void PHYSFS_setLookupFilterBits(PHYSFS_uint32 bitsPerEntry)
+{
+    DirHandle *i;
+
+    if (bitsPerEntry > 64)
+        bitsPerEntry = 64;
+
+    if (!initialized)  /* no lock yet, but nothing mounted either. */
+    {
+        lookupFilterBits = bitsPerEntry;
+        return;
+    } /* if */
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    if (bitsPerEntry != lookupFilterBits)
+    {
+        lookupFilterBits = bitsPerEntry;
+        for (i = searchPath; i != NULL; i = i->next)
+            freeLookupFilter(i);  /* rebuilt on demand at the new size. */
+    } /* if */
+    __PHYSFS_platformReleaseMutex(stateLock);
+} /* PHYSFS_setLookupFilterBits */
+
+
+PHYSFS_uint32 PHYSFS_getLookupFilterBits(void)
+{
+    return lookupFilterBits;
+} /* PHYSFS_getLookupFilterBits */
+
+
+int PHYSFS_getLookupFilterStats(PHYSFS_LookupFilterStats *stats)
+{
+    DirHandle *i;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+    BAIL_IF(!stats, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    memset(stats, '\0', sizeof (*stats));
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        if (i->filterstate == LOOKUP_FILTER_READY)
+        {
+            stats->filters++;
+            stats->bytes += i->filterbits / 8;
+        } /* if */
+    } /* for */
+    stats->skipped = lookupFilterSkipped;
+    stats->checked = lookupFilterChecked;
+    __PHYSFS_platformReleaseMutex(stateLock);
+
+    return 1;
+} /* PHYSFS_getLookupFilterStats */
+
+
+/*
+ * Let an archiver answer "any symlinks in this path?" in one step: returns 1
+ *  if there aren't, 0 (with an error set) if there are, and -1 if
+ *  verifyPath() should stat each element itself.
+ */
+static int checkSymlinksFast(DirHandle *h, char *fname, const int allowMissing)
+{
+    if (!h->funcs->info.supportsSymlinks)
+        return 1;  /* can't have any, don't ask. */
+    else if (h->funcs == &__PHYSFS_Archiver_DIR)
+        return __PHYSFS_DIR_checkSymlinks(h->opaque, fname, allowMissing);
+    #if PHYSFS_SUPPORTS_ZIP
+    else if (h->funcs->openArchive == __PHYSFS_Archiver_ZIP.openArchive)
+        return __PHYSFS_ZIP_checkSymlinks(h->opaque, fname, allowMissing);
+    #endif
+    return -1;
+} /* checkSymlinksFast */
+
+
+/*
+ * Turn (*_fname), a sanitized path in the virtual tree, into the path
+ *  (h)'s archiver knows it by: skip (h)'s mount point and prepend its root
+ *  directory, if any, into the space before (*_fname). Returns zero with
+ *  PHYSFS_ERR_NOT_FOUND set if the path isn't under the mount point.
+ */
+static int toArchivePath(DirHandle *h, char **_fname, int mountmatched)
+{
+    char *fname = *_fname;
+
+    if (h->mountPoint != NULL)  /* NULL mountpoint means "/". */
+    {
+        const size_t mntpntlen = h->mountPointLen;
+        assert(mntpntlen > 1); /* root mount points should be NULL. */
+
+        /* the mount tree already matched it if it handed us (h). */
+        if (!mountmatched)
+        {
+            /* case-sensitive, like the mount tree and every other path. */
+            BAIL_IF(strncmp(h->mountPoint, fname, mntpntlen-1) != 0,
+                    PHYSFS_ERR_NOT_FOUND, 0);
+            BAIL_IF((fname[mntpntlen-1] != '/') && (fname[mntpntlen-1] != '\0'),
+                    PHYSFS_ERR_NOT_FOUND, 0);
+        } /* if */
+
+        fname += mntpntlen-1;  /* move to start of actual archive path. */
+        if (*fname == '/')
+            fname++;
+    } /* if */
+
+    /* prepend the root directory, if any. */
+    if (h->root)
+    {
+        const int isempty = (*fname == '\0');
+        fname -= h->rootlen + (isempty ? 0 : 1);
+        strcpy(fname, h->root);
+        if (!isempty)
+            fname[h->rootlen] = '/';
+    } /* if */
+
+    *_fname = fname;
+    return 1;
+} /* toArchivePath */
+
+
+typedef struct
+{
+    const char *name;  /* path element we're looking for. */
+    char *found;  /* a name that only differs by case goes here. */
+    int matched;  /* 1 if (found) is filled in, 2 if (name) is there as-is. */
+} FixCaseData;
+
+static PHYSFS_EnumerateCallbackResult fixCaseCallback(void *_data,
+                                    const char *origdir, const char *fname)
+{
+    FixCaseData *data = (FixCaseData *) _data;
+    if (strcmp(fname, data->name) == 0)
+    {
+        data->matched = 2;
+        return PHYSFS_ENUM_STOP;
+    } /* if */
+
+    /* first one wins if several match, but keep looking for an exact one. */
+    else if ((data->matched == 0) && (strlen(fname) == strlen(data->name)) &&
+             (PHYSFS_utf8stricmp(fname, data->name) == 0))
+    {
+        strcpy(data->found, fname);
+        data->matched = 1;
+    } /* else if */
+
+    return PHYSFS_ENUM_OK;
+} /* fixCaseCallback */
+
+
+/*
+ * fixCase() for archivers without an index we can search: list each
+ *  directory along (fname) to find the next element in any case. This is
+ *  what extras/ignorecase.c does, but only once the path is known not to be
+ *  there as-is. (fname) only changes if all of it was found.
+ */
+static void fixCaseByEnumerating(DirHandle *h, char *fname)
+{
+    const size_t len = strlen(fname);
+    PHYSFS_Stat statbuf;
+    FixCaseData data;
+    char *path;
+    char *start;
+
+    if (h->funcs->stat(h->opaque, fname, &statbuf))
+        return;  /* exact matches win. */
+
+    path = (char *) __PHYSFS_smallAlloc((len + 1) * 2);
+    if (!path)
+        return;  /* just look for it as-is. */
+
+    strcpy(path, fname);
+    data.found = path + len + 1;
+    start = path;
+    while (1)
+    {
+        char *end = strchr(start, '/');
+        PHYSFS_EnumerateCallbackResult rc;
+
+        if (end != NULL)
+            *end = '\0';
+        if (start != path)
+            start[-1] = '\0';
+
+        data.name = start;
+        data.matched = 0;
+        rc = h->funcs->enumerate(h->opaque, (start == path) ? "" : path,
+                                 fixCaseCallback, "", &data);
+
+        if (start != path)
+            start[-1] = '/';
+        if (end != NULL)
+            *end = '/';
+
+        if ((rc == PHYSFS_ENUM_ERROR) || (data.matched == 0))
+            break;  /* not there in any case. */
+        else if (data.matched == 1)
+            memcpy(start, data.found, strlen(data.found));
+
+        if (end == NULL)
+        {
+            memcpy(fname, path, len);
+            break;
+        } /* if */
+
+        start = end + 1;
+    } /* while */
+
+    __PHYSFS_smallFree(path);
+} /* fixCaseByEnumerating */
+
+
+static int archiveDirTree(DirHandle *h, __PHYSFS_DirTree **tree);
+
+/*
+ * For PHYSFS_setIgnoreCase() mounts: if (fname), an archive path, isn't in
+ *  (h) as-is, but one that only differs by case is, rewrite (fname) in place
+ *  to name that. It can't grow, so only matches that are the same length in
+ *  bytes count. If nothing matches, (fname) is left alone, and the lookup
+ *  fails like it always did. Lookups stop at the first archive that has
+ *  the path, so only ones that go on through the whole search path (like
+ *  enumerations) need to put (fname) back before the next archive sees it.
+ */
+static void fixCase(DirHandle *h, char *fname)
+{
+    __PHYSFS_DirTree *tree;
+
+    if (*fname == '\0')
+        return;  /* the root is always there. */
+
+    else if (h->funcs == &__PHYSFS_Archiver_DIR)
+    {
+        if (__PHYSFS_DIR_fixCase(h->opaque, fname) != -1)
+            return;
+    } /* else if */
+
+    else if (archiveDirTree(h, &tree))
+    {
+        if (tree != NULL)
+            __PHYSFS_DirTreeFixCase(tree, fname);
+        return;  /* if the index failed, the archiver can't find it either. */
+    } /* else if */
+
+    fixCaseByEnumerating(h, fname);
+} /* fixCase */
+
+
+/*
+ * Verify that (fname) (in platform-independent notation), in relation
+ *  to (h) is secure. That means that each element of fname is checked
+ *  for symlinks (if they aren't permitted). This also allows for quick
+ *  rejection of files that exist outside an archive's mountpoint.
+ *
+ * With some exceptions (like PHYSFS_mkdir(), which builds multiple subdirs
+ *  at a time, or opening a file for writing, which creates the last
+ *  element), you should always pass zero for "allowMissing" for efficiency.
+ *  Zero means the caller only cares about paths that exist, so this may
+ *  fail with PHYSFS_ERR_NOT_FOUND as soon as it sees that one doesn't.
+ *
+ * (fname) must point to an output from sanitizePlatformIndependentPath(),
+ *  since it will make sure that path names are in the right format for
+ *  passing certain checks. It will also do checks for "insecure" pathnames
+ *  like ".." which should be done once instead of once per archive. This also
+ *  gives us license to treat (fname) as scratch space in this function.
+ *
+ * (fname)'s buffer must have enough space available before it for this
+ *  function to prepend any root directory for this DirHandle.
+ *
+ * Returns non-zero if string is safe, zero if there's a security issue.
+ *  PHYSFS_getLastError() will specify what was wrong. (*fname) will be
+ *  updated to point past any mount point elements so it is prepared to
+ *  be used with the archiver directly. On case-insensitive mounts, it might
+ *  also be rewritten to the case the archive has it in; see fixCase().
+ *
+ * Pass a non-zero (mountmatched) if (fname) is already known to be under
+ *  (h)'s mount point, like MountCursor's lastmatched, to skip checking it.
+ */
+static int verifyMountedPath(DirHandle *h, char **_fname, int allowMissing,
+                             int mountmatched)
+{
+    char *fname;
+    int retval = 1;
+    char *start;
+    char *end;
+
+    if ((**_fname == '\0') && (!h->root))  /* quick rejection. */
+        return 1;
+
+    BAIL_IF_ERRPASS(!toArchivePath(h, _fname, mountmatched), 0);
+    fname = *_fname;
+
+    if (h->ignorecase)
+        fixCase(h, fname);
+
+    start = fname;
+    if (!allowSymLinks)
+    {
+        const int fast = checkSymlinksFast(h, fname, allowMissing);
+        if (fast != -1)
+            return fast ? retval : 0;
+
+        while (1)
+        {
+            PHYSFS_Stat statbuf;
+            int rc = 0;
+            end = strchr(start, '/');
+
+            if (end != NULL) *end = '\0';
+            rc = h->funcs->stat(h->opaque, fname, &statbuf);
+            if (rc)
+                rc = (statbuf.filetype == PHYSFS_FILETYPE_SYMLINK);
+            else if (currentErrorCode() == PHYSFS_ERR_NOT_FOUND)
+                retval = 0;
+
+            if (end != NULL) *end = '/';
+
+            /* insecure path (has a disallowed symlink in it)? */
+            BAIL_IF(rc, PHYSFS_ERR_SYMLINK_FORBIDDEN, 0);
+
+            /* break out early if path element is missing. */
+            if (!retval)
+            {
+                /*
+                 * We need to clear it if it's the last element of the path,
+                 *  since this might be a non-existant file we're opening
+                 *  for writing...
+                 */
+                if ((end == NULL) || (allowMissing))
+                    retval = 1;
+                break;
+            } /* if */
+
+            if (end == NULL)
+                break;
+
+            start = end + 1;
+        } /* while */
+    } /* if */
+
+    return retval;
+} /* verifyMountedPath */
+
+
+static int verifyPath(DirHandle *h, char **_fname, int allowMissing)
+{
+    return verifyMountedPath(h, _fname, allowMissing, 0);
+} /* verifyPath */
+
+
+/* This must hold the stateLock before calling. */
+static int doMkdir(const char *_dname, char *dname)
+{
+    DirHandle *h = writeDir;
+    char *start;
+    char *end;
+    int retval = 0;
+    int exists = 1;  /* force existance check on first path element. */
+
+    assert(h != NULL);
+
+    BAIL_IF_ERRPASS(!sanitizePlatformIndependentPathWithRoot(h, _dname, dname), 0);
+    BAIL_IF_ERRPASS(!verifyPath(h, &dname, 1), 0);
+
+    start = dname;
+    while (1)
+    {
+        end = strchr(start, '/');
+        if (end != NULL)
+            *end = '\0';
+
+        /* only check for existance if all parent dirs existed, too... */
+        if (exists)
+        {
+            PHYSFS_Stat statbuf;
+            const int rc = h->funcs->stat(h->opaque, dname, &statbuf);
+            if ((!rc) && (currentErrorCode() == PHYSFS_ERR_NOT_FOUND))
+                exists = 0;
+            /* verifyPath made sure that (dname) doesn't have symlinks if they aren't
+               allowed, but it's possible the mounted writeDir itself has symlinks in it,
+               (for example "/var" on iOS is a symlink, and the prefpath will be somewhere
+               under that)...if we mounted that writeDir, we must allow those symlinks here
+               unconditionally. */
+            retval = ( (rc) && ((statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY) || (statbuf.filetype == PHYSFS_FILETYPE_SYMLINK)) );
+        } /* if */
+
+        if (!exists)
+            retval = h->funcs->mkdir(h->opaque, dname);
+
+        if (!retval)
+            break;
+
+        if (end == NULL)
+            break;
+
+        *end = '/';
+        start = end + 1;
+    } /* while */
+
+    return retval;
+} /* doMkdir */
+
+
+int PHYSFS_mkdir(const char *_dname)
+{
+    int retval = 0;
+    char *dname;
+    size_t len;
+
+    BAIL_IF(!_dname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    BAIL_IF_MUTEX(!writeDir, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
+    len = strlen(_dname) + dirHandleRootLen(writeDir) + 1;
+    dname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!dname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    retval = doMkdir(_dname, dname);
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(dname);
+    return retval;
+} /* PHYSFS_mkdir */
+
+
+/* This must hold the stateLock before calling. */
+static int doDelete(const char *_fname, char *fname)
+{
+    DirHandle *h = writeDir;
+    BAIL_IF_ERRPASS(!sanitizePlatformIndependentPathWithRoot(h, _fname, fname), 0);
+    BAIL_IF_ERRPASS(!verifyPath(h, &fname, 0), 0);
+    return h->funcs->remove(h->opaque, fname);
+} /* doDelete */
+
+
+int PHYSFS_delete(const char *_fname)
+{
+    int retval;
+    char *fname;
+    size_t len;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    BAIL_IF_MUTEX(!writeDir, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
+    len = strlen(_fname) + dirHandleRootLen(writeDir) + 1;
+    fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    retval = doDelete(_fname, fname);
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(fname);
+    return retval;
+} /* PHYSFS_delete */
+
+
+/*
+ * Find the archive that has (fname), a sanitized path with longest_root+1
+ *  bytes of room before it. (compiled) is (fname)'s PHYSFS_Path, or NULL.
+ *  MAKE SURE you hold stateLock before calling this!
+ */
+static DirHandle *findRealDirHandle(char *fname, PHYSFS_Path *compiled)
+{
+    DirHandle *retval = NULL;
+    LookupFilterKey key;
+    MountCursor cursor;
+    DirHandle *i;
+
+    initLookupFilterKey(&key);
+    if (compiled != NULL)
+        primeLookupFilterKey(&key, fname, compiled->hash, compiled->ascii);
+
+    for (i = firstMountCandidate(&cursor, fname, compiled); i != NULL;
+         i = nextMountCandidate(&cursor))
+    {
+        char *arcfname = fname;
+        if (partOfMountPoint(i, arcfname))
+        {
+            retval = i;
+            break;
+        } /* if */
+        else if (lookupFilterMightHave(i, arcfname, &key) &&
+                 verifyMountedPath(i, &arcfname, 0, cursor.lastmatched))
+        {
+            PHYSFS_Stat statbuf;
+            if (i->funcs->stat(i->opaque, arcfname, &statbuf))
+            {
+                retval = i;
+                break;
+            } /* if */
+        } /* if */
+    } /* for */
+
+    if (!retval)
+        finishLookup(&cursor, &key);
+
+    return retval;
+} /* findRealDirHandle */
+
+
+static DirHandle *getRealDirHandle(const char *_fname)
+{
+    DirHandle *retval = NULL;
+    char *allocated_fname = NULL;
+    char *fname = NULL;
+    size_t len;
+
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    len = strlen(_fname) + longest_root + 2;
+    allocated_fname = __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, NULL);
+    fname = allocated_fname + longest_root + 1;
+    if (sanitizePlatformIndependentPath(_fname, fname))
+        retval = findRealDirHandle(fname, NULL);
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return retval;
+} /* getRealDirHandle */
+
+const char *PHYSFS_getRealDir(const char *fname)
+{
+    DirHandle *dh = getRealDirHandle(fname);
+    return dh ? dh->dirName : NULL;
+} /* PHYSFS_getRealDir */
+
+
+static PHYSFS_EnumerateCallbackResult enumFilesCallback(void *data,
+                                        const char *origdir, const char *str)
+{
+    EnumStringListCallbackData *pecd = (EnumStringListCallbackData *) data;
+
+    /*
+     * Just collect everything; finishStringList() sorts and drops the names
+     *  that more than one archive supplied in one pass at the end, instead
+     *  of keeping the list sorted as we go.
+     */
+    if (!addToStringList(pecd, str))
+        return PHYSFS_ENUM_ERROR;  /* better luck next time. */
+
+    return PHYSFS_ENUM_OK;
+} /* enumFilesCallback */
+
+
+char **PHYSFS_enumerateFiles(const char *path)
+{
+    EnumStringListCallbackData ecd;
+    memset(&ecd, '\0', sizeof (ecd));
+    if (!PHYSFS_enumerate(path, enumFilesCallback, &ecd))
+    {
+        const PHYSFS_ErrorCode errcode = currentErrorCode();
+        freeStringListData(&ecd);
+        BAIL_IF(errcode == PHYSFS_ERR_APP_CALLBACK, ecd.errcode, NULL);
+        return NULL;
+    } /* if */
+
+    return finishStringList(&ecd, 1);
+} /* PHYSFS_enumerateFiles */
+
+
+/*
+ * Broke out to seperate function so we can use stack allocation gratuitously.
+ */
+static PHYSFS_EnumerateCallbackResult enumerateFromMountPoint(DirHandle *i,
+                                    const char *arcfname,
+                                    PHYSFS_EnumerateCallback callback,
+                                    const char *_fname, void *data)
+{
+    PHYSFS_EnumerateCallbackResult retval;
+    const size_t len = strlen(arcfname);
+    char *ptr = NULL;
+    char *end = NULL;
+    const size_t slen = strlen(i->mountPoint) + 1;
+    char *mountPoint = (char *) __PHYSFS_smallAlloc(slen);
+
+    BAIL_IF(!mountPoint, PHYSFS_ERR_OUT_OF_MEMORY, PHYSFS_ENUM_ERROR);
+
+    strcpy(mountPoint, i->mountPoint);
+    ptr = mountPoint + ((len) ? len + 1 : 0);
+    end = strchr(ptr, '/');
+    assert(end);  /* should always find a terminating '/'. */
+    *end = '\0';
+    retval = callback(data, _fname, ptr);
+    __PHYSFS_smallFree(mountPoint);
+
+    BAIL_IF(retval == PHYSFS_ENUM_ERROR, PHYSFS_ERR_APP_CALLBACK, retval);
+    return retval;
+} /* enumerateFromMountPoint */
+
+
+typedef struct SymlinkFilterData
+{
+    PHYSFS_EnumerateCallback callback;
+    void *callbackData;
+    DirHandle *dirhandle;
+    const char *arcfname;
+    PHYSFS_ErrorCode errcode;
+} SymlinkFilterData;
+
+static PHYSFS_EnumerateCallbackResult enumCallbackFilterSymLinks(void *_data,
+                                    const char *origdir, const char *fname)
+{
+    SymlinkFilterData *data = (SymlinkFilterData *) _data;
+    const DirHandle *dh = data->dirhandle;
+    const char *arcfname = data->arcfname;
+    PHYSFS_Stat statbuf;
+    const char *trimmedDir = (*arcfname == '/') ? (arcfname + 1) : arcfname;
+    const size_t slen = strlen(trimmedDir) + strlen(fname) + 2;
+    char *path = (char *) __PHYSFS_smallAlloc(slen);
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+
+    if (path == NULL)
+    {
+        data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+        return PHYSFS_ENUM_ERROR;
+    } /* if */
+
+    snprintf(path, slen, "%s%s%s", trimmedDir, *trimmedDir ? "/" : "", fname);
+
+    if (!dh->funcs->stat(dh->opaque, path, &statbuf))
+    {
+        data->errcode = currentErrorCode();
+        retval = PHYSFS_ENUM_ERROR;
+    } /* if */
+    else
+    {
+        /* Pass it on to the application if it's not a symlink. */
+        if (statbuf.filetype != PHYSFS_FILETYPE_SYMLINK)
+        {
+            retval = data->callback(data->callbackData, origdir, fname);
+            if (retval == PHYSFS_ENUM_ERROR)
+                data->errcode = PHYSFS_ERR_APP_CALLBACK;
+        } /* if */
+    } /* else */
+
+    __PHYSFS_smallFree(path);
+
+    return retval;
+} /* enumCallbackFilterSymLinks */
+
+
+static void initStat(PHYSFS_Stat *stat)
+{
+    /* set some sane defaults... */
+    stat->filesize = -1;
+    stat->modtime = -1;
+    stat->createtime = -1;
+    stat->accesstime = -1;
+    stat->filetype = PHYSFS_FILETYPE_OTHER;
+    stat->readonly = 1;
+} /* initStat */
+
+
+typedef struct EnumStatData
+{
+    PHYSFS_EnumerateStatCallback callback;
+    void *callbackData;
+    DirHandle *dirhandle;
+    const char *arcfname;
+    PHYSFS_ErrorCode errcode;
+} EnumStatData;
+
+static PHYSFS_EnumerateCallbackResult enumStatCallback(void *_data,
+                                    const char *origdir, const char *fname,
+                                    const PHYSFS_Stat *stat)
+{
+    EnumStatData *data = (EnumStatData *) _data;
+    PHYSFS_EnumerateCallbackResult retval;
+
+    if ((!allowSymLinks) && (stat->filetype == PHYSFS_FILETYPE_SYMLINK))
+        return PHYSFS_ENUM_OK;  /* same as enumCallbackFilterSymLinks(). */
+
+    retval = data->callback(data->callbackData, origdir, fname, stat,
+                            data->dirhandle->dirName);
+    if (retval == PHYSFS_ENUM_ERROR)
+        data->errcode = PHYSFS_ERR_APP_CALLBACK;
     return retval;
-} /* __PHYSFS_strdup */
+} /* enumStatCallback */
 
 
-PHYSFS_uint32 __PHYSFS_hashString(const char *str)
+/* for archivers that can't stat while they enumerate: ask for each child. */
+static PHYSFS_EnumerateCallbackResult enumStatEachChild(void *_data,
+                                    const char *origdir, const char *fname)
 {
-    PHYSFS_uint32 hash = 5381;
-    while (1)
+    EnumStatData *data = (EnumStatData *) _data;
+    const DirHandle *dh = data->dirhandle;
+    const char *arcfname = data->arcfname;
+    PHYSFS_Stat statbuf;
+    const char *trimmedDir = (*arcfname == '/') ? (arcfname + 1) : arcfname;
+    const size_t slen = strlen(trimmedDir) + strlen(fname) + 2;
+    char *path = (char *) __PHYSFS_smallAlloc(slen);
+    PHYSFS_EnumerateCallbackResult retval;
+
+    if (path == NULL)
     {
-        const char ch = *(str++);
-        if (ch == 0)
-            break;
-        hash = ((hash << 5) + hash) ^ ch;
-    } /* while */
-    return hash;
-} /* __PHYSFS_hashString */
+        data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+        return PHYSFS_ENUM_ERROR;
+    } /* if */
 
+    snprintf(path, slen, "%s%s%s", trimmedDir, *trimmedDir ? "/" : "", fname);
 
-PHYSFS_uint32 __PHYSFS_hashStringCaseFold(const char *str)
-{
-    PHYSFS_uint32 hash = 5381;
-    while (1)
+    initStat(&statbuf);
+    if (!dh->funcs->stat(dh->opaque, path, &statbuf))
     {
-        const PHYSFS_uint32 cp = __PHYSFS_utf8codepoint(&str);
-        if (cp == 0)
-            break;
-        else
-        {
-            PHYSFS_uint32 folded[3];
-            const int numbytes = (int) (PHYSFS_caseFold(cp, folded) * sizeof (PHYSFS_uint32));
-            const char *bytes = (const char *) folded;
-            int i;
-            for (i = 0; i < numbytes; i++)
-                hash = ((hash << 5) + hash) ^ *(bytes++);
-        } /* else */
-    } /* while */
+        data->errcode = currentErrorCode();
+        retval = PHYSFS_ENUM_ERROR;
+    } /* if */
+    else
+    {
+        retval = enumStatCallback(data, origdir, fname, &statbuf);
+    } /* else */
 
-    return hash;
-} /* __PHYSFS_hashStringCaseFold */
+    __PHYSFS_smallFree(path);
+
+    return retval;
+} /* enumStatEachChild */
 
 
-PHYSFS_uint32 __PHYSFS_hashStringCaseFoldUSAscii(const char *str)
+/* what doStat() would say about the next element of a mountpoint. */
+static PHYSFS_EnumerateCallbackResult enumStatMountPoint(void *_data,
+                                    const char *origdir, const char *fname)
 {
-    PHYSFS_uint32 hash = 5381;
-    while (1)
+    EnumStatData *data = (EnumStatData *) _data;
+    const DirHandle *dh = data->dirhandle;
+    const size_t len = strlen(data->arcfname);
+    const size_t elemend = (len ? len + 1 : 0) + strlen(fname) + 1;
+    PHYSFS_Stat statbuf;
+
+    initStat(&statbuf);
+
+    /* the last element is the archive's root; the rest are made up. */
+    if ((elemend != strlen(dh->mountPoint)) ||
+        (!dh->funcs->stat(dh->opaque, dh->root ? dh->root : "", &statbuf)))
     {
-        char ch = *(str++);
-        if (ch == 0)
-            break;
-        else if ((ch >= 'A') && (ch <= 'Z'))
-            ch -= ('A' - 'a');
+        initStat(&statbuf);
+        statbuf.filetype = PHYSFS_FILETYPE_DIRECTORY;
+        statbuf.readonly = 1;
+    } /* if */
 
-        hash = ((hash << 5) + hash) ^ ch;
-    } /* while */
-    return hash;
-} /* __PHYSFS_hashStringCaseFoldUSAscii */
+    return enumStatCallback(data, origdir, fname, &statbuf);
+} /* enumStatMountPoint */
 
 
-/* MAKE SURE you hold stateLock before calling this! */
-static int doRegisterArchiver(const PHYSFS_Archiver *_archiver)
+static PHYSFS_EnumerateCallbackResult enumerateArchiveWithStat(DirHandle *h,
+                                            const char *arcfname,
+                                            const char *origdir,
+                                            EnumStatData *data)
 {
-    const PHYSFS_uint32 maxver = CURRENT_PHYSFS_ARCHIVER_API_VERSION;
-    const size_t len = (numArchivers + 2) * sizeof (void *);
-    PHYSFS_Archiver *archiver = NULL;
-    PHYSFS_ArchiveInfo *info = NULL;
-    const char *ext = NULL;
-    void *ptr = NULL;
-    size_t i;
+    PHYSFS_EnumerateCallbackResult retval;
+    void *opaque = h->opaque;
 
-    BAIL_IF(!_archiver, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(_archiver->version > maxver, PHYSFS_ERR_UNSUPPORTED, 0);
-    BAIL_IF(!_archiver->info.extension, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->info.description, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->info.author, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->info.url, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->openArchive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->enumerate, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->openRead, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->openWrite, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->openAppend, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->remove, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->mkdir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->closeArchive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!_archiver->stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    data->dirhandle = h;
+    data->arcfname = arcfname;
+    data->errcode = PHYSFS_ERR_OK;
 
-    ext = _archiver->info.extension;
-    for (i = 0; i < numArchivers; i++)
+    if (h->funcs == &__PHYSFS_Archiver_DIR)
     {
-        if (PHYSFS_utf8stricmp(archiveInfo[i]->extension, ext) == 0)
-            BAIL(PHYSFS_ERR_DUPLICATE, 0);
-    } /* for */
-
-    /* make a copy of the data. */
-    archiver = (PHYSFS_Archiver *) allocator.Malloc(sizeof (*archiver));
-    GOTO_IF(!archiver, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
-
-    /* Must copy sizeof (OLD_VERSION_OF_STRUCT) when version changes! */
-    memcpy(archiver, _archiver, sizeof (*archiver));
+        retval = __PHYSFS_DIR_enumerateStat(opaque, arcfname,
+                                            enumStatCallback, origdir, data);
+    } /* if */
+    #if PHYSFS_SUPPORTS_ZIP
+    else if (h->funcs->openArchive == __PHYSFS_Archiver_ZIP.openArchive)
+    {
+        retval = __PHYSFS_ZIP_enumerateStat(opaque, arcfname,
+                                            enumStatCallback, origdir, data);
+    } /* else if */
+    #endif
+    else if (h->funcs->stat == UNPK_stat)
+    {
+        retval = UNPK_enumerateStat(opaque, arcfname,
+                                    enumStatCallback, origdir, data);
+    } /* else if */
+    else
+    {
+        retval = h->funcs->enumerate(opaque, arcfname, enumStatEachChild,
+                                     origdir, data);
+    } /* else */
 
-    info = (PHYSFS_ArchiveInfo *) &archiver->info;
-    memset(info, '\0', sizeof (*info));  /* NULL in case an alloc fails. */
-    #define CPYSTR(item) \
-        info->item = __PHYSFS_strdup(_archiver->info.item); \
-        GOTO_IF(!info->item, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
-    CPYSTR(extension);
-    CPYSTR(description);
-    CPYSTR(author);
-    CPYSTR(url);
-    info->supportsSymlinks = _archiver->info.supportsSymlinks;
-    #undef CPYSTR
+    /* archivers only know the callback failed; say why. */
+    if ((retval == PHYSFS_ENUM_ERROR) && (data->errcode != PHYSFS_ERR_OK))
+        PHYSFS_setErrorCode(data->errcode);
 
-    ptr = allocator.Realloc(archiveInfo, len);
-    GOTO_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
-    archiveInfo = (PHYSFS_ArchiveInfo **) ptr;
+    return retval;
+} /* enumerateArchiveWithStat */
 
-    ptr = allocator.Realloc(archivers, len);
-    GOTO_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, regfailed);
-    archivers = (PHYSFS_Archiver **) ptr;
 
-    archiveInfo[numArchivers] = info;
-    archiveInfo[numArchivers + 1] = NULL;
+/*
+ * Filtered enumeration.
+ *
+ * Names are checked against the filter before anything else happens to
+ *  them. For indexed archives, the filter goes all the way down: a
+ *  directory's children are sorted, so if every match has to start with
+ *  the same literal text, we only look at the children that do.
+ */
 
-    archivers[numArchivers] = archiver;
-    archivers[numArchivers + 1] = NULL;
+struct PHYSFS_Filter
+{
+    PHYSFS_FilterType type;
+    int caseSensitive;
+    PHYSFS_uint32 count;
+    size_t *lens;  /* strlen() of each pattern. */
+    char **patterns;
+    const char *prefix;  /* what every match starts with (not terminated). */
+    size_t prefixlen;  /* zero if there's no such thing. */
+};
 
-    numArchivers++;
 
-    return 1;
+static int filterStrEq(const char *a, const char *b, size_t len,
+                       const int caseSensitive)
+{
+    if (caseSensitive)
+        return (memcmp(a, b, len) == 0);
 
-regfailed:
-    if (info != NULL)
+    while (len--)
     {
-        allocator.Free((void *) info->extension);
-        allocator.Free((void *) info->description);
-        allocator.Free((void *) info->author);
-        allocator.Free((void *) info->url);
-    } /* if */
-    allocator.Free(archiver);
-
-    return 0;
-} /* doRegisterArchiver */
-
+        PHYSFS_uint8 ch1 = (PHYSFS_uint8) *(a++);
+        PHYSFS_uint8 ch2 = (PHYSFS_uint8) *(b++);
+        if ((ch1 >= 'A') && (ch1 <= 'Z'))
+            ch1 -= ('A' - 'a');
+        if ((ch2 >= 'A') && (ch2 <= 'Z'))
+            ch2 -= ('A' - 'a');
+        if (ch1 != ch2)
+            return 0;
+    } /* while */
 
-int PHYSFS_registerArchiver(const PHYSFS_Archiver *archiver)
-{
-    int retval;
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
-    __PHYSFS_platformGrabMutex(stateLock);
-    retval = doRegisterArchiver(archiver);
-    __PHYSFS_platformReleaseMutex(stateLock);
-    return retval;
-} /* PHYSFS_registerArchiver */
+    return 1;
+} /* filterStrEq */
 
 
-int PHYSFS_deregisterArchiver(const char *ext)
+/* '*' backtracks to the most recent star only, which is all it ever needs. */
+static int globMatches(const char *name, const char *pattern,
+                       const int caseSensitive)
 {
-    size_t i;
-
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
-    BAIL_IF(!ext, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    const char *starpattern = NULL;
+    const char *starname = NULL;
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    for (i = 0; i < numArchivers; i++)
+    while (*name)
     {
-        if (PHYSFS_utf8stricmp(archiveInfo[i]->extension, ext) == 0)
+        if (*pattern == '*')
         {
-            const int retval = doDeregisterArchiver(i);
-            __PHYSFS_platformReleaseMutex(stateLock);
-            return retval;
+            starpattern = ++pattern;
+            starname = name;
         } /* if */
-    } /* for */
-    __PHYSFS_platformReleaseMutex(stateLock);
-
-    BAIL(PHYSFS_ERR_NOT_FOUND, 0);
-} /* PHYSFS_deregisterArchiver */
+        else if (*pattern == '?')  /* one whole UTF-8 sequence. */
+        {
+            pattern++;
+            name++;
+            while ((*name & 0xC0) == 0x80)
+                name++;
+        } /* else if */
+        else if ((*pattern) && (filterStrEq(pattern, name, 1, caseSensitive)))
+        {
+            pattern++;
+            name++;
+        } /* else if */
+        else if (starpattern != NULL)  /* let the last '*' eat one more. */
+        {
+            pattern = starpattern;
+            name = ++starname;
+        } /* else if */
+        else
+        {
+            return 0;
+        } /* else */
+    } /* while */
 
+    while (*pattern == '*')
+        pattern++;
 
-const PHYSFS_ArchiveInfo **PHYSFS_supportedArchiveTypes(void)
-{
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, NULL);
-    return (const PHYSFS_ArchiveInfo **) archiveInfo;
-} /* PHYSFS_supportedArchiveTypes */
+    return (*pattern == '\0');
+} /* globMatches */
 
 
-void PHYSFS_freeList(void *list)
+static int filterMatches(const void *_filter, const char *name)
 {
-    void **i;
-    if (list != NULL)
-    {
-        for (i = (void **) list; *i != NULL; i++)
-            allocator.Free(*i);
+    const PHYSFS_Filter *filter = (const PHYSFS_Filter *) _filter;
+    const int cs = filter->caseSensitive;
+    const size_t len = (filter->type == PHYSFS_FILTER_GLOB) ? 0 : strlen(name);
+    PHYSFS_uint32 i;
 
-        allocator.Free(list);
-    } /* if */
-} /* PHYSFS_freeList */
+    for (i = 0; i < filter->count; i++)
+    {
+        const char *pattern = filter->patterns[i];
+        const size_t patternlen = filter->lens[i];
 
+        switch (filter->type)
+        {
+            case PHYSFS_FILTER_SUFFIX:
+                if ((len >= patternlen) &&
+                    (filterStrEq(name + (len - patternlen), pattern, patternlen, cs)))
+                    return 1;
+                break;
 
-const char *PHYSFS_getDirSeparator(void)
-{
-    static char retval[2] = { __PHYSFS_platformDirSeparator, '\0' };
-    return retval;
-} /* PHYSFS_getDirSeparator */
+            case PHYSFS_FILTER_PREFIX:
+                if ((len >= patternlen) && (filterStrEq(name, pattern, patternlen, cs)))
+                    return 1;
+                break;
 
+            case PHYSFS_FILTER_GLOB:
+                if (globMatches(name, pattern, cs))
+                    return 1;
+                break;
+        } /* switch */
+    } /* for */
 
-char **PHYSFS_getCdRomDirs(void)
-{
-    return doEnumStringList(__PHYSFS_platformDetectAvailableCDs);
-} /* PHYSFS_getCdRomDirs */
+    return 0;
+} /* filterMatches */
 
 
-void PHYSFS_getCdRomDirsCallback(PHYSFS_StringCallback callback, void *data)
+PHYSFS_Filter *PHYSFS_compileFilter(PHYSFS_FilterType type,
+                                    const char * const *patterns,
+                                    PHYSFS_uint32 count, int caseSensitive)
 {
-    __PHYSFS_platformDetectAvailableCDs(callback, data);
-} /* PHYSFS_getCdRomDirsCallback */
+    PHYSFS_Filter *retval;
+    size_t len = sizeof (PHYSFS_Filter);
+    char *ptr;
+    PHYSFS_uint32 i;
 
+    BAIL_IF((type != PHYSFS_FILTER_SUFFIX) && (type != PHYSFS_FILTER_PREFIX) &&
+            (type != PHYSFS_FILTER_GLOB), PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(!patterns, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(count == 0, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
 
-const char *PHYSFS_getPrefDir(const char *org, const char *app)
-{
-    const char dirsep = __PHYSFS_platformDirSeparator;
-    PHYSFS_Stat statbuf;
-    char *ptr = NULL;
-    char *endstr = NULL;
+    for (i = 0; i < count; i++)
+    {
+        BAIL_IF(!patterns[i], PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+        len += sizeof (size_t) + sizeof (char *) + strlen(patterns[i]) + 1;
+    } /* for */
 
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
-    BAIL_IF(!org, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
-    BAIL_IF(*org == '\0', PHYSFS_ERR_INVALID_ARGUMENT, NULL);
-    BAIL_IF(!app, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
-    BAIL_IF(*app == '\0', PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    /* everything in one block: the struct, (lens), (patterns), strings. */
+    retval = (PHYSFS_Filter *) allocator.Malloc(len);
+    BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    retval->type = type;
+    retval->caseSensitive = caseSensitive ? 1 : 0;
+    retval->count = count;
+    retval->lens = (size_t *) (retval + 1);
+    retval->patterns = (char **) (retval->lens + count);
+    ptr = (char *) (retval->patterns + count);
+
+    for (i = 0; i < count; i++)
+    {
+        retval->lens[i] = strlen(patterns[i]);
+        retval->patterns[i] = ptr;
+        memcpy(ptr, patterns[i], retval->lens[i] + 1);
+        ptr += retval->lens[i] + 1;
+    } /* for */
 
-    allocator.Free(prefDir);
-    prefDir = __PHYSFS_platformCalcPrefDir(org, app);
-    BAIL_IF_ERRPASS(!prefDir, NULL);
+    /* the literal text every match has to start with, if any. */
+    retval->prefix = retval->patterns[0];
+    retval->prefixlen = 0;
+    if ((caseSensitive) && (type != PHYSFS_FILTER_SUFFIX))
+    {
+        const char *first = retval->patterns[0];
+        size_t prefixlen = retval->lens[0];
 
-    assert(strlen(prefDir) > 0);
-    endstr = prefDir + (strlen(prefDir) - 1);
-    assert(*endstr == dirsep);
-    *endstr = '\0';  /* mask out the final dirsep for now. */
+        if (type == PHYSFS_FILTER_GLOB)
+            prefixlen = strcspn(first, "*?");
 
-    if (!__PHYSFS_platformStat(prefDir, &statbuf, 1))
-    {
-        for (ptr = strchr(prefDir, dirsep); ptr; ptr = strchr(ptr+1, dirsep))
+        for (i = 1; i < count; i++)
         {
-            *ptr = '\0';
-            __PHYSFS_platformMkDir(prefDir);
-            *ptr = dirsep;
+            const char *pattern = retval->patterns[i];
+            size_t j;
+            /* (first) has no wildcards in this range, so neither will this. */
+            for (j = 0; (j < prefixlen) && (pattern[j] == first[j]); j++) {}
+            prefixlen = j;
         } /* for */
 
-        if (!__PHYSFS_platformMkDir(prefDir))
-        {
-            allocator.Free(prefDir);
-            prefDir = NULL;
-        } /* if */
-    } /* if */
-
-    *endstr = dirsep;  /* readd the final dirsep. */
+        retval->prefixlen = prefixlen;
+    } /* if */
 
-    return prefDir;
-} /* PHYSFS_getPrefDir */
+    return retval;
+} /* PHYSFS_compileFilter */
 
 
-const char *PHYSFS_getBaseDir(void)
+void PHYSFS_freeFilter(PHYSFS_Filter *filter)
 {
-    return baseDir;   /* this is calculated in PHYSFS_init()... */
-} /* PHYSFS_getBaseDir */
+    allocator.Free(filter);
+} /* PHYSFS_freeFilter */
 
 
-const char *__PHYSFS_getUserDir(void)  /* not deprecated internal version. */
+typedef struct FilterCallbackData
 {
-    return userDir;   /* this is calculated in PHYSFS_init()... */
-} /* __PHYSFS_getUserDir */
-
+    const PHYSFS_Filter *filter;
+    PHYSFS_EnumerateCallback callback;
+    void *callbackData;
+} FilterCallbackData;
 
-const char *PHYSFS_getUserDir(void)
+static PHYSFS_EnumerateCallbackResult enumCallbackFilterNames(void *_data,
+                                    const char *origdir, const char *fname)
 {
-    return __PHYSFS_getUserDir();
-} /* PHYSFS_getUserDir */
+    const FilterCallbackData *data = (const FilterCallbackData *) _data;
+    if (!filterMatches(data->filter, fname))
+        return PHYSFS_ENUM_OK;
+    return data->callback(data->callbackData, origdir, fname);
+} /* enumCallbackFilterNames */
 
 
-const char *PHYSFS_getWriteDir(void)
+/*
+ * Returns non-zero if (h) is a built-in archiver with a DirTree, and puts
+ *  it in (*tree), indexing the archive first if it hasn't been yet. (*tree)
+ *  is NULL with an error set if that failed.
+ */
+static int archiveDirTree(DirHandle *h, __PHYSFS_DirTree **tree)
 {
-    const char *retval = NULL;
+    *tree = NULL;
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    if (writeDir != NULL)
-        retval = writeDir->dirName;
-    __PHYSFS_platformReleaseMutex(stateLock);
+    #if PHYSFS_SUPPORTS_ZIP
+    if (h->funcs->openArchive == __PHYSFS_Archiver_ZIP.openArchive)
+    {
+        *tree = __PHYSFS_ZIP_getTree(h->opaque);
+        return 1;
+    } /* if */
+    #endif
 
-    return retval;
-} /* PHYSFS_getWriteDir */
+    if (h->funcs->stat == UNPK_stat)
+    {
+        *tree = (__PHYSFS_DirTree *) h->opaque;
+        return 1;
+    } /* if */
+
+    return 0;
+} /* archiveDirTree */
 
 
-int PHYSFS_setWriteDir(const char *newDir)
+/* (h)'s enumerate(), with only the names that pass (filter), if any. */
+static PHYSFS_EnumerateCallbackResult enumerateArchive(DirHandle *h,
+                                    const char *arcfname,
+                                    const PHYSFS_Filter *filter,
+                                    PHYSFS_EnumerateCallback cb,
+                                    const char *origdir, void *data)
 {
-    int retval = 1;
+    __PHYSFS_DirTree *tree = NULL;
+    FilterCallbackData filterdata;
+    int hastree;
 
-    __PHYSFS_platformGrabMutex(stateLock);
+    if (filter == NULL)
+        return h->funcs->enumerate(h->opaque, arcfname, cb, origdir, data);
 
-    if (writeDir != NULL)
-    {
-        BAIL_IF_MUTEX_ERRPASS(!freeDirHandle(writeDir, openWriteList),
-                            stateLock, 0);
-        writeDir = NULL;
-    } /* if */
+    hastree = archiveDirTree(h, &tree);
+    BAIL_IF_ERRPASS(hastree && !tree, PHYSFS_ENUM_ERROR);
 
-    if (newDir != NULL)
+    if (tree != NULL)
     {
-        writeDir = createDirHandle(NULL, newDir, NULL, 1);
-        retval = (writeDir != NULL);
+        return __PHYSFS_DirTreeEnumerateMatching(tree, arcfname,
+                                       filter->prefix, filter->prefixlen,
+                                       filterMatches, filter,
+                                       cb, origdir, data);
     } /* if */
 
-    __PHYSFS_platformReleaseMutex(stateLock);
-
-    return retval;
-} /* PHYSFS_setWriteDir */
+    filterdata.filter = filter;
+    filterdata.callback = cb;
+    filterdata.callbackData = data;
+    return h->funcs->enumerate(h->opaque, arcfname, enumCallbackFilterNames,
+                               origdir, &filterdata);
+} /* enumerateArchive */
 
 
-int PHYSFS_setRoot(const char *archive, const char *subdir)
+/*
+ * (statdata) is non-NULL for PHYSFS_enumerateWithStat(), and (cb) unused.
+ *  (filter) is non-NULL for PHYSFS_enumerateFiltered().
+ */
+static int doEnumerate(const char *_fn, PHYSFS_EnumerateCallback cb,
+                       void *data, EnumStatData *statdata,
+                       const PHYSFS_Filter *filter)
 {
-    DirHandle *i;
-
-    BAIL_IF(!archive, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    size_t len;
+    char *allocated_fname;
+    char *fname;
 
     __PHYSFS_platformGrabMutex(stateLock);
 
-    for (i = searchPath; i != NULL; i = i->next)
+    len = strlen(_fn) + longest_root + 2;
+    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root + 1;
+    if (!sanitizePlatformIndependentPath(_fn, fname))
+        retval = PHYSFS_ENUM_STOP;
+    else
     {
-        if ((i->dirName != NULL) && (strcmp(archive, i->dirName) == 0))
+        DirHandle *i;
+        SymlinkFilterData filterdata;
+        LookupFilterKey key;
+        int rewritten = 0;
+
+        initLookupFilterKey(&key);
+        if (!allowSymLinks)
         {
-            if (!subdir || (strcmp(subdir, "/") == 0))
+            memset(&filterdata, '\0', sizeof (filterdata));
+            filterdata.callback = cb;
+            filterdata.callbackData = data;
+        } /* if */
+
+        for (i = searchPath; (retval == PHYSFS_ENUM_OK) && i; i = i->next)
+        {
+            char *arcfname = fname;
+
+            if (rewritten)  /* put back the case that the last archive fixed. */
+                sanitizePlatformIndependentPath(_fn, fname);
+            rewritten = i->ignorecase;
+
+            if (partOfMountPoint(i, arcfname))
             {
-                if (i->root)
-                    allocator.Free(i->root);
-                i->root = NULL;
-                i->rootlen = 0;
+                if (filter != NULL)
+                {
+                    FilterCallbackData mntfilterdata;
+                    mntfilterdata.filter = filter;
+                    mntfilterdata.callback = cb;
+                    mntfilterdata.callbackData = data;
+                    retval = enumerateFromMountPoint(i, arcfname,
+                                enumCallbackFilterNames, _fn, &mntfilterdata);
+                } /* if */
+                else if (statdata == NULL)
+                    retval = enumerateFromMountPoint(i, arcfname, cb, _fn, data);
+                else
+                {
+                    statdata->dirhandle = i;
+                    statdata->arcfname = arcfname;
+                    retval = enumerateFromMountPoint(i, arcfname,
+                                        enumStatMountPoint, _fn, statdata);
+                } /* else */
             } /* if */
-            else
+
+            else if (lookupFilterMightHave(i, arcfname, &key) &&
+                     verifyPath(i, &arcfname, 0))
             {
-                const size_t len = strlen(subdir) + 1;
-                char *ptr = (char *) allocator.Malloc(len);
-                BAIL_IF_MUTEX(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
-                if (!sanitizePlatformIndependentPath(subdir, ptr))
+                PHYSFS_Stat statbuf;
+                if (!i->funcs->stat(i->opaque, arcfname, &statbuf))
                 {
-                    allocator.Free(ptr);
-                    BAIL_MUTEX_ERRPASS(stateLock, 0);
+                    if (currentErrorCode() == PHYSFS_ERR_NOT_FOUND)
+                        continue;  /* no such dir in this archive, skip it. */
                 } /* if */
 
-                if (i->root)
-                    allocator.Free(i->root);
-                i->root = ptr;
-                i->rootlen = strlen(i->root);  /* in case sanitizePlatformIndependentPath changed subdir */
+                if (statbuf.filetype != PHYSFS_FILETYPE_DIRECTORY)
+                    continue;  /* not a directory in this archive, skip it. */
 
-                if (longest_root < i->rootlen)
-                    longest_root = i->rootlen;
-            } /* else */
+                else if (statdata != NULL)
+                {
+                    retval = enumerateArchiveWithStat(i, arcfname, _fn,
+                                                      statdata);
+                } /* else if */
 
-            break;
-        } /* if */
-    } /* for */
+                else if ((!allowSymLinks) && (i->funcs->info.supportsSymlinks))
+                {
+                    filterdata.dirhandle = i;
+                    filterdata.arcfname = arcfname;
+                    filterdata.errcode = PHYSFS_ERR_OK;
+                    retval = enumerateArchive(i, arcfname, filter,
+                                              enumCallbackFilterSymLinks,
+                                              _fn, &filterdata);
+                    if (retval == PHYSFS_ENUM_ERROR)
+                    {
+                        if (currentErrorCode() == PHYSFS_ERR_APP_CALLBACK)
+                            PHYSFS_setErrorCode(filterdata.errcode);
+                    } /* if */
+                } /* else if */
+                else
+                {
+                    retval = enumerateArchive(i, arcfname, filter,
+                                              cb, _fn, data);
+                } /* else */
+            } /* else if */
+        } /* for */
 
-    __PHYSFS_platformReleaseMutex(stateLock);
-    return 1;
-} /* PHYSFS_setRoot */
+    } /* if */
 
+    __PHYSFS_platformReleaseMutex(stateLock);
 
-static int doMount(PHYSFS_Io *io, const char *fname,
-                   const char *mountPoint, int appendToPath)
-{
-    DirHandle *dh;
-    DirHandle *prev = NULL;
-    DirHandle *i;
+    __PHYSFS_smallFree(allocated_fname);
 
-    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    return (retval == PHYSFS_ENUM_ERROR) ? 0 : 1;
+} /* doEnumerate */
 
-    if (mountPoint == NULL)
-        mountPoint = "/";
 
-    __PHYSFS_platformGrabMutex(stateLock);
+int PHYSFS_enumerate(const char *_fn, PHYSFS_EnumerateCallback cb, void *data)
+{
+    BAIL_IF(!_fn, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!cb, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    return doEnumerate(_fn, cb, data, NULL, NULL);
+} /* PHYSFS_enumerate */
 
-    for (i = searchPath; i != NULL; i = i->next)
-    {
-        /* already in search path? */
-        if ((i->dirName != NULL) && (strcmp(fname, i->dirName) == 0))
-            BAIL_MUTEX_ERRPASS(stateLock, 1);
-        prev = i;
-    } /* for */
 
-    dh = createDirHandle(io, fname, mountPoint, 0);
-    BAIL_IF_MUTEX_ERRPASS(!dh, stateLock, 0);
+int PHYSFS_enumerateWithStat(const char *_fn, PHYSFS_EnumerateStatCallback cb,
+                             void *data)
+{
+    EnumStatData statdata;
 
-    if (appendToPath)
-    {
-        if (prev == NULL)
-            searchPath = dh;
-        else
-            prev->next = dh;
-    } /* if */
-    else
-    {
-        dh->next = searchPath;
-        searchPath = dh;
-    } /* else */
+    BAIL_IF(!_fn, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!cb, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
-    __PHYSFS_platformReleaseMutex(stateLock);
-    return 1;
-} /* doMount */
+    memset(&statdata, '\0', sizeof (statdata));
+    statdata.callback = cb;
+    statdata.callbackData = data;
+    return doEnumerate(_fn, NULL, NULL, &statdata, NULL);
+} /* PHYSFS_enumerateWithStat */
 
 
-int PHYSFS_mountIo(PHYSFS_Io *io, const char *fname,
-                   const char *mountPoint, int appendToPath)
+int PHYSFS_enumerateFiltered(const char *_fn, const PHYSFS_Filter *filter,
+                             PHYSFS_EnumerateCallback cb, void *data)
 {
-    BAIL_IF(!io, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(io->version != 0, PHYSFS_ERR_UNSUPPORTED, 0);
-    return doMount(io, fname, mountPoint, appendToPath);
-} /* PHYSFS_mountIo */
+    BAIL_IF(!_fn, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!filter, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!cb, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    return doEnumerate(_fn, cb, data, NULL, filter);
+} /* PHYSFS_enumerateFiltered */
 
 
-int PHYSFS_mountMemory(const void *buf, PHYSFS_uint64 len, void (*del)(void *),
-                       const char *fname, const char *mountPoint,
-                       int appendToPath)
+char **PHYSFS_enumerateFilesFiltered(const char *path,
+                                     const PHYSFS_Filter *filter)
 {
-    int retval = 0;
-    PHYSFS_Io *io = NULL;
-
-    BAIL_IF(!buf, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-
-    io = __PHYSFS_createMemoryIo(buf, len, del);
-    BAIL_IF_ERRPASS(!io, 0);
-    retval = doMount(io, fname, mountPoint, appendToPath);
-    if (!retval)
+    EnumStringListCallbackData ecd;
+    memset(&ecd, '\0', sizeof (ecd));
+    if (!PHYSFS_enumerateFiltered(path, filter, enumFilesCallback, &ecd))
     {
-        /* docs say not to call (del) in case of failure, so cheat. */
-        MemoryIoInfo *info = (MemoryIoInfo *) io->opaque;
-        info->destruct = NULL;
-        io->destroy(io);
+        const PHYSFS_ErrorCode errcode = currentErrorCode();
+        freeStringListData(&ecd);
+        BAIL_IF(errcode == PHYSFS_ERR_APP_CALLBACK, ecd.errcode, NULL);
+        return NULL;
     } /* if */
 
-    return retval;
-} /* PHYSFS_mountMemory */
+    return finishStringList(&ecd, 1);
+} /* PHYSFS_enumerateFilesFiltered */
 
 
-int PHYSFS_mountHandle(PHYSFS_File *file, const char *fname,
-                       const char *mountPoint, int appendToPath)
+/*
+ * PHYSFS_walk() support.
+ *
+ * Each directory we visit knows which archives it came from (its "sources"),
+ *  in search path order, so its children are only looked up in those,
+ *  instead of going down the whole search path again for every directory.
+ */
+
+typedef struct WalkItem
 {
-    int retval = 0;
-    PHYSFS_Io *io = NULL;
+    size_t name;  /* offset into the WalkList's arena. */
+    PHYSFS_uint32 src;  /* index of the source that had it. */
+    PHYSFS_Stat stat;
+} WalkItem;
 
-    BAIL_IF(!file, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+typedef struct WalkList
+{
+    WalkItem *items;
+    PHYSFS_uint32 count;
+    PHYSFS_uint32 capacity;
+    char *arena;
+    size_t arenaused;
+    size_t arenasize;
+    PHYSFS_uint32 src;  /* source being read into the list right now. */
+    PHYSFS_ErrorCode errcode;
+} WalkList;
 
-    io = __PHYSFS_createHandleIo(file);
-    BAIL_IF_ERRPASS(!io, 0);
-    retval = doMount(io, fname, mountPoint, appendToPath);
-    if (!retval)
+typedef struct WalkDir
+{
+    struct WalkDir *next;  /* breadth-first queue. */
+    char *path;
+    PHYSFS_uint32 numsources;
+    DirHandle **sources;
+} WalkDir;
+
+/* PHYSFS_WALK_PARALLEL reads each source's subtree into one of these. */
+typedef struct WalkCacheDir
+{
+    char *path;
+    WalkList list;
+    PHYSFS_ErrorCode errcode;
+} WalkCacheDir;
+
+typedef struct WalkCache
+{
+    DirHandle *dh;
+    WalkCacheDir *dirs;  /* in depth-first order, sorted by walkPathCmp(). */
+    PHYSFS_uint32 count;
+    PHYSFS_uint32 capacity;
+    PHYSFS_ErrorCode errcode;
+} WalkCache;
+
+typedef struct WalkData
+{
+    PHYSFS_WalkCallback callback;
+    void *callbackData;
+    int breadthfirst;
+    WalkDir *queuehead;
+    WalkDir *queuetail;
+    char *path;  /* scratch space for the paths we report. */
+    size_t pathlen;
+    WalkCache *caches;  /* NULL unless walking in parallel. */
+    PHYSFS_uint32 numcaches;
+    PHYSFS_uint32 nextcache;
+    char *rootpath;
+    void *lock;
+} WalkData;
+
+
+static int addWalkItem(WalkList *list, const char *name,
+                       const PHYSFS_Stat *stat)
+{
+    const size_t len = strlen(name) + 1;
+    WalkItem *item;
+
+    if (list->count == list->capacity)
     {
-        /* docs say not to destruct in case of failure, so cheat. */
-        io->opaque = NULL;
-        io->destroy(io);
+        const PHYSFS_uint32 newcap = list->capacity ? list->capacity * 2 : 32;
+        void *ptr = allocator.Realloc(list->items, newcap * sizeof (WalkItem));
+        if (!ptr)
+        {
+            list->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+            return 0;
+        } /* if */
+        list->items = (WalkItem *) ptr;
+        list->capacity = newcap;
+    } /* if */
+
+    if ((list->arenasize - list->arenaused) < len)
+    {
+        size_t newsize = list->arenasize ? list->arenasize * 2 : 512;
+        void *ptr;
+        while ((newsize - list->arenaused) < len)
+            newsize *= 2;
+        ptr = allocator.Realloc(list->arena, newsize);
+        if (!ptr)
+        {
+            list->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+            return 0;
+        } /* if */
+        list->arena = (char *) ptr;
+        list->arenasize = newsize;
     } /* if */
 
-    return retval;
-} /* PHYSFS_mountHandle */
+    item = &list->items[list->count++];
+    item->name = list->arenaused;
+    item->src = list->src;
+    memcpy(&item->stat, stat, sizeof (PHYSFS_Stat));
+    memcpy(list->arena + list->arenaused, name, len);
+    list->arenaused += len;
+    return 1;
+} /* addWalkItem */
 
 
-int PHYSFS_mount(const char *newDir, const char *mountPoint, int appendToPath)
+static void freeWalkList(WalkList *list)
 {
-    BAIL_IF(!newDir, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    return doMount(NULL, newDir, mountPoint, appendToPath);
-} /* PHYSFS_mount */
+    allocator.Free(list->items);
+    allocator.Free(list->arena);
+    list->items = NULL;
+    list->arena = NULL;
+} /* freeWalkList */
 
 
-int PHYSFS_addToSearchPath(const char *newDir, int appendToPath)
+/* by name, then by source, so the first of each name is the one that wins. */
+static int walkListCmp(void *_a, size_t one, size_t two)
 {
-    return PHYSFS_mount(newDir, NULL, appendToPath);
-} /* PHYSFS_addToSearchPath */
+    const WalkList *list = (const WalkList *) _a;
+    const WalkItem *a = &list->items[one];
+    const WalkItem *b = &list->items[two];
+    const int rc = strcmp(list->arena + a->name, list->arena + b->name);
+    if (rc != 0)
+        return rc;
+    return (a->src < b->src) ? -1 : ((a->src > b->src) ? 1 : 0);
+} /* walkListCmp */
 
 
-int PHYSFS_removeFromSearchPath(const char *oldDir)
+static void walkListSwap(void *_a, size_t one, size_t two)
 {
-    return PHYSFS_unmount(oldDir);
-} /* PHYSFS_removeFromSearchPath */
+    WalkList *list = (WalkList *) _a;
+    WalkItem tmp;
+    memcpy(&tmp, &list->items[one], sizeof (WalkItem));
+    memcpy(&list->items[one], &list->items[two], sizeof (WalkItem));
+    memcpy(&list->items[two], &tmp, sizeof (WalkItem));
+} /* walkListSwap */
 
 
-int PHYSFS_unmount(const char *oldDir)
+static void sortWalkList(WalkList *list)
 {
-    DirHandle *i;
-    DirHandle *prev = NULL;
-    DirHandle *next = NULL;
-
-    BAIL_IF(oldDir == NULL, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    PHYSFS_uint32 i;
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    for (i = searchPath; i != NULL; i = i->next)
+    /* a single archive's names usually arrive in order already. */
+    for (i = 1; i < list->count; i++)
     {
-        if (strcmp(i->dirName, oldDir) == 0)
+        if (walkListCmp(list, i - 1, i) > 0)
         {
-            next = i->next;
-            BAIL_IF_MUTEX_ERRPASS(!freeDirHandle(i, openReadList),
-                                stateLock, 0);
-
-            if (prev == NULL)
-                searchPath = next;
-            else
-                prev->next = next;
-
-            BAIL_MUTEX_ERRPASS(stateLock, 1);
+            __PHYSFS_sort(list, list->count, walkListCmp, walkListSwap);
+            break;
         } /* if */
-        prev = i;
     } /* for */
-
-    BAIL_MUTEX(PHYSFS_ERR_NOT_MOUNTED, stateLock, 0);
-} /* PHYSFS_unmount */
-
-
-char **PHYSFS_getSearchPath(void)
-{
-    return doEnumStringList(PHYSFS_getSearchPathCallback);
-} /* PHYSFS_getSearchPath */
+} /* sortWalkList */
 
 
-const char *PHYSFS_getMountPoint(const char *dir)
+/*
+ * Compare paths the way a depth-first walk visits them: element by element,
+ *  so "a/z" comes before "a-b", because "a" does.
+ */
+static int walkPathCmp(const char *a, const char *b)
 {
-    DirHandle *i;
-    __PHYSFS_platformGrabMutex(stateLock);
-    for (i = searchPath; i != NULL; i = i->next)
+    while (1)
     {
-        if (strcmp(i->dirName, dir) == 0)
+        const int ca = (int) *((const unsigned char *) a);
+        const int cb = (int) *((const unsigned char *) b);
+        const int aend = ((ca == '\0') || (ca == '/'));
+        const int bend = ((cb == '\0') || (cb == '/'));
+
+        if (ca == cb)
         {
-            const char *retval = ((i->mountPoint) ? i->mountPoint : "/");
-            __PHYSFS_platformReleaseMutex(stateLock);
-            return retval;
+            if (ca == '\0')
+                return 0;
         } /* if */
-    } /* for */
-    __PHYSFS_platformReleaseMutex(stateLock);
+        else if (aend && bend)
+            return (ca == '\0') ? -1 : 1;  /* parents before children. */
+        else if (aend)
+            return -1;
+        else if (bend)
+            return 1;
+        else
+            return (ca < cb) ? -1 : 1;
 
-    BAIL(PHYSFS_ERR_NOT_MOUNTED, NULL);
-} /* PHYSFS_getMountPoint */
+        a++;
+        b++;
+    } /* while */
+} /* walkPathCmp */
 
 
-void PHYSFS_getSearchPathCallback(PHYSFS_StringCallback callback, void *data)
+static PHYSFS_EnumerateCallbackResult walkCollect(void *data,
+                                    const char *origdir, const char *fname,
+                                    const PHYSFS_Stat *stat,
+                                    const char *realdir)
 {
-    DirHandle *i;
-
-    __PHYSFS_platformGrabMutex(stateLock);
-
-    for (i = searchPath; i != NULL; i = i->next)
-        callback(data, i->dirName);
-
-    __PHYSFS_platformReleaseMutex(stateLock);
-} /* PHYSFS_getSearchPathCallback */
+    WalkList *list = (WalkList *) data;
+    (void) origdir;
+    (void) realdir;
+    return addWalkItem(list, fname, stat) ? PHYSFS_ENUM_OK : PHYSFS_ENUM_ERROR;
+} /* walkCollect */
 
 
-typedef struct setSaneCfgEnumData
+/*
+ * Add what (dh) has in (path) to (list). (path) is sanitized, and either
+ *  part of (dh)'s mountpoint or a directory we already know (dh) has, so
+ *  unlike verifyPath(), there's nothing to check here.
+ */
+static int readWalkSource(DirHandle *dh, char *path, WalkList *list)
 {
-    const char *archiveExt;
-    size_t archiveExtLen;
-    int archivesFirst;
-    PHYSFS_ErrorCode errcode;
-} setSaneCfgEnumData;
+    PHYSFS_EnumerateCallbackResult rc;
+    EnumStatData statdata;
 
-static PHYSFS_EnumerateCallbackResult setSaneCfgEnumCallback(void *_data,
-                                                const char *dir, const char *f)
-{
-    setSaneCfgEnumData *data = (setSaneCfgEnumData *) _data;
-    const size_t extlen = data->archiveExtLen;
-    const size_t l = strlen(f);
-    const char *ext;
+    memset(&statdata, '\0', sizeof (statdata));
+    statdata.callback = walkCollect;
+    statdata.callbackData = list;
+    list->errcode = PHYSFS_ERR_OK;
 
-    if ((l > extlen) && (f[l - extlen - 1] == '.'))
+    if (partOfMountPoint(dh, path))
     {
-        ext = f + (l - extlen);
-        if (PHYSFS_utf8stricmp(ext, data->archiveExt) == 0)
-        {
-            const char dirsep = __PHYSFS_platformDirSeparator;
-            const char *d = PHYSFS_getRealDir(f);
-            const size_t allocsize = strlen(d) + l + 2;
-            char *str = (char *) __PHYSFS_smallAlloc(allocsize);
-            if (str == NULL)
-                data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
-            else
-            {
-                snprintf(str, allocsize, "%s%c%s", d, dirsep, f);
-                if (!PHYSFS_mount(str, NULL, data->archivesFirst == 0))
-                    data->errcode = currentErrorCode();
-                __PHYSFS_smallFree(str);
-            } /* else */
-        } /* if */
+        statdata.dirhandle = dh;
+        statdata.arcfname = path;
+        rc = enumerateFromMountPoint(dh, path, enumStatMountPoint, path,
+                                     &statdata);
     } /* if */
+    else
+    {
+        const char *fname = path;
+        char *arcfname;
 
-    /* !!! FIXME: if we want to abort on errors... */
-    /*return (data->errcode != PHYSFS_ERR_OK) ? PHYSFS_ENUM_ERROR : PHYSFS_ENUM_OK;*/
-
-    return PHYSFS_ENUM_OK;  /* keep going */
-} /* setSaneCfgEnumCallback */
+        if (dh->mountPoint != NULL)
+        {
+            fname += strlen(dh->mountPoint) - 1;
+            if (*fname == '/')
+                fname++;
+        } /* if */
 
+        arcfname = (char *) __PHYSFS_smallAlloc(strlen(fname) + dh->rootlen + 2);
+        BAIL_IF(!arcfname, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        if (dh->root == NULL)
+            strcpy(arcfname, fname);
+        else
+        {
+            strcpy(arcfname, dh->root);
+            if (*fname != '\0')
+            {
+                arcfname[dh->rootlen] = '/';
+                strcpy(arcfname + dh->rootlen + 1, fname);
+            } /* if */
+        } /* else */
 
-int PHYSFS_setSaneConfig(const char *organization, const char *appName,
-                         const char *archiveExt, int includeCdRoms,
-                         int archivesFirst)
-{
-    const char *basedir;
-    const char *prefdir;
+        if (dh->ignorecase)
+            fixCase(dh, arcfname);
 
-    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, 0);
+        rc = enumerateArchiveWithStat(dh, arcfname, path, &statdata);
+        __PHYSFS_smallFree(arcfname);
+    } /* else */
 
-    prefdir = PHYSFS_getPrefDir(organization, appName);
-    BAIL_IF_ERRPASS(!prefdir, 0);
+    if (rc == PHYSFS_ENUM_ERROR)
+    {
+        if (list->errcode != PHYSFS_ERR_OK)
+            PHYSFS_setErrorCode(list->errcode);  /* say why, not just where. */
+        return 0;
+    } /* if */
 
-    basedir = PHYSFS_getBaseDir();
-    BAIL_IF_ERRPASS(!basedir, 0);
+    return 1;
+} /* readWalkSource */
 
-    BAIL_IF(!PHYSFS_setWriteDir(prefdir), PHYSFS_ERR_NO_WRITE_DIR, 0);
 
-    /* !!! FIXME: these can fail and we should report that... */
+/* read one source's whole subtree under (path), depth-first. */
+static int cacheWalkSubtree(WalkCache *cache, char *path)
+{
+    const size_t pathlen = strlen(path);
+    PHYSFS_uint32 idx;
+    PHYSFS_uint32 i;
 
-    /* Put write dir first in search path... */
-    PHYSFS_mount(prefdir, NULL, 0);
+    if (cache->count == cache->capacity)
+    {
+        const PHYSFS_uint32 newcap = cache->capacity ? cache->capacity * 2 : 16;
+        void *ptr = allocator.Realloc(cache->dirs, newcap * sizeof (WalkCacheDir));
+        BAIL_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        cache->dirs = (WalkCacheDir *) ptr;
+        cache->capacity = newcap;
+    } /* if */
 
-    /* Put base path on search path... */
-    PHYSFS_mount(basedir, NULL, 1);
+    idx = cache->count;
+    memset(&cache->dirs[idx], '\0', sizeof (WalkCacheDir));
+    cache->dirs[idx].path = (char *) allocator.Malloc(pathlen + 1);
+    BAIL_IF(!cache->dirs[idx].path, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    strcpy(cache->dirs[idx].path, path);
+    cache->count++;
 
-    /* handle CD-ROMs... */
-    if (includeCdRoms)
+    if (!readWalkSource(cache->dh, path, &cache->dirs[idx].list))
     {
-        char **cds = PHYSFS_getCdRomDirs();
-        char **i;
-        for (i = cds; *i != NULL; i++)
-            PHYSFS_mount(*i, NULL, 1);
-        PHYSFS_freeList(cds);
+        cache->dirs[idx].errcode = currentErrorCode();
+        return 0;
     } /* if */
 
-    /* Root out archives, and add them to search path... */
-    if (archiveExt != NULL)
+    sortWalkList(&cache->dirs[idx].list);
+
+    /* (cache->dirs) can move while we recurse, so don't hold pointers. */
+    for (i = 0; i < cache->dirs[idx].list.count; i++)
     {
-        setSaneCfgEnumData data;
-        memset(&data, '\0', sizeof (data));
-        data.archiveExt = archiveExt;
-        data.archiveExtLen = strlen(archiveExt);
-        data.archivesFirst = archivesFirst;
-        data.errcode = PHYSFS_ERR_OK;
-        if (!PHYSFS_enumerate("/", setSaneCfgEnumCallback, &data))
-        {
-            /* !!! FIXME: use this if we're reporting errors.
-            PHYSFS_ErrorCode errcode = currentErrorCode();
-            if (errcode == PHYSFS_ERR_APP_CALLBACK)
-                errcode = data->errcode; */
-        } /* if */
-    } /* if */
+        const WalkList *list = &cache->dirs[idx].list;
+        const WalkItem *item = &list->items[i];
+        const char *name = list->arena + item->name;
+        const size_t len = pathlen + strlen(name) + 2;
+        char *subdir;
+        int rc;
+
+        if (item->stat.filetype != PHYSFS_FILETYPE_DIRECTORY)
+            continue;
+
+        subdir = (char *) __PHYSFS_smallAlloc(len);
+        BAIL_IF(!subdir, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        snprintf(subdir, len, "%s%s%s", path, pathlen ? "/" : "", name);
+        rc = cacheWalkSubtree(cache, subdir);
+        __PHYSFS_smallFree(subdir);
+        if (!rc)
+            return 0;
+    } /* for */
 
     return 1;
-} /* PHYSFS_setSaneConfig */
+} /* cacheWalkSubtree */
 
 
-void PHYSFS_permitSymbolicLinks(int allow)
+/*
+ * Every thread, including the one that called PHYSFS_walk(), runs this until
+ *  every source has been read. The caller holds stateLock, and each source
+ *  is only touched by one thread, so the archivers don't have to care.
+ */
+static void walkCacheWorker(void *_data)
 {
-    allowSymLinks = allow;
-} /* PHYSFS_permitSymbolicLinks */
+    WalkData *data = (WalkData *) _data;
 
+    while (1)
+    {
+        WalkCache *cache;
+        PHYSFS_uint32 idx;
 
-int PHYSFS_symbolicLinksPermitted(void)
-{
-    return allowSymLinks;
-} /* PHYSFS_symbolicLinksPermitted */
+        __PHYSFS_platformGrabMutex(data->lock);
+        idx = data->nextcache;
+        if (idx < data->numcaches)
+            data->nextcache++;
+        __PHYSFS_platformReleaseMutex(data->lock);
 
+        if (idx >= data->numcaches)
+            break;  /* all done. */
 
-/*
- * Verify that (fname) (in platform-independent notation), in relation
- *  to (h) is secure. That means that each element of fname is checked
- *  for symlinks (if they aren't permitted). This also allows for quick
- *  rejection of files that exist outside an archive's mountpoint.
- *
- * With some exceptions (like PHYSFS_mkdir(), which builds multiple subdirs
- *  at a time), you should always pass zero for "allowMissing" for efficiency.
- *
- * (fname) must point to an output from sanitizePlatformIndependentPath(),
- *  since it will make sure that path names are in the right format for
- *  passing certain checks. It will also do checks for "insecure" pathnames
- *  like ".." which should be done once instead of once per archive. This also
- *  gives us license to treat (fname) as scratch space in this function.
- *
- * (fname)'s buffer must have enough space available before it for this
- *  function to prepend any root directory for this DirHandle.
- *
- * Returns non-zero if string is safe, zero if there's a security issue.
- *  PHYSFS_getLastError() will specify what was wrong. (*fname) will be
- *  updated to point past any mount point elements so it is prepared to
- *  be used with the archiver directly.
- */
-static int verifyPath(DirHandle *h, char **_fname, int allowMissing)
-{
-    char *fname = *_fname;
-    int retval = 1;
-    char *start;
-    char *end;
+        cache = &data->caches[idx];
+        if (!cacheWalkSubtree(cache, data->rootpath))
+        {
+            cache->errcode = PHYSFS_getLastErrorCode();
+            if (cache->errcode == PHYSFS_ERR_OK)
+                cache->errcode = PHYSFS_ERR_OTHER_ERROR;
+        } /* if */
+    } /* while */
+} /* walkCacheWorker */
 
-    if ((*fname == '\0') && (!h->root))  /* quick rejection. */
-        return 1;
 
-    /* !!! FIXME: This codeblock sucks. */
-    if (h->mountPoint != NULL)  /* NULL mountpoint means "/". */
-    {
-        size_t mntpntlen = strlen(h->mountPoint);
-        size_t len = strlen(fname);
-        assert(mntpntlen > 1); /* root mount points should be NULL. */
-        /* not under the mountpoint, so skip this archive. */
-        BAIL_IF(len < mntpntlen-1, PHYSFS_ERR_NOT_FOUND, 0);
-        /* !!! FIXME: Case insensitive? */
-        retval = strncmp(h->mountPoint, fname, mntpntlen-1);
-        BAIL_IF(retval != 0, PHYSFS_ERR_NOT_FOUND, 0);
-        if (len > mntpntlen-1)  /* corner case... */
-            BAIL_IF(fname[mntpntlen-1]!='/', PHYSFS_ERR_NOT_FOUND, 0);
-        fname += mntpntlen-1;  /* move to start of actual archive path. */
-        if (*fname == '/')
-            fname++;
-        *_fname = fname;  /* skip mountpoint for later use. */
-        retval = 1;  /* may be reset, below. */
-    } /* if */
+static int readWalkCache(WalkData *data, DirHandle *dh, const char *path,
+                         WalkList *list)
+{
+    const WalkCache *cache = NULL;
+    const WalkCacheDir *dir = NULL;
+    PHYSFS_uint32 lo = 0;
+    PHYSFS_uint32 hi;
+    PHYSFS_uint32 i;
 
-    /* prepend the root directory, if any. */
-    if (h->root)
+    for (i = 0; i < data->numcaches; i++)
     {
-        const int isempty = (*fname == '\0');
-        fname -= h->rootlen + (isempty ? 0 : 1);
-        strcpy(fname, h->root);
-        if (!isempty)
-            fname[h->rootlen] = '/';
-        *_fname = fname;
-    } /* if */
+        if (data->caches[i].dh == dh)
+        {
+            cache = &data->caches[i];
+            break;
+        } /* if */
+    } /* for */
 
-    start = fname;
-    if (!allowSymLinks)
+    assert(cache != NULL);  /* every source got one. */
+
+    hi = cache->count;
+    while (lo < hi)
     {
-        while (1)
+        const PHYSFS_uint32 mid = lo + ((hi - lo) / 2);
+        const int rc = walkPathCmp(path, cache->dirs[mid].path);
+        if (rc == 0)
         {
-            PHYSFS_Stat statbuf;
-            int rc = 0;
-            end = strchr(start, '/');
+            dir = &cache->dirs[mid];
+            break;
+        } /* if */
+        else if (rc < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    } /* while */
+
+    /* if the worker gave up before getting here, fail like it did. */
+    if (dir == NULL)
+    {
+        BAIL_IF(cache->errcode != PHYSFS_ERR_OK, cache->errcode, 0);
+        return 1;
+    } /* if */
 
-            if (end != NULL) *end = '\0';
-            rc = h->funcs->stat(h->opaque, fname, &statbuf);
-            if (rc)
-                rc = (statbuf.filetype == PHYSFS_FILETYPE_SYMLINK);
-            else if (currentErrorCode() == PHYSFS_ERR_NOT_FOUND)
-                retval = 0;
+    BAIL_IF(dir->errcode != PHYSFS_ERR_OK, dir->errcode, 0);
 
-            if (end != NULL) *end = '/';
+    for (i = 0; i < dir->list.count; i++)
+    {
+        const WalkItem *item = &dir->list.items[i];
+        if (!addWalkItem(list, dir->list.arena + item->name, &item->stat))
+            BAIL(list->errcode, 0);
+    } /* for */
 
-            /* insecure path (has a disallowed symlink in it)? */
-            BAIL_IF(rc, PHYSFS_ERR_SYMLINK_FORBIDDEN, 0);
+    return 1;
+} /* readWalkCache */
 
-            /* break out early if path element is missing. */
-            if (!retval)
-            {
-                /*
-                 * We need to clear it if it's the last element of the path,
-                 *  since this might be a non-existant file we're opening
-                 *  for writing...
-                 */
-                if ((end == NULL) || (allowMissing))
-                    retval = 1;
-                break;
-            } /* if */
 
-            if (end == NULL)
-                break;
+static WalkDir *allocWalkDir(const char *path, const PHYSFS_uint32 numsources)
+{
+    const size_t len = sizeof (WalkDir) + (numsources * sizeof (DirHandle *));
+    WalkDir *retval = (WalkDir *) allocator.Malloc(len + strlen(path) + 1);
+    BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    retval->next = NULL;
+    retval->sources = (DirHandle **) (retval + 1);
+    retval->path = ((char *) retval) + len;
+    retval->numsources = 0;
+    strcpy(retval->path, path);
+    return retval;
+} /* allocWalkDir */
 
-            start = end + 1;
-        } /* while */
-    } /* if */
+
+/* (path) followed by everything with the same name in (list)'s [i, end). */
+static WalkDir *makeWalkSubdir(const WalkDir *parent, const WalkList *list,
+                               PHYSFS_uint32 i, const PHYSFS_uint32 end,
+                               const char *path)
+{
+    WalkDir *retval = allocWalkDir(path, end - i);
+    BAIL_IF_ERRPASS(!retval, NULL);
+
+    for (; i < end; i++)
+    {
+        const WalkItem *item = &list->items[i];
+        if (item->stat.filetype == PHYSFS_FILETYPE_DIRECTORY)
+            retval->sources[retval->numsources++] = parent->sources[item->src];
+    } /* for */
 
     return retval;
-} /* verifyPath */
+} /* makeWalkSubdir */
 
 
-/* This must hold the stateLock before calling. */
-static int doMkdir(const char *_dname, char *dname)
+static char *buildWalkPath(WalkData *data, const char *dir,
+                           const size_t dirlen, const char *name)
 {
-    DirHandle *h = writeDir;
-    char *start;
-    char *end;
-    int retval = 0;
-    int exists = 1;  /* force existance check on first path element. */
+    const size_t namelen = strlen(name);
+    const size_t len = dirlen + namelen + 2;
 
-    assert(h != NULL);
+    if (len > data->pathlen)
+    {
+        void *ptr = allocator.Realloc(data->path, len * 2);
+        BAIL_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        data->path = (char *) ptr;
+        data->pathlen = len * 2;
+    } /* if */
 
-    BAIL_IF_ERRPASS(!sanitizePlatformIndependentPathWithRoot(h, _dname, dname), 0);
-    BAIL_IF_ERRPASS(!verifyPath(h, &dname, 1), 0);
+    if (dirlen == 0)
+        memcpy(data->path, name, namelen + 1);
+    else
+    {
+        memcpy(data->path, dir, dirlen);
+        data->path[dirlen] = '/';
+        memcpy(data->path + dirlen + 1, name, namelen + 1);
+    } /* else */
 
-    start = dname;
-    while (1)
+    return data->path;
+} /* buildWalkPath */
+
+
+static PHYSFS_EnumerateCallbackResult walkDirectory(WalkData *data,
+                                                    WalkDir *dir)
+{
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    const size_t dirlen = strlen(dir->path);
+    WalkList list;
+    PHYSFS_uint32 i;
+
+    memset(&list, '\0', sizeof (list));
+    for (i = 0; i < dir->numsources; i++)
     {
-        end = strchr(start, '/');
-        if (end != NULL)
-            *end = '\0';
+        int rc;
+        list.src = i;
+        if (data->caches != NULL)
+            rc = readWalkCache(data, dir->sources[i], dir->path, &list);
+        else
+            rc = readWalkSource(dir->sources[i], dir->path, &list);
 
-        /* only check for existance if all parent dirs existed, too... */
-        if (exists)
+        if (!rc)
         {
-            PHYSFS_Stat statbuf;
-            const int rc = h->funcs->stat(h->opaque, dname, &statbuf);
-            if ((!rc) && (currentErrorCode() == PHYSFS_ERR_NOT_FOUND))
-                exists = 0;
-            /* verifyPath made sure that (dname) doesn't have symlinks if they aren't
-               allowed, but it's possible the mounted writeDir itself has symlinks in it,
-               (for example "/var" on iOS is a symlink, and the prefpath will be somewhere
-               under that)...if we mounted that writeDir, we must allow those symlinks here
-               unconditionally. */
-            retval = ( (rc) && ((statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY) || (statbuf.filetype == PHYSFS_FILETYPE_SYMLINK)) );
+            freeWalkList(&list);
+            return PHYSFS_ENUM_ERROR;
         } /* if */
+    } /* for */
 
-        if (!exists)
-            retval = h->funcs->mkdir(h->opaque, dname);
+    sortWalkList(&list);
 
-        if (!retval)
+    i = 0;
+    while ((retval == PHYSFS_ENUM_OK) && (i < list.count))
+    {
+        const WalkItem *item = &list.items[i];  /* first source wins. */
+        const char *name = list.arena + item->name;
+        const DirHandle *dh = dir->sources[item->src];
+        PHYSFS_uint32 end = i + 1;
+        PHYSFS_WalkCallbackResult rc;
+        WalkDir *subdir;
+        char *path;
+
+        while ((end < list.count) &&
+               (strcmp(list.arena + list.items[end].name, name) == 0))
+            end++;
+
+        path = buildWalkPath(data, dir->path, dirlen, name);
+        if (!path)
+        {
+            retval = PHYSFS_ENUM_ERROR;
             break;
+        } /* if */
 
-        if (end == NULL)
-            break;
+        rc = data->callback(data->callbackData, path, &item->stat, dh->dirName);
+        if (rc == PHYSFS_WALK_ERROR)
+        {
+            PHYSFS_setErrorCode(PHYSFS_ERR_APP_CALLBACK);
+            retval = PHYSFS_ENUM_ERROR;
+        } /* if */
+        else if (rc == PHYSFS_WALK_STOP)
+            retval = PHYSFS_ENUM_STOP;
+        else if ((rc != PHYSFS_WALK_SKIP) &&
+                 (item->stat.filetype == PHYSFS_FILETYPE_DIRECTORY))
+        {
+            subdir = makeWalkSubdir(dir, &list, i, end, path);
+            if (!subdir)
+                retval = PHYSFS_ENUM_ERROR;
+            else if (data->breadthfirst)
+            {
+                if (data->queuetail)
+                    data->queuetail->next = subdir;
+                else
+                    data->queuehead = subdir;
+                data->queuetail = subdir;
+            } /* else if */
+            else
+            {
+                retval = walkDirectory(data, subdir);
+                allocator.Free(subdir);
+            } /* else */
+        } /* else if */
 
-        *end = '/';
-        start = end + 1;
+        i = end;
     } /* while */
 
+    freeWalkList(&list);
     return retval;
-} /* doMkdir */
+} /* walkDirectory */
 
 
-int PHYSFS_mkdir(const char *_dname)
+/* read every source's subtree now, on as many threads as make sense. */
+static int prepareWalkCaches(WalkData *data, const WalkDir *root)
 {
-    int retval = 0;
-    char *dname;
-    size_t len;
+    void *threads[MOUNT_MAX_THREADS];
+    PHYSFS_uint32 wanted = (PHYSFS_uint32) __PHYSFS_platformCPUCount();
+    int numthreads = 0;
+    PHYSFS_uint32 i;
 
-    BAIL_IF(!_dname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    data->caches = (WalkCache *) allocator.Malloc(root->numsources * sizeof (WalkCache));
+    BAIL_IF(!data->caches, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    memset(data->caches, '\0', root->numsources * sizeof (WalkCache));
+    data->numcaches = root->numsources;
+    for (i = 0; i < root->numsources; i++)
+        data->caches[i].dh = root->sources[i];
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    BAIL_IF_MUTEX(!writeDir, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
-    len = strlen(_dname) + dirHandleRootLen(writeDir) + 1;
-    dname = (char *) __PHYSFS_smallAlloc(len);
-    BAIL_IF_MUTEX(!dname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
-    retval = doMkdir(_dname, dname);
-    __PHYSFS_platformReleaseMutex(stateLock);
-    __PHYSFS_smallFree(dname);
-    return retval;
-} /* PHYSFS_mkdir */
+    data->lock = __PHYSFS_platformCreateMutex();
+    BAIL_IF(!data->lock, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    data->rootpath = root->path;
 
+    if (wanted > data->numcaches)
+        wanted = data->numcaches;
+    if (wanted > MOUNT_MAX_THREADS)
+        wanted = MOUNT_MAX_THREADS;
 
-/* This must hold the stateLock before calling. */
-static int doDelete(const char *_fname, char *fname)
+    /* this thread does its share too, so start one fewer. */
+    while ((PHYSFS_uint32) (numthreads + 1) < wanted)
+    {
+        threads[numthreads] = __PHYSFS_platformCreateThread(walkCacheWorker, data);
+        if (!threads[numthreads])
+            break;  /* that's okay, we'll manage with what we have. */
+        numthreads++;
+    } /* while */
+
+    walkCacheWorker(data);
+
+    while (numthreads > 0)
+        __PHYSFS_platformJoinThread(threads[--numthreads]);
+
+    return 1;
+} /* prepareWalkCaches */
+
+
+static void freeWalkCaches(WalkData *data)
 {
-    DirHandle *h = writeDir;
-    BAIL_IF_ERRPASS(!sanitizePlatformIndependentPathWithRoot(h, _fname, fname), 0);
-    BAIL_IF_ERRPASS(!verifyPath(h, &fname, 0), 0);
-    return h->funcs->remove(h->opaque, fname);
-} /* doDelete */
+    PHYSFS_uint32 i, j;
+
+    for (i = 0; i < data->numcaches; i++)
+    {
+        WalkCache *cache = &data->caches[i];
+        for (j = 0; j < cache->count; j++)
+        {
+            allocator.Free(cache->dirs[j].path);
+            freeWalkList(&cache->dirs[j].list);
+        } /* for */
+        allocator.Free(cache->dirs);
+    } /* for */
 
+    allocator.Free(data->caches);
+    if (data->lock)
+        __PHYSFS_platformDestroyMutex(data->lock);
+} /* freeWalkCaches */
 
-int PHYSFS_delete(const char *_fname)
+
+/* the archives that have (fname) as a directory, like doEnumerate() finds. */
+static WalkDir *findWalkRoot(char *fname)
 {
-    int retval;
-    char *fname;
-    size_t len;
+    PHYSFS_uint32 count = 0;
+    LookupFilterKey key;
+    WalkDir *retval;
+    DirHandle *i;
+    int rewritten = 0;
+
+    for (i = searchPath; i != NULL; i = i->next)
+        count++;
+
+    retval = allocWalkDir(fname, count);
+    BAIL_IF_ERRPASS(!retval, NULL);
+
+    initLookupFilterKey(&key);
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        char *arcfname = fname;
+
+        if (rewritten)  /* put back the case that the last archive fixed. */
+            strcpy(fname, retval->path);
+        rewritten = i->ignorecase;
+
+        if (partOfMountPoint(i, arcfname))
+            retval->sources[retval->numsources++] = i;
+
+        else if (lookupFilterMightHave(i, arcfname, &key) &&
+                 verifyPath(i, &arcfname, 0))
+        {
+            PHYSFS_Stat statbuf;
+            if ((i->funcs->stat(i->opaque, arcfname, &statbuf)) &&
+                (statbuf.filetype == PHYSFS_FILETYPE_DIRECTORY))
+                retval->sources[retval->numsources++] = i;
+        } /* else if */
+    } /* for */
 
-    __PHYSFS_platformGrabMutex(stateLock);
-    BAIL_IF_MUTEX(!writeDir, PHYSFS_ERR_NO_WRITE_DIR, stateLock, 0);
-    len = strlen(_fname) + dirHandleRootLen(writeDir) + 1;
-    fname = (char *) __PHYSFS_smallAlloc(len);
-    BAIL_IF_MUTEX(!fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
-    retval = doDelete(_fname, fname);
-    __PHYSFS_platformReleaseMutex(stateLock);
-    __PHYSFS_smallFree(fname);
     return retval;
-} /* PHYSFS_delete */
+} /* findWalkRoot */
 
 
-static DirHandle *getRealDirHandle(const char *_fname)
+int PHYSFS_walk(const char *_fn, PHYSFS_uint32 flags, PHYSFS_WalkCallback cb,
+                void *d)
 {
-    DirHandle *retval = NULL;
-    char *allocated_fname = NULL;
-    char *fname = NULL;
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    WalkDir *root = NULL;
+    WalkData data;
     size_t len;
+    char *allocated_fname;
+    char *fname;
 
-    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+    BAIL_IF(!_fn, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!cb, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    memset(&data, '\0', sizeof (data));
+    data.callback = cb;
+    data.callbackData = d;
+    data.breadthfirst = ((flags & PHYSFS_WALK_BREADTH_FIRST) != 0);
 
     __PHYSFS_platformGrabMutex(stateLock);
-    len = strlen(_fname) + longest_root + 2;
-    allocated_fname = __PHYSFS_smallAlloc(len);
-    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, NULL);
+
+    len = strlen(_fn) + longest_root + 2;
+    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
     fname = allocated_fname + longest_root + 1;
-    if (sanitizePlatformIndependentPath(_fname, fname))
+
+    if (!sanitizePlatformIndependentPath(_fn, fname))
+        retval = PHYSFS_ENUM_STOP;
+    else if ((root = findWalkRoot(fname)) == NULL)
+        retval = PHYSFS_ENUM_ERROR;
+    else if ((flags & PHYSFS_WALK_PARALLEL) && (root->numsources > 1) &&
+             (!prepareWalkCaches(&data, root)))
+        retval = PHYSFS_ENUM_ERROR;
+    else
     {
-        DirHandle *i;
-        for (i = searchPath; i != NULL; i = i->next)
+        retval = walkDirectory(&data, root);
+        while (data.queuehead != NULL)
         {
-            char *arcfname = fname;
-            if (partOfMountPoint(i, arcfname))
-            {
-                retval = i;
-                break;
-            } /* if */
-            else if (verifyPath(i, &arcfname, 0))
-            {
-                PHYSFS_Stat statbuf;
-                if (i->funcs->stat(i->opaque, arcfname, &statbuf))
-                {
-                    retval = i;
-                    break;
-                } /* if */
-            } /* if */
-        } /* for */
-    } /* if */
+            WalkDir *dir = data.queuehead;
+            data.queuehead = dir->next;
+            if (data.queuehead == NULL)
+                data.queuetail = NULL;
+            if (retval == PHYSFS_ENUM_OK)
+                retval = walkDirectory(&data, dir);
+            allocator.Free(dir);
+        } /* while */
+    } /* else */
 
     __PHYSFS_platformReleaseMutex(stateLock);
+
+    freeWalkCaches(&data);
+    allocator.Free(data.path);
+    allocator.Free(root);
     __PHYSFS_smallFree(allocated_fname);
-    return retval;
-} /* getRealDirHandle */
 
-const char *PHYSFS_getRealDir(const char *fname)
+    return (retval == PHYSFS_ENUM_ERROR) ? 0 : 1;
+} /* PHYSFS_walk */
+
+
+/*
+ * PHYSFS_openDirIter() support.
+ *
+ * Indexed archives are read straight out of their DirTree, a child at a
+ *  time, and the names we hand out point into it. Everything else is
+ *  listed into a buffer when we get to it, like PHYSFS_enumerateFiles()
+ *  would. A name is skipped if an archive earlier in the listing has it,
+ *  which is a binary search in each of those.
+ */
+
+#define DIRITER_MOUNTPOINT 0  /* just the next element of the mountpoint. */
+#define DIRITER_TREE 1  /* walk a DirTree directory's children. */
+#define DIRITER_LIST 2  /* enumerate into (list), then walk that. */
+
+typedef struct DirIterSource
 {
-    DirHandle *dh = getRealDirHandle(fname);
-    return dh ? dh->dirName : NULL;
-} /* PHYSFS_getRealDir */
+    DirHandle *dh;
+    int kind;  /* DIRITER_* */
+    const char *mntelem;  /* in (dh)'s mountpoint; not null-terminated. */
+    size_t mntelemlen;
+    __PHYSFS_DirTree *tree;
+    const __PHYSFS_DirTreeEntry *dir;
+    int (*issymlink)(const __PHYSFS_DirTreeEntry *entry);  /* to hide them. */
+    char *arcfname;
+    EnumStringListCallbackData list;
+    int loaded;
+} DirIterSource;
+
+struct PHYSFS_DirIter
+{
+    struct PHYSFS_DirIter *next;  /* openDirIters list. */
+    PHYSFS_uint32 numsources;
+    PHYSFS_uint32 cursrc;
+    PHYSFS_uint32 pos;  /* within sources[cursrc]. */
+    char *mntname;  /* room for the longest mountpoint element. */
+    DirIterSource sources[1];  /* actually (numsources) of them. */
+};
 
 
-static int locateInStringList(const char *str,
-                              char **list,
-                              PHYSFS_uint32 *pos)
+static void freeDirIter(PHYSFS_DirIter *iter)
 {
-    PHYSFS_uint32 len = *pos;
-    PHYSFS_uint32 half_len;
-    PHYSFS_uint32 lo = 0;
-    PHYSFS_uint32 middle;
-    int cmp;
+    PHYSFS_uint32 i;
+    for (i = 0; i < iter->numsources; i++)
+    {
+        allocator.Free(iter->sources[i].arcfname);
+        freeStringListData(&iter->sources[i].list);
+    } /* for */
+    allocator.Free(iter);
+} /* freeDirIter */
 
-    while (len > 0)
+
+/* MAKE SURE you hold stateLock before calling this! */
+static void closeDirIters(void)
+{
+    while (openDirIters != NULL)
     {
-        half_len = len >> 1;
-        middle = lo + half_len;
-        cmp = strcmp(list[middle], str);
+        PHYSFS_DirIter *next = openDirIters->next;
+        freeDirIter(openDirIters);
+        openDirIters = next;
+    } /* while */
+} /* closeDirIters */
 
-        if (cmp == 0)  /* it's in the list already. */
-            return 1;
-        else if (cmp > 0)
-            len = half_len;
-        else
+
+/* MAKE SURE you hold stateLock before calling this! */
+static int dirIterInUse(const DirHandle *dh)
+{
+    const PHYSFS_DirIter *iter;
+    PHYSFS_uint32 i;
+
+    for (iter = openDirIters; iter != NULL; iter = iter->next)
+    {
+        for (i = 0; i < iter->numsources; i++)
         {
-            lo = middle + 1;
-            len -= half_len + 1;
-        } /* else */
-    } /* while */
+            if (iter->sources[i].dh == dh)
+                return 1;
+        } /* for */
+    } /* for */
 
-    *pos = lo;
     return 0;
-} /* locateInStringList */
+} /* dirIterInUse */
 
 
-static PHYSFS_EnumerateCallbackResult enumFilesCallback(void *data,
-                                        const char *origdir, const char *str)
+/* set up (src) if (dh) has (fname); returns 0 on error, -1 if it doesn't. */
+static int initDirIterSource(DirIterSource *src, DirHandle *dh, char *fname,
+                             LookupFilterKey *key)
 {
-    PHYSFS_uint32 pos;
-    void *ptr;
-    char *newstr;
-    EnumStringListCallbackData *pecd = (EnumStringListCallbackData *) data;
-
-    /*
-     * See if file is in the list already, and if not, insert it in there
-     *  alphabetically...
-     */
-    pos = pecd->size;
-    if (locateInStringList(str, pecd->list, &pos))
-        return PHYSFS_ENUM_OK;  /* already in the list, but keep going. */
+    char *arcfname = fname;
+    PHYSFS_Stat statbuf;
 
-    ptr = allocator.Realloc(pecd->list, (pecd->size + 2) * sizeof (char *));
-    newstr = (char *) allocator.Malloc(strlen(str) + 1);
-    if (ptr != NULL)
-        pecd->list = (char **) ptr;
+    memset(src, '\0', sizeof (DirIterSource));
+    src->dh = dh;
 
-    if ((ptr == NULL) || (newstr == NULL))
+    if (partOfMountPoint(dh, fname))
     {
-        if (newstr)
-            allocator.Free(newstr);
+        const size_t len = strlen(fname);
+        src->kind = DIRITER_MOUNTPOINT;
+        src->mntelem = dh->mountPoint + (len ? len + 1 : 0);
+        src->mntelemlen = (size_t) (strchr(src->mntelem, '/') - src->mntelem);
+        return 1;
+    } /* if */
 
-        pecd->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
-        return PHYSFS_ENUM_ERROR;  /* better luck next time. */
+    if (!lookupFilterMightHave(dh, arcfname, key))
+        return -1;
+    else if (!verifyPath(dh, &arcfname, 0))
+        return -1;
+    else if (!dh->funcs->stat(dh->opaque, arcfname, &statbuf))
+        return -1;
+    else if (statbuf.filetype != PHYSFS_FILETYPE_DIRECTORY)
+        return -1;
+
+    #if PHYSFS_SUPPORTS_ZIP
+    if (dh->funcs->openArchive == __PHYSFS_Archiver_ZIP.openArchive)
+    {
+        src->tree = __PHYSFS_ZIP_getTree(dh->opaque);
+        BAIL_IF_ERRPASS(!src->tree, 0);
+        if (!allowSymLinks)
+            src->issymlink = __PHYSFS_ZIP_entryIsSymlink;
     } /* if */
+    #endif
 
-    strcpy(newstr, str);
+    if (dh->funcs->stat == UNPK_stat)
+        src->tree = (__PHYSFS_DirTree *) dh->opaque;
 
-    if (pos != pecd->size)
+    if (src->tree != NULL)
     {
-        memmove(&pecd->list[pos+1], &pecd->list[pos],
-                 sizeof (char *) * ((pecd->size) - pos));
+        src->kind = DIRITER_TREE;
+        src->dir = __PHYSFS_DirTreeOpenDir(src->tree, arcfname);
+        BAIL_IF_ERRPASS(!src->dir, 0);
+        return 1;
     } /* if */
 
-    pecd->list[pos] = newstr;
-    pecd->size++;
-
-    return PHYSFS_ENUM_OK;
-} /* enumFilesCallback */
+    src->kind = DIRITER_LIST;
+    src->arcfname = __PHYSFS_strdup(arcfname);
+    BAIL_IF(!src->arcfname, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    return 1;
+} /* initDirIterSource */
 
 
-char **PHYSFS_enumerateFiles(const char *path)
+/* same as the per-archive part of doEnumerate(), into (src->list). */
+static int loadDirIterList(DirIterSource *src)
 {
-    EnumStringListCallbackData ecd;
-    memset(&ecd, '\0', sizeof (ecd));
-    ecd.list = (char **) allocator.Malloc(sizeof (char *));
-    BAIL_IF(!ecd.list, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
-    if (!PHYSFS_enumerate(path, enumFilesCallback, &ecd))
+    DirHandle *dh = src->dh;
+    EnumStringListCallbackData *list = &src->list;
+    PHYSFS_EnumerateCallbackResult rc;
+    PHYSFS_uint32 i;
+
+    if ((!allowSymLinks) && (dh->funcs->info.supportsSymlinks))
     {
-        const PHYSFS_ErrorCode errcode = currentErrorCode();
-        PHYSFS_uint32 i;
-        for (i = 0; i < ecd.size; i++)
-            allocator.Free(ecd.list[i]);
-        allocator.Free(ecd.list);
-        BAIL_IF(errcode == PHYSFS_ERR_APP_CALLBACK, ecd.errcode, NULL);
-        return NULL;
+        SymlinkFilterData filterdata;
+        memset(&filterdata, '\0', sizeof (filterdata));
+        filterdata.callback = enumFilesCallback;
+        filterdata.callbackData = list;
+        filterdata.dirhandle = dh;
+        filterdata.arcfname = src->arcfname;
+        rc = dh->funcs->enumerate(dh->opaque, src->arcfname,
+                                  enumCallbackFilterSymLinks, "", &filterdata);
+        if ((rc == PHYSFS_ENUM_ERROR) && (filterdata.errcode != PHYSFS_ERR_OK))
+            PHYSFS_setErrorCode(filterdata.errcode);
     } /* if */
+    else
+    {
+        rc = dh->funcs->enumerate(dh->opaque, src->arcfname,
+                                  enumFilesCallback, "", list);
+    } /* else */
 
-    ecd.list[ecd.size] = NULL;
-    return ecd.list;
-} /* PHYSFS_enumerateFiles */
+    if (rc == PHYSFS_ENUM_ERROR)
+    {
+        if (list->errcode != PHYSFS_ERR_OK)
+            PHYSFS_setErrorCode(list->errcode);
+        return 0;
+    } /* if */
 
+    /* sorted, so later archives can look names up in it. */
+    for (i = 1; i < list->size; i++)
+    {
+        if (stringListCmp(list, i - 1, i) > 0)
+        {
+            __PHYSFS_sort(list, list->size, stringListCmp, stringListSwap);
+            break;
+        } /* if */
+    } /* for */
 
-/*
- * Broke out to seperate function so we can use stack allocation gratuitously.
- */
-static PHYSFS_EnumerateCallbackResult enumerateFromMountPoint(DirHandle *i,
-                                    const char *arcfname,
-                                    PHYSFS_EnumerateCallback callback,
-                                    const char *_fname, void *data)
+    src->loaded = 1;
+    return 1;
+} /* loadDirIterList */
+
+
+/* Next name in (src), or NULL at the end, or NULL with (*err) set. */
+static const char *nextDirIterName(PHYSFS_DirIter *iter, DirIterSource *src,
+                                   int *err)
 {
-    PHYSFS_EnumerateCallbackResult retval;
-    const size_t len = strlen(arcfname);
-    char *ptr = NULL;
-    char *end = NULL;
-    const size_t slen = strlen(i->mountPoint) + 1;
-    char *mountPoint = (char *) __PHYSFS_smallAlloc(slen);
+    if (src->kind == DIRITER_MOUNTPOINT)
+    {
+        if (iter->pos++ > 0)
+            return NULL;
+        memcpy(iter->mntname, src->mntelem, src->mntelemlen);
+        iter->mntname[src->mntelemlen] = '\0';
+        return iter->mntname;
+    } /* if */
 
-    BAIL_IF(!mountPoint, PHYSFS_ERR_OUT_OF_MEMORY, PHYSFS_ENUM_ERROR);
+    else if (src->kind == DIRITER_TREE)
+    {
+        while (iter->pos < src->dir->childcount)
+        {
+            const __PHYSFS_DirTreeEntry *kid;
+            kid = __PHYSFS_DirTreeChild(src->tree, src->dir, iter->pos++);
+            if ((src->issymlink == NULL) || (!src->issymlink(kid)))
+                return kid->name;
+        } /* while */
+        return NULL;
+    } /* else if */
 
-    strcpy(mountPoint, i->mountPoint);
-    ptr = mountPoint + ((len) ? len + 1 : 0);
-    end = strchr(ptr, '/');
-    assert(end);  /* should always find a terminating '/'. */
-    *end = '\0';
-    retval = callback(data, _fname, ptr);
-    __PHYSFS_smallFree(mountPoint);
+    assert(src->kind == DIRITER_LIST);
+    if ((!src->loaded) && (!loadDirIterList(src)))
+    {
+        *err = 1;
+        return NULL;
+    } /* if */
 
-    BAIL_IF(retval == PHYSFS_ENUM_ERROR, PHYSFS_ERR_APP_CALLBACK, retval);
-    return retval;
-} /* enumerateFromMountPoint */
+    if (iter->pos >= src->list.size)
+        return NULL;
 
+    return src->list.arena + src->list.offsets[iter->pos++];
+} /* nextDirIterName */
 
-typedef struct SymlinkFilterData
-{
-    PHYSFS_EnumerateCallback callback;
-    void *callbackData;
-    DirHandle *dirhandle;
-    const char *arcfname;
-    PHYSFS_ErrorCode errcode;
-} SymlinkFilterData;
 
-static PHYSFS_EnumerateCallbackResult enumCallbackFilterSymLinks(void *_data,
-                                    const char *origdir, const char *fname)
+/* would (src) have listed (name)? */
+static int dirIterSourceHas(const DirIterSource *src, const char *name)
 {
-    SymlinkFilterData *data = (SymlinkFilterData *) _data;
-    const DirHandle *dh = data->dirhandle;
-    const char *arcfname = data->arcfname;
-    PHYSFS_Stat statbuf;
-    const char *trimmedDir = (*arcfname == '/') ? (arcfname + 1) : arcfname;
-    const size_t slen = strlen(trimmedDir) + strlen(fname) + 2;
-    char *path = (char *) __PHYSFS_smallAlloc(slen);
-    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
-
-    if (path == NULL)
+    if (src->kind == DIRITER_MOUNTPOINT)
     {
-        data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
-        return PHYSFS_ENUM_ERROR;
+        return ((strncmp(src->mntelem, name, src->mntelemlen) == 0) &&
+                (name[src->mntelemlen] == '\0'));
     } /* if */
 
-    snprintf(path, slen, "%s%s%s", trimmedDir, *trimmedDir ? "/" : "", fname);
-
-    if (!dh->funcs->stat(dh->opaque, path, &statbuf))
+    else if (src->kind == DIRITER_TREE)
     {
-        data->errcode = currentErrorCode();
-        retval = PHYSFS_ENUM_ERROR;
-    } /* if */
+        const __PHYSFS_DirTreeEntry *kid;
+        kid = __PHYSFS_DirTreeFindChild(src->tree, src->dir, name);
+        if (kid == NULL)
+            return 0;
+        return ((src->issymlink == NULL) || (!src->issymlink(kid)));
+    } /* else if */
+
     else
     {
-        /* Pass it on to the application if it's not a symlink. */
-        if (statbuf.filetype != PHYSFS_FILETYPE_SYMLINK)
+        const EnumStringListCallbackData *list = &src->list;
+        PHYSFS_uint32 lo = 0;
+        PHYSFS_uint32 hi = list->size;
+
+        assert(src->kind == DIRITER_LIST);
+        assert(src->loaded);  /* earlier sources are always read first. */
+
+        while (lo < hi)
         {
-            retval = data->callback(data->callbackData, origdir, fname);
-            if (retval == PHYSFS_ENUM_ERROR)
-                data->errcode = PHYSFS_ERR_APP_CALLBACK;
-        } /* if */
+            const PHYSFS_uint32 mid = lo + ((hi - lo) / 2);
+            const int rc = strcmp(name, list->arena + list->offsets[mid]);
+            if (rc == 0)
+                return 1;
+            else if (rc < 0)
+                hi = mid;
+            else
+                lo = mid + 1;
+        } /* while */
     } /* else */
 
-    __PHYSFS_smallFree(path);
-
-    return retval;
-} /* enumCallbackFilterSymLinks */
+    return 0;
+} /* dirIterSourceHas */
 
 
-int PHYSFS_enumerate(const char *_fn, PHYSFS_EnumerateCallback cb, void *data)
+PHYSFS_DirIter *PHYSFS_openDirIter(const char *_fn)
 {
-    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    PHYSFS_DirIter *retval = NULL;
+    PHYSFS_uint32 count = 0;
+    size_t longest_mntpnt = 0;
     size_t len;
     char *allocated_fname;
     char *fname;
+    LookupFilterKey key;
+    DirHandle *i;
+    int rewritten = 0;
 
-    BAIL_IF(!_fn, PHYSFS_ERR_INVALID_ARGUMENT, 0);
-    BAIL_IF(!cb, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!_fn, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
 
     __PHYSFS_platformGrabMutex(stateLock);
 
+    for (i = searchPath; i != NULL; i = i->next)
+    {
+        count++;
+        if ((i->mountPoint) && (strlen(i->mountPoint) > longest_mntpnt))
+            longest_mntpnt = strlen(i->mountPoint);
+    } /* for */
+
     len = strlen(_fn) + longest_root + 2;
     allocated_fname = (char *) __PHYSFS_smallAlloc(len);
-    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, NULL);
     fname = allocated_fname + longest_root + 1;
     if (!sanitizePlatformIndependentPath(_fn, fname))
-        retval = PHYSFS_ENUM_STOP;
-    else
+        goto openDirIter_failed;  /* error is set. */
+
+    len = sizeof (PHYSFS_DirIter) + longest_mntpnt + 1;
+    if (count > 1)
+        len += (count - 1) * sizeof (DirIterSource);
+    retval = (PHYSFS_DirIter *) allocator.Malloc(len);
+    GOTO_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, openDirIter_failed);
+    memset(retval, '\0', sizeof (PHYSFS_DirIter));
+    retval->mntname = ((char *) retval) + (len - (longest_mntpnt + 1));
+
+    initLookupFilterKey(&key);
+    for (i = searchPath; i != NULL; i = i->next)
     {
-        DirHandle *i;
-        SymlinkFilterData filterdata;
+        DirIterSource *src = &retval->sources[retval->numsources];
+        int rc;
 
-        if (!allowSymLinks)
-        {
-            memset(&filterdata, '\0', sizeof (filterdata));
-            filterdata.callback = cb;
-            filterdata.callbackData = data;
-        } /* if */
+        if (rewritten)  /* put back the case that the last archive fixed. */
+            sanitizePlatformIndependentPath(_fn, fname);
+        rewritten = i->ignorecase;
 
-        for (i = searchPath; (retval == PHYSFS_ENUM_OK) && i; i = i->next)
+        rc = initDirIterSource(src, i, fname, &key);
+        if (rc == 1)
+            retval->numsources++;
+        else
         {
-            char *arcfname = fname;
+            allocator.Free(src->arcfname);
+            if (rc == 0)
+                goto openDirIter_failed;
+        } /* else */
+    } /* for */
 
-            if (partOfMountPoint(i, arcfname))
-                retval = enumerateFromMountPoint(i, arcfname, cb, _fn, data);
+    retval->next = openDirIters;
+    openDirIters = retval;
 
-            else if (verifyPath(i, &arcfname, 0))
-            {
-                PHYSFS_Stat statbuf;
-                if (!i->funcs->stat(i->opaque, arcfname, &statbuf))
-                {
-                    if (currentErrorCode() == PHYSFS_ERR_NOT_FOUND)
-                        continue;  /* no such dir in this archive, skip it. */
-                } /* if */
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return retval;
 
-                if (statbuf.filetype != PHYSFS_FILETYPE_DIRECTORY)
-                    continue;  /* not a directory in this archive, skip it. */
+openDirIter_failed:
+    if (retval != NULL)
+        freeDirIter(retval);
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return NULL;
+} /* PHYSFS_openDirIter */
 
-                else if ((!allowSymLinks) && (i->funcs->info.supportsSymlinks))
-                {
-                    filterdata.dirhandle = i;
-                    filterdata.arcfname = arcfname;
-                    filterdata.errcode = PHYSFS_ERR_OK;
-                    retval = i->funcs->enumerate(i->opaque, arcfname,
-                                                 enumCallbackFilterSymLinks,
-                                                 _fn, &filterdata);
-                    if (retval == PHYSFS_ENUM_ERROR)
-                    {
-                        if (currentErrorCode() == PHYSFS_ERR_APP_CALLBACK)
-                            PHYSFS_setErrorCode(filterdata.errcode);
-                    } /* if */
-                } /* else if */
-                else
-                {
-                    retval = i->funcs->enumerate(i->opaque, arcfname,
-                                                 cb, _fn, data);
-                } /* else */
-            } /* else if */
+
+int PHYSFS_nextDirEntry(PHYSFS_DirIter *iter, const char **name)
+{
+    BAIL_IF(!iter, PHYSFS_ERR_INVALID_ARGUMENT, -1);
+    BAIL_IF(!name, PHYSFS_ERR_INVALID_ARGUMENT, -1);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    while (iter->cursrc < iter->numsources)
+    {
+        DirIterSource *src = &iter->sources[iter->cursrc];
+        int err = 0;
+        const char *str = nextDirIterName(iter, src, &err);
+        PHYSFS_uint32 j;
+
+        if (err)
+        {
+            __PHYSFS_platformReleaseMutex(stateLock);
+            return -1;
+        } /* if */
+
+        else if (str == NULL)  /* done with this one. */
+        {
+            iter->cursrc++;
+            iter->pos = 0;
+            continue;
+        } /* else if */
+
+        for (j = 0; j < iter->cursrc; j++)
+        {
+            if (dirIterSourceHas(&iter->sources[j], str))
+                break;
         } /* for */
 
-    } /* if */
+        if (j == iter->cursrc)  /* first archive to have it. */
+        {
+            *name = str;
+            __PHYSFS_platformReleaseMutex(stateLock);
+            return 1;
+        } /* if */
+    } /* while */
 
     __PHYSFS_platformReleaseMutex(stateLock);
+    return 0;
+} /* PHYSFS_nextDirEntry */
 
-    __PHYSFS_smallFree(allocated_fname);
 
-    return (retval == PHYSFS_ENUM_ERROR) ? 0 : 1;
-} /* PHYSFS_enumerate */
+void PHYSFS_closeDirIter(PHYSFS_DirIter *iter)
+{
+    PHYSFS_DirIter *prev = NULL;
+    PHYSFS_DirIter *i;
+
+    if (iter == NULL)
+        return;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    for (i = openDirIters; i != NULL; i = i->next)
+    {
+        if (i == iter)
+        {
+            if (prev == NULL)
+                openDirIters = iter->next;
+            else
+                prev->next = iter->next;
+            freeDirIter(iter);
+            break;
+        } /* if */
+        prev = i;
+    } /* for */
+    __PHYSFS_platformReleaseMutex(stateLock);
+} /* PHYSFS_closeDirIter */
 
 
 typedef struct
@@ -2705,7 +6345,7 @@ static PHYSFS_File *doOpenWrite(const char *_fname, const int appending)
     {
         PHYSFS_Io *io = NULL;
         char *arcfname = fname;
-        if (verifyPath(h, &arcfname, 0))
+        if (verifyPath(h, &arcfname, 1))
         {
             const PHYSFS_Archiver *f = h->funcs;
             if (appending)
@@ -2752,6 +6392,58 @@ PHYSFS_File *PHYSFS_openAppend(const char *filename)
 } /* PHYSFS_openAppend */
 
 
+/* Like findRealDirHandle(), but opens the file. Hold stateLock for this! */
+static FileHandle *doOpenRead(char *fname, PHYSFS_Path *compiled)
+{
+    FileHandle *fh = NULL;
+    PHYSFS_Io *io = NULL;
+    LookupFilterKey key;
+    MountCursor cursor;
+    DirHandle *i;
+
+    initLookupFilterKey(&key);
+    if (compiled != NULL)
+        primeLookupFilterKey(&key, fname, compiled->hash, compiled->ascii);
+
+    for (i = firstMountCandidate(&cursor, fname, compiled); i != NULL;
+         i = nextMountCandidate(&cursor))
+    {
+        char *arcfname = fname;
+        if (lookupFilterMightHave(i, arcfname, &key) &&
+            verifyMountedPath(i, &arcfname, 0, cursor.lastmatched))
+        {
+            io = i->funcs->openRead(i->opaque, arcfname);
+            if (io)
+                break;
+        } /* if */
+    } /* for */
+
+    if (!io)
+        finishLookup(&cursor, &key);
+
+    if (io)
+    {
+        fh = (FileHandle *) allocator.Malloc(sizeof (FileHandle));
+        if (fh == NULL)
+        {
+            io->destroy(io);
+            PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
+        } /* if */
+        else
+        {
+            memset(fh, '\0', sizeof (FileHandle));
+            fh->io = io;
+            fh->forReading = 1;
+            fh->dirHandle = i;
+            fh->next = openReadList;
+            openReadList = fh;
+        } /* else */
+    } /* if */
+
+    return fh;
+} /* doOpenRead */
+
+
 PHYSFS_File *PHYSFS_openRead(const char *_fname)
 {
     FileHandle *fh = NULL;
@@ -2770,42 +6462,9 @@ PHYSFS_File *PHYSFS_openRead(const char *_fname)
     BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
     fname = allocated_fname + longest_root + 1;
 
-    if (sanitizePlatformIndependentPath(_fname, fname))
-    {
-        PHYSFS_Io *io = NULL;
-        DirHandle *i;
-
-        for (i = searchPath; i != NULL; i = i->next)
-        {
-            char *arcfname = fname;
-            if (verifyPath(i, &arcfname, 0))
-            {
-                io = i->funcs->openRead(i->opaque, arcfname);
-                if (io)
-                    break;
-            } /* if */
-        } /* for */
-
-        if (io)
-        {
-            fh = (FileHandle *) allocator.Malloc(sizeof (FileHandle));
-            if (fh == NULL)
-            {
-                io->destroy(io);
-                PHYSFS_setErrorCode(PHYSFS_ERR_OUT_OF_MEMORY);
-            } /* if */
-            else
-            {
-                memset(fh, '\0', sizeof (FileHandle));
-                fh->io = io;
-                fh->forReading = 1;
-                fh->dirHandle = i;
-                fh->next = openReadList;
-                openReadList = fh;
-            } /* else */
-        } /* if */
-    } /* if */
-
+    if (sanitizePlatformIndependentPath(_fname, fname))
+        fh = doOpenRead(fname, NULL);
+
     __PHYSFS_platformReleaseMutex(stateLock);
     __PHYSFS_smallFree(allocated_fname);
     return ((PHYSFS_File *) fh);
@@ -3024,179 +6683,665 @@ int PHYSFS_eof(PHYSFS_File *handle)
         return (pos >= len);
     } /* if */
 
-    return 0;
-} /* PHYSFS_eof */
+    return 0;
+} /* PHYSFS_eof */
+
+
+PHYSFS_sint64 PHYSFS_tell(PHYSFS_File *handle)
+{
+    FileHandle *fh = (FileHandle *) handle;
+    const PHYSFS_sint64 pos = fh->io->tell(fh->io);
+    const PHYSFS_sint64 retval = fh->forReading ?
+                                 (pos - fh->buffill) + fh->bufpos :
+                                 (pos + fh->buffill);
+    return retval;
+} /* PHYSFS_tell */
+
+
+int PHYSFS_seek(PHYSFS_File *handle, PHYSFS_uint64 pos)
+{
+    FileHandle *fh = (FileHandle *) handle;
+    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), 0);
+
+    if (fh->buffer && fh->forReading)
+    {
+        /* avoid throwing away our precious buffer if seeking within it. */
+        PHYSFS_sint64 offset = pos - PHYSFS_tell(handle);
+        if ( /* seeking within the already-buffered range? */
+             /* forward? */
+            ((offset >= 0) && (((size_t)offset) <= fh->buffill-fh->bufpos)) ||
+            /* backward? */
+            ((offset < 0) && (((size_t) -offset) <= fh->bufpos)) )
+        {
+            fh->bufpos = (size_t) (((PHYSFS_sint64) fh->bufpos) + offset);
+            return 1; /* successful seek */
+        } /* if */
+    } /* if */
+
+    /* we have to fall back to a 'raw' seek. */
+    fh->buffill = fh->bufpos = 0;
+    return fh->io->seek(fh->io, pos);
+} /* PHYSFS_seek */
+
+
+PHYSFS_sint64 PHYSFS_fileLength(PHYSFS_File *handle)
+{
+    PHYSFS_Io *io = ((FileHandle *) handle)->io;
+    return io->length(io);
+} /* PHYSFS_filelength */
+
+
+int PHYSFS_setBuffer(PHYSFS_File *handle, PHYSFS_uint64 _bufsize)
+{
+    FileHandle *fh = (FileHandle *) handle;
+    const size_t bufsize = (size_t) _bufsize;
+
+    if (!__PHYSFS_ui64FitsAddressSpace(_bufsize))
+        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), 0);
+
+    /*
+     * For reads, we need to move the file pointer to where it would be
+     *  if we weren't buffering, so that the next read will get the
+     *  right chunk of stuff from the file. PHYSFS_flush() handles writes.
+     */
+    if ((fh->forReading) && (fh->buffill != fh->bufpos))
+    {
+        PHYSFS_uint64 pos;
+        const PHYSFS_sint64 curpos = fh->io->tell(fh->io);
+        BAIL_IF_ERRPASS(curpos == -1, 0);
+        pos = ((curpos - fh->buffill) + fh->bufpos);
+        BAIL_IF_ERRPASS(!fh->io->seek(fh->io, pos), 0);
+    } /* if */
+
+    if (bufsize == 0)  /* delete existing buffer. */
+    {
+        if (fh->buffer)
+        {
+            allocator.Free(fh->buffer);
+            fh->buffer = NULL;
+        } /* if */
+    } /* if */
+
+    else
+    {
+        PHYSFS_uint8 *newbuf;
+        newbuf = (PHYSFS_uint8 *) allocator.Realloc(fh->buffer, bufsize);
+        BAIL_IF(!newbuf, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        fh->buffer = newbuf;
+    } /* else */
+
+    fh->bufsize = bufsize;
+    fh->buffill = fh->bufpos = 0;
+    return 1;
+} /* PHYSFS_setBuffer */
+
+
+int PHYSFS_flush(PHYSFS_File *handle)
+{
+    FileHandle *fh = (FileHandle *) handle;
+    PHYSFS_Io *io;
+    PHYSFS_sint64 rc;
+
+    if ((fh->forReading) || (fh->bufpos == fh->buffill))
+        return 1;  /* open for read or buffer empty are successful no-ops. */
+
+    /* dump buffer to disk. */
+    io = fh->io;
+    rc = io->write(io, fh->buffer + fh->bufpos, fh->buffill - fh->bufpos);
+    BAIL_IF_ERRPASS(rc <= 0, 0);
+    fh->bufpos = fh->buffill = 0;
+    return 1;
+} /* PHYSFS_flush */
+
+
+/*
+ * What PHYSFS_statMany() learned about one archive's copy of the parent
+ *  directory of one group of paths: for a real directory, a handle to stat
+ *  its files with, or for any archive, that it doesn't have it at all.
+ */
+typedef struct
+{
+    DirHandle *dh;
+    void *statdir;  /* from __PHYSFS_DIR_openStatDir(), or NULL. */
+    PHYSFS_ErrorCode errcode;  /* if no (statdir): why (0: do it the usual way). */
+} StatManyDir;
+
+/* Every path in a group has the same parent, so each archive needs one. */
+typedef struct
+{
+    StatManyDir *dirs;
+    size_t numdirs;
+    size_t capacity;
+} StatManyDirs;
+
+
+static void closeStatManyDirs(StatManyDirs *dirs)
+{
+    size_t i;
+    for (i = 0; i < dirs->numdirs; i++)
+    {
+        if (dirs->dirs[i].statdir != NULL)
+            __PHYSFS_platformCloseStatDir(dirs->dirs[i].statdir);
+    } /* for */
+    dirs->numdirs = 0;
+} /* closeStatManyDirs */
+
+
+/* Look at (h)'s copy of (dname), an archive path, for statManyStat(). */
+static void openStatManyDir(StatManyDir *dir, DirHandle *h, const char *dname)
+{
+    __PHYSFS_DirTree *tree;
+
+    dir->dh = h;
+    dir->statdir = NULL;
+    dir->errcode = PHYSFS_ERR_OK;
+
+    if (h->funcs == &__PHYSFS_Archiver_DIR)
+    {
+        dir->statdir = __PHYSFS_DIR_openStatDir(h->opaque, dname,
+                                                allowSymLinks);
+        if (dir->statdir == NULL)
+        {
+            /* only a missing or forbidden dir means none of these exist. */
+            dir->errcode = currentErrorCode();
+            if ((dir->errcode != PHYSFS_ERR_NOT_FOUND) &&
+                (dir->errcode != PHYSFS_ERR_SYMLINK_FORBIDDEN))
+                dir->errcode = PHYSFS_ERR_OK;
+        } /* if */
+    } /* if */
+
+    else if ((archiveDirTree(h, &tree)) && (tree != NULL) && (*dname))
+    {
+        /* one lookup, instead of a failed one for each file in (dname). */
+        const __PHYSFS_DirTreeEntry *entry = __PHYSFS_DirTreeFind(tree, dname);
+        if ((entry == NULL) || (!entry->isdir))
+            dir->errcode = PHYSFS_ERR_NOT_FOUND;
+    } /* else if */
+} /* openStatManyDir */
+
+
+/*
+ * Stat (fname), a sanitized path in the virtual tree, in (h), using what
+ *  (dirs) knows about its parent directory, for all of (dirs)'s group.
+ *  Returns -1 if the caller should stat it the usual way, zero if (h) can't
+ *  have it (like verifyPath() failing), and 1 if it was stat'd, with the
+ *  result in (*rc). (mountmatched) is as in verifyMountedPath(). Hold
+ *  stateLock for this!
+ */
+static int statManyStat(StatManyDirs *dirs, DirHandle *h, char *fname,
+                        int mountmatched, PHYSFS_Stat *stat, int *rc)
+{
+    StatManyDir *dir = NULL;
+    PHYSFS_Stat statbuf;
+    char *leaf;
+    size_t i;
+
+    for (i = 0; i < dirs->numdirs; i++)
+    {
+        if (dirs->dirs[i].dh == h)
+        {
+            dir = &dirs->dirs[i];
+            break;
+        } /* if */
+    } /* for */
+
+    if ((dir != NULL) && (dir->statdir == NULL) && (!dir->errcode))
+        return -1;  /* we already know there's no shortcut here. */
+    else if (h->ignorecase)
+        return -1;  /* verifyPath() has to find the right case first. */
+
+    BAIL_IF_ERRPASS(!toArchivePath(h, &fname, mountmatched), 0);
+    if (*fname == '\0')
+        return -1;  /* the archive's root; not worth a special case. */
+
+    leaf = strrchr(fname, '/');
+    if (dir == NULL)
+    {
+        if (dirs->numdirs == dirs->capacity)
+        {
+            const size_t newcap = dirs->capacity ? dirs->capacity * 2 : 4;
+            void *ptr = allocator.Realloc(dirs->dirs,
+                                          newcap * sizeof (StatManyDir));
+            if (!ptr)
+                return -1;  /* just do it the slow way. */
+            dirs->dirs = (StatManyDir *) ptr;
+            dirs->capacity = newcap;
+        } /* if */
+
+        dir = &dirs->dirs[dirs->numdirs++];
+        if (leaf != NULL)
+            *leaf = '\0';
+        openStatManyDir(dir, h, leaf ? fname : "");
+        if (leaf != NULL)
+            *leaf = '/';
+    } /* if */
+
+    if (dir->statdir == NULL)
+    {
+        BAIL_IF(dir->errcode, dir->errcode, 0);
+        return -1;
+    } /* if */
+
+    if (!__PHYSFS_platformStatAt(dir->statdir, leaf ? leaf + 1 : fname,
+                                 &statbuf))
+    {
+        *rc = 0;
+        return 1;
+    } /* if */
+
+    /* the leaf itself is the last element verifyPath() would check. */
+    if ((!allowSymLinks) && (statbuf.filetype == PHYSFS_FILETYPE_SYMLINK))
+        BAIL(PHYSFS_ERR_SYMLINK_FORBIDDEN, 0);
+
+    memcpy(stat, &statbuf, sizeof (statbuf));
+    *rc = 1;
+    return 1;
+} /* statManyStat */
+
+
+/*
+ * Like findRealDirHandle(), but stats the file. (dirs) is PHYSFS_statMany()'s
+ *  state for (fname)'s group, or NULL. Hold stateLock for this!
+ */
+static int doStat(char *fname, PHYSFS_Path *compiled, PHYSFS_Stat *stat,
+                  StatManyDirs *dirs)
+{
+    LookupFilterKey key;
+    MountCursor cursor;
+    DirHandle *i;
+    int exists = 0;
+    int retval = 0;
+
+    if (*fname == '\0')
+    {
+        stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
+        stat->readonly = !writeDir; /* Writeable if we have a writeDir */
+        return 1;
+    } /* if */
+
+    initLookupFilterKey(&key);
+    if (compiled != NULL)
+        primeLookupFilterKey(&key, fname, compiled->hash, compiled->ascii);
+
+    for (i = firstMountCandidate(&cursor, fname, compiled);
+         ((i != NULL) && (!exists)); i = nextMountCandidate(&cursor))
+    {
+        char *arcfname = fname;
+        exists = partOfMountPoint(i, arcfname);
+        if (exists)
+        {
+            stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
+            stat->readonly = 1;
+            retval = 1;
+        } /* if */
+        else if (lookupFilterMightHave(i, arcfname, &key))
+        {
+            int tried = -1;
+            if (dirs != NULL)
+                tried = statManyStat(dirs, i, arcfname, cursor.lastmatched,
+                                     stat, &retval);
+
+            if ((tried == -1) &&
+                (verifyMountedPath(i, &arcfname, 0, cursor.lastmatched)))
+            {
+                retval = i->funcs->stat(i->opaque, arcfname, stat);
+                tried = 1;
+            } /* if */
+
+            if (tried == 1)
+            {
+                if ((retval) || (currentErrorCode() != PHYSFS_ERR_NOT_FOUND))
+                    exists = 1;
+            } /* if */
+        } /* else if */
+    } /* for */
+
+    if (!exists)
+        finishLookup(&cursor, &key);
+
+    return retval;
+} /* doStat */
+
+
+int PHYSFS_stat(const char *_fname, PHYSFS_Stat *stat)
+{
+    int retval = 0;
+    char *allocated_fname;
+    char *fname;
+    size_t len;
+
+    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    initStat(stat);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+    len = strlen(_fname) + longest_root + 2;
+    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root + 1;
+
+    if (sanitizePlatformIndependentPath(_fname, fname))
+        retval = doStat(fname, NULL, stat, NULL);
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return retval;
+} /* PHYSFS_stat */
+
+
+/* One of PHYSFS_statMany()'s paths, sanitized into its arena. */
+typedef struct
+{
+    size_t offset;  /* into the arena. */
+    size_t len;  /* strlen() of it. */
+    size_t dirlen;  /* length of its parent directory's path. */
+    PHYSFS_uint32 idx;  /* into the caller's arrays. */
+} StatManyItem;
+
+typedef struct
+{
+    StatManyItem *items;
+    const char *arena;
+} StatManySortData;
+
+static int statManyCmp(void *_a, size_t one, size_t two)
+{
+    const StatManySortData *data = (const StatManySortData *) _a;
+    const StatManyItem *a = &data->items[one];
+    const StatManyItem *b = &data->items[two];
+
+    /* we only need each directory's paths together, not a real order. */
+    if (a->dirlen != b->dirlen)
+        return (a->dirlen < b->dirlen) ? -1 : 1;
+    return memcmp(data->arena + a->offset, data->arena + b->offset, a->dirlen);
+} /* statManyCmp */
+
+static void statManySwap(void *_a, size_t one, size_t two)
+{
+    StatManyItem *items = ((StatManySortData *) _a)->items;
+    StatManyItem tmp;
+    memcpy(&tmp, &items[one], sizeof (StatManyItem));
+    memcpy(&items[one], &items[two], sizeof (StatManyItem));
+    memcpy(&items[two], &tmp, sizeof (StatManyItem));
+} /* statManySwap */
+
+
+PHYSFS_sint64 PHYSFS_statMany(const char * const *paths, PHYSFS_uint32 count,
+                              PHYSFS_Stat *stats, PHYSFS_ErrorCode *errors)
+{
+    PHYSFS_sint64 retval = 0;
+    PHYSFS_uint32 firstfail = count;
+    PHYSFS_ErrorCode firsterr = PHYSFS_ERR_OK;
+    PHYSFS_ErrorCode prevcode;
+    StatManySortData sortdata;
+    StatManyItem *items = NULL;
+    StatManyDirs dirs;
+    char *allocated_fname = NULL;
+    char *arena;
+    ErrState *err;
+    size_t numitems = 0;
+    size_t longest = 0;
+    size_t total = 0;
+    size_t pos = 0;
+    size_t start;
+    size_t end;
+    PHYSFS_uint32 i;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, -1);
+    BAIL_IF((count > 0) && ((!paths) || (!stats)),
+            PHYSFS_ERR_INVALID_ARGUMENT, -1);
+
+    for (i = 0; i < count; i++)
+    {
+        size_t len;
+        BAIL_IF(!paths[i], PHYSFS_ERR_INVALID_ARGUMENT, -1);
+        len = strlen(paths[i]);
+        if (len > longest)
+            longest = len;
+        total += len + 1;
+    } /* for */
+
+    if (count == 0)
+        return 0;
+
+    /* sanitized paths are never longer than the originals. */
+    items = (StatManyItem *) allocator.Malloc((sizeof (StatManyItem) * count)
+                                              + total);
+    BAIL_IF(!items, PHYSFS_ERR_OUT_OF_MEMORY, -1);
+    arena = (char *) (items + count);
+    memset(&dirs, '\0', sizeof (dirs));
+
+    err = findErrorForCurrentThread();
+    prevcode = err ? err->code : PHYSFS_ERR_OK;
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    /* one scratch buffer, with room for verifyPath() to prepend roots. */
+    allocated_fname = (char *) allocator.Malloc(longest + longest_root + 2);
+    if (!allocated_fname)
+    {
+        __PHYSFS_platformReleaseMutex(stateLock);
+        allocator.Free(items);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, -1);
+    } /* if */
+
+    for (i = 0; i < count; i++)
+    {
+        StatManyItem *item = &items[numitems];
+        char *dst = arena + pos;
 
+        initStat(&stats[i]);
+        if (err)
+            err->code = PHYSFS_ERR_OK;
 
-PHYSFS_sint64 PHYSFS_tell(PHYSFS_File *handle)
-{
-    FileHandle *fh = (FileHandle *) handle;
-    const PHYSFS_sint64 pos = fh->io->tell(fh->io);
-    const PHYSFS_sint64 retval = fh->forReading ?
-                                 (pos - fh->buffill) + fh->bufpos :
-                                 (pos + fh->buffill);
-    return retval;
-} /* PHYSFS_tell */
+        if (sanitizePlatformIndependentPath(paths[i], dst))
+        {
+            const char *slash = strrchr(dst, '/');
+            item->offset = pos;
+            item->len = strlen(dst);
+            item->dirlen = slash ? (size_t) (slash - dst) : 0;
+            item->idx = i;
+            pos += item->len + 1;
+            numitems++;
+            continue;
+        } /* if */
 
+        if (!err)
+            err = findErrorForCurrentThread();
+        if (errors)
+            errors[i] = err ? err->code : PHYSFS_ERR_BAD_FILENAME;
+        if (firstfail == count)
+        {
+            firstfail = i;
+            firsterr = err ? err->code : PHYSFS_ERR_BAD_FILENAME;
+        } /* if */
+    } /* for */
 
-int PHYSFS_seek(PHYSFS_File *handle, PHYSFS_uint64 pos)
-{
-    FileHandle *fh = (FileHandle *) handle;
-    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), 0);
+    sortdata.items = items;
+    sortdata.arena = arena;
+    __PHYSFS_sort(&sortdata, numitems, statManyCmp, statManySwap);
 
-    if (fh->buffer && fh->forReading)
+    for (start = 0; start < numitems; start = end)
     {
-        /* avoid throwing away our precious buffer if seeking within it. */
-        PHYSFS_sint64 offset = pos - PHYSFS_tell(handle);
-        if ( /* seeking within the already-buffered range? */
-             /* forward? */
-            ((offset >= 0) && (((size_t)offset) <= fh->buffill-fh->bufpos)) ||
-            /* backward? */
-            ((offset < 0) && (((size_t) -offset) <= fh->bufpos)) )
+        const char *dir = arena + items[start].offset;
+        const size_t dirlen = items[start].dirlen;
+
+        for (end = start; end < numitems; end++)
         {
-            fh->bufpos = (size_t) (((PHYSFS_sint64) fh->bufpos) + offset);
-            return 1; /* successful seek */
-        } /* if */
-    } /* if */
+            const StatManyItem *item = &items[end];
+            char *fname = allocated_fname + longest_root + 1;
+            PHYSFS_ErrorCode code = PHYSFS_ERR_OK;
 
-    /* we have to fall back to a 'raw' seek. */
-    fh->buffill = fh->bufpos = 0;
-    return fh->io->seek(fh->io, pos);
-} /* PHYSFS_seek */
+            if ((item->dirlen != dirlen) ||
+                (memcmp(arena + item->offset, dir, dirlen) != 0))
+                break;  /* on to the next directory. */
 
+            if (err)
+                err->code = PHYSFS_ERR_OK;
 
-PHYSFS_sint64 PHYSFS_fileLength(PHYSFS_File *handle)
-{
-    PHYSFS_Io *io = ((FileHandle *) handle)->io;
-    return io->length(io);
-} /* PHYSFS_filelength */
+            /* doStat() and verifyPath() write to it. */
+            memcpy(fname, arena + item->offset, item->len + 1);
+            if (doStat(fname, NULL, &stats[item->idx], &dirs))
+                retval++;
+            else
+            {
+                if (!err)
+                    err = findErrorForCurrentThread();
+                code = err ? err->code : PHYSFS_ERR_OK;
+                if (code == PHYSFS_ERR_OK)
+                    code = PHYSFS_ERR_NOT_FOUND;  /* nothing is mounted. */
+                if (item->idx < firstfail)
+                {
+                    firstfail = item->idx;
+                    firsterr = code;
+                } /* if */
+            } /* else */
 
+            if (errors)
+                errors[item->idx] = code;
+        } /* for */
 
-int PHYSFS_setBuffer(PHYSFS_File *handle, PHYSFS_uint64 _bufsize)
-{
-    FileHandle *fh = (FileHandle *) handle;
-    const size_t bufsize = (size_t) _bufsize;
+        closeStatManyDirs(&dirs);
+    } /* for */
 
-    if (!__PHYSFS_ui64FitsAddressSpace(_bufsize))
-        BAIL(PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    __PHYSFS_platformReleaseMutex(stateLock);
 
-    BAIL_IF_ERRPASS(!PHYSFS_flush(handle), 0);
+    allocator.Free(dirs.dirs);
+    allocator.Free(allocated_fname);
+    allocator.Free(items);
 
-    /*
-     * For reads, we need to move the file pointer to where it would be
-     *  if we weren't buffering, so that the next read will get the
-     *  right chunk of stuff from the file. PHYSFS_flush() handles writes.
-     */
-    if ((fh->forReading) && (fh->buffill != fh->bufpos))
+    /* leave the first failure's error, or whatever was there before. */
+    if (firstfail < count)
+        PHYSFS_setErrorCode(firsterr);
+    else if (err)
+        err->code = prevcode;
+    return retval;
+} /* PHYSFS_statMany */
+
+
+PHYSFS_Path *PHYSFS_compilePath(const char *path)
+{
+    PHYSFS_Path *retval;
+    const char *ptr;
+    size_t elements = 1;
+    size_t slots;
+    size_t len;
+
+    BAIL_IF(!initialized, PHYSFS_ERR_NOT_INITIALIZED, NULL);
+    BAIL_IF(!path, PHYSFS_ERR_INVALID_ARGUMENT, NULL);
+
+    for (ptr = path; *ptr; ptr++)
     {
-        PHYSFS_uint64 pos;
-        const PHYSFS_sint64 curpos = fh->io->tell(fh->io);
-        BAIL_IF_ERRPASS(curpos == -1, 0);
-        pos = ((curpos - fh->buffill) + fh->bufpos);
-        BAIL_IF_ERRPASS(!fh->io->seek(fh->io, pos), 0);
-    } /* if */
+        if (*ptr == '/')
+            elements++;
+    } /* for */
 
-    if (bufsize == 0)  /* delete existing buffer. */
+    /* a mount tree walk visits the root and at most one node per element. */
+    slots = elements + 1;
+    if (slots > MOUNT_TREE_MAX_DEPTH + 1)
+        slots = MOUNT_TREE_MAX_DEPTH + 1;
+
+    len = (size_t) (ptr - path) + 1;
+    retval = (PHYSFS_Path *) allocator.Malloc(sizeof (PHYSFS_Path) +
+                                      (slots * sizeof (MountNode *)) + len);
+    BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+
+    memset(retval, '\0', sizeof (PHYSFS_Path));
+    retval->nodes = (MountNode **) (retval + 1);
+    retval->path = (char *) (retval->nodes + slots);
+    if (!sanitizePlatformIndependentPath(path, retval->path))
     {
-        if (fh->buffer)
-        {
-            allocator.Free(fh->buffer);
-            fh->buffer = NULL;
-        } /* if */
+        allocator.Free(retval);
+        return NULL;
     } /* if */
 
-    else
-    {
-        PHYSFS_uint8 *newbuf;
-        newbuf = (PHYSFS_uint8 *) allocator.Realloc(fh->buffer, bufsize);
-        BAIL_IF(!newbuf, PHYSFS_ERR_OUT_OF_MEMORY, 0);
-        fh->buffer = newbuf;
-    } /* else */
+    retval->len = strlen(retval->path);
+    retval->ascii = 1;
+    retval->hash = lookupFilterHash(LOOKUP_FILTER_HASH_INIT, retval->path,
+                                    retval->len, &retval->ascii);
+    return retval;
+} /* PHYSFS_compilePath */
 
-    fh->bufsize = bufsize;
-    fh->buffill = fh->bufpos = 0;
-    return 1;
-} /* PHYSFS_setBuffer */
 
+void PHYSFS_freePath(PHYSFS_Path *path)
+{
+    allocator.Free(path);
+} /* PHYSFS_freePath */
 
-int PHYSFS_flush(PHYSFS_File *handle)
+
+int PHYSFS_existsPath(PHYSFS_Path *path)
 {
-    FileHandle *fh = (FileHandle *) handle;
-    PHYSFS_Io *io;
-    PHYSFS_sint64 rc;
+    DirHandle *dh;
+    char *allocated_fname;
+    char *fname;
 
-    if ((fh->forReading) || (fh->bufpos == fh->buffill))
-        return 1;  /* open for read or buffer empty are successful no-ops. */
+    BAIL_IF(!path, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
-    /* dump buffer to disk. */
-    io = fh->io;
-    rc = io->write(io, fh->buffer + fh->bufpos, fh->buffill - fh->bufpos);
-    BAIL_IF_ERRPASS(rc <= 0, 0);
-    fh->bufpos = fh->buffill = 0;
-    return 1;
-} /* PHYSFS_flush */
+    __PHYSFS_platformGrabMutex(stateLock);
+    allocated_fname = (char *) __PHYSFS_smallAlloc(path->len + longest_root + 2);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root + 1;
+    memcpy(fname, path->path, path->len + 1);  /* verifyPath() writes to it. */
 
+    dh = findRealDirHandle(fname, path);
 
-int PHYSFS_stat(const char *_fname, PHYSFS_Stat *stat)
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return (dh != NULL);
+} /* PHYSFS_existsPath */
+
+
+int PHYSFS_statPath(PHYSFS_Path *path, PHYSFS_Stat *stat)
 {
-    int retval = 0;
+    int retval;
     char *allocated_fname;
     char *fname;
-    size_t len;
 
-    BAIL_IF(!_fname, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF(!path, PHYSFS_ERR_INVALID_ARGUMENT, 0);
     BAIL_IF(!stat, PHYSFS_ERR_INVALID_ARGUMENT, 0);
 
-    /* set some sane defaults... */
-    stat->filesize = -1;
-    stat->modtime = -1;
-    stat->createtime = -1;
-    stat->accesstime = -1;
-    stat->filetype = PHYSFS_FILETYPE_OTHER;
-    stat->readonly = 1;
+    initStat(stat);
 
     __PHYSFS_platformGrabMutex(stateLock);
-    len = strlen(_fname) + longest_root + 2;
-    allocated_fname = (char *) __PHYSFS_smallAlloc(len);
+    allocated_fname = (char *) __PHYSFS_smallAlloc(path->len + longest_root + 2);
     BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
     fname = allocated_fname + longest_root + 1;
+    memcpy(fname, path->path, path->len + 1);  /* verifyPath() writes to it. */
 
-    if (sanitizePlatformIndependentPath(_fname, fname))
-    {
-        if (*fname == '\0')
-        {
-            stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
-            stat->readonly = !writeDir; /* Writeable if we have a writeDir */
-            retval = 1;
-        } /* if */
-        else
-        {
-            DirHandle *i;
-            int exists = 0;
-            for (i = searchPath; ((i != NULL) && (!exists)); i = i->next)
-            {
-                char *arcfname = fname;
-                exists = partOfMountPoint(i, arcfname);
-                if (exists)
-                {
-                    stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
-                    stat->readonly = 1;
-                    retval = 1;
-                } /* if */
-                else if (verifyPath(i, &arcfname, 0))
-                {
-                    retval = i->funcs->stat(i->opaque, arcfname, stat);
-                    if ((retval) || (currentErrorCode() != PHYSFS_ERR_NOT_FOUND))
-                        exists = 1;
-                } /* else if */
-            } /* for */
-        } /* else */
-    } /* if */
+    retval = doStat(fname, path, stat, NULL);
 
     __PHYSFS_platformReleaseMutex(stateLock);
     __PHYSFS_smallFree(allocated_fname);
     return retval;
-} /* PHYSFS_stat */
+} /* PHYSFS_statPath */
+
+
+PHYSFS_File *PHYSFS_openReadPath(PHYSFS_Path *path)
+{
+    FileHandle *fh;
+    char *allocated_fname;
+    char *fname;
+
+    BAIL_IF(!path, PHYSFS_ERR_INVALID_ARGUMENT, 0);
+
+    __PHYSFS_platformGrabMutex(stateLock);
+
+    BAIL_IF_MUTEX(!searchPath, PHYSFS_ERR_NOT_FOUND, stateLock, 0);
+
+    allocated_fname = (char *) __PHYSFS_smallAlloc(path->len + longest_root + 2);
+    BAIL_IF_MUTEX(!allocated_fname, PHYSFS_ERR_OUT_OF_MEMORY, stateLock, 0);
+    fname = allocated_fname + longest_root + 1;
+    memcpy(fname, path->path, path->len + 1);  /* verifyPath() writes to it. */
+
+    fh = doOpenRead(fname, path);
+
+    __PHYSFS_platformReleaseMutex(stateLock);
+    __PHYSFS_smallFree(allocated_fname);
+    return ((PHYSFS_File *) fh);
+} /* PHYSFS_openReadPath */
 
 
 int __PHYSFS_readAll(PHYSFS_Io *io, void *buf, const size_t _len)
@@ -3280,49 +7425,241 @@ static void *mallocAllocatorRealloc(void *ptr, PHYSFS_uint64 s)
 } /* mallocAllocatorRealloc */
 
 
-static void mallocAllocatorFree(void *ptr)
-{
-    #undef free
-    free(ptr);
-} /* mallocAllocatorFree */
-#endif
+static void mallocAllocatorFree(void *ptr)
+{
+    #undef free
+    free(ptr);
+} /* mallocAllocatorFree */
+#endif
+
+static void setDefaultAllocator(void)
+{
+    assert(!externalAllocator);
+    allocator.Init = NULL;
+    allocator.Deinit = NULL;
+    #ifndef PHYSFS_NO_CRUNTIME_MALLOC
+    allocator.Malloc = mallocAllocatorMalloc;
+    allocator.Realloc = mallocAllocatorRealloc;
+    allocator.Free = mallocAllocatorFree;
+    #endif
+} /* setDefaultAllocator */
+
+
+/*
+ * DirTree names are carved out of large blocks instead of being malloc'd one
+ *  at a time: big archives have hundreds of thousands of them, they never go
+ *  away individually, and keeping them packed together is friendlier to the
+ *  cache. Blocks start small, so tiny archives don't waste much, and double
+ *  up to a limit.
+ */
+#define DIRTREE_ARENA_MINBLOCK (4 * 1024)
+#define DIRTREE_ARENA_MAXBLOCK (1024 * 1024)
+
+/*
+ * Entries themselves come in chunks of a power-of-two count, each roughly
+ *  this many bytes, so they never move once handed out and an entry index
+ *  turns into a pointer with a shift and a mask.
+ */
+#define DIRTREE_CHUNK_BYTES (8 * 1024)
+
+/* hash tables start with (1 << this) slots and double as they fill up. */
+#define DIRTREE_MIN_HASHBITS 6
+
+typedef union DirTreeArenaBlock
+{
+    union DirTreeArenaBlock *prev;  /* block allocated before this one. */
+    PHYSFS_uint64 align;  /* keeps the data after this header aligned. */
+} DirTreeArenaBlock;
+
+static void *dirTreeArenaAlloc(__PHYSFS_DirTree *dt, size_t len)
+{
+    void *retval;
+
+    if ((dt->arena == NULL) || ((dt->arenasize - dt->arenaused) < len))
+    {
+        size_t blocklen = dt->arenasize * 2;
+        DirTreeArenaBlock *block;
+
+        if (blocklen < DIRTREE_ARENA_MINBLOCK)
+            blocklen = DIRTREE_ARENA_MINBLOCK;
+        else if (blocklen > DIRTREE_ARENA_MAXBLOCK)
+            blocklen = DIRTREE_ARENA_MAXBLOCK;
+
+        if (blocklen < len)
+            blocklen = len;
+
+        block = (DirTreeArenaBlock *) allocator.Malloc(sizeof (DirTreeArenaBlock) + blocklen);
+        BAIL_IF(!block, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        block->prev = (DirTreeArenaBlock *) dt->arena;
+        dt->arena = block;
+        dt->arenaused = 0;
+        dt->arenasize = blocklen;
+    } /* if */
+
+    retval = ((PHYSFS_uint8 *) (((DirTreeArenaBlock *) dt->arena) + 1)) + dt->arenaused;
+    dt->arenaused += len;
+    return retval;
+} /* dirTreeArenaAlloc */
+
+
+static inline __PHYSFS_DirTreeEntry *dirTreeEntry(const __PHYSFS_DirTree *dt,
+                                                  const PHYSFS_uint32 idx)
+{
+    const PHYSFS_uint32 mask = (((PHYSFS_uint32) 1) << dt->chunkshift) - 1;
+    PHYSFS_uint8 *chunk = (PHYSFS_uint8 *) dt->chunks[idx >> dt->chunkshift];
+    return (__PHYSFS_DirTreeEntry *) (chunk + ((idx & mask) * dt->entrylen));
+} /* dirTreeEntry */
+
+
+/* djb's hash is weak in the low bits, so scramble it before picking a slot. */
+static inline PHYSFS_uint32 dirTreeSlot(const PHYSFS_uint32 hashval,
+                                        const PHYSFS_uint32 bits)
+{
+    return (PHYSFS_uint32) ((hashval * 0x9E3779B1u) >> (32 - bits));
+} /* dirTreeSlot */
+
+
+/* New entry goes at index (dt->count - 1); zeroed, not linked anywhere yet. */
+static __PHYSFS_DirTreeEntry *dirTreeNewEntry(__PHYSFS_DirTree *dt)
+{
+    const PHYSFS_uint32 idx = dt->count;
+    const PHYSFS_uint32 chunk = idx >> dt->chunkshift;
+    __PHYSFS_DirTreeEntry *retval;
+
+    BAIL_IF(idx == 0xFFFFFFFF, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+
+    if (chunk >= dt->chunkcount)
+    {
+        void *ptr = allocator.Realloc(dt->chunks, (chunk + 1) * sizeof (void *));
+        BAIL_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        dt->chunks = (void **) ptr;
+        ptr = allocator.Malloc(dt->entrylen << dt->chunkshift);
+        BAIL_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        dt->chunks[chunk] = ptr;
+        dt->chunkcount++;
+    } /* if */
+
+    dt->count++;
+    retval = dirTreeEntry(dt, idx);
+    memset(retval, '\0', dt->entrylen);
+    return retval;
+} /* dirTreeNewEntry */
+
+
+/*
+ * Hand back a shared copy of leaf name (name), storing a new one for entry
+ *  (idx) if nothing else is using it yet. Archives tend to repeat the same
+ *  handful of file and directory names all over the place.
+ */
+static const char *dirTreeInternName(__PHYSFS_DirTree *dt, const char *name,
+                                     const PHYSFS_uint32 idx)
+{
+    const PHYSFS_uint32 hashval = __PHYSFS_hashString(name);
+    PHYSFS_uint32 mask;
+    PHYSFS_uint32 i;
+    size_t len;
+    char *str;
+
+    if ((dt->names == NULL) || (dt->nameCount >= ((((PHYSFS_uint32) 1) << dt->nameBits) / 2)))
+    {
+        const PHYSFS_uint32 bits = dt->names ? dt->nameBits + 1 : DIRTREE_MIN_HASHBITS;
+        const PHYSFS_uint32 newslots = ((PHYSFS_uint32) 1) << bits;
+        const PHYSFS_uint32 oldslots = dt->names ? (((PHYSFS_uint32) 1) << dt->nameBits) : 0;
+        PHYSFS_uint32 *names;
+
+        names = (PHYSFS_uint32 *) allocator.Malloc(newslots * sizeof (PHYSFS_uint32));
+        BAIL_IF(!names, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        memset(names, '\0', newslots * sizeof (PHYSFS_uint32));
+
+        for (i = 0; i < oldslots; i++)
+        {
+            const PHYSFS_uint32 owner = dt->names[i];
+            if (owner != 0)
+            {
+                const char *ownername = dirTreeEntry(dt, owner)->name;
+                PHYSFS_uint32 slot = dirTreeSlot(__PHYSFS_hashString(ownername), bits);
+                while (names[slot] != 0)
+                    slot = (slot + 1) & (newslots - 1);
+                names[slot] = owner;
+            } /* if */
+        } /* for */
+
+        allocator.Free(dt->names);
+        dt->names = names;
+        dt->nameBits = bits;
+    } /* if */
+
+    mask = (((PHYSFS_uint32) 1) << dt->nameBits) - 1;
+    for (i = dirTreeSlot(hashval, dt->nameBits); dt->names[i]; i = (i + 1) & mask)
+    {
+        const char *existing = dirTreeEntry(dt, dt->names[i])->name;
+        if (strcmp(existing, name) == 0)
+            return existing;
+    } /* for */
+
+    len = strlen(name) + 1;
+    str = (char *) dirTreeArenaAlloc(dt, len);
+    BAIL_IF_ERRPASS(!str, NULL);
+    memcpy(str, name, len);
+    dt->names[i] = idx;
+    dt->nameCount++;
+    return str;
+} /* dirTreeInternName */
+
+
+/* Make sure the path hash has room for one more entry. */
+static int dirTreeGrowHash(__PHYSFS_DirTree *dt)
+{
+    const PHYSFS_uint32 bits = dt->hashBits + 1;
+    const size_t alloclen = (((size_t) 1) << bits) * sizeof (PHYSFS_uint32);
+    PHYSFS_uint32 *hash;
+    PHYSFS_uint32 i;
+
+    if (dt->count < (((PHYSFS_uint32) 1) << dt->hashBits))
+        return 1;  /* still fits, keep going. */
+
+    hash = (PHYSFS_uint32 *) allocator.Malloc(alloclen);
+    BAIL_IF(!hash, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    memset(hash, '\0', alloclen);
 
-static void setDefaultAllocator(void)
-{
-    assert(!externalAllocator);
-    allocator.Init = NULL;
-    allocator.Deinit = NULL;
-    #ifndef PHYSFS_NO_CRUNTIME_MALLOC
-    allocator.Malloc = mallocAllocatorMalloc;
-    allocator.Realloc = mallocAllocatorRealloc;
-    allocator.Free = mallocAllocatorFree;
-    #endif
-} /* setDefaultAllocator */
+    /* entry 0 is the root, which is never hashed. */
+    for (i = 1; i < dt->count; i++)
+    {
+        __PHYSFS_DirTreeEntry *entry = dirTreeEntry(dt, i);
+        const PHYSFS_uint32 slot = dirTreeSlot(entry->hashval, bits);
+        entry->hashnext = hash[slot];
+        hash[slot] = i;
+    } /* for */
+
+    allocator.Free(dt->hash);
+    dt->hash = hash;
+    dt->hashBits = bits;
+    return 1;
+} /* dirTreeGrowHash */
 
 
 int __PHYSFS_DirTreeInit(__PHYSFS_DirTree *dt, const size_t entrylen, const int case_sensitive, const int only_usascii)
 {
     static char rootpath[2] = { '/', '\0' };
-    size_t alloclen;
+    const size_t alloclen = (((size_t) 1) << DIRTREE_MIN_HASHBITS) * sizeof (PHYSFS_uint32);
 
     assert(entrylen >= sizeof (__PHYSFS_DirTreeEntry));
 
     memset(dt, '\0', sizeof (*dt));
     dt->case_sensitive = case_sensitive;
     dt->only_usascii = only_usascii;
+    dt->entrylen = entrylen;
+
+    while ((entrylen << (dt->chunkshift + 1)) <= DIRTREE_CHUNK_BYTES)
+        dt->chunkshift++;
 
-    dt->root = (__PHYSFS_DirTreeEntry *) allocator.Malloc(entrylen);
-    BAIL_IF(!dt->root, PHYSFS_ERR_OUT_OF_MEMORY, 0);
-    memset(dt->root, '\0', entrylen);
+    dt->root = dirTreeNewEntry(dt);
+    BAIL_IF_ERRPASS(!dt->root, 0);
     dt->root->name = rootpath;
     dt->root->isdir = 1;
-    dt->hashBuckets = 64;
-    if (!dt->hashBuckets)
-        dt->hashBuckets = 1;
-    dt->entrylen = entrylen;
 
-    alloclen = dt->hashBuckets * sizeof (__PHYSFS_DirTreeEntry *);
-    dt->hash = (__PHYSFS_DirTreeEntry **) allocator.Malloc(alloclen);
+    dt->hashBits = DIRTREE_MIN_HASHBITS;
+    dt->hash = (PHYSFS_uint32 *) allocator.Malloc(alloclen);
     BAIL_IF(!dt->hash, PHYSFS_ERR_OUT_OF_MEMORY, 0);
     memset(dt->hash, '\0', alloclen);
 
@@ -3332,21 +7669,194 @@ int __PHYSFS_DirTreeInit(__PHYSFS_DirTree *dt, const size_t entrylen, const int
 
 static PHYSFS_uint32 hashPathName(__PHYSFS_DirTree *dt, const char *name)
 {
-    const PHYSFS_uint32 hashval = dt->case_sensitive ? __PHYSFS_hashString(name) : dt->only_usascii ? __PHYSFS_hashStringCaseFoldUSAscii(name) : __PHYSFS_hashStringCaseFold(name);
-    return hashval % dt->hashBuckets;
+    return dt->case_sensitive ? __PHYSFS_hashString(name) : dt->only_usascii ? __PHYSFS_hashStringCaseFoldUSAscii(name) : __PHYSFS_hashStringCaseFold(name);
 } /* hashPathName */
 
 
+/* PHYSFS_utf8stricmp(), but (str) is (len) bytes, not null-terminated. */
+static int dirTreeNameMatchesCaseFold(const char *name, const char *str,
+                                      const size_t len)
+{
+    const char *end = str + len;
+    PHYSFS_uint32 folded1[3], folded2[3];
+    int head1 = 0, tail1 = 0, head2 = 0, tail2 = 0;
+    size_t checked = 0;
+
+    /* a byte at a time, for as long as both are still ASCII. */
+    while (str < end)
+    {
+        char ch1 = *name;
+        char ch2 = *str;
+        if ((ch1 | ch2) & 0x80)
+            break;
+        else if (ch1 == '\0')
+            return 0;
+        if ((ch1 >= 'A') && (ch1 <= 'Z'))
+            ch1 -= ('A' - 'a');
+        if ((ch2 >= 'A') && (ch2 <= 'Z'))
+            ch2 -= ('A' - 'a');
+        if (ch1 != ch2)
+            return 0;
+        name++;
+        str++;
+
+        /* still the same this far? Then it's worth 16 bytes at a time. */
+        if (++checked == 16)
+        {
+            const size_t namelen = strlen(name);
+            const size_t left = (size_t) (end - str);
+            const size_t skip = __PHYSFS_utf8AsciiMatchLen(name, str,
+                                            (namelen < left) ? namelen : left);
+            name += skip;
+            str += skip;
+        } /* if */
+    } /* while */
+
+    while (1)
+    {
+        PHYSFS_uint32 cp1, cp2;
+        if (head1 != tail1)
+            cp1 = folded1[tail1++];
+        else
+        {
+            head1 = PHYSFS_caseFold(__PHYSFS_utf8codepoint(&name), folded1);
+            cp1 = folded1[0];
+            tail1 = 1;
+        } /* else */
+
+        if (head2 != tail2)
+            cp2 = folded2[tail2++];
+        else
+        {
+            const PHYSFS_uint32 cp = (str < end) ? __PHYSFS_utf8codepoint(&str) : 0;
+            head2 = PHYSFS_caseFold(cp, folded2);
+            cp2 = folded2[0];
+            tail2 = 1;
+        } /* else */
+
+        if (cp1 != cp2)
+            return 0;
+        else if (cp1 == 0)
+            return 1;  /* complete match. */
+    } /* while */
+
+    return 0;  /* shouldn't hit this. */
+} /* dirTreeNameMatchesCaseFold */
+
+
+/* Does leaf name (name) match the (len) bytes at (str)? */
+static int dirTreeNameMatches(const __PHYSFS_DirTree *dt, const char *name,
+                              const char *str, const size_t len)
+{
+    if (dt->case_sensitive)
+        return ((strncmp(name, str, len) == 0) && (name[len] == '\0'));
+
+    else if (dt->only_usascii)
+    {
+        size_t i;
+        for (i = 0; i < len; i++)
+        {
+            char ch1 = name[i];
+            char ch2 = str[i];
+            if (ch1 == '\0')
+                return 0;
+            if ((ch1 >= 'A') && (ch1 <= 'Z'))
+                ch1 -= ('A' - 'a');
+            if ((ch2 >= 'A') && (ch2 <= 'Z'))
+                ch2 -= ('A' - 'a');
+            if (ch1 != ch2)
+                return 0;
+        } /* for */
+        return (name[len] == '\0');
+    } /* else if */
+
+    return dirTreeNameMatchesCaseFold(name, str, len);
+} /* dirTreeNameMatches */
+
+
+/*
+ * Match (path) against (entry) one component at a time, leaf first. If
+ *  (casefold) is non-zero, this ignores case even if (dt) doesn't.
+ */
+static int dirTreePathMatches(const __PHYSFS_DirTree *dt,
+                              const __PHYSFS_DirTreeEntry *entry,
+                              const char *path, const size_t pathlen,
+                              const int casefold)
+{
+    const char *end = path + pathlen;
+
+    while (1)
+    {
+        const char *start = end;
+        size_t len;
+        while ((start > path) && (start[-1] != '/'))
+            start--;
+
+        len = (size_t) (end - start);
+        if (casefold ? !dirTreeNameMatchesCaseFold(entry->name, start, len) :
+                       !dirTreeNameMatches(dt, entry->name, start, len))
+            return 0;
+        else if (start == path)  /* all of (path) used up? Must be in root. */
+            return (entry->parent == 0);
+        else if (entry->parent == 0)  /* (path) goes deeper than (entry). */
+            return 0;
+
+        end = start - 1;  /* skip the '/' */
+        entry = dirTreeEntry(dt, entry->parent);
+    } /* while */
+
+    return 0;  /* shouldn't hit this. */
+} /* dirTreePathMatches */
+
+
+static __PHYSFS_DirTreeEntry *dirTreeLookup(__PHYSFS_DirTree *dt,
+                                            const char *path,
+                                            const PHYSFS_uint32 hashval,
+                                            PHYSFS_uint32 *_idx)
+{
+    const PHYSFS_uint32 slot = dirTreeSlot(hashval, dt->hashBits);
+    const size_t pathlen = strlen(path);
+    __PHYSFS_DirTreeEntry *prev = NULL;
+    PHYSFS_uint32 idx = dt->hash[slot];
+
+    while (idx != 0)
+    {
+        __PHYSFS_DirTreeEntry *entry = dirTreeEntry(dt, idx);
+        if ((entry->hashval == hashval) && dirTreePathMatches(dt, entry, path, pathlen, 0))
+        {
+            if (prev != NULL)  /* move this to the front of the list */
+            {
+                prev->hashnext = entry->hashnext;
+                entry->hashnext = dt->hash[slot];
+                dt->hash[slot] = idx;
+            } /* if */
+
+            if (_idx)
+                *_idx = idx;
+            return entry;
+        } /* if */
+
+        prev = entry;
+        idx = entry->hashnext;
+    } /* while */
+
+    return NULL;
+} /* dirTreeLookup */
+
+
 /* Fill in missing parent directories. */
-static __PHYSFS_DirTreeEntry *addAncestors(__PHYSFS_DirTree *dt, char *name)
+static __PHYSFS_DirTreeEntry *addAncestors(__PHYSFS_DirTree *dt, char *name,
+                                           PHYSFS_uint32 *_idx)
 {
     __PHYSFS_DirTreeEntry *retval = dt->root;
     char *sep = strrchr(name, '/');
 
+    *_idx = 0;
+
     if (sep)
     {
         *sep = '\0';  /* chop off last piece. */
-        retval = (__PHYSFS_DirTreeEntry *) __PHYSFS_DirTreeFind(dt, name);
+        retval = dirTreeLookup(dt, name, hashPathName(dt, name), _idx);
 
         if (retval != NULL)
         {
@@ -3357,6 +7867,7 @@ static __PHYSFS_DirTreeEntry *addAncestors(__PHYSFS_DirTree *dt, char *name)
 
         /* okay, this is a new dir. Build and hash us. */
         retval = (__PHYSFS_DirTreeEntry*)__PHYSFS_DirTreeAdd(dt, name, 1);
+        *_idx = dt->count - 1;  /* it was just added, so it's the last one. */
         *sep = '/';
     } /* if */
 
@@ -3366,25 +7877,35 @@ static __PHYSFS_DirTreeEntry *addAncestors(__PHYSFS_DirTree *dt, char *name)
 
 void *__PHYSFS_DirTreeAdd(__PHYSFS_DirTree *dt, char *name, const int isdir)
 {
-    __PHYSFS_DirTreeEntry *retval = __PHYSFS_DirTreeFind(dt, name);
+    const PHYSFS_uint32 hashval = hashPathName(dt, name);
+    __PHYSFS_DirTreeEntry *retval = dirTreeLookup(dt, name, hashval, NULL);
     if (!retval)
     {
-        const size_t alloclen = strlen(name) + 1 + dt->entrylen;
-        PHYSFS_uint32 hashval;
-        __PHYSFS_DirTreeEntry *parent = addAncestors(dt, name);
+        const char *leaf = strrchr(name, '/');
+        PHYSFS_uint32 parentidx;
+        PHYSFS_uint32 idx;
+        PHYSFS_uint32 slot;
+        __PHYSFS_DirTreeEntry *parent = addAncestors(dt, name, &parentidx);
         BAIL_IF_ERRPASS(!parent, NULL);
-        assert(dt->entrylen >= sizeof (__PHYSFS_DirTreeEntry));
-        retval = (__PHYSFS_DirTreeEntry *) allocator.Malloc(alloclen);
-        BAIL_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
-        memset(retval, '\0', dt->entrylen);
-        retval->name = ((char *) retval) + dt->entrylen;
-        strcpy(retval->name, name);
-        hashval = hashPathName(dt, name);
-        retval->hashnext = dt->hash[hashval];
-        dt->hash[hashval] = retval;
-        retval->sibling = parent->children;
+        BAIL_IF_ERRPASS(!dirTreeGrowHash(dt), NULL);
+        retval = dirTreeNewEntry(dt);
+        BAIL_IF_ERRPASS(!retval, NULL);
+        idx = dt->count - 1;
+        retval->name = dirTreeInternName(dt, leaf ? leaf + 1 : name, idx);
+        if (!retval->name)
+        {
+            dt->count--;  /* give the slot back; nothing points to it yet. */
+            return NULL;
+        } /* if */
+
+        retval->hashval = hashval;
+        retval->parent = parentidx;
         retval->isdir = isdir;
-        parent->children = retval;
+        slot = dirTreeSlot(hashval, dt->hashBits);
+        retval->hashnext = dt->hash[slot];
+        dt->hash[slot] = idx;
+        parent->childcount++;
+        dt->kidsDirty = 1;
     } /* if */
 
     return retval;
@@ -3394,35 +7915,258 @@ void *__PHYSFS_DirTreeAdd(__PHYSFS_DirTree *dt, char *name, const int isdir)
 /* Find the __PHYSFS_DirTreeEntry for a path in platform-independent notation. */
 void *__PHYSFS_DirTreeFind(__PHYSFS_DirTree *dt, const char *path)
 {
-    const int cs = dt->case_sensitive;
-    PHYSFS_uint32 hashval;
-    __PHYSFS_DirTreeEntry *prev = NULL;
     __PHYSFS_DirTreeEntry *retval;
 
     if (*path == '\0')
         return dt->root;
 
-    hashval = hashPathName(dt, path);
-    for (retval = dt->hash[hashval]; retval; retval = retval->hashnext)
+    retval = dirTreeLookup(dt, path, hashPathName(dt, path), NULL);
+    BAIL_IF(!retval, PHYSFS_ERR_NOT_FOUND, NULL);
+    return retval;
+} /* __PHYSFS_DirTreeFind */
+
+
+/*
+ * verifyPath() support for archivers built on a DirTree: find the deepest
+ *  part of (path) that's in the tree, then walk up its parent links asking
+ *  (issymlink) about each entry, instead of looking up every prefix.
+ */
+int __PHYSFS_DirTreeCheckSymlinks(__PHYSFS_DirTree *dt, char *path,
+                                  const int allowMissing,
+                        int (*issymlink)(const __PHYSFS_DirTreeEntry *entry))
+{
+    const size_t len = strlen(path);
+    __PHYSFS_DirTreeEntry *entry;
+    size_t missing = 0;  /* trailing path elements that aren't in (dt). */
+    size_t i;
+
+    while (1)
     {
-        const int cmp = cs ? strcmp(retval->name, path) : PHYSFS_utf8stricmp(retval->name, path);
-        if (cmp == 0)
+        char *sep;
+
+        if (*path == '\0')
         {
-            if (prev != NULL)  /* move this to the front of the list */
-            {
-                prev->hashnext = retval->hashnext;
-                retval->hashnext = dt->hash[hashval];
-                dt->hash[hashval] = retval;
-            } /* if */
+            entry = dt->root;
+            break;
+        } /* if */
 
-            return retval;
+        entry = dirTreeLookup(dt, path, hashPathName(dt, path), NULL);
+        if (entry != NULL)
+            break;
+
+        missing++;
+        sep = strrchr(path, '/');
+        if (sep == NULL)
+        {
+            entry = dt->root;
+            break;
         } /* if */
+        *sep = '\0';  /* put back below. */
+    } /* while */
 
-        prev = retval;
+    for (i = 0; i < len; i++)
+    {
+        if (path[i] == '\0')
+            path[i] = '/';
     } /* for */
 
-    BAIL(PHYSFS_ERR_NOT_FOUND, NULL);
-} /* __PHYSFS_DirTreeFind */
+    while (entry != dt->root)
+    {
+        BAIL_IF(issymlink(entry), PHYSFS_ERR_SYMLINK_FORBIDDEN, 0);
+        entry = dirTreeEntry(dt, entry->parent);
+    } /* while */
+
+    BAIL_IF(missing && !allowMissing, PHYSFS_ERR_NOT_FOUND, 0);
+    return 1;
+} /* __PHYSFS_DirTreeCheckSymlinks */
+
+
+/*
+ * A second hash of every entry's full path, case-folded, for trees that are
+ *  otherwise case-sensitive. One allocation: the buckets, then each entry's
+ *  next index in its bucket, then each entry's folded hash. A parent always
+ *  comes before its children, so each hash carries on from its parent's.
+ */
+static int dirTreeBuildFoldHash(__PHYSFS_DirTree *dt)
+{
+    PHYSFS_uint32 bits = DIRTREE_MIN_HASHBITS;
+    PHYSFS_uint32 *buckets;
+    PHYSFS_uint32 *next;
+    PHYSFS_uint32 *vals;
+    PHYSFS_uint32 i;
+    size_t alloclen;
+
+    while ((((PHYSFS_uint32) 1) << bits) < dt->count)
+        bits++;
+
+    alloclen = ((((size_t) 1) << bits) + (((size_t) dt->count) * 2)) * sizeof (PHYSFS_uint32);
+    buckets = (PHYSFS_uint32 *) allocator.Realloc(dt->foldhash, alloclen);
+    BAIL_IF(!buckets, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    memset(buckets, '\0', (((size_t) 1) << bits) * sizeof (PHYSFS_uint32));
+    next = buckets + (((PHYSFS_uint32) 1) << bits);
+    vals = next + dt->count;
+
+    vals[0] = 5381;  /* the root, so top-level entries start from scratch. */
+    for (i = 1; i < dt->count; i++)
+    {
+        const __PHYSFS_DirTreeEntry *entry = dirTreeEntry(dt, i);
+        PHYSFS_uint32 hashval = vals[entry->parent];
+        PHYSFS_uint32 slot;
+        assert(entry->parent < i);
+        if (entry->parent != 0)
+            hashval = hashStringCaseFoldFrom(hashval, "/");
+        hashval = hashStringCaseFoldFrom(hashval, entry->name);
+        vals[i] = hashval;
+        slot = dirTreeSlot(hashval, bits);
+        next[i] = buckets[slot];
+        buckets[slot] = i;
+    } /* for */
+
+    dt->foldhash = buckets;
+    dt->foldBits = bits;
+    dt->foldCount = dt->count;
+    return 1;
+} /* dirTreeBuildFoldHash */
+
+
+int __PHYSFS_DirTreeFixCase(__PHYSFS_DirTree *dt, char *path)
+{
+    const size_t pathlen = strlen(path);
+    const __PHYSFS_DirTreeEntry *entry;
+    const PHYSFS_uint32 *next;
+    const PHYSFS_uint32 *vals;
+    PHYSFS_uint32 hashval;
+    PHYSFS_uint32 idx;
+    char *ptr;
+
+    if ((*path == '\0') || (!dt->case_sensitive))
+        return 1;  /* the root, or DirTreeFind() already ignores case. */
+    else if (dirTreeLookup(dt, path, hashPathName(dt, path), NULL) != NULL)
+        return 1;  /* exact matches win. */
+    else if (dt->foldCount != dt->count)  /* new entries since we built it? */
+        BAIL_IF_ERRPASS(!dirTreeBuildFoldHash(dt), 0);
+
+    hashval = hashStringCaseFoldFrom(5381, path);
+    next = dt->foldhash + (((PHYSFS_uint32) 1) << dt->foldBits);
+    vals = next + dt->foldCount;
+    idx = dt->foldhash[dirTreeSlot(hashval, dt->foldBits)];
+    for (; idx != 0; idx = next[idx])
+    {
+        size_t len = 0;
+
+        if (vals[idx] != hashval)
+            continue;
+
+        entry = dirTreeEntry(dt, idx);
+        if (!dirTreePathMatches(dt, entry, path, pathlen, 1))
+            continue;
+
+        /* only rewrite it if it's still the same size. */
+        while (1)
+        {
+            len += strlen(entry->name);
+            if (entry->parent == 0)
+                break;
+            len++;  /* the '/' */
+            entry = dirTreeEntry(dt, entry->parent);
+        } /* while */
+
+        if (len == pathlen)
+            break;
+    } /* for */
+
+    BAIL_IF(idx == 0, PHYSFS_ERR_NOT_FOUND, 0);
+
+    ptr = path + pathlen;
+    entry = dirTreeEntry(dt, idx);
+    while (1)
+    {
+        const size_t len = strlen(entry->name);
+        ptr -= len;
+        memcpy(ptr, entry->name, len);
+        if (entry->parent == 0)
+            break;
+        *(--ptr) = '/';
+        entry = dirTreeEntry(dt, entry->parent);
+    } /* while */
+
+    assert(ptr == path);
+    return 1;
+} /* __PHYSFS_DirTreeFixCase */
+
+
+typedef struct
+{
+    const __PHYSFS_DirTree *dt;
+    PHYSFS_uint32 *kids;
+} DirTreeKidsSortData;
+
+static int dirTreeKidsCmp(void *_a, size_t one, size_t two)
+{
+    const DirTreeKidsSortData *a = (const DirTreeKidsSortData *) _a;
+    const __PHYSFS_DirTreeEntry *entry1 = dirTreeEntry(a->dt, a->kids[one]);
+    const __PHYSFS_DirTreeEntry *entry2 = dirTreeEntry(a->dt, a->kids[two]);
+    return strcmp(entry1->name, entry2->name);
+} /* dirTreeKidsCmp */
+
+static void dirTreeKidsSwap(void *_a, size_t one, size_t two)
+{
+    DirTreeKidsSortData *a = (DirTreeKidsSortData *) _a;
+    const PHYSFS_uint32 tmp = a->kids[one];
+    a->kids[one] = a->kids[two];
+    a->kids[two] = tmp;
+} /* dirTreeKidsSwap */
+
+
+/*
+ * Lay every directory's children out next to each other, sorted by name,
+ *  so enumerating a directory is a walk down one small array. This is done
+ *  lazily, since archives add entries in whatever order they're stored in.
+ */
+static int dirTreeBuildKids(__PHYSFS_DirTree *dt)
+{
+    DirTreeKidsSortData data;
+    PHYSFS_uint32 *kids;
+    PHYSFS_uint32 total = 0;
+    PHYSFS_uint32 i;
+
+    if (!dt->kidsDirty)
+        return 1;
+
+    kids = (PHYSFS_uint32 *) allocator.Realloc(dt->kids, dt->count * sizeof (PHYSFS_uint32));
+    BAIL_IF(!kids, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    dt->kids = kids;
+
+    /* point each dir just past the end of its range... */
+    for (i = 0; i < dt->count; i++)
+    {
+        __PHYSFS_DirTreeEntry *entry = dirTreeEntry(dt, i);
+        total += entry->childcount;
+        entry->children = total;
+    } /* for */
+
+    /* ...and fill it in backwards, leaving (children) at the start. */
+    for (i = dt->count - 1; i > 0; i--)
+    {
+        __PHYSFS_DirTreeEntry *parent = dirTreeEntry(dt, dirTreeEntry(dt, i)->parent);
+        kids[--parent->children] = i;
+    } /* for */
+
+    data.dt = dt;
+    for (i = 0; i < dt->count; i++)
+    {
+        const __PHYSFS_DirTreeEntry *entry = dirTreeEntry(dt, i);
+        if (entry->childcount > 1)
+        {
+            data.kids = kids + entry->children;
+            __PHYSFS_sort(&data, entry->childcount, dirTreeKidsCmp, dirTreeKidsSwap);
+        } /* if */
+    } /* for */
+
+    dt->kidsDirty = 0;
+    return 1;
+} /* dirTreeBuildKids */
+
 
 PHYSFS_EnumerateCallbackResult __PHYSFS_DirTreeEnumerate(void *opaque,
                               const char *dname, PHYSFS_EnumerateCallback cb,
@@ -3431,50 +8175,183 @@ PHYSFS_EnumerateCallbackResult __PHYSFS_DirTreeEnumerate(void *opaque,
     PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
     __PHYSFS_DirTree *tree = (__PHYSFS_DirTree *) opaque;
     const __PHYSFS_DirTreeEntry *entry = __PHYSFS_DirTreeFind(tree, dname);
-    BAIL_IF(!entry, PHYSFS_ERR_NOT_FOUND, PHYSFS_ENUM_ERROR);
+    const PHYSFS_uint32 *kids;
+    PHYSFS_uint32 i;
 
-    entry = entry->children;
+    BAIL_IF(!entry, PHYSFS_ERR_NOT_FOUND, PHYSFS_ENUM_ERROR);
+    BAIL_IF_ERRPASS(!dirTreeBuildKids(tree), PHYSFS_ENUM_ERROR);
 
-    while (entry && (retval == PHYSFS_ENUM_OK))
+    kids = tree->kids + entry->children;
+    for (i = 0; (i < entry->childcount) && (retval == PHYSFS_ENUM_OK); i++)
     {
-        const char *name = entry->name;
-        const char *ptr = strrchr(name, '/');
-        retval = cb(callbackdata, origdir, ptr ? ptr + 1 : name);
+        retval = cb(callbackdata, origdir, dirTreeEntry(tree, kids[i])->name);
         BAIL_IF(retval == PHYSFS_ENUM_ERROR, PHYSFS_ERR_APP_CALLBACK, retval);
-        entry = entry->sibling;
-    } /* while */
+    } /* for */
 
     return retval;
 } /* __PHYSFS_DirTreeEnumerate */
 
 
+const __PHYSFS_DirTreeEntry *__PHYSFS_DirTreeOpenDir(__PHYSFS_DirTree *dt,
+                                                      const char *dname)
+{
+    const __PHYSFS_DirTreeEntry *entry = __PHYSFS_DirTreeFind(dt, dname);
+    BAIL_IF(!entry, PHYSFS_ERR_NOT_FOUND, NULL);
+    BAIL_IF(!entry->isdir, PHYSFS_ERR_NOT_FOUND, NULL);
+    BAIL_IF_ERRPASS(!dirTreeBuildKids(dt), NULL);
+    return entry;
+} /* __PHYSFS_DirTreeOpenDir */
+
+
+const __PHYSFS_DirTreeEntry *__PHYSFS_DirTreeChild(const __PHYSFS_DirTree *dt,
+                                        const __PHYSFS_DirTreeEntry *dir,
+                                        const PHYSFS_uint32 idx)
+{
+    assert(!dt->kidsDirty);
+    assert(idx < dir->childcount);
+    return dirTreeEntry(dt, dt->kids[dir->children + idx]);
+} /* __PHYSFS_DirTreeChild */
+
+
+const __PHYSFS_DirTreeEntry *__PHYSFS_DirTreeFindChild(
+                                        const __PHYSFS_DirTree *dt,
+                                        const __PHYSFS_DirTreeEntry *dir,
+                                        const char *name)
+{
+    const PHYSFS_uint32 *kids = dt->kids + dir->children;
+    PHYSFS_uint32 lo = 0;
+    PHYSFS_uint32 hi = dir->childcount;
+
+    assert(!dt->kidsDirty);
+
+    /* (kids) is sorted with strcmp(), whatever the tree's case rules. */
+    while (lo < hi)
+    {
+        const PHYSFS_uint32 mid = lo + ((hi - lo) / 2);
+        const __PHYSFS_DirTreeEntry *kid = dirTreeEntry(dt, kids[mid]);
+        const int rc = strcmp(name, kid->name);
+        if (rc == 0)
+            return kid;
+        else if (rc < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    } /* while */
+
+    return NULL;
+} /* __PHYSFS_DirTreeFindChild */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_DirTreeEnumerateMatching(
+                    __PHYSFS_DirTree *dt, const char *dname,
+                    const char *prefix, const size_t prefixlen,
+                    int (*match)(const void *matchdata, const char *name),
+                    const void *matchdata, PHYSFS_EnumerateCallback cb,
+                    const char *origdir, void *callbackdata)
+{
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    const __PHYSFS_DirTreeEntry *entry = __PHYSFS_DirTreeFind(dt, dname);
+    const PHYSFS_uint32 *kids;
+    PHYSFS_uint32 lo = 0;
+    PHYSFS_uint32 hi;
+    PHYSFS_uint32 i;
+
+    BAIL_IF(!entry, PHYSFS_ERR_NOT_FOUND, PHYSFS_ENUM_ERROR);
+    BAIL_IF_ERRPASS(!dirTreeBuildKids(dt), PHYSFS_ENUM_ERROR);
+
+    kids = dt->kids + entry->children;
+
+    /* (kids) is in strcmp() order, so names with (prefix) are together. */
+    if (prefixlen > 0)
+    {
+        hi = entry->childcount;
+        while (lo < hi)
+        {
+            const PHYSFS_uint32 mid = lo + ((hi - lo) / 2);
+            if (strncmp(dirTreeEntry(dt, kids[mid])->name, prefix, prefixlen) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        } /* while */
+    } /* if */
+
+    for (i = lo; (i < entry->childcount) && (retval == PHYSFS_ENUM_OK); i++)
+    {
+        const char *name = dirTreeEntry(dt, kids[i])->name;
+        if ((prefixlen > 0) && (strncmp(name, prefix, prefixlen) != 0))
+            break;  /* past the last one that could match. */
+        else if (!match(matchdata, name))
+            continue;
+        retval = cb(callbackdata, origdir, name);
+        BAIL_IF(retval == PHYSFS_ENUM_ERROR, PHYSFS_ERR_APP_CALLBACK, retval);
+    } /* for */
+
+    return retval;
+} /* __PHYSFS_DirTreeEnumerateMatching */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_DirTreeEnumerateStat(
+                    __PHYSFS_DirTree *dt, const char *dname,
+                    int (*statfn)(void *opaque,
+                                  const __PHYSFS_DirTreeEntry *entry,
+                                  PHYSFS_Stat *st),
+                    void *opaque, __PHYSFS_EnumerateStatCallback cb,
+                    const char *origdir, void *callbackdata)
+{
+    PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
+    const __PHYSFS_DirTreeEntry *entry = __PHYSFS_DirTreeFind(dt, dname);
+    const PHYSFS_uint32 *kids;
+    PHYSFS_uint32 i;
+
+    BAIL_IF(!entry, PHYSFS_ERR_NOT_FOUND, PHYSFS_ENUM_ERROR);
+    BAIL_IF_ERRPASS(!dirTreeBuildKids(dt), PHYSFS_ENUM_ERROR);
+
+    kids = dt->kids + entry->children;
+    for (i = 0; (i < entry->childcount) && (retval == PHYSFS_ENUM_OK); i++)
+    {
+        const __PHYSFS_DirTreeEntry *kid = dirTreeEntry(dt, kids[i]);
+        PHYSFS_Stat statbuf;
+        BAIL_IF_ERRPASS(!statfn(opaque, kid, &statbuf), PHYSFS_ENUM_ERROR);
+        retval = cb(callbackdata, origdir, kid->name, &statbuf);
+        BAIL_IF(retval == PHYSFS_ENUM_ERROR, PHYSFS_ERR_APP_CALLBACK, retval);
+    } /* for */
+
+    return retval;
+} /* __PHYSFS_DirTreeEnumerateStat */
+
+
 void __PHYSFS_DirTreeDeinit(__PHYSFS_DirTree *dt)
 {
+    PHYSFS_uint32 i;
+
     if (!dt)
         return;
 
-    if (dt->root)
+    if (dt->chunks)
     {
-        assert(dt->root->sibling == NULL);
-        assert(dt->hash || (dt->root->children == NULL));
-        allocator.Free(dt->root);
+        for (i = 0; i < dt->chunkcount; i++)
+            allocator.Free(dt->chunks[i]);
+        allocator.Free(dt->chunks);
     } /* if */
 
     if (dt->hash)
-    {
-        size_t i;
-        for (i = 0; i < dt->hashBuckets; i++)
-        {
-            __PHYSFS_DirTreeEntry *entry;
-            __PHYSFS_DirTreeEntry *next;
-            for (entry = dt->hash[i]; entry; entry = next)
-            {
-                next = entry->hashnext;
-                allocator.Free(entry);
-            } /* for */
-        } /* for */
         allocator.Free(dt->hash);
-    } /* if */
+    if (dt->names)
+        allocator.Free(dt->names);
+    if (dt->kids)
+        allocator.Free(dt->kids);
+    if (dt->foldhash)
+        allocator.Free(dt->foldhash);
+
+    /* every name lives in the arena, so this frees them all at once. */
+    while (dt->arena)
+    {
+        DirTreeArenaBlock *block = (DirTreeArenaBlock *) dt->arena;
+        dt->arena = block->prev;
+        allocator.Free(block);
+    } /* while */
+
+    memset(dt, '\0', sizeof (*dt));
 } /* __PHYSFS_DirTreeDeinit */
 
 /* end of physfs.c ... */
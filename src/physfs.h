@@ -718,6 +718,9 @@ extern PHYSFS_DECL const PHYSFS_ArchiveInfo ** PHYSFS_CALL PHYSFS_supportedArchi
  * It is safe to pass a NULL here, but doing so will cause a crash in versions
  * before PhysicsFS 2.1.0.
  *
+ * Since PhysicsFS 3.3.0, each list and its strings are a single allocation,
+ *  so don't free, realloc, or replace the individual strings in it.
+ *
  * \param listVar List of information specified as freeable by this function.
  *                May be NULL.
  *
@@ -4447,6 +4450,1124 @@ extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_setRoot(const char *archive, const cha
 /* Everything above this line is part of the PhysicsFS 3.1 API. */
 
 
+/**
+ * Enable or disable checksum verification of files read from archives.
+ *
+ * Some archive formats store a checksum for each file (for example, the
+ * CRC-32 in .zip files). PhysicsFS ignores these by default, since checking
+ * them costs some CPU time on every read, and most data is fine.
+ *
+ * If you enable this, files opened for reading from then on will have their
+ * data checked as it's read. When a read reaches the end of a file whose
+ * contents don't match the archive's checksum, that read fails and
+ * PHYSFS_getLastErrorCode() reports PHYSFS_ERR_CORRUPT. A file is only
+ * checked if all of it gets read, but it doesn't have to be read in order;
+ * parts that were seeked past are checked if a later seek goes back and
+ * reads them.
+ *
+ * Files that are already open are not affected, and archive types without
+ * checksums, and directories on the physical filesystem, are never checked.
+ *
+ * Checksum verification can be enabled or disabled at any time after
+ * you've called PHYSFS_init(), and is disabled by default.
+ *
+ * \param enable nonzero to verify checksums, zero to skip them.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_getChecksumVerification
+ * \sa PHYSFS_verifyArchive
+ */
+extern PHYSFS_DECL void PHYSFS_CALL PHYSFS_setChecksumVerification(int enable);
+
+
+/**
+ * Determine if checksums of files read from archives are verified.
+ *
+ * \returns nonzero if checksums are verified, zero if not.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setChecksumVerification
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_getChecksumVerification(void);
+
+
+/**
+ * Check every file in a mounted archive against its stored checksum.
+ *
+ * This reads every file in (archive) from start to end, with checksum
+ * verification enabled (see PHYSFS_setChecksumVerification()), spreading
+ * the work across the system's CPU cores where the platform allows it.
+ * It's meant for things like a "verify game files" option, or checking
+ * packages on a build machine.
+ *
+ * Every file in the archive is checked, even ones outside a root set with
+ * PHYSFS_setRoot(). For archive types without checksums, this just checks
+ * that every file can be read.
+ *
+ * (badfile) is called, on the calling thread and in no particular order,
+ * with the archive-relative path of each file that couldn't be read or
+ * didn't match its checksum. It may be NULL if you only care about the
+ * return value.
+ *
+ * Other threads' calls into PhysicsFS that need the search path (opening
+ * files, enumerating, mounting, etc) will block until this returns.
+ * Reading from files that are already open is not affected.
+ *
+ * \param archive dir/archive to check, as passed to PHYSFS_mount().
+ * \param badfile callback for each file that failed, or NULL.
+ * \param data pointer passed through to (badfile).
+ * \returns nonzero if every file passed, zero otherwise. Use
+ *          PHYSFS_getLastErrorCode() to obtain the specific error; a file
+ *          that failed its checksum reports PHYSFS_ERR_CORRUPT.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setChecksumVerification
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_verifyArchive(const char *archive,
+                                                      PHYSFS_StringCallback badfile,
+                                                      void *data);
+
+
+/**
+ * When archives build their index of the files they contain.
+ *
+ * \since This enum is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setIndexingMode
+ */
+typedef enum PHYSFS_IndexingMode
+{
+	PHYSFS_INDEX_AT_MOUNT, /**< index the whole archive in PHYSFS_mount(). */
+	PHYSFS_INDEX_ON_FIRST_USE, /**< index when a lookup first needs it. */
+	PHYSFS_INDEX_IN_BACKGROUND /**< like ON_FIRST_USE, but start now on another thread. */
+} PHYSFS_IndexingMode;
+
+
+/**
+ * Decide when newly-mounted archives build their file index.
+ *
+ * By default, PHYSFS_mount() reads an archive's whole directory before it
+ * returns. That can add up if you mount many large archives at startup
+ * and only touch a few of them.
+ *
+ * With PHYSFS_INDEX_ON_FIRST_USE, mounting only checks that the archive is
+ * valid (its signature and the location of its directory), and the full
+ * index is built the first time a lookup, open or enumeration reaches
+ * that archive in the search path. PHYSFS_INDEX_IN_BACKGROUND does the
+ * same, but also queues the archive to be indexed on a background thread
+ * right away, one archive at a time in the order they were mounted. Any
+ * lookup that reaches an archive that is still being indexed waits for it
+ * to finish. On platforms without thread support, PHYSFS_INDEX_IN_BACKGROUND
+ * behaves like PHYSFS_INDEX_ON_FIRST_USE.
+ *
+ * If a deferred archive turns out to be corrupt, the mount has already
+ * succeeded; lookups that reach it fail with the error that indexing hit,
+ * and you can PHYSFS_unmount() it as usual.
+ *
+ * This only affects archives mounted after the call. Currently only .zip
+ * archives defer their indexing; other archive types are always indexed
+ * at mount time.
+ *
+ * The default is PHYSFS_INDEX_AT_MOUNT.
+ *
+ *   \param mode when archives mounted from now on should be indexed.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_getIndexingMode
+ * \sa PHYSFS_mount
+ */
+extern PHYSFS_DECL void PHYSFS_CALL PHYSFS_setIndexingMode(PHYSFS_IndexingMode mode);
+
+
+/**
+ * Determine when newly-mounted archives build their file index.
+ *
+ * \returns the current PHYSFS_IndexingMode.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setIndexingMode
+ */
+extern PHYSFS_DECL PHYSFS_IndexingMode PHYSFS_CALL PHYSFS_getIndexingMode(void);
+
+
+/**
+ * One item to mount with PHYSFS_mountMany().
+ *
+ * The first three fields have the same meaning as the arguments to
+ *  PHYSFS_mount(). PHYSFS_mountMany() fills in (error).
+ *
+ * \since This struct is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_mountMany
+ */
+typedef struct PHYSFS_MountSpec
+{
+	const char *newDir; /**< directory or archive to add to the path. */
+	const char *mountPoint; /**< location in the tree, NULL for root. */
+	int appendToPath; /**< nonzero to append, zero to prepend. */
+	PHYSFS_ErrorCode error; /**< PHYSFS_ERR_OK if this one was mounted. */
+} PHYSFS_MountSpec;
+
+
+/**
+ * Add several archives or directories to the search path at once.
+ *
+ * This has the same result as calling PHYSFS_mount() on each of (specs),
+ *  in order, except that the archives are opened in parallel, spreading
+ *  the work across the system's CPU cores where the platform allows it.
+ *  Opening an archive usually means reading its whole table of contents,
+ *  so if you have a lot of big archives to mount at startup, this can be
+ *  much faster than mounting them one at a time.
+ *
+ * Other threads never see a partially-updated search path; all of the
+ *  successfully-opened items are added at once, once they're all open.
+ *  Items that fail to open are skipped, just like a failed PHYSFS_mount()
+ *  call would be, and the rest are still mounted. Each item's (error)
+ *  field is set to PHYSFS_ERR_OK if it was mounted (or was already in the
+ *  search path), or to the reason it wasn't.
+ *
+ *   \param specs array of things to mount.
+ *   \param count number of items in (specs).
+ *  \return nonzero if every item was mounted, zero if any failed. In that
+ *          case, PHYSFS_getLastErrorCode() reports the first failure, and
+ *          each item's (error) field says which ones.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_mount
+ * \sa PHYSFS_MountSpec
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_mountMany(PHYSFS_MountSpec *specs,
+                                                   PHYSFS_uint32 count);
+
+
+/**
+ * Counters for the native handle pool.
+ *
+ * These tell you how hard the limit set with PHYSFS_setNativeHandleLimit()
+ *  is working. If (reopens) climbs steadily while your game runs, the limit
+ *  is too low for how many archives and files you're using at once.
+ *
+ * The counts are since PHYSFS_init().
+ *
+ * \since This struct is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_getNativeHandleStats
+ * \sa PHYSFS_setNativeHandleLimit
+ */
+typedef struct PHYSFS_NativeHandleStats
+{
+	PHYSFS_uint32 pooled; /**< read handles the pool manages right now. */
+	PHYSFS_uint32 open; /**< how many of those have an OS handle open. */
+	PHYSFS_uint32 peakopen; /**< most pooled OS handles open at once. */
+	PHYSFS_uint64 evictions; /**< times a handle was closed to make room. */
+	PHYSFS_uint64 reopens; /**< times a closed handle was opened again. */
+	PHYSFS_uint64 mismatches; /**< reopens that found a different file. */
+} PHYSFS_NativeHandleStats;
+
+
+/**
+ * Limit how many files PhysicsFS keeps open at the OS level for reading.
+ *
+ * Every mounted archive keeps its file open, and so does every file you
+ *  open for reading from an archive or directory. With hundreds of
+ *  archives mounted, that can run into the operating system's limit on
+ *  open files (RLIMIT_NOFILE on Unix, for example).
+ *
+ * With a limit set, files PhysicsFS opens for reading from then on share
+ *  a pool: when there are (limit) of them open and another is needed, the
+ *  least-recently-used one that isn't busy is closed. It's reopened,
+ *  transparently, the next time it's used, at the same position. When
+ *  that happens, PhysicsFS checks that it's still the same file (same
+ *  device, inode, size and modification time, as far as the platform can
+ *  tell). If the file was replaced or changed on disk in the meantime,
+ *  reads from it fail with PHYSFS_ERR_CORRUPT instead of quietly reading
+ *  the wrong data.
+ *
+ * Files opened for writing or appending are never closed behind your back,
+ *  and don't count against the limit. The limit can be exceeded briefly if
+ *  many threads are in the middle of reading different files at once.
+ *
+ * Setting a lower limit closes idle pooled files right away. Setting it to
+ *  zero, the default, turns pooling off for files opened from then on;
+ *  files already in the pool stay there, but are no longer closed to make
+ *  room.
+ *
+ * This can be called before PHYSFS_init(), so the limit is in place before
+ *  anything is mounted. PHYSFS_deinit() puts it back to zero.
+ *
+ *   \param limit maximum pooled files to keep open, or zero for no limit.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_getNativeHandleLimit
+ * \sa PHYSFS_getNativeHandleStats
+ */
+extern PHYSFS_DECL void PHYSFS_CALL PHYSFS_setNativeHandleLimit(PHYSFS_uint32 limit);
+
+
+/**
+ * Get the current limit on pooled native file handles.
+ *
+ * \returns the value last set with PHYSFS_setNativeHandleLimit(), zero if
+ *          there's no limit.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setNativeHandleLimit
+ */
+extern PHYSFS_DECL PHYSFS_uint32 PHYSFS_CALL PHYSFS_getNativeHandleLimit(void);
+
+
+/**
+ * Get counters from the native handle pool.
+ *
+ *   \param stats the PHYSFS_NativeHandleStats to fill in.
+ *  \return non-zero on success, zero on failure. On failure, the reason
+ *          can be retrieved with PHYSFS_getLastErrorCode(). This always
+ *          fails before PHYSFS_init().
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setNativeHandleLimit
+ * \sa PHYSFS_NativeHandleStats
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_getNativeHandleStats(PHYSFS_NativeHandleStats *stats);
+
+
+/**
+ * Use Bloom filters to skip archives that don't have a file.
+ *
+ * Looking up a file walks the search path in order, asking each archive
+ *  whether it has that path. With many archives mounted (a base game plus
+ *  dozens of patches and mods, say), most of them usually don't, and each
+ *  "no" still costs a lookup in that archive, or several when symlinks
+ *  aren't permitted.
+ *
+ * With this set, PhysicsFS builds a small Bloom filter for each archive
+ *  over every path in it, and PHYSFS_openRead(), PHYSFS_exists(),
+ *  PHYSFS_stat(), PHYSFS_getRealDir() and PHYSFS_enumerate() skip archives
+ *  whose filter says the path definitely isn't there. A filter can say
+ *  "maybe" for a path that isn't there (a false positive); then the archive
+ *  is asked as usual, so results are always the same as without filters.
+ *
+ * (bitsPerEntry) trades memory for fewer false positives: 5 bits per path
+ *  gives roughly a 10% false positive rate, 10 bits about 1%, and 15 bits
+ *  about 0.1%. Values over 64 are treated as 64. Zero, the default, turns
+ *  filters off.
+ *
+ * Filters are built when an archive is mounted, or on its first lookup if
+ *  PHYSFS_setIndexingMode() defers indexing; building one enumerates the
+ *  whole archive. Changing this setting throws away existing filters and
+ *  they're rebuilt at the new size as needed.
+ *
+ * Real directories never get a filter, since their contents can change
+ *  while they're mounted, and neither do archives with paths that aren't
+ *  plain ASCII. If you register your own archiver with
+ *  PHYSFS_registerArchiver(), only use filters if its enumerate method
+ *  lists every path its stat method can find, and the archive's contents
+ *  don't change while it's mounted.
+ *
+ * This can be called before PHYSFS_init(), so filters are built as the
+ *  first archives are mounted. PHYSFS_deinit() turns filters back off.
+ *
+ *   \param bitsPerEntry filter bits per path in each archive, or zero to
+ *                       not use filters.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_getLookupFilterBits
+ * \sa PHYSFS_getLookupFilterStats
+ */
+extern PHYSFS_DECL void PHYSFS_CALL PHYSFS_setLookupFilterBits(PHYSFS_uint32 bitsPerEntry);
+
+
+/**
+ * Get the current lookup filter size.
+ *
+ * \returns the value last set with PHYSFS_setLookupFilterBits(), zero if
+ *          lookup filters are off.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setLookupFilterBits
+ */
+extern PHYSFS_DECL PHYSFS_uint32 PHYSFS_CALL PHYSFS_getLookupFilterBits(void);
+
+
+/**
+ * Counters for the lookup filters.
+ *
+ * (skipped) counts filter hits: an archive was skipped because its filter
+ *  said it didn't have the path. (checked) counts misses: the filter said
+ *  "maybe", so the archive was asked. If (checked) is high but lookups
+ *  usually end up in one of the first archives searched, that's expected;
+ *  if lookups usually fail anyway, more bits per entry might help.
+ *
+ * The counts are since PHYSFS_init().
+ *
+ * \since This struct is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_getLookupFilterStats
+ * \sa PHYSFS_setLookupFilterBits
+ */
+typedef struct PHYSFS_LookupFilterStats
+{
+	PHYSFS_uint32 filters; /**< mounted archives with a filter right now. */
+	PHYSFS_uint64 bytes; /**< memory those filters use. */
+	PHYSFS_uint64 skipped; /**< archives skipped thanks to their filter. */
+	PHYSFS_uint64 checked; /**< archives asked because the filter said maybe. */
+} PHYSFS_LookupFilterStats;
+
+
+/**
+ * Get counters from the lookup filters.
+ *
+ *   \param stats the PHYSFS_LookupFilterStats to fill in.
+ *  \return non-zero on success, zero on failure. On failure, the reason
+ *          can be retrieved with PHYSFS_getLastErrorCode(). This always
+ *          fails before PHYSFS_init().
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setLookupFilterBits
+ * \sa PHYSFS_LookupFilterStats
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_getLookupFilterStats(PHYSFS_LookupFilterStats *stats);
+
+
+/**
+ * A path that PHYSFS_compilePath() has done the string work for already.
+ *
+ * This is opaque; create one with PHYSFS_compilePath(), pass it to
+ *  PHYSFS_openReadPath(), PHYSFS_statPath() or PHYSFS_existsPath() as many
+ *  times as you like, and free it with PHYSFS_freePath().
+ *
+ * \since This datatype is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_compilePath
+ */
+typedef struct PHYSFS_Path PHYSFS_Path;
+
+
+/**
+ * Prepare a path for repeated lookups.
+ *
+ * Every lookup by name has to measure, copy and check the path (for ".."
+ *  and the like), hash it for lookup filters, and work out which mount
+ *  points it falls under. If your game looks up the same paths over and
+ *  over, compile them once and use the PHYSFS_*Path() functions instead;
+ *  they skip straight to asking the archives. Results are exactly the same
+ *  as looking up the string.
+ *
+ * A compiled path stays valid as the search path changes; it notices and
+ *  redoes the mount point work on its next use. It doesn't hold on to any
+ *  archive, so unmounting is never blocked by one.
+ *
+ * Compiled paths use the allocator you gave PhysicsFS, so free them with
+ *  PHYSFS_freePath() before PHYSFS_deinit().
+ *
+ *   \param path the path to compile, in platform-independent notation.
+ *  \return a new PHYSFS_Path, or NULL on failure (the path is bad, or out of
+ *          memory). The reason can be retrieved with
+ *          PHYSFS_getLastErrorCode().
+ *
+ * \threadsafety It is safe to call this function from any thread. A
+ *               compiled path may be used from several threads at once.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_freePath
+ * \sa PHYSFS_openReadPath
+ * \sa PHYSFS_statPath
+ * \sa PHYSFS_existsPath
+ */
+extern PHYSFS_DECL PHYSFS_Path * PHYSFS_CALL PHYSFS_compilePath(const char *path);
+
+
+/**
+ * Free a path from PHYSFS_compilePath().
+ *
+ *   \param path the compiled path to free. NULL is ignored.
+ *
+ * \threadsafety It is safe to call this function from any thread, as long
+ *               as no other thread is using (path).
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_compilePath
+ */
+extern PHYSFS_DECL void PHYSFS_CALL PHYSFS_freePath(PHYSFS_Path *path);
+
+
+/**
+ * Open a compiled path for reading.
+ *
+ * This is PHYSFS_openRead() for a path from PHYSFS_compilePath().
+ *
+ *   \param path the compiled path to open.
+ *  \return A valid PhysicsFS filehandle on success, NULL on error. Use
+ *          PHYSFS_getLastErrorCode() to obtain the specific error.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_openRead
+ * \sa PHYSFS_compilePath
+ */
+extern PHYSFS_DECL PHYSFS_File * PHYSFS_CALL PHYSFS_openReadPath(PHYSFS_Path *path);
+
+
+/**
+ * Get information about a compiled path.
+ *
+ * This is PHYSFS_stat() for a path from PHYSFS_compilePath().
+ *
+ *   \param path the compiled path to stat.
+ *   \param stat pointer to structure to fill in with data about (path).
+ *  \return non-zero on success, zero on failure. On failure, the reason
+ *          can be retrieved with PHYSFS_getLastErrorCode().
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_stat
+ * \sa PHYSFS_compilePath
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_statPath(PHYSFS_Path *path,
+                                                   PHYSFS_Stat *stat);
+
+
+/**
+ * Determine if a compiled path exists in the search path.
+ *
+ * This is PHYSFS_exists() for a path from PHYSFS_compilePath().
+ *
+ *   \param path the compiled path to look for.
+ *  \return non-zero if it exists, zero otherwise.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_exists
+ * \sa PHYSFS_compilePath
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_existsPath(PHYSFS_Path *path);
+
+
+/**
+ * \typedef PHYSFS_EnumerateStatCallback
+ * \brief Function signature for callbacks that enumerate with metadata.
+ *
+ * This is PHYSFS_EnumerateCallback with two more parameters: (stat) is what
+ *  PHYSFS_stat() would report for (fname) in the archive that supplied it,
+ *  and (realdir) is that archive, as PHYSFS_getRealDir() would name it.
+ *  Neither pointer is valid after the callback returns, so copy what you
+ *  need.
+ *
+ * The return value works just like it does for PHYSFS_EnumerateCallback.
+ *
+ *    \param data User-defined data pointer, passed through from the API
+ *                that eventually called the callback.
+ *    \param origdir A string containing the full path, in platform-independent
+ *                   notation, of the directory containing this file.
+ *    \param fname The filename that is being enumerated.
+ *    \param stat Metadata for (fname).
+ *    \param realdir The search path element (fname) was found in.
+ *   \return A value from PHYSFS_EnumerateCallbackResult.
+ *
+ * \since This typedef is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_enumerateWithStat
+ * \sa PHYSFS_EnumerateCallback
+ */
+typedef PHYSFS_EnumerateCallbackResult (PHYSFS_CALL *PHYSFS_EnumerateStatCallback)(void *data,
+                const char *origdir, const char *fname,
+                const PHYSFS_Stat *stat, const char *realdir);
+
+
+/**
+ * \brief Enumerate a directory, getting each item's metadata along the way.
+ *
+ * This is PHYSFS_enumerate(), but the callback also gets a PHYSFS_Stat for
+ *  each item. Calling PHYSFS_stat() on every item yourself means walking the
+ *  search path all over again for each one; this gets the information from
+ *  the archive while it's already listing the directory. The built-in
+ *  archivers read it straight from their index (or, for real directories,
+ *  stat each item relative to the open directory); other archivers are
+ *  asked for each item with their stat() method.
+ *
+ * As with PHYSFS_enumerate(), you may receive duplicate filenames, once per
+ *  archive that has them, in search path order. The first one you see is
+ *  the one PHYSFS_stat() and PHYSFS_openRead() would use. Symlinks are left
+ *  out unless PHYSFS_permitSymbolicLinks() allows them, in which case they
+ *  are reported as PHYSFS_FILETYPE_SYMLINK. If an item can't be stat'ed
+ *  (a broken symlink in a .zip, say), enumeration stops with that error,
+ *  the same way PHYSFS_enumerate() does when it has to check for symlinks.
+ *
+ *   \param dir Directory, in platform-independent notation, to enumerate.
+ *   \param c Callback function to notify about search path elements.
+ *   \param d Application-defined data passed to callback. Can be NULL.
+ *  \return non-zero on success, zero on failure, just like
+ *          PHYSFS_enumerate().
+ *
+ * \threadsafety It is safe to call this function from any thread, but it
+ *               holds the same lock PHYSFS_enumerate() does while your
+ *               callback runs.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_EnumerateStatCallback
+ * \sa PHYSFS_enumerate
+ * \sa PHYSFS_stat
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_enumerateWithStat(const char *dir,
+                                        PHYSFS_EnumerateStatCallback c,
+                                        void *d);
+
+
+/**
+ * Possible return values from PHYSFS_WalkCallback.
+ *
+ * These are the same as PHYSFS_EnumerateCallbackResult, plus a way to leave
+ *  out the rest of a directory's subtree.
+ *
+ * \since This enum is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_WalkCallback
+ * \sa PHYSFS_walk
+ */
+typedef enum PHYSFS_WalkCallbackResult
+{
+    PHYSFS_WALK_ERROR = -1,  /**< Stop walking, report error to app. */
+    PHYSFS_WALK_STOP = 0,    /**< Stop walking, report success to app. */
+    PHYSFS_WALK_OK = 1,      /**< Keep walking, no problems. */
+    PHYSFS_WALK_SKIP = 2     /**< Keep walking, but not into this directory. */
+} PHYSFS_WalkCallbackResult;
+
+
+/**
+ * Flags for PHYSFS_walk(). OR them together.
+ *
+ * \since This enum is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_walk
+ */
+typedef enum PHYSFS_WalkFlags
+{
+    PHYSFS_WALK_DEPTH_FIRST = 0,  /**< Visit a directory's subtree before its next sibling (the default). */
+    PHYSFS_WALK_BREADTH_FIRST = (1 << 0),  /**< Visit everything at one depth before going deeper. */
+    PHYSFS_WALK_PARALLEL = (1 << 1)  /**< Read separate archives on separate threads. */
+} PHYSFS_WalkFlags;
+
+
+/**
+ * \typedef PHYSFS_WalkCallback
+ * \brief Function signature for PHYSFS_walk() callbacks.
+ *
+ * (path) is the full path, in platform-independent notation, of the item
+ *  being visited, (stat) is what PHYSFS_stat() would report for it, and
+ *  (realdir) is the search path element it came from, as
+ *  PHYSFS_getRealDir() would name it. None of these pointers are valid
+ *  after the callback returns, so copy what you need.
+ *
+ * Return PHYSFS_WALK_SKIP for a directory to keep PHYSFS_walk() from
+ *  going into it; for anything else, it means the same as PHYSFS_WALK_OK.
+ *
+ *    \param data User-defined data pointer, passed through from
+ *                PHYSFS_walk().
+ *    \param path The item being visited.
+ *    \param stat Metadata for (path).
+ *    \param realdir The search path element (path) was found in.
+ *   \return A value from PHYSFS_WalkCallbackResult.
+ *
+ * \since This typedef is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_walk
+ */
+typedef PHYSFS_WalkCallbackResult (PHYSFS_CALL *PHYSFS_WalkCallback)(void *data,
+                const char *path, const PHYSFS_Stat *stat,
+                const char *realdir);
+
+
+/**
+ * \brief Visit everything under a directory, recursively.
+ *
+ * This calls (c) once for every file and directory under (dir), in every
+ *  archive in the search path, but not for (dir) itself. Doing this by
+ *  hand with PHYSFS_enumerate() means going down the whole search path
+ *  again for every directory; this remembers which archives each directory
+ *  came from, and only asks those about what's in it.
+ *
+ * Unlike PHYSFS_enumerate(), each path is only reported once, with the
+ *  metadata and realdir of the first archive in the search path that has
+ *  it, the same one PHYSFS_stat() and PHYSFS_openRead() would use. If more
+ *  than one archive has a directory, you see what's in all of them. If the
+ *  first archive to have a path has a file there, directories of that name
+ *  in later archives are ignored.
+ *
+ * A directory's contents are visited in strcmp() order. By default, the
+ *  walk is depth-first: each directory is reported, then everything under
+ *  it, then its next sibling. With PHYSFS_WALK_BREADTH_FIRST, everything at
+ *  one depth is reported before anything deeper. Either way, returning
+ *  PHYSFS_WALK_SKIP from (c) for a directory leaves out everything under
+ *  it.
+ *
+ * Symlinks are reported (as PHYSFS_FILETYPE_SYMLINK) only if
+ *  PHYSFS_permitSymbolicLinks() allows them, and are never followed.
+ *
+ * With PHYSFS_WALK_PARALLEL, when more than one archive has something
+ *  under (dir), each one's subtree is read on its own thread before (c) is
+ *  called at all, and the results are merged in search path order on the
+ *  calling thread. This is a win when the archives are big directories on
+ *  slow storage, but it reads everything up front, including anything you
+ *  later skip, and holds on to it until the walk is done. The order and
+ *  content of callbacks are the same either way.
+ *
+ *   \param dir Directory, in platform-independent notation, to walk.
+ *   \param flags Zero or more PHYSFS_WalkFlags, ORed together.
+ *   \param c Callback function to call for each item.
+ *   \param d Application-defined data passed to callback. Can be NULL.
+ *  \return non-zero on success, zero on failure. If (c) returns
+ *          PHYSFS_WALK_ERROR, this fails with PHYSFS_ERR_APP_CALLBACK. As
+ *          with PHYSFS_enumerate(), a (dir) that doesn't exist is not an
+ *          error; there's just nothing to visit.
+ *
+ * \threadsafety It is safe to call this function from any thread, but it
+ *               holds the same lock PHYSFS_enumerate() does while your
+ *               callback runs.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_WalkCallback
+ * \sa PHYSFS_enumerateWithStat
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_walk(const char *dir,
+                                               PHYSFS_uint32 flags,
+                                               PHYSFS_WalkCallback c,
+                                               void *d);
+
+
+/**
+ * \typedef PHYSFS_DirIter
+ * \brief An open directory listing, for reading one name at a time.
+ *
+ * This is an opaque datatype; get one from PHYSFS_openDirIter() and give it
+ *  back with PHYSFS_closeDirIter().
+ *
+ * \since This datatype is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_openDirIter
+ * \sa PHYSFS_nextDirEntry
+ * \sa PHYSFS_closeDirIter
+ */
+typedef struct PHYSFS_DirIter PHYSFS_DirIter;
+
+
+/**
+ * \brief Start listing a directory, one name at a time.
+ *
+ * This is PHYSFS_enumerateFiles() without building the whole list up front,
+ *  and PHYSFS_enumerate() without the callback: you ask for each name with
+ *  PHYSFS_nextDirEntry() when you want it. Nothing is read here except what
+ *  it takes to find out which archives in the search path have (dir).
+ *
+ * As with PHYSFS_enumerateFiles(), each name is reported once, even if
+ *  several archives have it. Names come one archive at a time, in search
+ *  path order; within an archive, .zip files and other indexed archives
+ *  report them in strcmp() order, and real directories in whatever order
+ *  the OS lists them. Archives mounted after this call aren't included.
+ *
+ * An archive with a directory listing open can't be unmounted; that fails
+ *  with PHYSFS_ERR_FILES_STILL_OPEN, as it does for open files.
+ *  PHYSFS_deinit() closes any that are still open.
+ *
+ *   \param dir Directory, in platform-independent notation, to list.
+ *  \return A new directory listing, or NULL on error. A (dir) that doesn't
+ *          exist is not an error, just an empty listing, like
+ *          PHYSFS_enumerateFiles() would give.
+ *
+ * \threadsafety It is safe to call this function from any thread, but only
+ *               one thread may use the returned listing at a time.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_nextDirEntry
+ * \sa PHYSFS_closeDirIter
+ * \sa PHYSFS_enumerateFiles
+ */
+extern PHYSFS_DECL PHYSFS_DirIter * PHYSFS_CALL PHYSFS_openDirIter(const char *dir);
+
+
+/**
+ * \brief Get the next name from a directory listing.
+ *
+ * The name is not a copy; for .zip files and other archives that keep an
+ *  index, it points straight into it, so listing one of those allocates
+ *  nothing at all. Real directories are read all at once when the listing
+ *  gets to them. Either way, don't free the name, and don't use it after
+ *  the next call with (iter), or after PHYSFS_closeDirIter().
+ *
+ *   \param iter A listing from PHYSFS_openDirIter().
+ *   \param name On success, filled in with the next name.
+ *  \return 1 if (name) was filled in, 0 if there are no more names, or -1
+ *          on error. Use PHYSFS_getLastErrorCode() to find out why.
+ *
+ * \threadsafety It is safe to call this function from any thread, but only
+ *               one thread may use (iter) at a time.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_openDirIter
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_nextDirEntry(PHYSFS_DirIter *iter,
+                                                       const char **name);
+
+
+/**
+ * \brief Finish with a directory listing.
+ *
+ * You may stop before PHYSFS_nextDirEntry() runs out of names. Passing NULL
+ *  is harmless.
+ *
+ *   \param iter A listing from PHYSFS_openDirIter().
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_openDirIter
+ */
+extern PHYSFS_DECL void PHYSFS_CALL PHYSFS_closeDirIter(PHYSFS_DirIter *iter);
+
+
+/**
+ * \typedef PHYSFS_Filter
+ * \brief A compiled filename filter, for enumerating only some names.
+ *
+ * This is an opaque datatype; get one from PHYSFS_compileFilter() and give
+ *  it back with PHYSFS_freeFilter().
+ *
+ * \since This datatype is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_compileFilter
+ * \sa PHYSFS_enumerateFiltered
+ */
+typedef struct PHYSFS_Filter PHYSFS_Filter;
+
+
+/**
+ * How a PHYSFS_Filter's patterns are matched against a name.
+ *
+ * \since This enum is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_compileFilter
+ */
+typedef enum PHYSFS_FilterType
+{
+    PHYSFS_FILTER_SUFFIX, /**< name ends with the pattern, like ".lua". */
+    PHYSFS_FILTER_PREFIX, /**< name starts with the pattern. */
+    PHYSFS_FILTER_GLOB    /**< '*' matches any run of characters, '?' any one. */
+} PHYSFS_FilterType;
+
+
+/**
+ * \brief Compile a filter for PHYSFS_enumerateFiltered().
+ *
+ * A name passes the filter if it matches any of (patterns). For example,
+ *  a PHYSFS_FILTER_SUFFIX filter of ".lua" and ".luac" picks out Lua
+ *  scripts, and a PHYSFS_FILTER_GLOB filter of "e1m*.bsp" picks out the
+ *  first episode's maps. Patterns only ever match a single name, not a
+ *  path; there is no special meaning to '/' in them.
+ *
+ * If (caseSensitive) is zero, 'A' through 'Z' match 'a' through 'z'; other
+ *  characters must match exactly. Case-sensitive filters are faster,
+ *  because indexed archives can skip straight to the names that start with
+ *  the right thing.
+ *
+ *   \param type How to match (patterns).
+ *   \param patterns Array of (count) strings. They are copied, so you can
+ *                   free them when this returns.
+ *   \param count Number of strings in (patterns). Must be at least one.
+ *   \param caseSensitive Non-zero to match case exactly.
+ *  \return A new filter, or NULL on error.
+ *
+ * \threadsafety It is safe to call this function from any thread, and the
+ *               filter it returns can be used by any number of threads at
+ *               once.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_freeFilter
+ * \sa PHYSFS_enumerateFiltered
+ */
+extern PHYSFS_DECL PHYSFS_Filter * PHYSFS_CALL PHYSFS_compileFilter(
+                                        PHYSFS_FilterType type,
+                                        const char * const *patterns,
+                                        PHYSFS_uint32 count,
+                                        int caseSensitive);
+
+
+/**
+ * \brief Free a filter from PHYSFS_compileFilter().
+ *
+ *   \param filter The filter to free. Passing NULL is harmless.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_compileFilter
+ */
+extern PHYSFS_DECL void PHYSFS_CALL PHYSFS_freeFilter(PHYSFS_Filter *filter);
+
+
+/**
+ * \brief Enumerate only the names in a directory that pass a filter.
+ *
+ * This is PHYSFS_enumerate(), but (c) is only called for names that pass
+ *  (filter). That's more than a convenience: the filter is checked before
+ *  anything else is done with a name, so names that don't pass never cost
+ *  a callback (or a symlink check), and .zip files and other indexed
+ *  archives don't even look at most of the names a case-sensitive prefix
+ *  or glob filter can't match.
+ *
+ *   \param dir Directory, in platform-independent notation, to enumerate.
+ *   \param filter A filter from PHYSFS_compileFilter().
+ *   \param c Callback function to notify about matching names.
+ *   \param d Application-defined data passed to callback. Can be NULL.
+ *  \return non-zero on success, zero on failure, just like
+ *          PHYSFS_enumerate().
+ *
+ * \threadsafety It is safe to call this function from any thread, but it
+ *               holds the same lock PHYSFS_enumerate() does while your
+ *               callback runs.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_compileFilter
+ * \sa PHYSFS_enumerateFilesFiltered
+ * \sa PHYSFS_enumerate
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_enumerateFiltered(const char *dir,
+                                                const PHYSFS_Filter *filter,
+                                                PHYSFS_EnumerateCallback c,
+                                                void *d);
+
+
+/**
+ * \brief Get a sorted list of the names in a directory that pass a filter.
+ *
+ * This is PHYSFS_enumerateFiles(), with the names that don't pass (filter)
+ *  left out; see PHYSFS_enumerateFiltered() for why that's faster than
+ *  filtering the list yourself. Free the list with PHYSFS_freeList().
+ *
+ *   \param dir Directory, in platform-independent notation, to enumerate.
+ *   \param filter A filter from PHYSFS_compileFilter().
+ *  \return Null-terminated array of null-terminated strings, or NULL on
+ *          error.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_enumerateFiltered
+ * \sa PHYSFS_enumerateFiles
+ */
+extern PHYSFS_DECL char ** PHYSFS_CALL PHYSFS_enumerateFilesFiltered(
+                                                const char *dir,
+                                                const PHYSFS_Filter *filter);
+
+
+/**
+ * \brief Get information about many files at once.
+ *
+ * This is PHYSFS_stat() for every path in (paths), but the search path is
+ *  locked once for the whole batch, and paths in the same directory are
+ *  looked up together. On platforms that support it, a directory on the
+ *  real filesystem is only opened once per batch, and the files in it are
+ *  stat'd relative to that directory instead of by their full paths, so
+ *  this is a good deal cheaper than calling PHYSFS_stat() in a loop when
+ *  you have thousands of paths to check.
+ *
+ * The paths can be in any order, and (stats[i]) and (errors[i]) always
+ *  describe (paths[i]), whatever order they were looked up in.
+ *
+ *   \param paths Array of (count) paths, in platform-independent notation.
+ *   \param count Number of paths in (paths).
+ *   \param stats Array of (count) structures to fill in; (stats[i]) is
+ *                only meaningful if (paths[i]) was found.
+ *   \param errors Array of (count) error codes to fill in; (errors[i]) is
+ *                 PHYSFS_ERR_OK if (paths[i]) was stat'd, or why it
+ *                 couldn't be, like PHYSFS_getLastErrorCode() would say
+ *                 after PHYSFS_stat(). Can be NULL if you don't care why.
+ *  \return the number of paths that were stat'd, or -1 if the batch
+ *          couldn't be done at all (bad arguments, out of memory), in
+ *          which case the reason can be retrieved with
+ *          PHYSFS_getLastErrorCode(). If some paths failed, the last
+ *          error code is the first failure's, in (paths) order.
+ *
+ * \threadsafety It is safe to call this function from any thread. Other
+ *               threads wait for the whole batch to finish before they
+ *               can use the search path.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_stat
+ * \sa PHYSFS_statPath
+ */
+extern PHYSFS_DECL PHYSFS_sint64 PHYSFS_CALL PHYSFS_statMany(
+                                                const char * const *paths,
+                                                PHYSFS_uint32 count,
+                                                PHYSFS_Stat *stats,
+                                                PHYSFS_ErrorCode *errors);
+
+
+/**
+ * \brief Keep the contents of mounted directories in memory.
+ *
+ * Every PHYSFS_stat(), PHYSFS_exists() or enumeration that reaches a
+ *  directory on the real filesystem normally asks the OS again, which adds
+ *  up if you look up the same paths over and over, or search through many
+ *  mounted directories for each file.
+ *
+ * With this enabled, directories mounted from now on are mirrored in memory
+ *  as they are looked at: the first lookup in a directory reads all of it,
+ *  and later lookups there don't touch the disk at all. PhysicsFS asks the
+ *  OS to report changes to every directory it has read, and applies them
+ *  before it answers anything from memory, so files that other programs
+ *  create, delete, rename or change are seen just as they would be without
+ *  caching. Opening files always goes to the real filesystem.
+ *
+ * This costs some memory per file, and the OS might limit how many
+ *  directories can be watched; PhysicsFS falls back to asking the OS for
+ *  anything it can't keep in memory. Access times reported by PHYSFS_stat()
+ *  may be out of date, since reading a file doesn't count as a change.
+ *
+ * This only affects directories mounted after the call, and never the
+ *  write dir. It needs the platform's support for watching directories
+ *  (currently Linux's inotify); elsewhere, this setting does nothing.
+ *
+ * Caching is disabled by default.
+ *
+ *   \param enable non-zero to cache directories mounted from now on, zero
+ *                 to ask the OS every time.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_getDirCaching
+ * \sa PHYSFS_mount
+ */
+extern PHYSFS_DECL void PHYSFS_CALL PHYSFS_setDirCaching(int enable);
+
+
+/**
+ * \brief Determine if mounted directories are kept in memory.
+ *
+ * \return non-zero if directories mounted from now on will be cached.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setDirCaching
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_getDirCaching(void);
+
+
+/**
+ * \brief Find files in mounted archives regardless of case.
+ *
+ * PhysicsFS paths are case-sensitive, but data made on a platform that
+ *  isn't tends to refer to files in whatever case someone typed. With this
+ *  enabled, archives and directories mounted from now on find a path in any
+ *  case: if "Textures/Wall.PNG" isn't there as-is, but "textures/wall.png"
+ *  is, that's the file that PHYSFS_openRead(), PHYSFS_stat(),
+ *  PHYSFS_enumerate() and friends use. This is much faster than
+ *  PHYSFSEXT_locateCorrectCase() from extras/ignorecase.c, since archives
+ *  look the path up in a case-folded index, instead of listing every
+ *  directory along the way.
+ *
+ * Some caveats:
+ *  - A path that's there as-is always wins. If more than one path only
+ *    differs by case, you get one of them, but which one isn't defined.
+ *  - Mount points are still case-sensitive, as is the write dir.
+ *  - A match has to be the same length, in bytes, as the path you asked
+ *    for. Almost everything is, but a few characters fold to ones that are
+ *    longer or shorter in UTF-8 (like the Kelvin sign, which folds to a
+ *    plain 'k').
+ *  - Real directories keep their listings in memory to do this, the same
+ *    way PHYSFS_setDirCaching() does. Where the platform can't watch
+ *    directories for changes, they're listed one at a time instead, but
+ *    only if the path isn't there as-is.
+ *
+ * This only affects archives mounted after the call. It's disabled by
+ *  default.
+ *
+ *   \param enable non-zero to ignore case in archives mounted from now on,
+ *                 zero to match paths exactly.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_getIgnoreCase
+ * \sa PHYSFS_mount
+ */
+extern PHYSFS_DECL void PHYSFS_CALL PHYSFS_setIgnoreCase(int enable);
+
+
+/**
+ * \brief Determine if mounted archives find paths regardless of case.
+ *
+ * \return non-zero if archives mounted from now on will ignore case.
+ *
+ * \threadsafety It is safe to call this function from any thread.
+ *
+ * \since This function is available since PhysicsFS 3.3.0.
+ *
+ * \sa PHYSFS_setIgnoreCase
+ */
+extern PHYSFS_DECL int PHYSFS_CALL PHYSFS_getIgnoreCase(void);
+
+
+/* Everything above this line is part of the PhysicsFS 3.3 API. */
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,6 +11,15 @@
 
 /* There's no PHYSFS_Io interface here. Use __PHYSFS_createNativeIo(). */
 
+typedef struct DIRcache DIRcache;
+
+typedef struct
+{
+    char *base;  /* platform-dependent path, ending in a dir separator. */
+    void *resolver;  /* from __PHYSFS_platformOpenResolveDir(), or NULL. */
+    int triedresolver;  /* non-zero if we already tried to open (resolver). */
+    DIRcache *cache;  /* see PHYSFS_setDirCaching(), or NULL. */
+} DIRinfo;
 
 
 static char *cvtToDependent(const char *prepend, const char *path,
@@ -32,10 +41,875 @@ static char *cvtToDependent(const char *prepend, const char *path,
 } /* cvtToDependent */
 
 
-#define CVT_TO_DEPENDENT(buf, pre, dir) { \
-    const size_t len = ((pre) ? strlen((char *) pre) : 0) + strlen(dir) + 1; \
-    buf = cvtToDependent((char*)pre,dir,(char*)__PHYSFS_smallAlloc(len),len); \
+#define CVT_TO_DEPENDENT(buf, opaque, dir) { \
+    const char *pre = ((DIRinfo *) (opaque))->base; \
+    const size_t len = strlen(pre) + strlen(dir) + 1; \
+    buf = cvtToDependent(pre, dir, (char *) __PHYSFS_smallAlloc(len), len); \
+}
+
+
+/* archive paths are relative paths already, unless the dir separator differs. */
+#if __PHYSFS_STANDARD_DIRSEP
+#define CVT_TO_RELATIVE(buf, dir) buf = (char *) (dir)
+#define FREE_RELATIVE(buf)
+#else
+#define CVT_TO_RELATIVE(buf, dir) { \
+    const size_t len = strlen(dir) + 1; \
+    buf = cvtToDependent(NULL, dir, (char *) __PHYSFS_smallAlloc(len), len); \
 }
+#define FREE_RELATIVE(buf) __PHYSFS_smallFree(buf)
+#endif
+
+
+static void *getResolver(DIRinfo *info)
+{
+    if (!info->triedresolver)  /* only hold it open if someone needs it. */
+    {
+        info->triedresolver = 1;
+        info->resolver = __PHYSFS_platformOpenResolveDir(info->base);
+    } /* if */
+    return info->resolver;
+} /* getResolver */
+
+
+static int statUncached(DIRinfo *info, const char *name, PHYSFS_Stat *stat)
+{
+    void *resolver = getResolver(info);
+    int retval;
+    char *d;
+
+    if (resolver != NULL)  /* don't make the OS walk (base) again. */
+    {
+        CVT_TO_RELATIVE(d, name);
+        BAIL_IF_ERRPASS(!d, 0);
+        retval = __PHYSFS_platformStatAt(resolver, *d ? d : ".", stat);
+        FREE_RELATIVE(d);
+        return retval;
+    } /* if */
+
+    CVT_TO_DEPENDENT(d, info, name);
+    BAIL_IF_ERRPASS(!d, 0);
+    retval = __PHYSFS_platformStat(d, stat, 0);
+    __PHYSFS_smallFree(d);
+    return retval;
+} /* statUncached */
+
+
+/*
+ * PHYSFS_setDirCaching() keeps an in-memory mirror of a mount's directories,
+ *  built as lookups need it, and kept correct by watching each directory it
+ *  has for changes. A node is a watched directory, plus its children and
+ *  their metadata once something needed them. Nodes hang off their parent's,
+ *  so a change that replaces a directory drops everything cached below it.
+ *  Changes are read before anything is answered from the cache, so it's
+ *  never behind what the platform has told us. File opens always go to disk.
+ */
+typedef struct
+{
+    size_t name;  /* offset into the node's (names). */
+    PHYSFS_Stat stat;
+    int stale;  /* non-zero if it changed since (stat) was read. */
+} DIRcacheEntry;
+
+typedef struct DIRcacheNode
+{
+    char *path;  /* archive path, "" for the root; allocated with the node. */
+    size_t pathlen;
+    PHYSFS_uint32 hash;
+    int watch;
+    int listed;  /* non-zero if (entries) are valid. */
+    DIRcacheEntry *entries;  /* sorted by name. */
+    PHYSFS_uint32 numentries;
+    char *names;
+    PHYSFS_uint32 *folded;  /* entries by case-folded name, or NULL. */
+    PHYSFS_uint32 foldslots;  /* size of (folded), a power of two. */
+    struct DIRcacheNode *parent;
+    struct DIRcacheNode *children;
+    struct DIRcacheNode *sibling;
+    struct DIRcacheNode *pathnext;  /* next in the same (bypath) bucket. */
+    struct DIRcacheNode *watchnext;  /* next in the same (bywatch) bucket. */
+} DIRcacheNode;
+
+struct DIRcache
+{
+    void *watcher;  /* from __PHYSFS_platformCreateDirWatcher(). */
+    DIRcacheNode *root;  /* every other node is below this one. */
+    DIRcacheNode **bypath;  /* (numbuckets) of these, then (bywatch). */
+    DIRcacheNode **bywatch;
+    size_t numbuckets;  /* a power of two. */
+    size_t numnodes;
+    int busy;  /* enumerations running; don't poll, since it frees things. */
+};
+
+
+static PHYSFS_uint32 dirCacheHash(const char *path, size_t len)
+{
+    PHYSFS_uint32 hash = 5381;
+    while (len--)
+        hash = ((hash << 5) + hash) ^ *(path++);
+    return hash;
+} /* dirCacheHash */
+
+
+static DIRcacheNode *dirCacheFind(const DIRcache *cache, const char *path,
+                                  const size_t len, const PHYSFS_uint32 hash)
+{
+    DIRcacheNode *node = cache->bypath[hash & (cache->numbuckets - 1)];
+    for (; node != NULL; node = node->pathnext)
+    {
+        if ((node->hash == hash) && (node->pathlen == len) &&
+            (memcmp(node->path, path, len) == 0))
+            return node;
+    } /* for */
+    return NULL;
+} /* dirCacheFind */
+
+
+static DIRcacheNode *dirCacheFindWatch(const DIRcache *cache, const int watch)
+{
+    const size_t bucket = ((size_t) watch) & (cache->numbuckets - 1);
+    DIRcacheNode *node;
+    for (node = cache->bywatch[bucket]; node != NULL; node = node->watchnext)
+    {
+        if (node->watch == watch)
+            return node;
+    } /* for */
+    return NULL;
+} /* dirCacheFindWatch */
+
+
+static void dirCacheInsert(DIRcache *cache, DIRcacheNode *node)
+{
+    const size_t mask = cache->numbuckets - 1;
+    DIRcacheNode **pathbucket = &cache->bypath[node->hash & mask];
+    DIRcacheNode **watchbucket = &cache->bywatch[((size_t) node->watch) & mask];
+    node->pathnext = *pathbucket;
+    *pathbucket = node;
+    node->watchnext = *watchbucket;
+    *watchbucket = node;
+} /* dirCacheInsert */
+
+
+static int dirCacheGrow(DIRcache *cache)
+{
+    const size_t oldcount = cache->numbuckets;
+    DIRcacheNode **oldpath = cache->bypath;
+    const size_t newcount = oldcount * 2;
+    const size_t len = sizeof (DIRcacheNode *) * newcount * 2;
+    DIRcacheNode **buckets = (DIRcacheNode **) allocator.Malloc(len);
+    size_t i;
+
+    BAIL_IF(!buckets, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    memset(buckets, '\0', len);
+    cache->bypath = buckets;
+    cache->bywatch = buckets + newcount;
+    cache->numbuckets = newcount;
+
+    for (i = 0; i < oldcount; i++)
+    {
+        DIRcacheNode *node = oldpath[i];
+        while (node != NULL)
+        {
+            DIRcacheNode *next = node->pathnext;
+            dirCacheInsert(cache, node);
+            node = next;
+        } /* while */
+    } /* for */
+
+    allocator.Free(oldpath);
+    return 1;
+} /* dirCacheGrow */
+
+
+/* Forget (node)'s children, so they're read again next time. */
+static void dirCacheForget(DIRcacheNode *node)
+{
+    allocator.Free(node->entries);
+    allocator.Free(node->names);
+    allocator.Free(node->folded);
+    node->entries = NULL;
+    node->names = NULL;
+    node->folded = NULL;
+    node->foldslots = 0;
+    node->numentries = 0;
+    node->listed = 0;
+} /* dirCacheForget */
+
+
+/* Free (node) and everything below it, without unlinking anything. */
+static void dirCacheFree(DIRcacheNode *node)
+{
+    while (node->children != NULL)
+    {
+        DIRcacheNode *kid = node->children;
+        node->children = kid->sibling;
+        dirCacheFree(kid);
+    } /* while */
+    dirCacheForget(node);
+    allocator.Free(node);
+} /* dirCacheFree */
+
+
+/* Stop caching (node) and everything below it. */
+static void dirCacheDrop(DIRcache *cache, DIRcacheNode *node)
+{
+    const size_t mask = cache->numbuckets - 1;
+    DIRcacheNode **ptr;
+
+    while (node->children != NULL)
+        dirCacheDrop(cache, node->children);
+
+    for (ptr = &cache->bypath[node->hash & mask]; *ptr != node; )
+        ptr = &(*ptr)->pathnext;
+    *ptr = node->pathnext;
+
+    for (ptr = &cache->bywatch[((size_t) node->watch) & mask]; *ptr != node; )
+        ptr = &(*ptr)->watchnext;
+    *ptr = node->watchnext;
+
+    if (node->parent == NULL)
+        cache->root = NULL;
+    else
+    {
+        for (ptr = &node->parent->children; *ptr != node; )
+            ptr = &(*ptr)->sibling;
+        *ptr = node->sibling;
+    } /* else */
+
+    __PHYSFS_platformRemoveDirWatch(cache->watcher, node->watch);
+    cache->numnodes--;
+    dirCacheForget(node);
+    allocator.Free(node);
+} /* dirCacheDrop */
+
+
+static DIRcacheEntry *dirCacheFindEntry(const DIRcacheNode *node,
+                                        const char *name, const size_t len)
+{
+    PHYSFS_uint32 lo = 0;
+    PHYSFS_uint32 hi = node->numentries;
+
+    while (lo < hi)
+    {
+        const PHYSFS_uint32 mid = lo + ((hi - lo) / 2);
+        const char *str = node->names + node->entries[mid].name;
+        int rc = strncmp(name, str, len);
+        if ((rc == 0) && (str[len] != '\0'))
+            rc = -1;  /* (name) is a prefix of (str). */
+
+        if (rc == 0)
+            return &node->entries[mid];
+        else if (rc < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    } /* while */
+
+    return NULL;
+} /* dirCacheFindEntry */
+
+
+/* (node)'s own entry in its parent changed, too; its times, at least. */
+static void dirCacheTouch(DIRcacheNode *node)
+{
+    const DIRcacheNode *parent = node->parent;
+    if ((parent != NULL) && (parent->listed))
+    {
+        const size_t skip = parent->pathlen ? parent->pathlen + 1 : 0;
+        DIRcacheEntry *entry = dirCacheFindEntry(parent, node->path + skip,
+                                                 node->pathlen - skip);
+        if (entry != NULL)
+            entry->stale = 1;
+    } /* if */
+} /* dirCacheTouch */
+
+
+static void dirCacheEvent(void *data, int watch, __PHYSFS_DirWatchEvent event,
+                          const char *name)
+{
+    DIRcache *cache = (DIRcache *) data;
+    DIRcacheNode *node;
+
+    if (event == __PHYSFS_DIRWATCH_OVERFLOW)
+    {
+        if (cache->root != NULL)
+            dirCacheDrop(cache, cache->root);
+        return;
+    } /* if */
+
+    node = dirCacheFindWatch(cache, watch);
+    if (node == NULL)
+        return;  /* something we already dropped. */
+
+    if (event == __PHYSFS_DIRWATCH_GONE)
+        dirCacheDrop(cache, node);
+
+    else if (name == NULL)  /* the dir itself; permissions, maybe. */
+    {
+        while (node->children != NULL)
+            dirCacheDrop(cache, node->children);
+        dirCacheForget(node);
+        dirCacheTouch(node);
+    } /* else if */
+
+    else if (event == __PHYSFS_DIRWATCH_RENAMED)
+    {
+        /* anything cached under that name isn't there anymore. */
+        DIRcacheNode *kid;
+        const size_t skip = node->pathlen ? node->pathlen + 1 : 0;
+        for (kid = node->children; kid != NULL; kid = kid->sibling)
+        {
+            if (strcmp(kid->path + skip, name) == 0)
+            {
+                dirCacheDrop(cache, kid);
+                break;
+            } /* if */
+        } /* for */
+        dirCacheForget(node);
+        dirCacheTouch(node);
+    } /* else if */
+
+    else if (node->listed)
+    {
+        DIRcacheEntry *entry = dirCacheFindEntry(node, name, strlen(name));
+        if (entry != NULL)
+            entry->stale = 1;  /* just stat that one again. */
+        else
+            dirCacheForget(node);  /* we missed something? Start over. */
+    } /* else if */
+} /* dirCacheEvent */
+
+
+static void dirCachePoll(DIRcache *cache)
+{
+    if (cache->busy)
+        return;
+    else if (!__PHYSFS_platformPollDirWatcher(cache->watcher, dirCacheEvent, cache))
+    {
+        /* we can't tell what changed, so forget everything. */
+        if (cache->root != NULL)
+            dirCacheDrop(cache, cache->root);
+    } /* else if */
+} /* dirCachePoll */
+
+
+/*
+ * Get the node for (path), an archive path (len) bytes long, watching it
+ *  (and its parents) first if it isn't cached yet. Returns NULL if it can't
+ *  be cached, and sets (*missing) if that's because its parent's cached
+ *  children say it doesn't exist, or isn't a directory.
+ */
+static DIRcacheNode *dirCacheGetDir(DIRinfo *info, const char *path,
+                                    const size_t len, int *missing)
+{
+    DIRcache *cache = info->cache;
+    const PHYSFS_uint32 hash = dirCacheHash(path, len);
+    DIRcacheNode *node = dirCacheFind(cache, path, len, hash);
+    DIRcacheNode *parent = NULL;
+    char *fullpath;
+    int watch;
+
+    *missing = 0;
+    if (node != NULL)
+        return node;
+
+    /* watch the parent first, so we hear about this being replaced. */
+    if (len > 0)
+    {
+        size_t parentlen = len;
+        while ((parentlen > 0) && (path[parentlen - 1] != '/'))
+            parentlen--;
+
+        parent = dirCacheGetDir(info, path, parentlen ? parentlen - 1 : 0,
+                                missing);
+        if (parent == NULL)
+            return NULL;
+        else if (parent->listed)
+        {
+            const DIRcacheEntry *entry = dirCacheFindEntry(parent,
+                                           path + parentlen, len - parentlen);
+            if ((entry == NULL) ||
+                ((entry->stat.filetype != PHYSFS_FILETYPE_DIRECTORY) &&
+                 (entry->stat.filetype != PHYSFS_FILETYPE_SYMLINK)))
+            {
+                *missing = 1;
+                return NULL;
+            } /* if */
+        } /* else if */
+    } /* if */
+
+    if ((cache->numnodes >= cache->numbuckets) && (!dirCacheGrow(cache)))
+        return NULL;
+
+    node = (DIRcacheNode *) allocator.Malloc(sizeof (DIRcacheNode) + len + 1);
+    BAIL_IF(!node, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    memset(node, '\0', sizeof (DIRcacheNode));
+    node->path = (char *) (node + 1);
+    memcpy(node->path, path, len);
+    node->path[len] = '\0';
+    node->pathlen = len;
+    node->hash = hash;
+
+    CVT_TO_DEPENDENT(fullpath, info, node->path);
+    if (!fullpath)
+    {
+        allocator.Free(node);
+        return NULL;
+    } /* if */
+    watch = __PHYSFS_platformAddDirWatch(cache->watcher, fullpath);
+    __PHYSFS_smallFree(fullpath);
+
+    /* a second way to reach a dir we watch (a symlink) gets the same id. */
+    if ((watch < 0) || (dirCacheFindWatch(cache, watch) != NULL))
+    {
+        allocator.Free(node);
+        return NULL;
+    } /* if */
+
+    node->watch = watch;
+    node->parent = parent;
+    if (parent == NULL)
+        cache->root = node;
+    else
+    {
+        node->sibling = parent->children;
+        parent->children = node;
+    } /* else */
+
+    dirCacheInsert(cache, node);
+    cache->numnodes++;
+    return node;
+} /* dirCacheGetDir */
+
+
+typedef struct
+{
+    DIRcacheNode *node;
+    size_t capacity;  /* of (node->entries). */
+    size_t namesused;
+    size_t namesalloc;
+    PHYSFS_ErrorCode errcode;
+} DIRcacheListData;
+
+static PHYSFS_EnumerateCallbackResult dirCacheAddEntry(void *_data,
+                                    const char *origdir, const char *fname,
+                                    const PHYSFS_Stat *stat)
+{
+    DIRcacheListData *data = (DIRcacheListData *) _data;
+    DIRcacheNode *node = data->node;
+    const size_t len = strlen(fname) + 1;
+    DIRcacheEntry *entry;
+
+    if (node->numentries == data->capacity)
+    {
+        const size_t newcap = data->capacity ? data->capacity * 2 : 32;
+        void *ptr = allocator.Realloc(node->entries,
+                                      newcap * sizeof (DIRcacheEntry));
+        if (!ptr)
+        {
+            data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+            return PHYSFS_ENUM_ERROR;
+        } /* if */
+        node->entries = (DIRcacheEntry *) ptr;
+        data->capacity = newcap;
+    } /* if */
+
+    if (data->namesused + len > data->namesalloc)
+    {
+        size_t newlen = data->namesalloc ? data->namesalloc * 2 : 512;
+        void *ptr;
+        while (newlen < data->namesused + len)
+            newlen *= 2;
+        ptr = allocator.Realloc(node->names, newlen);
+        if (!ptr)
+        {
+            data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+            return PHYSFS_ENUM_ERROR;
+        } /* if */
+        node->names = (char *) ptr;
+        data->namesalloc = newlen;
+    } /* if */
+
+    entry = &node->entries[node->numentries++];
+    entry->name = data->namesused;
+    memcpy(&entry->stat, stat, sizeof (PHYSFS_Stat));
+    entry->stale = 0;
+    memcpy(node->names + data->namesused, fname, len);
+    data->namesused += len;
+    return PHYSFS_ENUM_OK;
+} /* dirCacheAddEntry */
+
+
+static int dirCacheEntryCmp(void *_a, size_t one, size_t two)
+{
+    const DIRcacheNode *node = (const DIRcacheNode *) _a;
+    return strcmp(node->names + node->entries[one].name,
+                  node->names + node->entries[two].name);
+} /* dirCacheEntryCmp */
+
+
+static void dirCacheEntrySwap(void *_a, size_t one, size_t two)
+{
+    DIRcacheNode *node = (DIRcacheNode *) _a;
+    DIRcacheEntry tmp;
+    memcpy(&tmp, &node->entries[one], sizeof (DIRcacheEntry));
+    memcpy(&node->entries[one], &node->entries[two], sizeof (DIRcacheEntry));
+    memcpy(&node->entries[two], &tmp, sizeof (DIRcacheEntry));
+} /* dirCacheEntrySwap */
+
+
+static PHYSFS_EnumerateCallbackResult enumerateStatUncached(void *opaque,
+                             const char *dname,
+                             __PHYSFS_EnumerateStatCallback cb,
+                             const char *origdir, void *callbackdata);
+
+/* Read (node)'s children, if we don't have them already. */
+static int dirCacheList(DIRinfo *info, DIRcacheNode *node)
+{
+    DIRcacheListData data;
+
+    if (node->listed)
+        return 1;
+
+    memset(&data, '\0', sizeof (data));
+    data.node = node;
+    if (enumerateStatUncached(info, node->path, dirCacheAddEntry, NULL,
+                              &data) == PHYSFS_ENUM_ERROR)
+    {
+        dirCacheForget(node);
+        BAIL_IF(data.errcode, data.errcode, 0);
+        return 0;
+    } /* if */
+
+    __PHYSFS_sort(node, node->numentries, dirCacheEntryCmp, dirCacheEntrySwap);
+    node->listed = 1;
+    return 1;
+} /* dirCacheList */
+
+
+/* Stat (entry) again if it changed since we did. Zero if it's gone. */
+static int dirCacheRefresh(DIRinfo *info, const DIRcacheNode *node,
+                           DIRcacheEntry *entry)
+{
+    const char *name = node->names + entry->name;
+    const size_t len = node->pathlen + strlen(name) + 2;
+    PHYSFS_Stat statbuf;
+    char *path;
+    int rc;
+
+    if (!entry->stale)
+        return 1;
+
+    path = (char *) __PHYSFS_smallAlloc(len);
+    BAIL_IF(!path, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    snprintf(path, len, "%s%s%s", node->path, node->pathlen ? "/" : "", name);
+    rc = statUncached(info, path, &statbuf);
+    __PHYSFS_smallFree(path);
+
+    if (rc)
+    {
+        memcpy(&entry->stat, &statbuf, sizeof (PHYSFS_Stat));
+        entry->stale = 0;
+    } /* if */
+
+    return rc;
+} /* dirCacheRefresh */
+
+
+/*
+ * The cached versions of DIR_stat() and friends return -1 if the caller
+ *  should go to disk instead, because some part of this can't be cached.
+ */
+static int dirCacheStat(DIRinfo *info, const char *name, PHYSFS_Stat *stat)
+{
+    const char *leaf = strrchr(name, '/');
+    const size_t dirlen = leaf ? (size_t) (leaf - name) : 0;
+    DIRcacheEntry *entry;
+    DIRcacheNode *node;
+    int missing;
+
+    dirCachePoll(info->cache);
+    if (*name == '\0')
+        return -1;  /* the mount's own directory; just ask. */
+
+    leaf = leaf ? leaf + 1 : name;
+    node = dirCacheGetDir(info, name, dirlen, &missing);
+    if (node == NULL)
+    {
+        BAIL_IF(missing, PHYSFS_ERR_NOT_FOUND, 0);
+        return -1;
+    } /* if */
+
+    if (!dirCacheList(info, node))
+        return -1;
+
+    entry = dirCacheFindEntry(node, leaf, strlen(leaf));
+    BAIL_IF(!entry, PHYSFS_ERR_NOT_FOUND, 0);
+    if (!dirCacheRefresh(info, node, entry))
+        return -1;
+
+    memcpy(stat, &entry->stat, sizeof (PHYSFS_Stat));
+    return 1;
+} /* dirCacheStat */
+
+
+static int dirCacheEnumerate(DIRinfo *info, const char *dname,
+                             PHYSFS_EnumerateCallback cb,
+                             __PHYSFS_EnumerateStatCallback statcb,
+                             const char *origdir, void *callbackdata,
+                             PHYSFS_EnumerateCallbackResult *retval)
+{
+    DIRcache *cache = info->cache;
+    DIRcacheNode *node;
+    PHYSFS_uint32 i;
+    int missing;
+
+    *retval = PHYSFS_ENUM_ERROR;
+
+    dirCachePoll(cache);
+    node = dirCacheGetDir(info, dname, strlen(dname), &missing);
+    if (node == NULL)
+    {
+        BAIL_IF(missing, PHYSFS_ERR_NOT_FOUND, 1);
+        return -1;
+    } /* if */
+
+    if (!dirCacheList(info, node))
+        return -1;
+
+    /* callbacks can stat, too; keep (node) from being freed meanwhile. */
+    cache->busy++;
+    *retval = PHYSFS_ENUM_OK;
+    for (i = 0; (*retval == PHYSFS_ENUM_OK) && (i < node->numentries); i++)
+    {
+        DIRcacheEntry *entry = &node->entries[i];
+        const char *name = node->names + entry->name;
+        if (statcb == NULL)
+            *retval = cb(callbackdata, origdir, name);
+        else if (dirCacheRefresh(info, node, entry))
+            *retval = statcb(callbackdata, origdir, name, &entry->stat);
+
+        if (*retval == PHYSFS_ENUM_ERROR)
+            PHYSFS_setErrorCode(PHYSFS_ERR_APP_CALLBACK);
+    } /* for */
+    cache->busy--;
+
+    return 1;
+} /* dirCacheEnumerate */
+
+
+/* __PHYSFS_DIR_checkSymlinks(), one element at a time from the cache. */
+static int dirCacheCheckSymlinks(DIRinfo *info, const char *path,
+                                 const int allowMissing)
+{
+    const char *start = path;
+
+    dirCachePoll(info->cache);
+    if (*path == '\0')
+        return 1;
+
+    while (1)
+    {
+        const char *end = strchr(start, '/');
+        const size_t len = end ? (size_t) (end - start) : strlen(start);
+        const size_t dirlen = (start == path) ? 0 : (size_t) (start - path - 1);
+        const DIRcacheEntry *entry;
+        DIRcacheNode *node;
+        int missing;
+
+        node = dirCacheGetDir(info, path, dirlen, &missing);
+        if (node == NULL)
+        {
+            if (!missing)
+                return -1;
+            break;
+        } /* if */
+
+        if (!dirCacheList(info, node))
+            return -1;
+
+        entry = dirCacheFindEntry(node, start, len);
+        if (entry == NULL)
+            break;
+
+        /* types don't change without a rename, so (stale) doesn't matter. */
+        BAIL_IF(entry->stat.filetype == PHYSFS_FILETYPE_SYMLINK,
+                PHYSFS_ERR_SYMLINK_FORBIDDEN, 0);
+
+        if (end == NULL)
+            return 1;
+        else if (entry->stat.filetype != PHYSFS_FILETYPE_DIRECTORY)
+            break;
+
+        start = end + 1;
+    } /* while */
+
+    BAIL_IF(!allowMissing, PHYSFS_ERR_NOT_FOUND, 0);
+    return 1;
+} /* dirCacheCheckSymlinks */
+
+
+/*
+ * Find a child of (node) called (name) in any case, and the same length
+ *  in bytes, building (node)'s folded index first if it hasn't got one.
+ *  The index is an open-addressed table of entry indices plus one, so
+ *  zero is an empty slot; it's thrown out with the entries.
+ */
+static const DIRcacheEntry *dirCacheFindFolded(DIRcacheNode *node,
+                                               const char *name)
+{
+    const size_t len = strlen(name);
+    PHYSFS_uint32 mask;
+    PHYSFS_uint32 i;
+
+    if (node->folded == NULL)
+    {
+        PHYSFS_uint32 slots = 16;
+        PHYSFS_uint32 j;
+
+        while (slots < node->numentries * 2)
+            slots *= 2;
+
+        node->folded = (PHYSFS_uint32 *) allocator.Malloc(slots * sizeof (PHYSFS_uint32));
+        BAIL_IF(!node->folded, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        memset(node->folded, '\0', slots * sizeof (PHYSFS_uint32));
+        node->foldslots = slots;
+
+        for (j = 0; j < node->numentries; j++)
+        {
+            const char *str = node->names + node->entries[j].name;
+            i = __PHYSFS_hashStringCaseFold(str) & (slots - 1);
+            while (node->folded[i] != 0)
+                i = (i + 1) & (slots - 1);
+            node->folded[i] = j + 1;
+        } /* for */
+    } /* if */
+
+    mask = node->foldslots - 1;
+    for (i = __PHYSFS_hashStringCaseFold(name) & mask; node->folded[i];
+         i = (i + 1) & mask)
+    {
+        const DIRcacheEntry *entry = &node->entries[node->folded[i] - 1];
+        const char *str = node->names + entry->name;
+        if ((strlen(str) == len) && (PHYSFS_utf8stricmp(str, name) == 0))
+            return entry;
+    } /* for */
+
+    return NULL;
+} /* dirCacheFindFolded */
+
+
+/* __PHYSFS_DIR_fixCase(), one element at a time from the cache. */
+static int dirCacheFixCase(DIRinfo *info, char *path)
+{
+    const size_t pathlen = strlen(path);
+    int retval = -1;
+    char *start;
+    char *buf;
+
+    dirCachePoll(info->cache);
+
+    /* work on a copy, so (path) only changes if all of it was found. */
+    buf = (char *) __PHYSFS_smallAlloc(pathlen + 1);
+    BAIL_IF(!buf, PHYSFS_ERR_OUT_OF_MEMORY, -1);
+    strcpy(buf, path);
+
+    start = buf;
+    while (1)
+    {
+        char *end = strchr(start, '/');
+        const size_t len = end ? (size_t) (end - start) : strlen(start);
+        const size_t dirlen = (start == buf) ? 0 : (size_t) (start - buf - 1);
+        const DIRcacheEntry *entry;
+        DIRcacheNode *node;
+        int missing;
+
+        node = dirCacheGetDir(info, buf, dirlen, &missing);
+        if (node == NULL)
+        {
+            if (missing)
+                retval = 0;
+            break;
+        } /* if */
+        else if (!dirCacheList(info, node))
+            break;
+
+        entry = dirCacheFindEntry(node, start, len);
+        if (entry == NULL)
+        {
+            if (end != NULL)
+                *end = '\0';
+            entry = dirCacheFindFolded(node, start);
+            if (end != NULL)
+                *end = '/';
+
+            if (entry == NULL)
+            {
+                retval = 0;
+                break;
+            } /* if */
+            memcpy(start, node->names + entry->name, len);
+        } /* if */
+
+        if (end == NULL)
+        {
+            memcpy(path, buf, pathlen);
+            retval = 1;
+            break;
+        } /* if */
+
+        start = end + 1;
+    } /* while */
+
+    __PHYSFS_smallFree(buf);
+    return retval;
+} /* dirCacheFixCase */
+
+
+static DIRcache *dirCacheCreate(void)
+{
+    const size_t numbuckets = 64;
+    const size_t len = sizeof (DIRcacheNode *) * numbuckets * 2;
+    void *watcher = __PHYSFS_platformCreateDirWatcher();
+    DIRcache *cache;
+
+    if (watcher == NULL)
+        return NULL;  /* can't tell when to update it, so don't cache. */
+
+    cache = (DIRcache *) allocator.Malloc(sizeof (DIRcache));
+    if (cache != NULL)
+    {
+        memset(cache, '\0', sizeof (DIRcache));
+        cache->bypath = (DIRcacheNode **) allocator.Malloc(len);
+        if (cache->bypath == NULL)
+        {
+            allocator.Free(cache);
+            cache = NULL;
+        } /* if */
+    } /* if */
+
+    if (cache == NULL)
+    {
+        __PHYSFS_platformDestroyDirWatcher(watcher);
+        return NULL;  /* just don't cache. */
+    } /* if */
+
+    memset(cache->bypath, '\0', len);
+    cache->bywatch = cache->bypath + numbuckets;
+    cache->numbuckets = numbuckets;
+    cache->watcher = watcher;
+    return cache;
+} /* dirCacheCreate */
+
+
+static void dirCacheDestroy(DIRcache *cache)
+{
+    if (cache->root != NULL)
+        dirCacheFree(cache->root);  /* closing the watcher drops the watches. */
+    __PHYSFS_platformDestroyDirWatcher(cache->watcher);
+    allocator.Free(cache->bypath);
+    allocator.Free(cache);
+} /* dirCacheDestroy */
 
 
 
@@ -44,7 +918,8 @@ static void *DIR_openArchive(PHYSFS_Io *io, const char *name,
 {
     PHYSFS_Stat st;
     const char dirsep = __PHYSFS_platformDirSeparator;
-    char *retval = NULL;
+    DIRinfo *retval = NULL;
+    char *base;
     const size_t namelen = strlen(name);
     const size_t seplen = 1;
 
@@ -55,18 +930,26 @@ static void *DIR_openArchive(PHYSFS_Io *io, const char *name,
         BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);
 
     *claimed = 1;
-    retval = allocator.Malloc(namelen + seplen + 1);
+    retval = (DIRinfo *) allocator.Malloc(sizeof (DIRinfo) + namelen + seplen + 1);
     BAIL_IF(retval == NULL, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
 
-    strcpy(retval, name);
+    memset(retval, '\0', sizeof (DIRinfo));
+    base = retval->base = (char *) (retval + 1);
+    strcpy(base, name);
 
     /* make sure there's a dir separator at the end of the string */
-    if (retval[namelen - 1] != dirsep)
+    if (base[namelen - 1] != dirsep)
     {
-        retval[namelen] = dirsep;
-        retval[namelen + 1] = '\0';
+        base[namelen] = dirsep;
+        base[namelen + 1] = '\0';
     } /* if */
 
+    /* the write dir changes under us anyhow; don't bother caching it.
+       Case-insensitive mounts search the cached listings, so they get one. */
+    if ((!forWriting) &&
+        ((__PHYSFS_dirCachingEnabled()) || (__PHYSFS_ignoreCaseEnabled())))
+        retval->cache = dirCacheCreate();
+
     return retval;
 } /* DIR_openArchive */
 
@@ -75,8 +958,27 @@ static PHYSFS_EnumerateCallbackResult DIR_enumerate(void *opaque,
                          const char *dname, PHYSFS_EnumerateCallback cb,
                          const char *origdir, void *callbackdata)
 {
+    DIRinfo *info = (DIRinfo *) opaque;
+    void *resolver;
     char *d;
     PHYSFS_EnumerateCallbackResult retval;
+
+    if ((info->cache != NULL) &&
+        (dirCacheEnumerate(info, dname, cb, NULL, origdir, callbackdata,
+                           &retval) != -1))
+        return retval;
+
+    resolver = getResolver(info);
+    if (resolver != NULL)
+    {
+        CVT_TO_RELATIVE(d, dname);
+        BAIL_IF_ERRPASS(!d, PHYSFS_ENUM_ERROR);
+        retval = __PHYSFS_platformEnumerateAt(resolver, d, cb, NULL,
+                                              origdir, callbackdata);
+        FREE_RELATIVE(d);
+        return retval;
+    } /* if */
+
     CVT_TO_DEPENDENT(d, opaque, dname);
     BAIL_IF_ERRPASS(!d, PHYSFS_ENUM_ERROR);
     retval = __PHYSFS_platformEnumerate(d, cb, origdir, callbackdata);
@@ -85,23 +987,145 @@ static PHYSFS_EnumerateCallbackResult DIR_enumerate(void *opaque,
 } /* DIR_enumerate */
 
 
+typedef struct
+{
+    __PHYSFS_EnumerateStatCallback cb;
+    void *callbackdata;
+    char *path;  /* the dir, then room for any child's name. */
+    size_t dirlen;
+    size_t pathlen;
+    PHYSFS_ErrorCode errcode;
+} DIRstatEnumData;
+
+static PHYSFS_EnumerateCallbackResult DIR_statEachChild(void *_data,
+                                    const char *origdir, const char *fname)
+{
+    DIRstatEnumData *data = (DIRstatEnumData *) _data;
+    const size_t len = strlen(fname);
+    PHYSFS_EnumerateCallbackResult retval;
+    PHYSFS_Stat statbuf;
+
+    if ((data->dirlen + len + 1) > data->pathlen)
+    {
+        const size_t newlen = data->dirlen + len + 64;
+        void *ptr = allocator.Realloc(data->path, newlen);
+        if (!ptr)
+        {
+            data->errcode = PHYSFS_ERR_OUT_OF_MEMORY;
+            return PHYSFS_ENUM_ERROR;
+        } /* if */
+        data->path = (char *) ptr;
+        data->pathlen = newlen;
+    } /* if */
+
+    memcpy(data->path + data->dirlen, fname, len + 1);
+    if (!__PHYSFS_platformStat(data->path, &statbuf, 0))
+    {
+        data->errcode = PHYSFS_getLastErrorCode();
+        return PHYSFS_ENUM_ERROR;
+    } /* if */
+
+    retval = data->cb(data->callbackdata, origdir, fname, &statbuf);
+    if (retval == PHYSFS_ENUM_ERROR)
+        data->errcode = PHYSFS_ERR_APP_CALLBACK;
+    return retval;
+} /* DIR_statEachChild */
+
+
+static PHYSFS_EnumerateCallbackResult enumerateStatUncached(void *opaque,
+                             const char *dname,
+                             __PHYSFS_EnumerateStatCallback cb,
+                             const char *origdir, void *callbackdata)
+{
+    const char dirsep = __PHYSFS_platformDirSeparator;
+    void *resolver = getResolver((DIRinfo *) opaque);
+    PHYSFS_EnumerateCallbackResult retval;
+    DIRstatEnumData data;
+    char *d;
+
+    if (resolver != NULL)
+    {
+        CVT_TO_RELATIVE(d, dname);
+        BAIL_IF_ERRPASS(!d, PHYSFS_ENUM_ERROR);
+        retval = __PHYSFS_platformEnumerateAt(resolver, d, NULL, cb,
+                                              origdir, callbackdata);
+        FREE_RELATIVE(d);
+        return retval;
+    } /* if */
+
+    CVT_TO_DEPENDENT(d, opaque, dname);
+    BAIL_IF_ERRPASS(!d, PHYSFS_ENUM_ERROR);
+    retval = __PHYSFS_platformEnumerateStat(d, cb, origdir, callbackdata);
+    if (retval == PHYSFS_ENUM_ERROR)
+    {
+        const PHYSFS_ErrorCode err = PHYSFS_getLastErrorCode();
+        if (err != PHYSFS_ERR_UNSUPPORTED)
+        {
+            __PHYSFS_smallFree(d);
+            BAIL(err, PHYSFS_ENUM_ERROR);
+        } /* if */
+    } /* if */
+
+    else
+    {
+        __PHYSFS_smallFree(d);
+        return retval;
+    } /* else */
+
+    /* no shortcut on this platform; stat each child by its full path. */
+    memset(&data, '\0', sizeof (data));
+    data.cb = cb;
+    data.callbackdata = callbackdata;
+    data.dirlen = strlen(d);
+    data.pathlen = data.dirlen + 64;
+    data.path = (char *) allocator.Malloc(data.pathlen);
+    if (!data.path)
+    {
+        __PHYSFS_smallFree(d);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, PHYSFS_ENUM_ERROR);
+    } /* if */
+
+    strcpy(data.path, d);
+    if ((data.dirlen == 0) || (data.path[data.dirlen - 1] != dirsep))
+        data.path[data.dirlen++] = dirsep;
+
+    retval = __PHYSFS_platformEnumerate(d, DIR_statEachChild, origdir, &data);
+    __PHYSFS_smallFree(d);
+    allocator.Free(data.path);
+    BAIL_IF((retval == PHYSFS_ENUM_ERROR) && (data.errcode), data.errcode, retval);
+    return retval;
+} /* enumerateStatUncached */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_DIR_enumerateStat(void *opaque,
+                             const char *dname,
+                             __PHYSFS_EnumerateStatCallback cb,
+                             const char *origdir, void *callbackdata)
+{
+    DIRinfo *info = (DIRinfo *) opaque;
+    PHYSFS_EnumerateCallbackResult retval;
+
+    if ((info->cache != NULL) &&
+        (dirCacheEnumerate(info, dname, NULL, cb, origdir, callbackdata,
+                           &retval) != -1))
+        return retval;
+
+    return enumerateStatUncached(opaque, dname, cb, origdir, callbackdata);
+} /* __PHYSFS_DIR_enumerateStat */
+
+
 static PHYSFS_Io *doOpen(void *opaque, const char *name, const int mode)
 {
+    DIRinfo *info = (DIRinfo *) opaque;
+    void *resolver = getResolver(info);
     PHYSFS_Io *io = NULL;
     char *f = NULL;
 
     CVT_TO_DEPENDENT(f, opaque, name);
     BAIL_IF_ERRPASS(!f, NULL);
 
-    io = __PHYSFS_createNativeIo(f, mode);
-    if (io == NULL)
-    {
-        const PHYSFS_ErrorCode err = PHYSFS_getLastErrorCode();
-        PHYSFS_Stat statbuf;
-        __PHYSFS_platformStat(f, &statbuf, 0);  /* !!! FIXME: why are we stating here? */
-        PHYSFS_setErrorCode(err);
-    } /* if */
-
+    /* (f) is (base) and then (name); open that part relative to (base). */
+    io = __PHYSFS_createNativeIoAt(resolver, f + strlen(info->base), f, mode);
     __PHYSFS_smallFree(f);
 
     return io;
@@ -154,21 +1178,98 @@ static int DIR_mkdir(void *opaque, const char *name)
 
 static void DIR_closeArchive(void *opaque)
 {
-    allocator.Free(opaque);
+    DIRinfo *info = (DIRinfo *) opaque;
+    if (info->resolver != NULL)
+        __PHYSFS_platformCloseResolveDir(info->resolver);
+    if (info->cache != NULL)
+        dirCacheDestroy(info->cache);
+    allocator.Free(info);
 } /* DIR_closeArchive */
 
 
 static int DIR_stat(void *opaque, const char *name, PHYSFS_Stat *stat)
 {
-    int retval = 0;
+    DIRinfo *info = (DIRinfo *) opaque;
+
+    if (info->cache != NULL)
+    {
+        const int rc = dirCacheStat(info, name, stat);
+        if (rc != -1)
+            return rc;
+    } /* if */
+
+    return statUncached(info, name, stat);
+} /* DIR_stat */
+
+
+int __PHYSFS_DIR_checkSymlinks(void *opaque, char *path, const int allowMissing)
+{
+    DIRinfo *info = (DIRinfo *) opaque;
+    void *resolver;
+    int exists = 0;
+    int retval;
+    char *f;
+
+    if (info->cache != NULL)
+    {
+        retval = dirCacheCheckSymlinks(info, path, allowMissing);
+        if (retval != -1)
+            return retval;
+    } /* if */
+
+    resolver = getResolver(info);
+    if (resolver == NULL)
+        return -1;
+
+    CVT_TO_RELATIVE(f, path);
+    BAIL_IF_ERRPASS(!f, -1);
+    retval = __PHYSFS_platformCheckNoSymlinks(resolver, f, &exists);
+    FREE_RELATIVE(f);
+
+    BAIL_IF(retval == 0, PHYSFS_ERR_SYMLINK_FORBIDDEN, 0);
+    BAIL_IF((retval == 1) && (!exists) && (!allowMissing), PHYSFS_ERR_NOT_FOUND, 0);
+    return retval;
+} /* __PHYSFS_DIR_checkSymlinks */
+
+
+int __PHYSFS_DIR_fixCase(void *opaque, char *path)
+{
+    DIRinfo *info = (DIRinfo *) opaque;
+    if (info->cache == NULL)
+        return -1;
+    return dirCacheFixCase(info, path);
+} /* __PHYSFS_DIR_fixCase */
+
+
+void *__PHYSFS_DIR_openStatDir(void *opaque, const char *dname,
+                               const int allowSymlinks)
+{
+    DIRinfo *info = (DIRinfo *) opaque;
+    void *resolver;
+    void *retval;
     char *d;
 
-    CVT_TO_DEPENDENT(d, opaque, name);
-    BAIL_IF_ERRPASS(!d, 0);
-    retval = __PHYSFS_platformStat(d, stat, 0);
-    __PHYSFS_smallFree(d);
+    /* stats come from memory here; PHYSFS_statMany() should just ask. */
+    BAIL_IF(info->cache != NULL, PHYSFS_ERR_UNSUPPORTED, NULL);
+
+    if (allowSymlinks)
+    {
+        CVT_TO_DEPENDENT(d, opaque, dname);
+        BAIL_IF_ERRPASS(!d, NULL);
+        retval = __PHYSFS_platformOpenStatDir(NULL, d);
+        __PHYSFS_smallFree(d);
+        return retval;
+    } /* if */
+
+    /* the resolver refuses symlinks in (dname) as it opens it. */
+    resolver = getResolver(info);
+    BAIL_IF(resolver == NULL, PHYSFS_ERR_UNSUPPORTED, NULL);
+    CVT_TO_RELATIVE(d, dname);
+    BAIL_IF_ERRPASS(!d, NULL);
+    retval = __PHYSFS_platformOpenStatDir(resolver, d);
+    FREE_RELATIVE(d);
     return retval;
-} /* DIR_stat */
+} /* __PHYSFS_DIR_openStatDir */
 
 
 const PHYSFS_Archiver __PHYSFS_Archiver_DIR =
@@ -239,12 +239,10 @@ int UNPK_mkdir(void *opaque, const char *name)
 } /* UNPK_mkdir */
 
 
-int UNPK_stat(void *opaque, const char *path, PHYSFS_Stat *stat)
+static int UNPK_entryStat(void *opaque, const __PHYSFS_DirTreeEntry *_entry,
+                          PHYSFS_Stat *stat)
 {
-    UNPKinfo *info = (UNPKinfo *) opaque;
-    const UNPKentry *entry = findEntry(info, path);
-
-    BAIL_IF_ERRPASS(!entry, 0);
+    const UNPKentry *entry = (const UNPKentry *) _entry;
 
     if (entry->tree.isdir)
     {
@@ -263,9 +261,29 @@ int UNPK_stat(void *opaque, const char *path, PHYSFS_Stat *stat)
     stat->readonly = 1;
 
     return 1;
+} /* UNPK_entryStat */
+
+
+int UNPK_stat(void *opaque, const char *path, PHYSFS_Stat *stat)
+{
+    UNPKinfo *info = (UNPKinfo *) opaque;
+    const UNPKentry *entry = findEntry(info, path);
+    BAIL_IF_ERRPASS(!entry, 0);
+    return UNPK_entryStat(opaque, &entry->tree, stat);
 } /* UNPK_stat */
 
 
+PHYSFS_EnumerateCallbackResult UNPK_enumerateStat(void *opaque,
+                             const char *dname,
+                             __PHYSFS_EnumerateStatCallback cb,
+                             const char *origdir, void *callbackdata)
+{
+    UNPKinfo *info = (UNPKinfo *) opaque;
+    return __PHYSFS_DirTreeEnumerateStat(&info->tree, dname, UNPK_entryStat,
+                                         opaque, cb, origdir, callbackdata);
+} /* UNPK_enumerateStat */
+
+
 void *UNPK_addEntry(void *opaque, char *name, const int isdir,
                     const PHYSFS_sint64 ctime, const PHYSFS_sint64 mtime,
                     const PHYSFS_uint64 pos, const PHYSFS_uint64 len)
@@ -8,6 +8,12 @@
  */
 
 #define __PHYSICSFS_INTERNAL__
+
+/* this has to come first, since it uses malloc(), which we #define away. */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
 #include "physfs_internal.h"
 
 #if PHYSFS_SUPPORTS_ZIP
@@ -22,6 +28,38 @@
 #endif
 #include "physfs_miniz.h"
 
+#if PHYSFS_SUPPORTS_ZIP_LZMA
+#define PHYSFS_LZMASDK_DECODER_ONLY 1
+#include "physfs_lzmasdk.h"
+#endif
+
+#if PHYSFS_SUPPORTS_ZIP_BZIP2
+#include <bzlib.h>
+#endif
+
+#if PHYSFS_SUPPORTS_ZIP_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+#include <zstd.h>
+#endif
+
+#if PHYSFS_SUPPORTS_ZIP_LZ4
+#include <lz4frame.h>
+#endif
+
+#if PHYSFS_SUPPORTS_ZIP_LIBDEFLATE
+#define ZIP_CRC32_LIBDEFLATE 1
+#elif defined(__ARM_FEATURE_CRC32) && !defined(__ARM_BIG_ENDIAN)
+#define ZIP_CRC32_ARM 1
+#include <arm_acle.h>
+#elif (defined(__x86_64__) || defined(__i386__)) && \
+      ((defined(__GNUC__) && (__GNUC__ >= 5)) || \
+       (defined(__clang__) && ((__clang_major__ > 3) || ((__clang_major__ == 3) && (__clang_minor__ >= 8)))))
+#define ZIP_CRC32_PCLMUL 1  /* <immintrin.h> is included at the top. */
+#endif
+
 /*
  * A buffer of ZIP_READBUFSIZE is allocated for each compressed file opened,
  *  and is freed when you close the file; compressed data is read into
@@ -36,6 +74,20 @@
  */
 #define ZIP_READBUFSIZE   (16 * 1024)
 
+/*
+ * When a file is closed, its ZIPfileinfo (read buffer and decompressor
+ *  state included) goes back to a per-archive free list instead of being
+ *  freed, and the next open of an entry with the same compression method
+ *  just resets it. Programs that open and close lots of small files from
+ *  one archive skip a malloc/init/free cycle for each one this way.
+ *
+ * This is the most that will be kept per archive; set it to zero to turn
+ *  pooling off.
+ */
+#ifndef ZIP_FILEINFO_POOLSIZE
+#define ZIP_FILEINFO_POOLSIZE 8
+#endif
+
 
 /*
  * Entries are "unresolved" until they are first opened. At that time,
@@ -57,26 +109,52 @@ typedef enum
 } ZipResolveType;
 
 
+/* bits in ZIPentry::flags... */
+#define ZIP_ENTRY_RESOLVE_MASK        0x0007  /* a ZipResolveType.       */
+#define ZIP_ENTRY_LOADED              0x0008  /* central dir record seen. */
+#define ZIP_ENTRY_WIDE                0x0010  /* values are in (wide).   */
+#define ZIP_ENTRY_TRADITIONAL_CRYPTO  0x0020  /* general purpose bit 0.  */
+#define ZIP_ENTRY_IGNORE_LOCAL_HEADER 0x0040  /* general purpose bit 3.  */
+
 /*
- * One ZIPentry is kept for each file in an open ZIP archive.
+ * One ZIPentry is kept for each file in an open ZIP archive. There can be
+ *  hundreds of thousands of these, so they're kept small: sizes and offset
+ *  are 32 bits, and the rare entry that needs more (Zip64) sets
+ *  ZIP_ENTRY_WIDE and keeps them in ZIPinfo's (wide) list instead, with
+ *  (offset) being the index into it. Use zip_entry_offset(), etc, to read
+ *  them. The modification time stays in MS-DOS format until stat'd.
  */
 typedef struct _ZIPentry
 {
     __PHYSFS_DirTreeEntry tree;         /* manages directory tree         */
     struct _ZIPentry *symlink;          /* NULL or file we symlink to     */
-    ZipResolveType resolved;            /* Have we resolved file/symlink? */
-    PHYSFS_uint64 offset;               /* offset of data in archive      */
-    PHYSFS_uint16 version;              /* version made by                */
-    PHYSFS_uint16 version_needed;       /* version needed to extract      */
-    PHYSFS_uint16 general_bits;         /* general purpose bits           */
-    PHYSFS_uint16 compression_method;   /* compression method             */
+    PHYSFS_uint32 offset;               /* offset of data in archive      */
+    PHYSFS_uint32 compressed_size;      /* compressed size                */
+    PHYSFS_uint32 uncompressed_size;    /* uncompressed size              */
     PHYSFS_uint32 crc;                  /* crc-32                         */
-    PHYSFS_uint64 compressed_size;      /* compressed size                */
-    PHYSFS_uint64 uncompressed_size;    /* uncompressed size              */
-    PHYSFS_sint64 last_mod_time;        /* last file mod time             */
     PHYSFS_uint32 dos_mod_time;         /* original MS-DOS style mod time */
+    PHYSFS_uint16 compression_method;   /* compression method             */
+    PHYSFS_uint16 flags;                /* ZIP_ENTRY_* bits               */
 } ZIPentry;
 
+/* Offset and sizes of a ZIPentry that don't all fit in 32 bits. */
+typedef struct
+{
+    PHYSFS_uint64 offset;
+    PHYSFS_uint64 compressed_size;
+    PHYSFS_uint64 uncompressed_size;
+} ZIPwideentry;
+
+/* Where an MS-DOS date starts, as a PhysicsFS timestamp; see zip_mod_time(). */
+#ifndef ZIP_DAY_CACHE_SIZE
+#define ZIP_DAY_CACHE_SIZE 16
+#endif
+typedef struct
+{
+    PHYSFS_uint32 dosdate;  /* MS-DOS date plus one, zero if unused.  */
+    PHYSFS_sint64 start;    /* midnight, or -1 if DST changes that day. */
+} ZIPday;
+
 /*
  * One ZIPinfo is kept for each open ZIP archive.
  */
@@ -86,24 +164,121 @@ typedef struct
     PHYSFS_Io *io;            /* the i/o interface for this archive.    */
     int zip64;                /* non-zero if this is a Zip64 archive.   */
     int has_crypto;           /* non-zero if any entry uses encryption. */
+    ZIPwideentry *wide;       /* entries with 64-bit offset or sizes.   */
+    PHYSFS_uint32 widecount;  /* number of items in (wide).             */
+    PHYSFS_uint32 widealloc;  /* number of items (wide) has room for.   */
+    ZIPday days[ZIP_DAY_CACHE_SIZE];  /* recently converted dates.      */
+    struct _ZIPfileinfo *pool;  /* closed files, ready for reuse.       */
+    size_t poolcount;         /* number of items in (pool).             */
+    void *poollock;           /* protects (pool) and (poolcount).       */
+    void *indexlock;          /* non-NULL if indexing was deferred.     */
+    int indexed;              /* non-zero once entries are loaded.      */
+    PHYSFS_ErrorCode indexerror;  /* why loading entries failed.        */
+    volatile int cancelindex; /* non-zero to stop loading entries.      */
+    PHYSFS_uint64 dstart;     /* data start, for deferred indexing.     */
+    PHYSFS_uint64 cdir_ofs;   /* central dir offset, ditto.             */
+    PHYSFS_uint64 count;      /* number of entries, ditto.              */
+    __PHYSFS_BackgroundTask indextask;  /* for PHYSFS_INDEX_IN_BACKGROUND. */
 } ZIPinfo;
 
+typedef struct _ZIPdecompressor ZIPdecompressor;
+
+#if PHYSFS_SUPPORTS_ZIP_LZMA
 /*
- * One ZIPfileinfo is kept for each open file in a ZIP archive.
+ * LZMA entries start with a small header (SDK version and decoder
+ *  properties), then the raw LZMA stream. We decode into a dictionary
+ *  buffer that is the smaller of the stream's dictionary size and the
+ *  entry's uncompressed size, and copy out of it in ZIP_read().
  */
 typedef struct
 {
+    CLzmaDec decoder;                 /* lzma sdk decoder state.        */
+    PHYSFS_uint8 header[4 + LZMA_PROPS_SIZE];  /* entry's lzma header. */
+    size_t headerlen;                 /* bytes of (header) read so far. */
+    int initialized;                  /* non-zero once (header) parsed. */
+    int finished;                     /* non-zero at end-of-stream mark. */
+    SizeT copied;                     /* dictionary bytes given out.    */
+    PHYSFS_uint64 remaining;          /* uncompressed bytes not decoded. */
+} ZIPlzma;
+#endif
+
+/*
+ * One ZIPfileinfo is kept for each open file in a ZIP archive.
+ */
+typedef struct _ZIPfileinfo
+{
+    ZIPinfo *info;                        /* archive this came from.    */
+    struct _ZIPfileinfo *next_pooled;     /* next in ZIPinfo's pool.    */
     ZIPentry *entry;                      /* Info on file.              */
+    PHYSFS_uint64 offset;                 /* (entry)'s data offset.     */
+    PHYSFS_uint64 compressed_size;        /* (entry)'s compressed size. */
+    PHYSFS_uint64 uncompressed_size;      /* (entry)'s real size.       */
     PHYSFS_Io *io;                        /* physical file handle.      */
     PHYSFS_uint32 compressed_position;    /* offset in compressed data. */
     PHYSFS_uint32 uncompressed_position;  /* tell() position.           */
     PHYSFS_uint8 *buffer;                 /* decompression buffer.      */
+    const PHYSFS_uint8 *next_in;          /* next unused byte in buffer. */
+    size_t avail_in;                      /* unused bytes at (next_in). */
     PHYSFS_uint32 crypto_keys[3];         /* for "traditional" crypto.  */
     PHYSFS_uint32 initial_crypto_keys[3]; /* for "traditional" crypto.  */
-    z_stream stream;                      /* zlib stream state.         */
+    const ZIPdecompressor *decompressor;  /* NULL for stored entries.   */
+    int verify_crc;                       /* non-zero to check (crc).   */
+    PHYSFS_uint32 crc;                    /* crc-32 of data so far.     */
+    PHYSFS_uint32 crc_position;           /* bytes covered by (crc).    */
+    union
+    {
+        z_stream zlib;
+        #if PHYSFS_SUPPORTS_ZIP_LZMA
+        ZIPlzma *lzma;
+        #endif
+        #if PHYSFS_SUPPORTS_ZIP_BZIP2
+        bz_stream bzip2;
+        #endif
+        #if PHYSFS_SUPPORTS_ZIP_ZSTD
+        ZSTD_DStream *zstd;
+        #endif
+        #if PHYSFS_SUPPORTS_ZIP_LZ4
+        LZ4F_dctx *lz4;
+        #endif
+    } stream;                             /* decompressor state.        */
 } ZIPfileinfo;
 
 
+typedef enum
+{
+    ZIP_DECOMPRESS_ERROR,     /* failed; physfs error state is set.  */
+    ZIP_DECOMPRESS_OK,        /* made progress, more data may follow. */
+    ZIP_DECOMPRESS_FINISHED   /* reached the end of the stream.      */
+} ZipDecompressResult;
+
+/*
+ * Every compression method we can decode has a ZIPdecompressor in the
+ *  zip_decompressors table. ZIP_read() and ZIP_seek() only talk to the
+ *  codec through these, so adding a new one is just a new table entry.
+ *
+ * decompress() consumes bytes from finfo->next_in/avail_in (ZIP_read()
+ *  refills those from the archive), writes at most (*outlen) bytes to (out),
+ *  and sets (*outlen) to the number of bytes it actually produced.
+ *  reset() rewinds the state to the start of the stream, for backwards seeks.
+ *
+ * decompress_all() is optional; it decodes a complete entry that is already
+ *  in memory straight into a buffer of exactly the uncompressed size, when
+ *  the app reads a whole file at once. It doesn't touch the streaming state.
+ *  If it's NULL, we feed the whole buffer through decompress() instead.
+ */
+struct _ZIPdecompressor
+{
+    PHYSFS_uint16 method;              /* compression method it handles. */
+    int (*init)(ZIPfileinfo *finfo);
+    int (*reset)(ZIPfileinfo *finfo);
+    ZipDecompressResult (*decompress)(ZIPfileinfo *finfo, void *out,
+                                      size_t *outlen);
+    void (*deinit)(ZIPfileinfo *finfo);
+    int (*decompress_all)(const void *in, size_t inlen,
+                          void *out, size_t outlen);
+};
+
+
 /* Magic numbers... */
 #define ZIP_LOCAL_FILE_SIG                          0x04034b50
 #define ZIP_CENTRAL_DIR_SIG                         0x02014b50
@@ -114,6 +289,15 @@ typedef struct
 
 /* compression methods... */
 #define COMPMETH_NONE 0
+#define COMPMETH_DEFLATE 8
+#define COMPMETH_BZIP2 12
+#define COMPMETH_LZMA 14
+#define COMPMETH_ZSTD 93
+/* LZ4 has no id in PKWARE's APPNOTE.TXT, so let builds pick one if needed. */
+#ifndef PHYSFS_ZIP_COMPMETH_LZ4
+#define PHYSFS_ZIP_COMPMETH_LZ4 100
+#endif
+#define COMPMETH_LZ4 PHYSFS_ZIP_COMPMETH_LZ4
 /* ...and others... */
 
 
@@ -123,15 +307,46 @@ typedef struct
 #define ZIP_GENERAL_BITS_TRADITIONAL_CRYPTO   (1 << 0)
 #define ZIP_GENERAL_BITS_IGNORE_LOCAL_HEADER  (1 << 3)
 
+static ZipResolveType zip_entry_resolved(const ZIPentry *entry)
+{
+    return (ZipResolveType) (entry->flags & ZIP_ENTRY_RESOLVE_MASK);
+} /* zip_entry_resolved */
+
+static void zip_entry_set_resolved(ZIPentry *entry, const ZipResolveType type)
+{
+    entry->flags = (PHYSFS_uint16) ((entry->flags & ~ZIP_ENTRY_RESOLVE_MASK) | type);
+} /* zip_entry_set_resolved */
+
+static PHYSFS_uint64 zip_entry_offset(const ZIPinfo *info, const ZIPentry *entry)
+{
+    if (entry->flags & ZIP_ENTRY_WIDE)
+        return info->wide[entry->offset].offset;
+    return (PHYSFS_uint64) entry->offset;
+} /* zip_entry_offset */
+
+static PHYSFS_uint64 zip_entry_compressed_size(const ZIPinfo *info, const ZIPentry *entry)
+{
+    if (entry->flags & ZIP_ENTRY_WIDE)
+        return info->wide[entry->offset].compressed_size;
+    return (PHYSFS_uint64) entry->compressed_size;
+} /* zip_entry_compressed_size */
+
+static PHYSFS_uint64 zip_entry_uncompressed_size(const ZIPinfo *info, const ZIPentry *entry)
+{
+    if (entry->flags & ZIP_ENTRY_WIDE)
+        return info->wide[entry->offset].uncompressed_size;
+    return (PHYSFS_uint64) entry->uncompressed_size;
+} /* zip_entry_uncompressed_size */
+
 /* support for "traditional" PKWARE encryption. */
 static int zip_entry_is_tradional_crypto(const ZIPentry *entry)
 {
-    return (entry->general_bits & ZIP_GENERAL_BITS_TRADITIONAL_CRYPTO) != 0;
+    return (entry->flags & ZIP_ENTRY_TRADITIONAL_CRYPTO) != 0;
 } /* zip_entry_is_traditional_crypto */
 
 static int zip_entry_ignore_local_header(const ZIPentry *entry)
 {
-    return (entry->general_bits & ZIP_GENERAL_BITS_IGNORE_LOCAL_HEADER) != 0;
+    return (entry->flags & ZIP_ENTRY_IGNORE_LOCAL_HEADER) != 0;
 } /* zip_entry_is_traditional_crypto */
 
 static PHYSFS_uint32 zip_crypto_crc32(const PHYSFS_uint32 crc, const PHYSFS_uint8 val)
@@ -269,6 +484,510 @@ static int zlib_err(const int rc)
     return rc;
 } /* zlib_err */
 
+
+static int zip_inflate_init(ZIPfileinfo *finfo)
+{
+    initializeZStream(&finfo->stream.zlib);
+    return (zlib_err(inflateInit2(&finfo->stream.zlib, -MAX_WBITS)) == Z_OK);
+} /* zip_inflate_init */
+
+static int zip_inflate_reset(ZIPfileinfo *finfo)
+{
+    return (zlib_err(inflateReset(&finfo->stream.zlib)) == Z_OK);
+} /* zip_inflate_reset */
+
+static ZipDecompressResult zip_inflate_decompress(ZIPfileinfo *finfo,
+                                                  void *out, size_t *outlen)
+{
+    z_stream *str = &finfo->stream.zlib;
+    int rc;
+
+    str->next_in = finfo->next_in;
+    str->avail_in = (unsigned int) finfo->avail_in;
+    str->next_out = (unsigned char *) out;
+    str->avail_out = (unsigned int) *outlen;
+
+    rc = zlib_err(inflate(str, Z_SYNC_FLUSH));
+
+    finfo->avail_in -= (size_t) (str->next_in - finfo->next_in);
+    finfo->next_in = str->next_in;
+    *outlen = (size_t) (str->next_out - ((unsigned char *) out));
+
+    if (rc == Z_STREAM_END)
+        return ZIP_DECOMPRESS_FINISHED;
+    return (rc == Z_OK) ? ZIP_DECOMPRESS_OK : ZIP_DECOMPRESS_ERROR;
+} /* zip_inflate_decompress */
+
+static void zip_inflate_deinit(ZIPfileinfo *finfo)
+{
+    inflateEnd(&finfo->stream.zlib);
+} /* zip_inflate_deinit */
+
+#if PHYSFS_SUPPORTS_ZIP_LIBDEFLATE
+static int zip_inflate_decompress_all(const void *in, size_t inlen,
+                                      void *out, size_t outlen)
+{
+    struct libdeflate_decompressor *decomp = libdeflate_alloc_decompressor();
+    size_t actual = 0;
+    enum libdeflate_result rc;
+
+    BAIL_IF(!decomp, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    rc = libdeflate_deflate_decompress(decomp, in, inlen, out, outlen, &actual);
+    libdeflate_free_decompressor(decomp);
+
+    BAIL_IF(rc != LIBDEFLATE_SUCCESS, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(actual != outlen, PHYSFS_ERR_CORRUPT, 0);
+    return 1;
+} /* zip_inflate_decompress_all */
+#else
+/*
+ * When the whole output buffer is available, tinfl can decode straight into
+ *  it instead of going through inflate()'s 32k sliding window and copying
+ *  everything back out, which is most of the cost of the streaming path.
+ */
+static int zip_inflate_decompress_all(const void *in, size_t inlen,
+                                      void *out, size_t outlen)
+{
+    tinfl_decompressor *decomp;
+    size_t produced = outlen;
+    tinfl_status status;
+
+    decomp = (tinfl_decompressor *) allocator.Malloc(sizeof (tinfl_decompressor));
+    BAIL_IF(!decomp, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    tinfl_init(decomp);
+    status = tinfl_decompress(decomp, (const mz_uint8 *) in, &inlen,
+                              (mz_uint8 *) out, (mz_uint8 *) out, &produced,
+                              TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    allocator.Free(decomp);
+
+    BAIL_IF(status != TINFL_STATUS_DONE, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(produced != outlen, PHYSFS_ERR_CORRUPT, 0);
+    return 1;
+} /* zip_inflate_decompress_all */
+#endif
+
+
+#if PHYSFS_SUPPORTS_ZIP_LZMA
+
+/* LZMA SDK's ISzAlloc interface ... */
+
+static void *zip_ISzAlloc_Alloc(void *p, size_t size)
+{
+    return allocator.Malloc(size ? size : 1);
+} /* zip_ISzAlloc_Alloc */
+
+static void zip_ISzAlloc_Free(void *p, void *address)
+{
+    if (address)
+        allocator.Free(address);
+} /* zip_ISzAlloc_Free */
+
+static ISzAlloc zip_SzAlloc = {
+    zip_ISzAlloc_Alloc, zip_ISzAlloc_Free
+};
+
+
+static int zip_lzma_init(ZIPfileinfo *finfo)
+{
+    ZIPlzma *lzma = (ZIPlzma *) allocator.Malloc(sizeof (ZIPlzma));
+    BAIL_IF(!lzma, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    memset(lzma, '\0', sizeof (*lzma));
+    LzmaDec_Construct(&lzma->decoder);
+    lzma->remaining = finfo->uncompressed_size;
+    finfo->stream.lzma = lzma;
+    return 1;
+} /* zip_lzma_init */
+
+static int zip_lzma_reset(ZIPfileinfo *finfo)
+{
+    ZIPlzma *lzma = finfo->stream.lzma;
+
+    /* keep the probs and dictionary; we'll reread the header. */
+    lzma->headerlen = 0;
+    lzma->initialized = 0;
+    lzma->finished = 0;
+    lzma->copied = 0;
+    lzma->remaining = finfo->uncompressed_size;
+    return 1;
+} /* zip_lzma_reset */
+
+/* Read the lzma header at the start of the entry and set up the decoder. */
+static int zip_lzma_parse_header(ZIPfileinfo *finfo, ZIPlzma *lzma)
+{
+    CLzmaDec *decoder = &lzma->decoder;
+    PHYSFS_uint64 dictsize;
+    SRes rc;
+
+    while ((lzma->headerlen < sizeof (lzma->header)) && (finfo->avail_in > 0))
+    {
+        lzma->header[lzma->headerlen++] = *(finfo->next_in++);
+        finfo->avail_in--;
+    } /* while */
+
+    if (lzma->headerlen < sizeof (lzma->header))
+        return 1;  /* need more input. */
+
+    /* first two bytes are the SDK version that wrote it; ignore them. */
+    BAIL_IF(lzma->header[2] != LZMA_PROPS_SIZE, PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(lzma->header[3] != 0, PHYSFS_ERR_CORRUPT, 0);
+
+    /* this reuses the existing probs if a pooled decoder has them. */
+    rc = LzmaDec_AllocateProbs(decoder, &lzma->header[4], LZMA_PROPS_SIZE, &zip_SzAlloc);
+    BAIL_IF(rc == SZ_ERROR_MEM, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    BAIL_IF(rc != SZ_OK, PHYSFS_ERR_CORRUPT, 0);
+
+    dictsize = (PHYSFS_uint64) decoder->prop.dicSize;
+    if (dictsize > finfo->uncompressed_size)
+        dictsize = finfo->uncompressed_size;
+    if (dictsize == 0)
+        dictsize = 1;
+    BAIL_IF(!__PHYSFS_ui64FitsAddressSpace(dictsize), PHYSFS_ERR_OUT_OF_MEMORY, 0);
+
+    /* a reset or pooled decoder keeps its dictionary if it's big enough. */
+    if ((decoder->dic != NULL) && (((PHYSFS_uint64) decoder->dicBufSize) < dictsize))
+    {
+        allocator.Free(decoder->dic);
+        decoder->dic = NULL;
+    } /* if */
+
+    if (decoder->dic == NULL)
+    {
+        decoder->dic = (Byte *) allocator.Malloc((size_t) dictsize);
+        BAIL_IF(!decoder->dic, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        decoder->dicBufSize = (SizeT) dictsize;
+    } /* if */
+
+    decoder->dicPos = 0;
+    LzmaDec_Init(decoder);
+    lzma->initialized = 1;
+    return 1;
+} /* zip_lzma_parse_header */
+
+static ZipDecompressResult zip_lzma_decompress(ZIPfileinfo *finfo,
+                                               void *out, size_t *outlen)
+{
+    ZIPlzma *lzma = finfo->stream.lzma;
+    CLzmaDec *decoder = &lzma->decoder;
+    PHYSFS_uint8 *ptr = (PHYSFS_uint8 *) out;
+    const size_t wanted = *outlen;
+    size_t total = 0;
+
+    if ((!lzma->initialized) && (!zip_lzma_parse_header(finfo, lzma)))
+    {
+        *outlen = 0;
+        return ZIP_DECOMPRESS_ERROR;
+    } /* if */
+
+    while ((lzma->initialized) && (total < wanted))
+    {
+        ELzmaStatus status;
+        SizeT inlen = (SizeT) finfo->avail_in;
+        SizeT dicpos, diclimit;
+        SRes rc;
+
+        /* hand out anything that's already sitting in the dictionary. */
+        if (lzma->copied < decoder->dicPos)
+        {
+            size_t cpy = (size_t) (decoder->dicPos - lzma->copied);
+            if (cpy > (wanted - total))
+                cpy = wanted - total;
+            memcpy(ptr + total, decoder->dic + lzma->copied, cpy);
+            lzma->copied += cpy;
+            total += cpy;
+            continue;
+        } /* if */
+
+        if ((lzma->finished) || (lzma->remaining == 0))
+            break;
+
+        /* dictionary full and drained? wrap around. */
+        if (decoder->dicPos == decoder->dicBufSize)
+            decoder->dicPos = lzma->copied = 0;
+
+        dicpos = decoder->dicPos;
+        diclimit = decoder->dicBufSize;
+        if ((PHYSFS_uint64) (diclimit - dicpos) > lzma->remaining)
+            diclimit = dicpos + (SizeT) lzma->remaining;
+
+        rc = LzmaDec_DecodeToDic(decoder, diclimit, finfo->next_in, &inlen,
+                                 LZMA_FINISH_ANY, &status);
+        finfo->next_in += inlen;
+        finfo->avail_in -= (size_t) inlen;
+        lzma->remaining -= (PHYSFS_uint64) (decoder->dicPos - dicpos);
+
+        if (rc != SZ_OK)
+        {
+            *outlen = total;
+            BAIL(PHYSFS_ERR_CORRUPT, ZIP_DECOMPRESS_ERROR);
+        } /* if */
+
+        if (status == LZMA_STATUS_FINISHED_WITH_MARK)
+            lzma->finished = 1;
+        else if ((decoder->dicPos == dicpos) && (inlen == 0))
+            break;  /* needs more input. */
+    } /* while */
+
+    *outlen = total;
+    if ((lzma->finished) && (lzma->copied == decoder->dicPos))
+        return ZIP_DECOMPRESS_FINISHED;
+    return ZIP_DECOMPRESS_OK;
+} /* zip_lzma_decompress */
+
+static void zip_lzma_deinit(ZIPfileinfo *finfo)
+{
+    ZIPlzma *lzma = finfo->stream.lzma;
+    if (lzma->decoder.dic != NULL)
+        allocator.Free(lzma->decoder.dic);
+    LzmaDec_FreeProbs(&lzma->decoder, &zip_SzAlloc);
+    allocator.Free(lzma);
+} /* zip_lzma_deinit */
+#endif
+
+
+#if PHYSFS_SUPPORTS_ZIP_BZIP2
+/*
+ * Bridge physfs allocation functions to libbz2's format...
+ */
+static void *bzip2PhysfsAlloc(void *opaque, int items, int size)
+{
+    return ((PHYSFS_Allocator *) opaque)->Malloc(((size_t) items) * ((size_t) size));
+} /* bzip2PhysfsAlloc */
+
+static void bzip2PhysfsFree(void *opaque, void *address)
+{
+    ((PHYSFS_Allocator *) opaque)->Free(address);
+} /* bzip2PhysfsFree */
+
+static PHYSFS_ErrorCode bzip2_error_code(int rc)
+{
+    switch (rc)
+    {
+        case BZ_OK: return PHYSFS_ERR_OK;  /* not an error. */
+        case BZ_STREAM_END: return PHYSFS_ERR_OK; /* not an error. */
+        case BZ_MEM_ERROR: return PHYSFS_ERR_OUT_OF_MEMORY;
+        case BZ_IO_ERROR: return PHYSFS_ERR_IO;
+        default: return PHYSFS_ERR_CORRUPT;
+    } /* switch */
+} /* bzip2_error_code */
+
+static int zip_bzip2_init(ZIPfileinfo *finfo)
+{
+    bz_stream *str = &finfo->stream.bzip2;
+    int rc;
+    memset(str, '\0', sizeof (bz_stream));
+    str->bzalloc = bzip2PhysfsAlloc;
+    str->bzfree = bzip2PhysfsFree;
+    str->opaque = &allocator;
+    rc = BZ2_bzDecompressInit(str, 0, 0);
+    BAIL_IF(rc != BZ_OK, bzip2_error_code(rc), 0);
+    return 1;
+} /* zip_bzip2_init */
+
+static int zip_bzip2_reset(ZIPfileinfo *finfo)
+{
+    /*
+     * libbz2's state points back at the bz_stream, so we can't init a copy
+     *  and swap it in. If the init fails, the stream is left zeroed, and
+     *  BZ2_bzDecompressEnd() on it in deinit is harmless.
+     */
+    BZ2_bzDecompressEnd(&finfo->stream.bzip2);
+    return zip_bzip2_init(finfo);
+} /* zip_bzip2_reset */
+
+static ZipDecompressResult zip_bzip2_decompress(ZIPfileinfo *finfo,
+                                                void *out, size_t *outlen)
+{
+    bz_stream *str = &finfo->stream.bzip2;
+    int rc;
+
+    str->next_in = (char *) finfo->next_in;
+    str->avail_in = (unsigned int) finfo->avail_in;
+    str->next_out = (char *) out;
+    str->avail_out = (unsigned int) *outlen;
+
+    rc = BZ2_bzDecompress(str);
+
+    finfo->avail_in -= (size_t) (((const PHYSFS_uint8 *) str->next_in) - finfo->next_in);
+    finfo->next_in = (const PHYSFS_uint8 *) str->next_in;
+    *outlen = (size_t) (((PHYSFS_uint8 *) str->next_out) - ((PHYSFS_uint8 *) out));
+
+    if (rc == BZ_STREAM_END)
+        return ZIP_DECOMPRESS_FINISHED;
+    BAIL_IF(rc != BZ_OK, bzip2_error_code(rc), ZIP_DECOMPRESS_ERROR);
+    return ZIP_DECOMPRESS_OK;
+} /* zip_bzip2_decompress */
+
+static void zip_bzip2_deinit(ZIPfileinfo *finfo)
+{
+    BZ2_bzDecompressEnd(&finfo->stream.bzip2);
+} /* zip_bzip2_deinit */
+#endif
+
+
+#if PHYSFS_SUPPORTS_ZIP_ZSTD
+static int zip_zstd_init(ZIPfileinfo *finfo)
+{
+    finfo->stream.zstd = ZSTD_createDStream();
+    BAIL_IF(!finfo->stream.zstd, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    return 1;
+} /* zip_zstd_init */
+
+static int zip_zstd_reset(ZIPfileinfo *finfo)
+{
+    const size_t rc = ZSTD_DCtx_reset(finfo->stream.zstd, ZSTD_reset_session_only);
+    BAIL_IF(ZSTD_isError(rc), PHYSFS_ERR_OTHER_ERROR, 0);
+    return 1;
+} /* zip_zstd_reset */
+
+static ZipDecompressResult zip_zstd_decompress(ZIPfileinfo *finfo,
+                                               void *out, size_t *outlen)
+{
+    ZSTD_inBuffer inbuf;
+    ZSTD_outBuffer outbuf;
+    size_t rc;
+
+    inbuf.src = finfo->next_in;
+    inbuf.size = finfo->avail_in;
+    inbuf.pos = 0;
+    outbuf.dst = out;
+    outbuf.size = *outlen;
+    outbuf.pos = 0;
+
+    rc = ZSTD_decompressStream(finfo->stream.zstd, &outbuf, &inbuf);
+
+    finfo->next_in += inbuf.pos;
+    finfo->avail_in -= inbuf.pos;
+    *outlen = outbuf.pos;
+
+    BAIL_IF(ZSTD_isError(rc), PHYSFS_ERR_CORRUPT, ZIP_DECOMPRESS_ERROR);
+
+    /* (rc == 0) means a frame ended, but an entry can hold several frames,
+       so let the caller's uncompressed size decide when we're done. */
+    return ZIP_DECOMPRESS_OK;
+} /* zip_zstd_decompress */
+
+static void zip_zstd_deinit(ZIPfileinfo *finfo)
+{
+    ZSTD_freeDStream(finfo->stream.zstd);
+} /* zip_zstd_deinit */
+
+static int zip_zstd_decompress_all(const void *in, size_t inlen,
+                                   void *out, size_t outlen)
+{
+    const size_t rc = ZSTD_decompress(out, outlen, in, inlen);
+    BAIL_IF(ZSTD_isError(rc), PHYSFS_ERR_CORRUPT, 0);
+    BAIL_IF(rc != outlen, PHYSFS_ERR_CORRUPT, 0);
+    return 1;
+} /* zip_zstd_decompress_all */
+#endif
+
+
+#if PHYSFS_SUPPORTS_ZIP_LZ4
+static int zip_lz4_init(ZIPfileinfo *finfo)
+{
+    const LZ4F_errorCode_t rc = LZ4F_createDecompressionContext(&finfo->stream.lz4, LZ4F_VERSION);
+    BAIL_IF(LZ4F_isError(rc), PHYSFS_ERR_OUT_OF_MEMORY, 0);
+    return 1;
+} /* zip_lz4_init */
+
+static int zip_lz4_reset(ZIPfileinfo *finfo)
+{
+    LZ4F_resetDecompressionContext(finfo->stream.lz4);
+    return 1;
+} /* zip_lz4_reset */
+
+static ZipDecompressResult zip_lz4_decompress(ZIPfileinfo *finfo,
+                                              void *out, size_t *outlen)
+{
+    size_t inlen = finfo->avail_in;
+    const size_t rc = LZ4F_decompress(finfo->stream.lz4, out, outlen,
+                                      finfo->next_in, &inlen, NULL);
+
+    finfo->next_in += inlen;
+    finfo->avail_in -= inlen;
+
+    BAIL_IF(LZ4F_isError(rc), PHYSFS_ERR_CORRUPT, ZIP_DECOMPRESS_ERROR);
+    return ZIP_DECOMPRESS_OK;  /* like zstd, frames can be concatenated. */
+} /* zip_lz4_decompress */
+
+static void zip_lz4_deinit(ZIPfileinfo *finfo)
+{
+    LZ4F_freeDecompressionContext(finfo->stream.lz4);
+} /* zip_lz4_deinit */
+#endif
+
+
+static const ZIPdecompressor zip_decompressors[] =
+{
+    {
+        COMPMETH_DEFLATE, zip_inflate_init, zip_inflate_reset,
+        zip_inflate_decompress, zip_inflate_deinit, zip_inflate_decompress_all
+    },
+    #if PHYSFS_SUPPORTS_ZIP_LZMA
+    {
+        COMPMETH_LZMA, zip_lzma_init, zip_lzma_reset,
+        zip_lzma_decompress, zip_lzma_deinit, NULL
+    },
+    #endif
+    #if PHYSFS_SUPPORTS_ZIP_BZIP2
+    {
+        COMPMETH_BZIP2, zip_bzip2_init, zip_bzip2_reset,
+        zip_bzip2_decompress, zip_bzip2_deinit, NULL
+    },
+    #endif
+    #if PHYSFS_SUPPORTS_ZIP_ZSTD
+    {
+        COMPMETH_ZSTD, zip_zstd_init, zip_zstd_reset,
+        zip_zstd_decompress, zip_zstd_deinit, zip_zstd_decompress_all
+    },
+    #endif
+    #if PHYSFS_SUPPORTS_ZIP_LZ4
+    {
+        COMPMETH_LZ4, zip_lz4_init, zip_lz4_reset,
+        zip_lz4_decompress, zip_lz4_deinit, NULL
+    },
+    #endif
+};
+
+static const ZIPdecompressor *zip_find_decompressor(const PHYSFS_uint16 method)
+{
+    size_t i;
+    for (i = 0; i < __PHYSFS_ARRAYLEN(zip_decompressors); i++)
+    {
+        if (zip_decompressors[i].method == method)
+            return &zip_decompressors[i];
+    } /* for */
+
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);
+} /* zip_find_decompressor */
+
+
+/*
+ * Decompress everything waiting at finfo->next_in, which must produce
+ *  exactly (outlen) bytes. This is for when we have the whole compressed
+ *  stream in memory already.
+ */
+static int zip_decompress_buffer(ZIPfileinfo *finfo, void *out,
+                                 const size_t outlen)
+{
+    PHYSFS_uint8 *ptr = (PHYSFS_uint8 *) out;
+    size_t total = 0;
+
+    while (total < outlen)
+    {
+        size_t len = outlen - total;
+        const ZipDecompressResult rc = finfo->decompressor->decompress(finfo, ptr + total, &len);
+        total += len;
+        if (rc == ZIP_DECOMPRESS_ERROR)
+            return 0;
+        else if ((rc == ZIP_DECOMPRESS_FINISHED) || (len == 0))
+            break;
+    } /* while */
+
+    BAIL_IF(total != outlen, PHYSFS_ERR_CORRUPT, 0);
+    return 1;
+} /* zip_decompress_buffer */
+
 /*
  * Read an unsigned 64-bit int and swap to native byte order.
  */
@@ -280,61 +999,381 @@ static int readui64(PHYSFS_Io *io, PHYSFS_uint64 *val)
     return 1;
 } /* readui64 */
 
-/*
- * Read an unsigned 32-bit int and swap to native byte order.
- */
-static int readui32(PHYSFS_Io *io, PHYSFS_uint32 *val)
+/*
+ * Read an unsigned 32-bit int and swap to native byte order.
+ */
+static int readui32(PHYSFS_Io *io, PHYSFS_uint32 *val)
+{
+    PHYSFS_uint32 v;
+    BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, &v, sizeof (v)), 0);
+    *val = PHYSFS_swapULE32(v);
+    return 1;
+} /* readui32 */
+
+
+/*
+ * Read an unsigned 16-bit int and swap to native byte order.
+ */
+static int readui16(PHYSFS_Io *io, PHYSFS_uint16 *val)
+{
+    PHYSFS_uint16 v;
+    BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, &v, sizeof (v)), 0);
+    *val = PHYSFS_swapULE16(v);
+    return 1;
+} /* readui16 */
+
+
+/*
+ * CRC-32 of uncompressed data, to check entries against when the app has
+ *  asked for that with PHYSFS_setChecksumVerification(). This has to keep
+ *  up with the decompressors, so it's libdeflate's (which uses PCLMULQDQ
+ *  and friends when the CPU has them) if we have it, the ARMv8 CRC32
+ *  instructions if the compiler targets them, and slice-by-16 otherwise,
+ *  with PCLMULQDQ folding for the bulk of it on x86 CPUs that have it.
+ *  Works like zlib's crc32(): start with zero and feed the result back in.
+ */
+#if ZIP_CRC32_LIBDEFLATE
+static void zip_crc32_init(void) {}
+static PHYSFS_uint32 zip_crc32(PHYSFS_uint32 crc, const PHYSFS_uint8 *buf, size_t len)
+{
+    return (PHYSFS_uint32) libdeflate_crc32(crc, buf, len);
+} /* zip_crc32 */
+
+#elif ZIP_CRC32_ARM
+static void zip_crc32_init(void) {}
+static PHYSFS_uint32 zip_crc32(PHYSFS_uint32 crc, const PHYSFS_uint8 *buf, size_t len)
+{
+    crc = ~crc;
+    while (len >= 8)
+    {
+        PHYSFS_uint64 val;
+        memcpy(&val, buf, sizeof (val));
+        crc = __crc32d(crc, val);
+        buf += 8;
+        len -= 8;
+    } /* while */
+
+    while (len-- > 0)
+        crc = __crc32b(crc, *(buf++));
+
+    return ~crc;
+} /* zip_crc32 */
+
+#else
+static PHYSFS_uint32 zip_crc32_table[16][256];
+static int zip_crc32_table_ready = 0;
+
+#if ZIP_CRC32_PCLMUL
+static int zip_crc32_have_pclmul = 0;
+
+/*
+ * Carry-less multiplication folding, from Intel's "Fast CRC Computation for
+ *  Generic Polynomials Using PCLMULQDQ Instruction" paper. (len) must be at
+ *  least 64 and a multiple of 16, and (crc) is the inverted, in-progress
+ *  value, not what zip_crc32() takes and returns.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static PHYSFS_uint32 zip_crc32_pclmul(PHYSFS_uint32 crc, const PHYSFS_uint8 *buf, size_t len)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596LL, 0x0154442BD4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009ELL, 0x01751997D0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163CD6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01F7011641LL, 0x01DB710641LL);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128((const __m128i *) (buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *) (buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *) (buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *) (buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+    buf += 64;
+    len -= 64;
+
+    /* fold four 128-bit lanes at a time... */
+    x0 = k1k2;
+    while (len >= 64)
+    {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *) (buf + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *) (buf + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *) (buf + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *) (buf + 0x30)));
+        buf += 64;
+        len -= 64;
+    } /* while */
+
+    /* ...then the four lanes down into one... */
+    x0 = k3k4;
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* ...fold in anything left over, 128 bits at a time... */
+    while (len >= 16)
+    {
+        x2 = _mm_loadu_si128((const __m128i *) buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    } /* while */
+
+    /* ...reduce 128 bits to 64... */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* ...and Barrett reduction down to the final 32. */
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (PHYSFS_uint32) _mm_extract_epi32(x1, 1);
+} /* zip_crc32_pclmul */
+#endif
+
+/* Only called while holding the state lock (from opening a file). */
+static void zip_crc32_init(void)
+{
+    PHYSFS_uint32 i, j;
+
+    if (zip_crc32_table_ready)
+        return;
+
+    for (i = 0; i < 256; i++)
+    {
+        PHYSFS_uint32 crc = i;
+        for (j = 0; j < 8; j++)
+            crc = (crc & 1) ? (0xEDB88320 ^ (crc >> 1)) : (crc >> 1);
+        zip_crc32_table[0][i] = crc;
+    } /* for */
+
+    for (i = 0; i < 256; i++)
+    {
+        for (j = 1; j < 16; j++)
+        {
+            const PHYSFS_uint32 prev = zip_crc32_table[j - 1][i];
+            zip_crc32_table[j][i] = (prev >> 8) ^ zip_crc32_table[0][prev & 0xFF];
+        } /* for */
+    } /* for */
+
+    #if ZIP_CRC32_PCLMUL
+    zip_crc32_have_pclmul = __builtin_cpu_supports("pclmul") &&
+                            __builtin_cpu_supports("sse4.1");
+    #endif
+
+    zip_crc32_table_ready = 1;
+} /* zip_crc32_init */
+
+static PHYSFS_uint32 zip_crc32(PHYSFS_uint32 crc, const PHYSFS_uint8 *buf, size_t len)
+{
+    PHYSFS_uint32 (*t)[256] = zip_crc32_table;
+
+    crc = ~crc;
+
+    #if ZIP_CRC32_PCLMUL
+    if ((zip_crc32_have_pclmul) && (len >= 64))
+    {
+        const size_t chunk = len & ~((size_t) 15);
+        crc = zip_crc32_pclmul(crc, buf, chunk);
+        buf += chunk;
+        len -= chunk;
+    } /* if */
+    #endif
+
+    while (len >= 16)
+    {
+        crc ^= ((PHYSFS_uint32) buf[0]) | (((PHYSFS_uint32) buf[1]) << 8) |
+               (((PHYSFS_uint32) buf[2]) << 16) | (((PHYSFS_uint32) buf[3]) << 24);
+        crc = t[15][crc & 0xFF] ^ t[14][(crc >> 8) & 0xFF] ^
+              t[13][(crc >> 16) & 0xFF] ^ t[12][crc >> 24] ^
+              t[11][buf[4]] ^ t[10][buf[5]] ^ t[9][buf[6]] ^ t[8][buf[7]] ^
+              t[7][buf[8]] ^ t[6][buf[9]] ^ t[5][buf[10]] ^ t[4][buf[11]] ^
+              t[3][buf[12]] ^ t[2][buf[13]] ^ t[1][buf[14]] ^ t[0][buf[15]];
+        buf += 16;
+        len -= 16;
+    } /* while */
+
+    while (len-- > 0)
+        crc = (crc >> 8) ^ t[0][(crc ^ *(buf++)) & 0xFF];
+
+    return ~crc;
+} /* zip_crc32 */
+#endif
+
+
+/*
+ * Fold (len) bytes just read from uncompressed offset (pos) into the
+ *  running CRC if they're the next ones it needs, and check it once the
+ *  whole entry has been covered. Bytes we seek past without reading are
+ *  picked up if a later backwards seek rereads them. Returns (len), or -1
+ *  with PHYSFS_ERR_CORRUPT if the data doesn't match the entry's CRC.
+ */
+static PHYSFS_sint64 zip_check_crc(ZIPfileinfo *finfo, const void *buf,
+                                   const PHYSFS_uint32 pos,
+                                   const PHYSFS_sint64 len)
+{
+    const PHYSFS_uint32 end = pos + (PHYSFS_uint32) len;
+
+    if ((!finfo->verify_crc) || (len <= 0))
+        return len;
+    else if ((pos > finfo->crc_position) || (end <= finfo->crc_position))
+        return len;
+
+    finfo->crc = zip_crc32(finfo->crc,
+                           ((const PHYSFS_uint8 *) buf) + (finfo->crc_position - pos),
+                           (size_t) (end - finfo->crc_position));
+    finfo->crc_position = end;
+
+    if (end == finfo->uncompressed_size)
+        BAIL_IF(finfo->crc != finfo->entry->crc, PHYSFS_ERR_CORRUPT, -1);
+
+    return len;
+} /* zip_check_crc */
+
+
+/* Put (finfo) back at the start of the entry, ready to decode it again. */
+static int zip_rewind(ZIPfileinfo *finfo)
 {
-    PHYSFS_uint32 v;
-    BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, &v, sizeof (v)), 0);
-    *val = PHYSFS_swapULE32(v);
+    const ZIPdecompressor *decomp = finfo->decompressor;
+    const int encrypted = zip_entry_is_tradional_crypto(finfo->entry);
+    PHYSFS_Io *io = finfo->io;
+
+    if ((decomp != NULL) && (!decomp->reset(finfo)))
+        return 0;
+
+    BAIL_IF_ERRPASS(!io->seek(io, finfo->offset + (encrypted ? 12 : 0)), 0);
+
+    finfo->uncompressed_position = finfo->compressed_position = 0;
+    finfo->next_in = finfo->buffer;
+    finfo->avail_in = 0;
+
+    if (encrypted)
+        memcpy(finfo->crypto_keys, finfo->initial_crypto_keys, 12);
+
     return 1;
-} /* readui32 */
+} /* zip_rewind */
 
 
 /*
- * Read an unsigned 16-bit int and swap to native byte order.
+ * The app wants the whole entry in one read (a common "load this asset"
+ *  pattern), so pull all the compressed data in with a single read and
+ *  decode it in one shot, instead of ZIP_READBUFSIZE chunks at a time.
+ *  Returns 1 on success, 0 on error, and -1 if we couldn't get the memory
+ *  and the caller should stream instead.
  */
-static int readui16(PHYSFS_Io *io, PHYSFS_uint16 *val)
+static int zip_read_whole_entry(ZIPfileinfo *finfo, void *buf)
 {
-    PHYSFS_uint16 v;
-    BAIL_IF_ERRPASS(!__PHYSFS_readAll(io, &v, sizeof (v)), 0);
-    *val = PHYSFS_swapULE16(v);
+    const ZIPdecompressor *decomp = finfo->decompressor;
+    const PHYSFS_uint64 hdrlen = zip_entry_is_tradional_crypto(finfo->entry) ? 12 : 0;
+    const PHYSFS_uint64 complen = finfo->compressed_size - hdrlen;
+    const size_t outlen = (size_t) finfo->uncompressed_size;
+    PHYSFS_uint8 *compressed;
+    int rc;
+
+    if ((finfo->compressed_size < hdrlen) ||
+        (!__PHYSFS_ui64FitsAddressSpace(complen)))
+        return -1;
+
+    compressed = (PHYSFS_uint8 *) allocator.Malloc((size_t) (complen ? complen : 1));
+    if (!compressed)
+        return -1;  /* not an error, just go the slow way. */
+
+    rc = (zip_read_decrypt(finfo, compressed, complen) == (PHYSFS_sint64) complen);
+    if (rc)
+    {
+        if (decomp->decompress_all != NULL)
+            rc = decomp->decompress_all(compressed, (size_t) complen, buf, outlen);
+        else
+        {
+            finfo->next_in = compressed;
+            finfo->avail_in = (size_t) complen;
+            rc = zip_decompress_buffer(finfo, buf, outlen);
+            finfo->next_in = finfo->buffer;
+            finfo->avail_in = 0;
+        } /* else */
+    } /* if */
+
+    allocator.Free(compressed);
+
+    if (!rc)
+    {
+        /* we've eaten the compressed data, so start over for the next
+           read, but keep the error from the failed decode. */
+        const PHYSFS_ErrorCode err = PHYSFS_getLastErrorCode();
+        zip_rewind(finfo);
+        PHYSFS_setErrorCode((err != PHYSFS_ERR_OK) ? err : PHYSFS_ERR_CORRUPT);
+        return 0;
+    } /* if */
+
+    /* the streaming state is stale now, but we're at EOF, so only a
+       backwards seek can use it again, and that resets it first. */
+    finfo->compressed_position = (PHYSFS_uint32) finfo->compressed_size;
+    finfo->uncompressed_position = (PHYSFS_uint32) finfo->uncompressed_size;
+
     return 1;
-} /* readui16 */
+} /* zip_read_whole_entry */
 
 
 static PHYSFS_sint64 ZIP_read(PHYSFS_Io *_io, void *buf, PHYSFS_uint64 len)
 {
     ZIPfileinfo *finfo = (ZIPfileinfo *) _io->opaque;
-    ZIPentry *entry = finfo->entry;
     PHYSFS_sint64 retval = 0;
     PHYSFS_sint64 maxread = (PHYSFS_sint64) len;
-    PHYSFS_sint64 avail = entry->uncompressed_size -
+    PHYSFS_sint64 avail = finfo->uncompressed_size -
                           finfo->uncompressed_position;
+    const PHYSFS_uint32 startpos = finfo->uncompressed_position;
+    int whole = -1;
 
     if (avail < maxread)
         maxread = avail;
 
     BAIL_IF_ERRPASS(maxread == 0, 0);    /* quick rejection. */
 
-    if (entry->compression_method == COMPMETH_NONE)
+    if (finfo->decompressor == NULL)
         retval = zip_read_decrypt(finfo, buf, maxread);
+    else if ((finfo->uncompressed_position == 0) &&
+             (finfo->compressed_position == 0) &&
+             (((PHYSFS_uint64) maxread) == finfo->uncompressed_size) &&
+             ((whole = zip_read_whole_entry(finfo, buf)) != -1))
+    {
+        /* whole thing in one shot. */
+        BAIL_IF_ERRPASS(!whole, -1);
+        return zip_check_crc(finfo, buf, startpos, maxread);
+    } /* else if */
     else
     {
-        finfo->stream.next_out = buf;
-        finfo->stream.avail_out = (uInt) maxread;
+        PHYSFS_uint8 *out = (PHYSFS_uint8 *) buf;
 
         while (retval < maxread)
         {
-            const PHYSFS_uint32 before = (PHYSFS_uint32) finfo->stream.total_out;
-            int rc;
+            size_t outlen = (size_t) (maxread - retval);
+            ZipDecompressResult rc;
 
-            if (finfo->stream.avail_in == 0)
+            if (finfo->avail_in == 0)
             {
                 PHYSFS_sint64 br;
 
-                br = entry->compressed_size - finfo->compressed_position;
+                br = finfo->compressed_size - finfo->compressed_position;
                 if (br > 0)
                 {
                     if (br > ZIP_READBUFSIZE)
@@ -345,23 +1384,31 @@ static PHYSFS_sint64 ZIP_read(PHYSFS_Io *_io, void *buf, PHYSFS_uint64 len)
                         break;
 
                     finfo->compressed_position += (PHYSFS_uint32) br;
-                    finfo->stream.next_in = finfo->buffer;
-                    finfo->stream.avail_in = (unsigned int) br;
+                    finfo->next_in = finfo->buffer;
+                    finfo->avail_in = (size_t) br;
                 } /* if */
             } /* if */
 
-            rc = zlib_err(inflate(&finfo->stream, Z_SYNC_FLUSH));
-            retval += (finfo->stream.total_out - before);
+            rc = finfo->decompressor->decompress(finfo, out + retval, &outlen);
+            retval += (PHYSFS_sint64) outlen;
+
+            if (rc != ZIP_DECOMPRESS_OK)
+                break;
 
-            if (rc != Z_OK)
+            /* out of compressed data and the decoder is stuck? Truncated. */
+            else if ((outlen == 0) && (finfo->avail_in == 0) &&
+                     (finfo->compressed_position >= finfo->compressed_size))
+            {
+                PHYSFS_setErrorCode(PHYSFS_ERR_CORRUPT);
                 break;
+            } /* else if */
         } /* while */
     } /* else */
 
     if (retval > 0)
         finfo->uncompressed_position += (PHYSFS_uint32) retval;
 
-    return retval;
+    return zip_check_crc(finfo, buf, startpos, retval);
 } /* ZIP_read */
 
 
@@ -380,15 +1427,14 @@ static PHYSFS_sint64 ZIP_tell(PHYSFS_Io *io)
 static int ZIP_seek(PHYSFS_Io *_io, PHYSFS_uint64 offset)
 {
     ZIPfileinfo *finfo = (ZIPfileinfo *) _io->opaque;
-    ZIPentry *entry = finfo->entry;
     PHYSFS_Io *io = finfo->io;
-    const int encrypted = zip_entry_is_tradional_crypto(entry);
+    const int encrypted = zip_entry_is_tradional_crypto(finfo->entry);
 
-    BAIL_IF(offset > entry->uncompressed_size, PHYSFS_ERR_PAST_EOF, 0);
+    BAIL_IF(offset > finfo->uncompressed_size, PHYSFS_ERR_PAST_EOF, 0);
 
-    if (!encrypted && (entry->compression_method == COMPMETH_NONE))
+    if (!encrypted && (finfo->decompressor == NULL))
     {
-        PHYSFS_sint64 newpos = offset + entry->offset;
+        PHYSFS_sint64 newpos = offset + finfo->offset;
         BAIL_IF_ERRPASS(!io->seek(io, newpos), 0);
         finfo->uncompressed_position = (PHYSFS_uint32) offset;
     } /* if */
@@ -403,21 +1449,8 @@ static int ZIP_seek(PHYSFS_Io *_io, PHYSFS_uint64 offset)
          */
         if (offset < finfo->uncompressed_position)
         {
-            /* we do a copy so state is sane if inflateInit2() fails. */
-            z_stream str;
-            initializeZStream(&str);
-            if (zlib_err(inflateInit2(&str, -MAX_WBITS)) != Z_OK)
-                return 0;
-
-            if (!io->seek(io, entry->offset + (encrypted ? 12 : 0)))
+            if (!zip_rewind(finfo))
                 return 0;
-
-            inflateEnd(&finfo->stream);
-            memcpy(&finfo->stream, &str, sizeof (z_stream));
-            finfo->uncompressed_position = finfo->compressed_position = 0;
-
-            if (encrypted)
-                memcpy(finfo->crypto_keys, finfo->initial_crypto_keys, 12);
         } /* if */
 
         while (finfo->uncompressed_position != offset)
@@ -441,52 +1474,161 @@ static int ZIP_seek(PHYSFS_Io *_io, PHYSFS_uint64 offset)
 static PHYSFS_sint64 ZIP_length(PHYSFS_Io *io)
 {
     const ZIPfileinfo *finfo = (ZIPfileinfo *) io->opaque;
-    return (PHYSFS_sint64) finfo->entry->uncompressed_size;
+    return (PHYSFS_sint64) finfo->uncompressed_size;
 } /* ZIP_length */
 
 
-static PHYSFS_Io *zip_get_io(PHYSFS_Io *io, ZIPinfo *inf, ZIPentry *entry);
+static void zip_free_fileinfo(ZIPfileinfo *finfo)
+{
+    if (finfo->decompressor != NULL)
+        finfo->decompressor->deinit(finfo);
+
+    if (finfo->buffer != NULL)
+        allocator.Free(finfo->buffer);
+
+    allocator.Free(finfo);
+} /* zip_free_fileinfo */
+
+
+/*
+ * Get a ZIPfileinfo that's ready to decompress (entry), from (info)'s pool
+ *  if one with the right decompressor is there, or a new one otherwise.
+ *  The caller still has to set up (io) and any crypto state.
+ */
+static ZIPfileinfo *zip_alloc_fileinfo(ZIPinfo *info, ZIPentry *entry)
+{
+    const ZIPdecompressor *decomp = NULL;
+    ZIPfileinfo *finfo = NULL;
+
+    if (entry->compression_method != COMPMETH_NONE)
+    {
+        decomp = zip_find_decompressor(entry->compression_method);
+        BAIL_IF_ERRPASS(!decomp, NULL);
+    } /* if */
+
+    if (info->poollock != NULL)
+    {
+        ZIPfileinfo *prev = NULL;
+        __PHYSFS_platformGrabMutex(info->poollock);
+        for (finfo = info->pool; finfo != NULL; finfo = finfo->next_pooled)
+        {
+            if (finfo->decompressor == decomp)
+            {
+                if (prev == NULL)
+                    info->pool = finfo->next_pooled;
+                else
+                    prev->next_pooled = finfo->next_pooled;
+                info->poolcount--;
+                break;
+            } /* if */
+            prev = finfo;
+        } /* for */
+        __PHYSFS_platformReleaseMutex(info->poollock);
+    } /* if */
+
+    if (finfo != NULL)
+    {
+        finfo->next_pooled = NULL;
+        finfo->entry = entry;
+        finfo->offset = zip_entry_offset(info, entry);
+        finfo->compressed_size = zip_entry_compressed_size(info, entry);
+        finfo->uncompressed_size = zip_entry_uncompressed_size(info, entry);
+        finfo->compressed_position = 0;
+        finfo->uncompressed_position = 0;
+        finfo->next_in = finfo->buffer;
+        finfo->avail_in = 0;
+        memset(finfo->crypto_keys, '\0', sizeof (finfo->crypto_keys));
+        memset(finfo->initial_crypto_keys, '\0', sizeof (finfo->initial_crypto_keys));
+        finfo->crc = 0;
+        finfo->crc_position = 0;
+        if ((decomp != NULL) && (!decomp->reset(finfo)))
+        {
+            zip_free_fileinfo(finfo);
+            return NULL;
+        } /* if */
+        return finfo;
+    } /* if */
+
+    finfo = (ZIPfileinfo *) allocator.Malloc(sizeof (ZIPfileinfo));
+    BAIL_IF(!finfo, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    memset(finfo, '\0', sizeof (ZIPfileinfo));
+    finfo->info = info;
+    finfo->entry = entry;
+    finfo->offset = zip_entry_offset(info, entry);
+    finfo->compressed_size = zip_entry_compressed_size(info, entry);
+    finfo->uncompressed_size = zip_entry_uncompressed_size(info, entry);
+
+    if (decomp != NULL)
+    {
+        finfo->buffer = (PHYSFS_uint8 *) allocator.Malloc(ZIP_READBUFSIZE);
+        if (!finfo->buffer)
+        {
+            allocator.Free(finfo);
+            BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+        } /* if */
+        else if (!decomp->init(finfo))
+        {
+            zip_free_fileinfo(finfo);
+            return NULL;
+        } /* else if */
+        finfo->decompressor = decomp;
+    } /* if */
+
+    return finfo;
+} /* zip_alloc_fileinfo */
+
+
+/* Give (finfo) back to its archive's pool, or free it if the pool is full. */
+static void zip_release_fileinfo(ZIPfileinfo *finfo)
+{
+    ZIPinfo *info = finfo->info;
+
+    if (finfo->io != NULL)
+    {
+        finfo->io->destroy(finfo->io);
+        finfo->io = NULL;
+    } /* if */
+
+    if (info->poollock != NULL)
+    {
+        __PHYSFS_platformGrabMutex(info->poollock);
+        if (info->poolcount < ZIP_FILEINFO_POOLSIZE)
+        {
+            finfo->next_pooled = info->pool;
+            info->pool = finfo;
+            info->poolcount++;
+            finfo = NULL;
+        } /* if */
+        __PHYSFS_platformReleaseMutex(info->poollock);
+    } /* if */
+
+    if (finfo != NULL)
+        zip_free_fileinfo(finfo);
+} /* zip_release_fileinfo */
+
+
+static PHYSFS_Io *zip_get_io(PHYSFS_Io *io, const ZIPfileinfo *finfo);
 
 static PHYSFS_Io *ZIP_duplicate(PHYSFS_Io *io)
 {
     ZIPfileinfo *origfinfo = (ZIPfileinfo *) io->opaque;
     PHYSFS_Io *retval = (PHYSFS_Io *) allocator.Malloc(sizeof (PHYSFS_Io));
-    ZIPfileinfo *finfo = (ZIPfileinfo *) allocator.Malloc(sizeof (ZIPfileinfo));
+    ZIPfileinfo *finfo = NULL;
     GOTO_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, failed);
-    GOTO_IF(!finfo, PHYSFS_ERR_OUT_OF_MEMORY, failed);
-    memset(finfo, '\0', sizeof (*finfo));
 
-    finfo->entry = origfinfo->entry;
-    finfo->io = zip_get_io(origfinfo->io, NULL, finfo->entry);
+    finfo = zip_alloc_fileinfo(origfinfo->info, origfinfo->entry);
+    GOTO_IF_ERRPASS(!finfo, failed);
+    finfo->verify_crc = origfinfo->verify_crc;
+    finfo->io = zip_get_io(origfinfo->io, finfo);
     GOTO_IF_ERRPASS(!finfo->io, failed);
 
-    initializeZStream(&finfo->stream);
-    if (finfo->entry->compression_method != COMPMETH_NONE)
-    {
-        finfo->buffer = (PHYSFS_uint8 *) allocator.Malloc(ZIP_READBUFSIZE);
-        GOTO_IF(!finfo->buffer, PHYSFS_ERR_OUT_OF_MEMORY, failed);
-        if (zlib_err(inflateInit2(&finfo->stream, -MAX_WBITS)) != Z_OK)
-            goto failed;
-    } /* if */
-
     memcpy(retval, io, sizeof (PHYSFS_Io));
     retval->opaque = finfo;
     return retval;
 
 failed:
     if (finfo != NULL)
-    {
-        if (finfo->io != NULL)
-            finfo->io->destroy(finfo->io);
-
-        if (finfo->buffer != NULL)
-        {
-            allocator.Free(finfo->buffer);
-            inflateEnd(&finfo->stream);
-        } /* if */
-
-        allocator.Free(finfo);
-    } /* if */
+        zip_release_fileinfo(finfo);
 
     if (retval != NULL)
         allocator.Free(retval);
@@ -498,16 +1640,7 @@ static int ZIP_flush(PHYSFS_Io *io) { return 1;  /* no write support. */ }
 
 static void ZIP_destroy(PHYSFS_Io *io)
 {
-    ZIPfileinfo *finfo = (ZIPfileinfo *) io->opaque;
-    finfo->io->destroy(finfo->io);
-
-    if (finfo->entry->compression_method != COMPMETH_NONE)
-        inflateEnd(&finfo->stream);
-
-    if (finfo->buffer != NULL)
-        allocator.Free(finfo->buffer);
-
-    allocator.Free(finfo);
+    zip_release_fileinfo((ZIPfileinfo *) io->opaque);
     allocator.Free(io);
 } /* ZIP_destroy */
 
@@ -753,7 +1886,7 @@ static ZIPentry *zip_follow_symlink(PHYSFS_Io *io, ZIPinfo *info, char *path)
 
 static int zip_resolve_symlink(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
 {
-    const size_t size = (size_t) entry->uncompressed_size;
+    const size_t size = (size_t) zip_entry_uncompressed_size(info, entry);
     char *path = NULL;
     int rc = 0;
 
@@ -763,7 +1896,7 @@ static int zip_resolve_symlink(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
      *  follow it.
      */
 
-    BAIL_IF_ERRPASS(!io->seek(io, entry->offset), 0);
+    BAIL_IF_ERRPASS(!io->seek(io, zip_entry_offset(info, entry)), 0);
 
     path = (char *) __PHYSFS_smallAlloc(size + 1);
     BAIL_IF(!path, PHYSFS_ERR_OUT_OF_MEMORY, 0);
@@ -773,35 +1906,37 @@ static int zip_resolve_symlink(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
 
     else  /* symlink target path is compressed... */
     {
-        z_stream stream;
-        const size_t complen = (size_t) entry->compressed_size;
+        ZIPfileinfo finfo;
+        const size_t complen = (size_t) zip_entry_compressed_size(info, entry);
         PHYSFS_uint8 *compressed = (PHYSFS_uint8*) __PHYSFS_smallAlloc(complen);
-        if (compressed != NULL)
+        memset(&finfo, '\0', sizeof (finfo));
+        finfo.entry = entry;
+        finfo.compressed_size = complen;
+        finfo.uncompressed_size = size;
+        finfo.decompressor = zip_find_decompressor(entry->compression_method);
+        if ((compressed != NULL) && (finfo.decompressor != NULL))
         {
             if (__PHYSFS_readAll(io, compressed, complen))
             {
-                initializeZStream(&stream);
-                stream.next_in = compressed;
-                stream.avail_in = (unsigned int) complen;
-                stream.next_out = (unsigned char *) path;
-                stream.avail_out = (unsigned int) size;
-                if (zlib_err(inflateInit2(&stream, -MAX_WBITS)) == Z_OK)
+                finfo.next_in = compressed;
+                finfo.avail_in = complen;
+                if (finfo.decompressor->init(&finfo))
                 {
-                    rc = zlib_err(inflate(&stream, Z_FINISH));
-                    inflateEnd(&stream);
-
-                    /* both are acceptable outcomes... */
-                    rc = ((rc == Z_OK) || (rc == Z_STREAM_END));
+                    rc = zip_decompress_buffer(&finfo, path, size);
+                    finfo.decompressor->deinit(&finfo);
                 } /* if */
             } /* if */
-            __PHYSFS_smallFree(compressed);
         } /* if */
+
+        if (compressed != NULL)
+            __PHYSFS_smallFree(compressed);
     } /* else */
 
     if (rc)
     {
-        path[entry->uncompressed_size] = '\0';    /* null-terminate it. */
-        zip_convert_dos_path(entry->version, path);
+        /* no zip_convert_dos_path() here: only entries from hosts that
+           do symlinks are treated as symlinks, and those aren't DOS. */
+        path[size] = '\0';    /* null-terminate it. */
         entry->symlink = zip_follow_symlink(io, info, path);
     } /* else */
 
@@ -814,7 +1949,7 @@ static int zip_resolve_symlink(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
 /*
  * Parse the local file header of an entry, and update entry->offset.
  */
-static int zip_parse_local(PHYSFS_Io *io, ZIPentry *entry)
+static int zip_parse_local(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
 {
     PHYSFS_uint32 ui32;
     PHYSFS_uint16 ui16;
@@ -834,14 +1969,10 @@ static int zip_parse_local(PHYSFS_Io *io, ZIPentry *entry)
        !!! FIXME:  which is probably true for Jar files, fwiw, but we don't
        !!! FIXME:  care about these values anyhow. */
 
-    BAIL_IF_ERRPASS(!io->seek(io, entry->offset), 0);
+    BAIL_IF_ERRPASS(!io->seek(io, zip_entry_offset(info, entry)), 0);
     BAIL_IF_ERRPASS(!readui32(io, &ui32), 0);
     BAIL_IF(ui32 != ZIP_LOCAL_FILE_SIG, PHYSFS_ERR_CORRUPT, 0);
-    BAIL_IF_ERRPASS(!readui16(io, &ui16), 0);
-    /* Windows Explorer might rewrite the entire central directory, setting
-       this field to 2.0/MS-DOS for all files, so favor the local version,
-       which it leaves intact if it didn't alter that specific file. */
-    entry->version_needed = ui16;
+    BAIL_IF_ERRPASS(!readui16(io, &ui16), 0);  /* version needed. */
     BAIL_IF_ERRPASS(!readui16(io, &ui16), 0);  /* general bits. */
     BAIL_IF_ERRPASS(!readui16(io, &ui16), 0);
     BAIL_IF(ui16 != entry->compression_method, PHYSFS_ERR_CORRUPT, 0);
@@ -851,16 +1982,20 @@ static int zip_parse_local(PHYSFS_Io *io, ZIPentry *entry)
 
     BAIL_IF_ERRPASS(!readui32(io, &ui32), 0);
     BAIL_IF(ui32 && (ui32 != 0xFFFFFFFF) &&
-                  (ui32 != entry->compressed_size), PHYSFS_ERR_CORRUPT, 0);
+                  (ui32 != zip_entry_compressed_size(info, entry)), PHYSFS_ERR_CORRUPT, 0);
 
     BAIL_IF_ERRPASS(!readui32(io, &ui32), 0);
     BAIL_IF(ui32 && (ui32 != 0xFFFFFFFF) &&
-                 (ui32 != entry->uncompressed_size), PHYSFS_ERR_CORRUPT, 0);
+                 (ui32 != zip_entry_uncompressed_size(info, entry)), PHYSFS_ERR_CORRUPT, 0);
 
     BAIL_IF_ERRPASS(!readui16(io, &fnamelen), 0);
     BAIL_IF_ERRPASS(!readui16(io, &extralen), 0);
 
-    entry->offset += fnamelen + extralen + 30;
+    /* zip_load_entry() made sure this can't overflow a narrow entry. */
+    if (entry->flags & ZIP_ENTRY_WIDE)
+        info->wide[entry->offset].offset += fnamelen + extralen + 30;
+    else
+        entry->offset += fnamelen + extralen + 30;
     return 1;
 } /* zip_parse_local */
 
@@ -868,7 +2003,7 @@ static int zip_parse_local(PHYSFS_Io *io, ZIPentry *entry)
 static int zip_resolve(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
 {
     int retval = 1;
-    const ZipResolveType resolve_type = entry->resolved;
+    const ZipResolveType resolve_type = zip_entry_resolved(entry);
 
     if (resolve_type == ZIP_DIRECTORY)
         return 1;   /* we're good. */
@@ -891,11 +2026,11 @@ static int zip_resolve(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
     {
         if (entry->tree.isdir)  /* an ancestor dir that DirTree filled in? */
         {
-            entry->resolved = ZIP_DIRECTORY;
+            zip_entry_set_resolved(entry, ZIP_DIRECTORY);
             return 1;
         } /* if */
 
-        retval = zip_parse_local(io, entry);
+        retval = zip_parse_local(io, info, entry);
         if (retval)
         {
             /*
@@ -908,9 +2043,9 @@ static int zip_resolve(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
         } /* if */
 
         if (resolve_type == ZIP_UNRESOLVED_SYMLINK)
-            entry->resolved = ((retval) ? ZIP_RESOLVED : ZIP_BROKEN_SYMLINK);
+            zip_entry_set_resolved(entry, (retval) ? ZIP_RESOLVED : ZIP_BROKEN_SYMLINK);
         else if (resolve_type == ZIP_UNRESOLVED_FILE)
-            entry->resolved = ((retval) ? ZIP_RESOLVED : ZIP_BROKEN_FILE);
+            zip_entry_set_resolved(entry, (retval) ? ZIP_RESOLVED : ZIP_BROKEN_FILE);
     } /* if */
 
     return retval;
@@ -919,8 +2054,9 @@ static int zip_resolve(PHYSFS_Io *io, ZIPinfo *info, ZIPentry *entry)
 
 static int zip_entry_is_symlink(const ZIPentry *entry)
 {
-    return ((entry->resolved == ZIP_UNRESOLVED_SYMLINK) ||
-            (entry->resolved == ZIP_BROKEN_SYMLINK) ||
+    const ZipResolveType resolve_type = zip_entry_resolved(entry);
+    return ((resolve_type == ZIP_UNRESOLVED_SYMLINK) ||
+            (resolve_type == ZIP_BROKEN_SYMLINK) ||
             (entry->symlink));
 } /* zip_entry_is_symlink */
 
@@ -957,12 +2093,13 @@ static int zip_version_does_symlinks(PHYSFS_uint32 version)
 } /* zip_version_does_symlinks */
 
 
-static inline int zip_has_symlink_attr(const ZIPentry *entry,
+static inline int zip_has_symlink_attr(const PHYSFS_uint16 version,
+                                       const PHYSFS_uint64 uncompressed_size,
                                        const PHYSFS_uint32 extern_attr)
 {
     PHYSFS_uint16 xattr = ((extern_attr >> 16) & 0xFFFF);
-    return ( (zip_version_does_symlinks(entry->version)) &&
-             (entry->uncompressed_size > 0) &&
+    return ( (zip_version_does_symlinks(version)) &&
+             (uncompressed_size > 0) &&
              ((xattr & UNIX_FILETYPE_MASK) == UNIX_FILETYPE_SYMLINK) );
 } /* zip_has_symlink_attr */
 
@@ -993,12 +2130,86 @@ static PHYSFS_sint64 zip_dos_time_to_physfs_time(PHYSFS_uint32 dostime)
 } /* zip_dos_time_to_physfs_time */
 
 
+/*
+ * Entries keep their MS-DOS timestamp and convert it when stat'd. mktime()
+ *  is slow, though, and archives rarely span more than a few days, so
+ *  remember where each date starts and add the time of day to that, unless
+ *  daylight savings time starts or ends on that date.
+ */
+static PHYSFS_sint64 zip_mod_time(ZIPinfo *info, const PHYSFS_uint32 dostime)
+{
+    const PHYSFS_uint32 dosdate = (dostime >> 16) & 0xFFFF;
+    ZIPday *day = &info->days[dosdate % ZIP_DAY_CACHE_SIZE];
+
+    if (day->dosdate != dosdate + 1)
+    {
+        /* 0xBF7D is 23:59:58, the last time MS-DOS can express. */
+        const PHYSFS_sint64 start = zip_dos_time_to_physfs_time(dosdate << 16);
+        const PHYSFS_sint64 end = zip_dos_time_to_physfs_time((dosdate << 16) | 0xBF7D);
+        day->dosdate = dosdate + 1;
+        day->start = ((end - start) == 86398) ? start : -1;
+    } /* if */
+
+    if (day->start == -1)
+        return zip_dos_time_to_physfs_time(dostime);
+
+    return day->start + (((dostime >> 11) & 0x1F) * 3600) +
+                        (((dostime >> 5) & 0x3F) * 60) +
+                        ((dostime << 1) & 0x3E);
+} /* zip_mod_time */
+
+
+/*
+ * Store (entry)'s offset and sizes, in (info)'s wide list if they don't fit
+ *  in 32 bits. zip_parse_local() will add the local header's length to the
+ *  offset later, so leave room for the biggest one that can be.
+ */
+static int zip_entry_set_values(ZIPinfo *info, ZIPentry *entry,
+                                const PHYSFS_uint64 offset,
+                                const PHYSFS_uint64 compressed_size,
+                                const PHYSFS_uint64 uncompressed_size)
+{
+    const PHYSFS_uint64 maxoffset = 0xFFFFFFFF - (30 + 0xFFFF + 0xFFFF);
+    ZIPwideentry *wide;
+
+    if ( (offset <= maxoffset) &&
+         (compressed_size <= 0xFFFFFFFF) &&
+         (uncompressed_size <= 0xFFFFFFFF) )
+    {
+        entry->offset = (PHYSFS_uint32) offset;
+        entry->compressed_size = (PHYSFS_uint32) compressed_size;
+        entry->uncompressed_size = (PHYSFS_uint32) uncompressed_size;
+        return 1;
+    } /* if */
+
+    if (info->widecount == info->widealloc)
+    {
+        const PHYSFS_uint32 newalloc = info->widealloc ? info->widealloc * 2 : 16;
+        void *ptr = allocator.Realloc(info->wide, newalloc * sizeof (ZIPwideentry));
+        BAIL_IF(!ptr, PHYSFS_ERR_OUT_OF_MEMORY, 0);
+        info->wide = (ZIPwideentry *) ptr;
+        info->widealloc = newalloc;
+    } /* if */
+
+    wide = &info->wide[info->widecount];
+    wide->offset = offset;
+    wide->compressed_size = compressed_size;
+    wide->uncompressed_size = uncompressed_size;
+    entry->offset = info->widecount++;
+    entry->compressed_size = entry->uncompressed_size = 0;
+    entry->flags |= ZIP_ENTRY_WIDE;
+    return 1;
+} /* zip_entry_set_values */
+
+
 static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
                                 const PHYSFS_uint64 ofs_fixup)
 {
     PHYSFS_Io *io = info->io;
-    ZIPentry entry;
     ZIPentry *retval = NULL;
+    PHYSFS_uint16 version, general_bits, compression_method;
+    PHYSFS_uint32 dos_mod_time, crc;
+    PHYSFS_uint64 compressed_size, uncompressed_size;
     PHYSFS_uint16 fnamelen, extralen, commentlen;
     PHYSFS_uint32 external_attr;
     PHYSFS_uint32 starting_disk;
@@ -1013,20 +2224,17 @@ static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
     BAIL_IF_ERRPASS(!readui32(io, &ui32), NULL);
     BAIL_IF(ui32 != ZIP_CENTRAL_DIR_SIG, PHYSFS_ERR_CORRUPT, NULL);
 
-    memset(&entry, '\0', sizeof (entry));
-
     /* Get the pertinent parts of the record... */
-    BAIL_IF_ERRPASS(!readui16(io, &entry.version), NULL);
-    BAIL_IF_ERRPASS(!readui16(io, &entry.version_needed), NULL);
-    BAIL_IF_ERRPASS(!readui16(io, &entry.general_bits), NULL);  /* general bits */
-    BAIL_IF_ERRPASS(!readui16(io, &entry.compression_method), NULL);
-    BAIL_IF_ERRPASS(!readui32(io, &entry.dos_mod_time), NULL);
-    entry.last_mod_time = zip_dos_time_to_physfs_time(entry.dos_mod_time);
-    BAIL_IF_ERRPASS(!readui32(io, &entry.crc), NULL);
+    BAIL_IF_ERRPASS(!readui16(io, &version), NULL);
+    BAIL_IF_ERRPASS(!readui16(io, &ui16), NULL);  /* version needed */
+    BAIL_IF_ERRPASS(!readui16(io, &general_bits), NULL);  /* general bits */
+    BAIL_IF_ERRPASS(!readui16(io, &compression_method), NULL);
+    BAIL_IF_ERRPASS(!readui32(io, &dos_mod_time), NULL);
+    BAIL_IF_ERRPASS(!readui32(io, &crc), NULL);
     BAIL_IF_ERRPASS(!readui32(io, &ui32), NULL);
-    entry.compressed_size = (PHYSFS_uint64) ui32;
+    compressed_size = (PHYSFS_uint64) ui32;
     BAIL_IF_ERRPASS(!readui32(io, &ui32), NULL);
-    entry.uncompressed_size = (PHYSFS_uint64) ui32;
+    uncompressed_size = (PHYSFS_uint64) ui32;
     BAIL_IF_ERRPASS(!readui16(io, &fnamelen), NULL);
     BAIL_IF_ERRPASS(!readui16(io, &extralen), NULL);
     BAIL_IF_ERRPASS(!readui16(io, &commentlen), NULL);
@@ -1052,7 +2260,7 @@ static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
     } /* if */
     name[fnamelen] = '\0';  /* null-terminate the filename. */
 
-    zip_convert_dos_path(entry.version, name);
+    zip_convert_dos_path(version, name);
 
     retval = (ZIPentry *) __PHYSFS_DirTreeAdd(&info->tree, name, isdir);
     __PHYSFS_smallFree(name);
@@ -1061,21 +2269,26 @@ static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
 
     /* It's okay to BAIL without freeing retval, because it's stored in the
        __PHYSFS_DirTree and will be freed later anyhow. */
-    BAIL_IF(retval->last_mod_time != 0, PHYSFS_ERR_CORRUPT, NULL); /* dupe? */
+    BAIL_IF(retval->flags & ZIP_ENTRY_LOADED, PHYSFS_ERR_CORRUPT, NULL); /* dupe? */
 
     /* Move the data we already read into place in the official object. */
-    memcpy(((PHYSFS_uint8 *) retval) + sizeof (__PHYSFS_DirTreeEntry),
-           ((PHYSFS_uint8 *) &entry) + sizeof (__PHYSFS_DirTreeEntry),
-           sizeof (*retval) - sizeof (__PHYSFS_DirTreeEntry));
-
     retval->symlink = NULL;  /* will be resolved later, if necessary. */
+    retval->crc = crc;
+    retval->dos_mod_time = dos_mod_time;
+    retval->compression_method = compression_method;
+    retval->flags = ZIP_ENTRY_LOADED;
+    if (general_bits & ZIP_GENERAL_BITS_TRADITIONAL_CRYPTO)
+        retval->flags |= ZIP_ENTRY_TRADITIONAL_CRYPTO;
+    if (general_bits & ZIP_GENERAL_BITS_IGNORE_LOCAL_HEADER)
+        retval->flags |= ZIP_ENTRY_IGNORE_LOCAL_HEADER;
 
     if (isdir)
-        retval->resolved = ZIP_DIRECTORY;
+        zip_entry_set_resolved(retval, ZIP_DIRECTORY);
     else
     {
-        retval->resolved = (zip_has_symlink_attr(retval, external_attr)) ?
-                                ZIP_UNRESOLVED_SYMLINK : ZIP_UNRESOLVED_FILE;
+        zip_entry_set_resolved(retval,
+            zip_has_symlink_attr(version, uncompressed_size, external_attr) ?
+                                ZIP_UNRESOLVED_SYMLINK : ZIP_UNRESOLVED_FILE);
     } /* else */
 
     si64 = io->tell(io);
@@ -1086,8 +2299,8 @@ static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
     if ( (zip64) &&
          ((offset == 0xFFFFFFFF) ||
           (starting_disk == 0xFFFFFFFF) ||
-          (retval->compressed_size == 0xFFFFFFFF) ||
-          (retval->uncompressed_size == 0xFFFFFFFF)) )
+          (compressed_size == 0xFFFFFFFF) ||
+          (uncompressed_size == 0xFFFFFFFF)) )
     {
         int found = 0;
         PHYSFS_uint16 sig = 0;
@@ -1111,17 +2324,17 @@ static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
 
         BAIL_IF(!found, PHYSFS_ERR_CORRUPT, NULL);
 
-        if (retval->uncompressed_size == 0xFFFFFFFF)
+        if (uncompressed_size == 0xFFFFFFFF)
         {
             BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
-            BAIL_IF_ERRPASS(!readui64(io, &retval->uncompressed_size), NULL);
+            BAIL_IF_ERRPASS(!readui64(io, &uncompressed_size), NULL);
             len -= 8;
         } /* if */
 
-        if (retval->compressed_size == 0xFFFFFFFF)
+        if (compressed_size == 0xFFFFFFFF)
         {
             BAIL_IF(len < 8, PHYSFS_ERR_CORRUPT, NULL);
-            BAIL_IF_ERRPASS(!readui64(io, &retval->compressed_size), NULL);
+            BAIL_IF_ERRPASS(!readui64(io, &compressed_size), NULL);
             len -= 8;
         } /* if */
 
@@ -1144,7 +2357,8 @@ static ZIPentry *zip_load_entry(ZIPinfo *info, const int zip64,
 
     BAIL_IF(starting_disk != 0, PHYSFS_ERR_CORRUPT, NULL);
 
-    retval->offset = offset + ofs_fixup;
+    BAIL_IF_ERRPASS(!zip_entry_set_values(info, retval, offset + ofs_fixup,
+                                          compressed_size, uncompressed_size), NULL);
 
     /* seek to the start of the next entry in the central directory... */
     BAIL_IF_ERRPASS(!io->seek(io, si64 + extralen + commentlen), NULL);
@@ -1167,7 +2381,9 @@ static int zip_load_entries(ZIPinfo *info,
 
     for (i = 0; i < entry_count; i++)
     {
-        ZIPentry *entry = zip_load_entry(info, zip64, data_ofs);
+        ZIPentry *entry;
+        BAIL_IF(info->cancelindex, PHYSFS_ERR_OTHER_ERROR, 0);
+        entry = zip_load_entry(info, zip64, data_ofs);
         BAIL_IF_ERRPASS(!entry, 0);
         if (zip_entry_is_tradional_crypto(entry))
             info->has_crypto = 1;
@@ -1450,6 +2666,53 @@ static int zip_parse_end_of_central_dir(ZIPinfo *info,
 } /* zip_parse_end_of_central_dir */
 
 
+/*
+ * Load the entries of an archive that was mounted with deferred indexing.
+ *  Caller must hold (info->indexlock).
+ */
+static void zip_build_index(ZIPinfo *info)
+{
+    if (info->indexed)
+        return;  /* already done (or already failed). */
+
+    info->indexed = 1;
+    if (!zip_load_entries(info, info->dstart, info->cdir_ofs, info->count))
+    {
+        info->indexerror = PHYSFS_getLastErrorCode();
+        if (info->indexerror == PHYSFS_ERR_OK)
+            info->indexerror = PHYSFS_ERR_CORRUPT;
+    } /* if */
+} /* zip_build_index */
+
+
+static void zip_index_task(void *opaque)
+{
+    ZIPinfo *info = (ZIPinfo *) opaque;
+    __PHYSFS_platformGrabMutex(info->indexlock);
+    zip_build_index(info);
+    __PHYSFS_platformReleaseMutex(info->indexlock);
+} /* zip_index_task */
+
+
+/* Make sure (info)'s entries are loaded before looking anything up. */
+static int zip_ensure_indexed(ZIPinfo *info)
+{
+    PHYSFS_ErrorCode err;
+
+    if (info->indexlock == NULL)
+        return 1;  /* indexed at mount time. */
+
+    /* a background thread might be building it right now; wait if so. */
+    __PHYSFS_platformGrabMutex(info->indexlock);
+    zip_build_index(info);
+    err = info->indexerror;
+    __PHYSFS_platformReleaseMutex(info->indexlock);
+
+    BAIL_IF(err != PHYSFS_ERR_OK, err, 0);
+    return 1;
+} /* zip_ensure_indexed */
+
+
 static void ZIP_closeArchive(void *opaque)
 {
     ZIPinfo *info = (ZIPinfo *) (opaque);
@@ -1457,11 +2720,34 @@ static void ZIP_closeArchive(void *opaque)
     if (!info)
         return;
 
+    if (info->indexlock)
+    {
+        /* stop any background indexing before pulling the rug out. */
+        info->cancelindex = 1;
+        __PHYSFS_cancelBackgroundTask(&info->indextask);
+        __PHYSFS_platformGrabMutex(info->indexlock);
+        __PHYSFS_platformReleaseMutex(info->indexlock);
+        __PHYSFS_platformDestroyMutex(info->indexlock);
+    } /* if */
+
     if (info->io)
         info->io->destroy(info->io);
 
+    while (info->pool != NULL)
+    {
+        ZIPfileinfo *next = info->pool->next_pooled;
+        zip_free_fileinfo(info->pool);
+        info->pool = next;
+    } /* while */
+
+    if (info->poollock)
+        __PHYSFS_platformDestroyMutex(info->poollock);
+
     __PHYSFS_DirTreeDeinit(&info->tree);
 
+    if (info->wide)
+        allocator.Free(info->wide);
+
     allocator.Free(info);
 } /* ZIP_closeArchive */
 
@@ -1474,6 +2760,7 @@ static void *ZIP_openArchive(PHYSFS_Io *io, const char *name,
     PHYSFS_uint64 dstart = 0;  /* data start */
     PHYSFS_uint64 cdir_ofs;  /* central dir offset */
     PHYSFS_uint64 count;
+    PHYSFS_IndexingMode mode = PHYSFS_getIndexingMode();
 
     assert(io != NULL);  /* shouldn't ever happen. */
 
@@ -1488,18 +2775,47 @@ static void *ZIP_openArchive(PHYSFS_Io *io, const char *name,
 
     info->io = io;
 
+    if (ZIP_FILEINFO_POOLSIZE > 0)
+    {
+        /* no lock just means no pooling; don't fail the mount over it. */
+        info->poollock = __PHYSFS_platformCreateMutex();
+    } /* if */
+
     if (!zip_parse_end_of_central_dir(info, &dstart, &cdir_ofs, &count))
         goto ZIP_openarchive_failed;
     else if (!__PHYSFS_DirTreeInit(&info->tree, sizeof (ZIPentry), 1, 0))
         goto ZIP_openarchive_failed;
 
     root = (ZIPentry *) info->tree.root;
-    root->resolved = ZIP_DIRECTORY;
+    zip_entry_set_resolved(root, ZIP_DIRECTORY);
 
-    if (!zip_load_entries(info, dstart, cdir_ofs, count))
-        goto ZIP_openarchive_failed;
+    if (mode != PHYSFS_INDEX_AT_MOUNT)
+    {
+        /* no lock just means we index right now, like we used to. */
+        info->indexlock = __PHYSFS_platformCreateMutex();
+    } /* if */
+
+    if (info->indexlock == NULL)
+    {
+        if (!zip_load_entries(info, dstart, cdir_ofs, count))
+            goto ZIP_openarchive_failed;
+    } /* if */
+
+    else
+    {
+        info->dstart = dstart;
+        info->cdir_ofs = cdir_ofs;
+        info->count = count;
+
+        if (mode == PHYSFS_INDEX_IN_BACKGROUND)
+        {
+            /* if this fails, the first lookup does the work instead. */
+            info->indextask.run = zip_index_task;
+            info->indextask.data = info;
+            __PHYSFS_queueBackgroundTask(&info->indextask);
+        } /* if */
+    } /* else */
 
-    assert(info->tree.root->sibling == NULL);
     return info;
 
 ZIP_openarchive_failed:
@@ -1509,24 +2825,16 @@ ZIP_openarchive_failed:
 } /* ZIP_openArchive */
 
 
-static PHYSFS_Io *zip_get_io(PHYSFS_Io *io, ZIPinfo *inf, ZIPentry *entry)
+/* (finfo)'s entry must already be resolved, and not be a symlink. */
+static PHYSFS_Io *zip_get_io(PHYSFS_Io *io, const ZIPfileinfo *finfo)
 {
-    int success;
     PHYSFS_Io *retval = io->duplicate(io);
     BAIL_IF_ERRPASS(!retval, NULL);
 
-    assert(!entry->tree.isdir); /* should have been checked before calling. */
+    assert(!finfo->entry->tree.isdir); /* should have been checked before calling. */
+    assert(zip_entry_resolved(finfo->entry) == ZIP_RESOLVED);
 
-    /* (inf) can be NULL if we already resolved. */
-    success = (inf == NULL) || zip_resolve(retval, inf, entry);
-    if (success)
-    {
-        PHYSFS_sint64 offset;
-        offset = ((entry->symlink) ? entry->symlink->offset : entry->offset);
-        success = retval->seek(retval, offset);
-    } /* if */
-
-    if (!success)
+    if (!retval->seek(retval, finfo->offset))
     {
         retval->destroy(retval);
         retval = NULL;
@@ -1540,11 +2848,14 @@ static PHYSFS_Io *ZIP_openRead(void *opaque, const char *filename)
 {
     PHYSFS_Io *retval = NULL;
     ZIPinfo *info = (ZIPinfo *) opaque;
-    ZIPentry *entry = zip_find_entry(info, filename);
+    ZIPentry *entry;
     ZIPfileinfo *finfo = NULL;
     PHYSFS_Io *io = NULL;
     PHYSFS_uint8 *password = NULL;
 
+    BAIL_IF_ERRPASS(!zip_ensure_indexed(info), NULL);
+    entry = zip_find_entry(info, filename);
+
     /* if not found, see if maybe "$PASSWORD" is appended. */
     if ((!entry) && (info->has_crypto))
     {
@@ -1568,27 +2879,23 @@ static PHYSFS_Io *ZIP_openRead(void *opaque, const char *filename)
 
     BAIL_IF(entry->tree.isdir, PHYSFS_ERR_NOT_A_FILE, NULL);
 
+    /* a symlink can point at a directory, too. */
+    if (entry->symlink != NULL)
+        BAIL_IF(entry->symlink->tree.isdir, PHYSFS_ERR_NOT_A_FILE, NULL);
+
     retval = (PHYSFS_Io *) allocator.Malloc(sizeof (PHYSFS_Io));
     GOTO_IF(!retval, PHYSFS_ERR_OUT_OF_MEMORY, ZIP_openRead_failed);
 
-    finfo = (ZIPfileinfo *) allocator.Malloc(sizeof (ZIPfileinfo));
-    GOTO_IF(!finfo, PHYSFS_ERR_OUT_OF_MEMORY, ZIP_openRead_failed);
-    memset(finfo, '\0', sizeof (ZIPfileinfo));
+    finfo = zip_alloc_fileinfo(info, ((entry->symlink != NULL) ? entry->symlink : entry));
+    GOTO_IF_ERRPASS(!finfo, ZIP_openRead_failed);
 
-    io = zip_get_io(info->io, info, entry);
+    io = zip_get_io(info->io, finfo);
     GOTO_IF_ERRPASS(!io, ZIP_openRead_failed);
     finfo->io = io;
-    finfo->entry = ((entry->symlink != NULL) ? entry->symlink : entry);
-    initializeZStream(&finfo->stream);
 
-    if (finfo->entry->compression_method != COMPMETH_NONE)
-    {
-        finfo->buffer = (PHYSFS_uint8 *) allocator.Malloc(ZIP_READBUFSIZE);
-        if (!finfo->buffer)
-            GOTO(PHYSFS_ERR_OUT_OF_MEMORY, ZIP_openRead_failed);
-        else if (zlib_err(inflateInit2(&finfo->stream, -MAX_WBITS)) != Z_OK)
-            goto ZIP_openRead_failed;
-    } /* if */
+    finfo->verify_crc = __PHYSFS_checksumsEnabled();
+    if (finfo->verify_crc)
+        zip_crc32_init();
 
     if (!zip_entry_is_tradional_crypto(entry))
         GOTO_IF(password != NULL, PHYSFS_ERR_BAD_PASSWORD, ZIP_openRead_failed);
@@ -1609,18 +2916,7 @@ static PHYSFS_Io *ZIP_openRead(void *opaque, const char *filename)
 
 ZIP_openRead_failed:
     if (finfo != NULL)
-    {
-        if (finfo->io != NULL)
-            finfo->io->destroy(finfo->io);
-
-        if (finfo->buffer != NULL)
-        {
-            allocator.Free(finfo->buffer);
-            inflateEnd(&finfo->stream);
-        } /* if */
-
-        allocator.Free(finfo);
-    } /* if */
+        zip_release_fileinfo(finfo);
 
     if (retval != NULL)
         allocator.Free(retval);
@@ -1629,6 +2925,16 @@ ZIP_openRead_failed:
 } /* ZIP_openRead */
 
 
+static PHYSFS_EnumerateCallbackResult ZIP_enumerate(void *opaque,
+                                 const char *dname, PHYSFS_EnumerateCallback cb,
+                                 const char *origdir, void *callbackdata)
+{
+    ZIPinfo *info = (ZIPinfo *) opaque;
+    BAIL_IF_ERRPASS(!zip_ensure_indexed(info), PHYSFS_ENUM_ERROR);
+    return __PHYSFS_DirTreeEnumerate(opaque, dname, cb, origdir, callbackdata);
+} /* ZIP_enumerate */
+
+
 static PHYSFS_Io *ZIP_openWrite(void *opaque, const char *filename)
 {
     BAIL(PHYSFS_ERR_READ_ONLY, NULL);
@@ -1653,18 +2959,16 @@ static int ZIP_mkdir(void *opaque, const char *name)
 } /* ZIP_mkdir */
 
 
-static int ZIP_stat(void *opaque, const char *filename, PHYSFS_Stat *stat)
+static int zip_entry_stat(void *opaque, const __PHYSFS_DirTreeEntry *_entry,
+                          PHYSFS_Stat *stat)
 {
     ZIPinfo *info = (ZIPinfo *) opaque;
-    ZIPentry *entry = zip_find_entry(info, filename);
+    ZIPentry *entry = (ZIPentry *) _entry;  /* resolving may fill it in. */
 
-    if (entry == NULL)
-        return 0;
-
-    else if (!zip_resolve(info->io, info, entry))
+    if (!zip_resolve(info->io, info, entry))
         return 0;
 
-    else if (entry->resolved == ZIP_DIRECTORY)
+    else if (zip_entry_resolved(entry) == ZIP_DIRECTORY)
     {
         stat->filesize = 0;
         stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
@@ -1678,19 +2982,76 @@ static int ZIP_stat(void *opaque, const char *filename, PHYSFS_Stat *stat)
 
     else
     {
-        stat->filesize = (PHYSFS_sint64) entry->uncompressed_size;
+        stat->filesize = (PHYSFS_sint64) zip_entry_uncompressed_size(info, entry);
         stat->filetype = PHYSFS_FILETYPE_REGULAR;
     } /* else */
 
-    stat->modtime = ((entry) ? entry->last_mod_time : 0);
+    if (entry->flags & ZIP_ENTRY_LOADED)
+        stat->modtime = zip_mod_time(info, entry->dos_mod_time);
+    else
+        stat->modtime = 0;  /* root, or an ancestor dir DirTree filled in. */
     stat->createtime = stat->modtime;
     stat->accesstime = -1;
     stat->readonly = 1; /* .zip files are always read only */
 
     return 1;
+} /* zip_entry_stat */
+
+
+static int ZIP_stat(void *opaque, const char *filename, PHYSFS_Stat *stat)
+{
+    ZIPinfo *info = (ZIPinfo *) opaque;
+    ZIPentry *entry;
+
+    BAIL_IF_ERRPASS(!zip_ensure_indexed(info), 0);
+
+    entry = zip_find_entry(info, filename);
+    if (entry == NULL)
+        return 0;
+
+    return zip_entry_stat(opaque, &entry->tree, stat);
 } /* ZIP_stat */
 
 
+PHYSFS_EnumerateCallbackResult __PHYSFS_ZIP_enumerateStat(void *opaque,
+                             const char *dname,
+                             __PHYSFS_EnumerateStatCallback cb,
+                             const char *origdir, void *callbackdata)
+{
+    ZIPinfo *info = (ZIPinfo *) opaque;
+    BAIL_IF_ERRPASS(!zip_ensure_indexed(info), PHYSFS_ENUM_ERROR);
+    return __PHYSFS_DirTreeEnumerateStat(&info->tree, dname, zip_entry_stat,
+                                         opaque, cb, origdir, callbackdata);
+} /* __PHYSFS_ZIP_enumerateStat */
+
+
+int __PHYSFS_ZIP_entryIsSymlink(const __PHYSFS_DirTreeEntry *entry)
+{
+    /* known from the central directory, so this never has to resolve. */
+    return zip_entry_is_symlink((const ZIPentry *) entry);
+} /* __PHYSFS_ZIP_entryIsSymlink */
+
+
+__PHYSFS_DirTree *__PHYSFS_ZIP_getTree(void *opaque)
+{
+    ZIPinfo *info = (ZIPinfo *) opaque;
+    BAIL_IF_ERRPASS(!zip_ensure_indexed(info), NULL);
+    return &info->tree;
+} /* __PHYSFS_ZIP_getTree */
+
+
+int __PHYSFS_ZIP_checkSymlinks(void *opaque, char *path, const int allowMissing)
+{
+    ZIPinfo *info = (ZIPinfo *) opaque;
+
+    if (!zip_ensure_indexed(info))
+        return -1;  /* let the slow path report this. */
+
+    return __PHYSFS_DirTreeCheckSymlinks(&info->tree, path, allowMissing,
+                                         __PHYSFS_ZIP_entryIsSymlink);
+} /* __PHYSFS_ZIP_checkSymlinks */
+
+
 const PHYSFS_Archiver __PHYSFS_Archiver_ZIP =
 {
     CURRENT_PHYSFS_ARCHIVER_API_VERSION,
@@ -1702,7 +3063,7 @@ const PHYSFS_Archiver __PHYSFS_Archiver_ZIP =
         1,  /* supportsSymlinks */
     },
     ZIP_openArchive,
-    __PHYSFS_DirTreeEnumerate,
+    ZIP_enumerate,
     ZIP_openRead,
     ZIP_openWrite,
     ZIP_openAppend,
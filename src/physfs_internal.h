@@ -195,6 +195,21 @@ void __PHYSFS_smallFree(void *ptr);
 #ifndef PHYSFS_SUPPORTS_ZIP
 #define PHYSFS_SUPPORTS_ZIP PHYSFS_SUPPORTS_DEFAULT
 #endif
+#ifndef PHYSFS_SUPPORTS_ZIP_LZMA  /* uses our copy of the LZMA SDK. */
+#define PHYSFS_SUPPORTS_ZIP_LZMA PHYSFS_SUPPORTS_ZIP
+#endif
+#ifndef PHYSFS_SUPPORTS_ZIP_BZIP2  /* needs libbz2, so off by default. */
+#define PHYSFS_SUPPORTS_ZIP_BZIP2 0
+#endif
+#ifndef PHYSFS_SUPPORTS_ZIP_LIBDEFLATE  /* needs libdeflate, so off by default. */
+#define PHYSFS_SUPPORTS_ZIP_LIBDEFLATE 0
+#endif
+#ifndef PHYSFS_SUPPORTS_ZIP_ZSTD  /* needs libzstd, so off by default. */
+#define PHYSFS_SUPPORTS_ZIP_ZSTD 0
+#endif
+#ifndef PHYSFS_SUPPORTS_ZIP_LZ4  /* needs liblz4, so off by default. */
+#define PHYSFS_SUPPORTS_ZIP_LZ4 0
+#endif
 #ifndef PHYSFS_SUPPORTS_7Z
 #define PHYSFS_SUPPORTS_7Z PHYSFS_SUPPORTS_DEFAULT
 #endif
@@ -388,6 +403,15 @@ extern PHYSFS_Allocator __PHYSFS_AllocatorHooks;
  */
 PHYSFS_Io *__PHYSFS_createNativeIo(const char *path, const int mode);
 
+/*
+ * Same as __PHYSFS_createNativeIo(path, mode), but open the file through
+ *  (relpath), relative to (dirhandle) from __PHYSFS_platformOpenResolveDir(),
+ *  unless that's NULL. (path) must name the same file; it's still needed to
+ *  reopen the file later.
+ */
+PHYSFS_Io *__PHYSFS_createNativeIoAt(void *dirhandle, const char *relpath,
+                                     const char *path, const int mode);
+
 /*
  * Create a PHYSFS_Io for a buffer of memory (READ-ONLY). If you already
  *  have one of these, just use its duplicate() method, and it'll increment
@@ -403,6 +427,53 @@ PHYSFS_Io *__PHYSFS_createMemoryIo(const void *buf, PHYSFS_uint64 len,
  */
 int __PHYSFS_readAll(PHYSFS_Io *io, void *buf, const size_t len);
 
+/*
+ * Non-zero if archivers should verify the checksums of files opened for
+ *  reading right now; that is, if the app enabled it with
+ *  PHYSFS_setChecksumVerification(), or PHYSFS_verifyArchive() is running.
+ */
+int __PHYSFS_checksumsEnabled(void);
+
+/*
+ * Non-zero if the DIR archiver should keep directories mounted right now in
+ *  memory; see PHYSFS_setDirCaching().
+ */
+int __PHYSFS_dirCachingEnabled(void);
+
+/*
+ * Non-zero if archives mounted right now should find paths regardless of
+ *  case; see PHYSFS_setIgnoreCase().
+ */
+int __PHYSFS_ignoreCaseEnabled(void);
+
+/*
+ * Work for PhysicsFS's background thread. The caller owns this struct, and
+ *  it has to stay valid until (run) has returned, or until
+ *  __PHYSFS_cancelBackgroundTask() has returned.
+ */
+typedef struct __PHYSFS_BackgroundTask
+{
+    void (*run)(void *data);
+    void *data;
+    struct __PHYSFS_BackgroundTask *next;  /* for internal use. */
+} __PHYSFS_BackgroundTask;
+
+/*
+ * Queue (task) to run on a background thread. Tasks run one at a time, in
+ *  the order they were queued. Returns zero if there's no way to run it in
+ *  the background (no thread support, etc); the caller has to do the work
+ *  some other way then. Does not set the error state.
+ */
+int __PHYSFS_queueBackgroundTask(__PHYSFS_BackgroundTask *task);
+
+/*
+ * Make sure (task) won't run anymore. If it's still waiting in the queue,
+ *  this removes it and returns non-zero. If it's running right now, this
+ *  blocks until it finishes. Otherwise, it already ran. Those last two
+ *  return zero.
+ */
+int __PHYSFS_cancelBackgroundTask(__PHYSFS_BackgroundTask *task);
+
 
 /* These are shared between some archivers. */
 
@@ -421,28 +492,64 @@ int UNPK_mkdir(void *opaque, const char *name);
 int UNPK_stat(void *opaque, const char *fn, PHYSFS_Stat *st);
 #define UNPK_enumerate __PHYSFS_DirTreeEnumerate
 
+/*
+ * PHYSFS_enumerateWithStat() support. This is PHYSFS_EnumerateCallback plus
+ *  the child's metadata; physfs.c adds which archive it came from.
+ */
+typedef PHYSFS_EnumerateCallbackResult (*__PHYSFS_EnumerateStatCallback)(
+                            void *data, const char *origdir, const char *fname,
+                            const PHYSFS_Stat *stat);
+
+PHYSFS_EnumerateCallbackResult UNPK_enumerateStat(void *opaque,
+                             const char *dname,
+                             __PHYSFS_EnumerateStatCallback cb,
+                             const char *origdir, void *callbackdata);
+
 
 
 /* Optional API many archivers use this to manage their directory tree. */
 /* !!! FIXME: document this better. */
 
+/*
+ * Entries only keep their own (leaf) name and link to each other with 32-bit
+ *  indices instead of pointers; a full path is found by hashing it and then
+ *  matching it one component at a time up through the parent links. Entry 0
+ *  is always the root, so 0 doubles as "none" for (hashnext).
+ */
 typedef struct __PHYSFS_DirTreeEntry
 {
-    char *name;                              /* Full path in archive.        */
-    struct __PHYSFS_DirTreeEntry *hashnext;  /* next item in hash bucket.    */
-    struct __PHYSFS_DirTreeEntry *children;  /* linked list of kids, if dir. */
-    struct __PHYSFS_DirTreeEntry *sibling;   /* next item in same dir.       */
+    const char *name;        /* leaf name, shared with identical names.     */
+    PHYSFS_uint32 hashval;   /* full path hash, before picking a bucket.    */
+    PHYSFS_uint32 hashnext;  /* index of next item in hash bucket.          */
+    PHYSFS_uint32 parent;    /* index of containing dir.                    */
+    PHYSFS_uint32 children;  /* first of this dir's kids in the (kids) list. */
+    PHYSFS_uint32 childcount;  /* number of kids, if dir.                   */
     int isdir;
 } __PHYSFS_DirTreeEntry;
 
 typedef struct __PHYSFS_DirTree
 {
     __PHYSFS_DirTreeEntry *root;    /* root of directory tree.             */
-    __PHYSFS_DirTreeEntry **hash;  /* all entries hashed for fast lookup. */
-    size_t hashBuckets;            /* number of buckets in hash.          */
+    void **chunks;         /* entries live here, (1 << chunkshift) apiece. */
+    PHYSFS_uint32 chunkshift;  /* log2 of entries per chunk.               */
+    PHYSFS_uint32 chunkcount;  /* number of chunks allocated.              */
+    PHYSFS_uint32 count;   /* number of entries, including root.           */
+    PHYSFS_uint32 *hash;   /* all entries hashed for fast lookup.          */
+    PHYSFS_uint32 hashBits;  /* log2 of number of buckets in hash.         */
+    PHYSFS_uint32 *names;  /* interned leaf names, as entry indices.       */
+    PHYSFS_uint32 nameBits;  /* log2 of number of slots in (names).      */
+    PHYSFS_uint32 nameCount;  /* slots of (names) in use.                  */
+    PHYSFS_uint32 *kids;   /* each dir's children, grouped, sorted by name. */
+    int kidsDirty;      /* non-zero if (kids) must be rebuilt before use.  */
     size_t entrylen;    /* size in bytes of entries (including subclass). */
     int case_sensitive;  /* non-zero to treat entries as case-sensitive in DirTreeFind */
     int only_usascii;  /* non-zero to treat paths as US ASCII only (one byte per char, only 'A' through 'Z' are considered for case folding). */
+    PHYSFS_uint32 *foldhash;  /* case-folded path hash, for __PHYSFS_DirTreeFixCase(). */
+    PHYSFS_uint32 foldBits;  /* log2 of number of buckets in (foldhash).    */
+    PHYSFS_uint32 foldCount;  /* entries (foldhash) covers; stale if != count. */
+    void *arena;        /* newest block that names are carved from.       */
+    size_t arenaused;   /* bytes of (arena) handed out so far.            */
+    size_t arenasize;   /* bytes (arena) can hand out in total.           */
 } __PHYSFS_DirTree;
 
 
@@ -450,11 +557,105 @@ typedef struct __PHYSFS_DirTree
 int __PHYSFS_DirTreeInit(__PHYSFS_DirTree *dt, const size_t entrylen, const int case_sensitive, const int only_usascii);
 void *__PHYSFS_DirTreeAdd(__PHYSFS_DirTree *dt, char *name, const int isdir);
 void *__PHYSFS_DirTreeFind(__PHYSFS_DirTree *dt, const char *path);
+int __PHYSFS_DirTreeCheckSymlinks(__PHYSFS_DirTree *dt, char *path,
+                                  const int allowMissing,
+                        int (*issymlink)(const __PHYSFS_DirTreeEntry *entry));
 PHYSFS_EnumerateCallbackResult __PHYSFS_DirTreeEnumerate(void *opaque,
                               const char *dname, PHYSFS_EnumerateCallback cb,
                               const char *origdir, void *callbackdata);
+/*
+ * Only the children of (dname) that start with the first (prefixlen) bytes
+ *  of (prefix) and that (match) likes. (prefixlen) can be zero.
+ */
+PHYSFS_EnumerateCallbackResult __PHYSFS_DirTreeEnumerateMatching(
+                    __PHYSFS_DirTree *dt, const char *dname,
+                    const char *prefix, const size_t prefixlen,
+                    int (*match)(const void *matchdata, const char *name),
+                    const void *matchdata, PHYSFS_EnumerateCallback cb,
+                    const char *origdir, void *callbackdata);
+/* (statfn) fills in (st) from one of (opaque)'s entries. */
+PHYSFS_EnumerateCallbackResult __PHYSFS_DirTreeEnumerateStat(
+                    __PHYSFS_DirTree *dt, const char *dname,
+                    int (*statfn)(void *opaque,
+                                  const __PHYSFS_DirTreeEntry *entry,
+                                  PHYSFS_Stat *st),
+                    void *opaque, __PHYSFS_EnumerateStatCallback cb,
+                    const char *origdir, void *callbackdata);
+/*
+ * For walking a directory's children one at a time, in name order, without
+ *  a callback. __PHYSFS_DirTreeOpenDir() returns (dname)'s entry, or NULL
+ *  with an error set if it isn't a directory; its children are then
+ *  __PHYSFS_DirTreeChild() with (idx) from 0 to (childcount - 1).
+ *  __PHYSFS_DirTreeFindChild() returns the child called exactly (name), or
+ *  NULL. The entries stay put until the tree is changed or freed.
+ */
+const __PHYSFS_DirTreeEntry *__PHYSFS_DirTreeOpenDir(__PHYSFS_DirTree *dt,
+                                                      const char *dname);
+const __PHYSFS_DirTreeEntry *__PHYSFS_DirTreeChild(const __PHYSFS_DirTree *dt,
+                                        const __PHYSFS_DirTreeEntry *dir,
+                                        const PHYSFS_uint32 idx);
+const __PHYSFS_DirTreeEntry *__PHYSFS_DirTreeFindChild(
+                                        const __PHYSFS_DirTree *dt,
+                                        const __PHYSFS_DirTreeEntry *dir,
+                                        const char *name);
+/*
+ * For case-insensitive mounts: if (path) isn't in (dt), but a path the same
+ *  length in bytes that only differs by case is, overwrite (path) with that.
+ *  Exact matches are left alone. Returns zero if nothing matches (path).
+ *  Trees that aren't case-sensitive find paths in any case already.
+ */
+int __PHYSFS_DirTreeFixCase(__PHYSFS_DirTree *dt, char *path);
 void __PHYSFS_DirTreeDeinit(__PHYSFS_DirTree *dt);
 
+/*
+ * verifyPath() normally stats every element of a path to make sure none are
+ *  symlinks. Built-in archivers that can hold symlinks do it faster with
+ *  these. They take an archive path like the archiver's stat() does, and
+ *  return 1 if no element of it is a symlink, 0 with an error set if one is
+ *  (or any element is missing and (allowMissing) is zero), or -1 if the
+ *  caller should check each element the slow way.
+ */
+int __PHYSFS_DIR_checkSymlinks(void *opaque, char *path, const int allowMissing);
+int __PHYSFS_ZIP_checkSymlinks(void *opaque, char *path, const int allowMissing);
+
+/*
+ * __PHYSFS_DirTreeFixCase() for the DIR archiver, from its cached listings.
+ *  Returns -1 if the directory isn't cached, so the caller should search
+ *  for (path) itself.
+ */
+int __PHYSFS_DIR_fixCase(void *opaque, char *path);
+
+/*
+ * PHYSFS_statMany() support. Open directory (dname), an archive path, so
+ *  the files in it can be stat'd by their leaf names. If (allowSymlinks) is
+ *  zero, no element of (dname) may be a symlink. Returns NULL with the
+ *  error set on failure: PHYSFS_ERR_NOT_FOUND or PHYSFS_ERR_SYMLINK_FORBIDDEN
+ *  mean this archive doesn't have anything under (dname), anything else
+ *  means the caller should stat each file the usual way.
+ */
+void *__PHYSFS_DIR_openStatDir(void *opaque, const char *dname,
+                               const int allowSymlinks);
+
+/*
+ * Same as UNPK_enumerateStat(), for the built-in archivers that don't use
+ *  UNPK. Archivers without one of these get each child's stat() instead.
+ */
+PHYSFS_EnumerateCallbackResult __PHYSFS_DIR_enumerateStat(void *opaque,
+                             const char *dname,
+                             __PHYSFS_EnumerateStatCallback cb,
+                             const char *origdir, void *callbackdata);
+PHYSFS_EnumerateCallbackResult __PHYSFS_ZIP_enumerateStat(void *opaque,
+                             const char *dname,
+                             __PHYSFS_EnumerateStatCallback cb,
+                             const char *origdir, void *callbackdata);
+
+/*
+ * A .zip's DirTree (indexing it first, if it hasn't been yet), and whether
+ *  one of its entries is a symlink, for callers that walk it directly.
+ */
+__PHYSFS_DirTree *__PHYSFS_ZIP_getTree(void *opaque);
+int __PHYSFS_ZIP_entryIsSymlink(const __PHYSFS_DirTreeEntry *entry);
+
 
 
 /*--------------------------------------------------------------------------*/
@@ -550,6 +751,16 @@ void *__PHYSFS_platformOpenWrite(const char *filename);
  */
 void *__PHYSFS_platformOpenAppend(const char *filename);
 
+/*
+ * Open (path), in platform-dependent notation relative to (dirhandle), the
+ *  way __PHYSFS_platformOpenRead(), __PHYSFS_platformOpenWrite() or
+ *  __PHYSFS_platformOpenAppend() would for (mode) 'r', 'w' or 'a'.
+ *  (dirhandle) is from __PHYSFS_platformOpenResolveDir(), and "" means that
+ *  directory itself. Symlinks are followed, just like with a full path.
+ */
+void *__PHYSFS_platformOpenAt(void *dirhandle, const char *path,
+                              const int mode);
+
 /*
  * Read more data from a platform-specific file handle. (opaque) should be
  *  cast to whatever data type your platform uses. Read a maximum of (len)
@@ -616,6 +827,29 @@ PHYSFS_sint64 __PHYSFS_platformTell(void *opaque);
  */
 PHYSFS_sint64 __PHYSFS_platformFileLength(void *handle);
 
+/*
+ * Things that tell one file apart from another, from
+ *  __PHYSFS_platformFileId(). These are only ever compared for equality,
+ *  so use whatever units are handy.
+ */
+typedef struct __PHYSFS_FileId
+{
+    PHYSFS_uint64 device;  /* device/volume the file lives on, or zero. */
+    PHYSFS_uint64 inode;   /* file's inode/index on (device), or zero. */
+    PHYSFS_uint64 modtime; /* last modification time, or zero. */
+    PHYSFS_uint64 size;    /* file length in bytes. */
+} __PHYSFS_FileId;
+
+/*
+ * Fill in (id) for the file that (handle) refers to. If the file at a path
+ *  is replaced by another, or rewritten, reopening the path should give a
+ *  different (id). Zero any fields the platform can't provide; the more
+ *  fields you fill in, the better replaced files get noticed.
+ *
+ * Return zero on failure and call PHYSFS_setErrorCode(), non-zero on success.
+ */
+int __PHYSFS_platformFileId(void *handle, __PHYSFS_FileId *id);
+
 
 /*
  * Read filesystem metadata for a specific path.
@@ -629,6 +863,115 @@ PHYSFS_sint64 __PHYSFS_platformFileLength(void *handle);
  */
 int __PHYSFS_platformStat(const char *fn, PHYSFS_Stat *stat, const int follow);
 
+/*
+ * Open a handle on directory (dir), in platform-dependent notation, that
+ *  __PHYSFS_platformCheckNoSymlinks(), __PHYSFS_platformStatAt(),
+ *  __PHYSFS_platformOpenAt() and __PHYSFS_platformEnumerateAt() can use
+ *  paths relative to, so the platform doesn't walk (dir) again for each
+ *  one. Return NULL if the platform can't use relative paths that way. That
+ *  isn't an error; don't call PHYSFS_setErrorCode().
+ */
+void *__PHYSFS_platformOpenResolveDir(const char *dir);
+
+/*
+ * Check, in one step, that no element of (path), in platform-dependent
+ *  notation relative to (dirhandle), is a symlink.
+ *
+ * Return 1 if none of them are, including when resolving stopped early
+ *  because an element doesn't exist; set (*exists) to zero in that case and
+ *  non-zero otherwise. Return 0 if one is a symlink. Return -1 if this
+ *  couldn't tell, so the caller should stat each element itself. Don't call
+ *  PHYSFS_setErrorCode() in any case.
+ */
+int __PHYSFS_platformCheckNoSymlinks(void *dirhandle, const char *path,
+                                     int *exists);
+
+/*
+ * Close a handle from __PHYSFS_platformOpenResolveDir().
+ */
+void __PHYSFS_platformCloseResolveDir(void *dirhandle);
+
+/*
+ * Open a handle on directory (path), in platform-dependent notation, that
+ *  __PHYSFS_platformStatAt() can stat files in by their leaf names. If
+ *  (resolvedir) isn't NULL, it's from __PHYSFS_platformOpenResolveDir() and
+ *  (path) is relative to it, and may not go through any symlinks or leave
+ *  it ("" means (resolvedir) itself). Otherwise (path) is a full path and
+ *  symlinks are followed.
+ *
+ * Return NULL and set the error on failure: PHYSFS_ERR_NOT_FOUND if (path)
+ *  or an element of it doesn't exist or isn't a directory,
+ *  PHYSFS_ERR_SYMLINK_FORBIDDEN if an element is a symlink that
+ *  (resolvedir) wouldn't go through, and PHYSFS_ERR_UNSUPPORTED if this
+ *  platform can't do this at all.
+ */
+void *__PHYSFS_platformOpenStatDir(void *resolvedir, const char *path);
+
+/*
+ * Same as __PHYSFS_platformStat(fullpath, st, 0), where (name) is the path
+ *  of a file relative to the directory (dirhandle) refers to; that's from
+ *  __PHYSFS_platformOpenStatDir() or __PHYSFS_platformOpenResolveDir().
+ */
+int __PHYSFS_platformStatAt(void *dirhandle, const char *name,
+                            PHYSFS_Stat *st);
+
+/*
+ * Close a handle from __PHYSFS_platformOpenStatDir().
+ */
+void __PHYSFS_platformCloseStatDir(void *dirhandle);
+
+/*
+ * What __PHYSFS_platformPollDirWatcher() reports about a watched directory.
+ */
+typedef enum __PHYSFS_DirWatchEvent
+{
+    __PHYSFS_DIRWATCH_CHANGED,  /* (name)'s metadata or contents changed. */
+    __PHYSFS_DIRWATCH_RENAMED,  /* (name) was created, deleted or moved. */
+    __PHYSFS_DIRWATCH_GONE,  /* the directory itself went away. */
+    __PHYSFS_DIRWATCH_OVERFLOW  /* events were lost; anything may differ. */
+} __PHYSFS_DirWatchEvent;
+
+typedef void (*__PHYSFS_DirWatchCallback)(void *data, int id,
+                                          __PHYSFS_DirWatchEvent event,
+                                          const char *name);
+
+/*
+ * Create something that can watch directories for changes, for the DIR
+ *  archiver's cache. Return NULL if this platform can't do that; that isn't
+ *  an error, so don't call PHYSFS_setErrorCode().
+ */
+void *__PHYSFS_platformCreateDirWatcher(void);
+
+/*
+ * Start watching directory (path), in platform-dependent notation, for
+ *  children being added or removed, and for changes to any child's
+ *  metadata. Returns a non-negative id that changes will be reported with,
+ *  or -1 with the error set. If the directory is already watched, through
+ *  any path, this returns the same id as before.
+ */
+int __PHYSFS_platformAddDirWatch(void *watcher, const char *path);
+
+/*
+ * Stop watching the directory with (id). Changes that were already queued
+ *  may still be reported with it.
+ */
+void __PHYSFS_platformRemoveDirWatch(void *watcher, int id);
+
+/*
+ * Call (cb) for every change queued since the last call, without waiting
+ *  for more. (name) is the child a change is about, or NULL if it's about
+ *  the directory itself. (id) is -1 for __PHYSFS_DIRWATCH_OVERFLOW. Return
+ *  zero with the error set if this failed, in which case the caller has to
+ *  assume anything could have changed.
+ */
+int __PHYSFS_platformPollDirWatcher(void *watcher,
+                                    __PHYSFS_DirWatchCallback cb, void *data);
+
+/*
+ * Stop watching everything and free (watcher).
+ */
+void __PHYSFS_platformDestroyDirWatcher(void *watcher);
+
 /*
  * Flush any pending writes to disk. (opaque) should be cast to whatever data
  *  type your platform uses. Be sure to check for errors; the caller expects
@@ -711,6 +1054,30 @@ PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerate(const char *dirname,
                                PHYSFS_EnumerateCallback callback,
                                const char *origdir, void *callbackdata);
 
+/*
+ * Like __PHYSFS_platformEnumerate(), but also hand (callback) what
+ *  __PHYSFS_platformStat(path, st, 0) would say about each child. Platforms
+ *  that can't do that any cheaper than stat'ing each child by its full path
+ *  should fail with PHYSFS_ERR_UNSUPPORTED before calling (callback), and
+ *  the DIR archiver will do that itself.
+ */
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateStat(
+                               const char *dirname,
+                               __PHYSFS_EnumerateStatCallback callback,
+                               const char *origdir, void *callbackdata);
+
+/*
+ * Like __PHYSFS_platformEnumerate(), if (statcallback) is NULL, or
+ *  __PHYSFS_platformEnumerateStat() otherwise, but (path) is relative to
+ *  (dirhandle), from __PHYSFS_platformOpenResolveDir(). "" means that
+ *  directory itself.
+ */
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateAt(void *dirhandle,
+                               const char *path,
+                               PHYSFS_EnumerateCallback callback,
+                               __PHYSFS_EnumerateStatCallback statcallback,
+                               const char *origdir, void *callbackdata);
+
 /*
  * Make a directory in the actual filesystem. (path) is specified in
  *  platform-dependent notation. On error, return zero and set the error
@@ -779,10 +1146,45 @@ int __PHYSFS_platformGrabMutex(void *mutex);
  */
 void __PHYSFS_platformReleaseMutex(void *mutex);
 
+/*
+ * Start a new thread that runs fn(data), and return an opaque handle to it
+ *  for __PHYSFS_platformJoinThread().
+ *
+ * Return (NULL) if you couldn't start one. Systems without threads should
+ *  always return NULL; callers have to be ready to do the work on the
+ *  calling thread instead.
+ */
+void *__PHYSFS_platformCreateThread(void (*fn)(void *), void *data);
+
+/*
+ * Block until a thread from __PHYSFS_platformCreateThread() has finished,
+ *  then clean up any resources associated with it.
+ */
+void __PHYSFS_platformJoinThread(void *thread);
+
+/*
+ * Return the number of CPU cores that work can be spread across. Return 1
+ *  if you don't know, or the system doesn't have threads.
+ */
+int __PHYSFS_platformCPUCount(void);
+
 
 /* !!! FIXME: move to public API? */
 PHYSFS_uint32 __PHYSFS_utf8codepoint(const char **_str);
 
+/*
+ * Fast paths for case folding the ASCII parts of UTF-8 strings, 16 bytes at
+ *  a time with SSE2 or NEON where the compiler has them.
+ *  __PHYSFS_utf8LowerAscii16() writes the 16 bytes at (src) to (dst) with
+ *  'A' to 'Z' lowercased, and returns zero without finishing if any of them
+ *  isn't 7-bit ASCII. __PHYSFS_utf8AsciiMatchLen() returns how many bytes
+ *  at the start of (str1) and (str2), a multiple of 16 and no more than
+ *  (len), are ASCII in both and the same once lowercased.
+ */
+int __PHYSFS_utf8LowerAscii16(const char *src, char *dst);
+size_t __PHYSFS_utf8AsciiMatchLen(const char *str1, const char *str2,
+                                  const size_t len);
+
 
 #if PHYSFS_HAVE_PRAGMA_VISIBILITY
 #pragma GCC visibility pop
@@ -6,6 +6,9 @@ This code is all public domain, and mostly (if not entirely) written by
 Igor Pavlov. http://www.7-zip.org/sdk.html
 --ryan. */
 
+/* #define PHYSFS_LZMASDK_DECODER_ONLY before including this if you just want
+   the raw LZMA decoder and not all the .7z archive parsing code. */
+
 
 
 /* 7zTypes.h -- Basic types
@@ -187,6 +190,8 @@ typedef struct
   SRes (*Seek)(void *p, Int64 *pos, ESzSeek origin);
 } ILookInStream;
 
+#ifndef PHYSFS_LZMASDK_DECODER_ONLY
+
 static SRes LookInStream_SeekTo(ILookInStream *stream, UInt64 offset);
 
 /* reads via ILookInStream::Read */
@@ -207,6 +212,8 @@ typedef struct
 static void LookToRead_CreateVTable(CLookToRead *p, int lookahead);
 static void LookToRead_Init(CLookToRead *p);
 
+#endif  /* PHYSFS_LZMASDK_DECODER_ONLY */
+
 typedef struct
 {
   ISeqInStream s;
@@ -255,6 +262,8 @@ EXTERN_C_END
 
 #endif
 
+#ifndef PHYSFS_LZMASDK_DECODER_ONLY
+
 /* 7z.h -- 7z interface
 2015-11-18 : Igor Pavlov : Public domain */
 
@@ -908,6 +917,8 @@ EXTERN_C_END
 
 #endif
 
+#endif  /* PHYSFS_LZMASDK_DECODER_ONLY */
+
 /* LzmaDec.h -- LZMA Decoder
 2013-01-18 : Igor Pavlov : Public domain */
 
@@ -1090,6 +1101,8 @@ EXTERN_C_END
 
 #endif
 
+#ifndef PHYSFS_LZMASDK_DECODER_ONLY
+
 /* Lzma2Dec.h -- LZMA2 Decoder
 2015-05-13 : Igor Pavlov : Public domain */
 
@@ -1146,9 +1159,13 @@ EXTERN_C_END
 #endif
 
 
+#endif  /* PHYSFS_LZMASDK_DECODER_ONLY */
+
 /* END HEADERS */
 
 
+#ifndef PHYSFS_LZMASDK_DECODER_ONLY
+
 /* 7zCrc.c -- CRC32 init
 2015-03-10 : Igor Pavlov : Public domain */
 
@@ -4718,6 +4735,8 @@ static void Delta_Decode(Byte *state, unsigned delta, Byte *data, SizeT size)
   MyMemCpy(state + delta - j, buf, j);
 }
 
+#endif  /* PHYSFS_LZMASDK_DECODER_ONLY */
+
 /* LzmaDec.c -- LZMA Decoder
 2016-05-16 : Igor Pavlov : Public domain */
 
@@ -5712,6 +5731,8 @@ static SRes LzmaDec_AllocateProbs(CLzmaDec *p, const Byte *props, unsigned props
   return SZ_OK;
 }
 
+#ifndef PHYSFS_LZMASDK_DECODER_ONLY
+
 /* Lzma2Dec.c -- LZMA2 Decoder
 2015-11-09 : Igor Pavlov : Public domain */
 
@@ -6025,6 +6046,8 @@ static SRes Lzma2Dec_DecodeToDic(CLzma2Dec *p, SizeT dicLimit,
   return SZ_OK;
 }
 
+#endif  /* PHYSFS_LZMASDK_DECODER_ONLY */
+
 #endif  /* _INCLUDE_PHYSFS_LZMASDK_H_ */
 
 /* end of physfs_lzmasdk.h ... */
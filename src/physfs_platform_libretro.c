@@ -240,6 +240,23 @@ void __PHYSFS_platformReleaseMutex(void *mutex)
 } /* __PHYSFS_platformReleaseMutex */
 
 
+void *__PHYSFS_platformCreateThread(void (*fn)(void *), void *data)
+{
+    return NULL;  /* !!! FIXME: implement this; callers fall back to one thread. */
+} /* __PHYSFS_platformCreateThread */
+
+
+void __PHYSFS_platformJoinThread(void *thread)
+{
+} /* __PHYSFS_platformJoinThread */
+
+
+int __PHYSFS_platformCPUCount(void)
+{
+    return 1;
+} /* __PHYSFS_platformCPUCount */
+
+
 PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerate(const char *dirname,
                                PHYSFS_EnumerateCallback callback,
                                const char *origdir, void *callbackdata)
@@ -360,6 +377,19 @@ PHYSFS_sint64 __PHYSFS_platformFileLength(void *opaque)
 } /* __PHYSFS_platformFileLength */
 
 
+int __PHYSFS_platformFileId(void *opaque, __PHYSFS_FileId *id)
+{
+    /* the vfs interface can't tell us more than this. */
+    const PHYSFS_sint64 len = __PHYSFS_platformFileLength(opaque);
+    BAIL_IF_ERRPASS(len < 0, 0);
+    id->device = 0;
+    id->inode = 0;
+    id->modtime = 0;
+    id->size = (PHYSFS_uint64) len;
+    return 1;
+} /* __PHYSFS_platformFileId */
+
+
 int __PHYSFS_platformFlush(void *opaque)
 {
     BAIL_IF(physfs_platform_libretro_vfs == NULL || physfs_platform_libretro_vfs->flush == NULL, PHYSFS_ERR_NOT_INITIALIZED, 0);
@@ -462,6 +492,98 @@ int __PHYSFS_platformStat(const char *fname, PHYSFS_Stat *st, const int follow)
     return 1;
 } /* __PHYSFS_platformStat */
 
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateStat(
+                               const char *dirname,
+                               __PHYSFS_EnumerateStatCallback callback,
+                               const char *origdir, void *callbackdata)
+{
+    /* the DIR archiver stats each child itself. */
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+} /* __PHYSFS_platformEnumerateStat */
+
+
+void *__PHYSFS_platformOpenAt(void *dirhandle, const char *path,
+                              const int mode)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* no resolve dir to be relative to. */
+} /* __PHYSFS_platformOpenAt */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateAt(void *dirhandle,
+                               const char *path,
+                               PHYSFS_EnumerateCallback callback,
+                               __PHYSFS_EnumerateStatCallback statcallback,
+                               const char *origdir, void *callbackdata)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+} /* __PHYSFS_platformEnumerateAt */
+
+
+void *__PHYSFS_platformOpenResolveDir(const char *dir)
+{
+    return NULL;  /* no one-step resolve here; verifyPath() stats instead. */
+} /* __PHYSFS_platformOpenResolveDir */
+
+
+int __PHYSFS_platformCheckNoSymlinks(void *dirhandle, const char *path,
+                                     int *exists)
+{
+    return -1;
+} /* __PHYSFS_platformCheckNoSymlinks */
+
+
+void __PHYSFS_platformCloseResolveDir(void *dirhandle)
+{
+} /* __PHYSFS_platformCloseResolveDir */
+
+
+void *__PHYSFS_platformOpenStatDir(void *resolvedir, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* PHYSFS_statMany() stats each. */
+} /* __PHYSFS_platformOpenStatDir */
+
+
+int __PHYSFS_platformStatAt(void *dirhandle, const char *name,
+                            PHYSFS_Stat *st)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformStatAt */
+
+
+void __PHYSFS_platformCloseStatDir(void *dirhandle)
+{
+} /* __PHYSFS_platformCloseStatDir */
+
+
+void *__PHYSFS_platformCreateDirWatcher(void)
+{
+    return NULL;  /* no change notification; DIR mounts aren't cached. */
+} /* __PHYSFS_platformCreateDirWatcher */
+
+
+int __PHYSFS_platformAddDirWatch(void *watcher, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, -1);
+} /* __PHYSFS_platformAddDirWatch */
+
+
+void __PHYSFS_platformRemoveDirWatch(void *watcher, int id)
+{
+} /* __PHYSFS_platformRemoveDirWatch */
+
+
+int __PHYSFS_platformPollDirWatcher(void *watcher,
+                                    __PHYSFS_DirWatchCallback cb, void *data)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformPollDirWatcher */
+
+
+void __PHYSFS_platformDestroyDirWatcher(void *watcher)
+{
+} /* __PHYSFS_platformDestroyDirWatcher */
+
 #endif  /* PHYSFS_PLATFORM_LIBRETRO */
 
 /* end of physfs_platform_libretro.c ... */
@@ -270,6 +270,19 @@ PHYSFS_sint64 __PHYSFS_platformFileLength(void *opaque)
 } /* __PHYSFS_platformFileLength */
 
 
+int __PHYSFS_platformFileId(void *opaque, __PHYSFS_FileId *id)
+{
+    const int fd = *((int *) opaque);
+    struct stat statbuf;
+    BAIL_IF(fstat(fd, &statbuf) == -1, errcodeFromErrno(), 0);
+    id->device = (PHYSFS_uint64) statbuf.st_dev;
+    id->inode = (PHYSFS_uint64) statbuf.st_ino;
+    id->modtime = (PHYSFS_uint64) statbuf.st_mtime;
+    id->size = (PHYSFS_uint64) statbuf.st_size;
+    return 1;
+} /* __PHYSFS_platformFileId */
+
+
 int __PHYSFS_platformFlush(void *opaque)
 {
     const int fd = *((int *) opaque);
@@ -341,6 +354,98 @@ int __PHYSFS_platformStat(const char *fname, PHYSFS_Stat *st, const int follow)
 } /* __PHYSFS_platformStat */
 
 
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateStat(
+                               const char *dirname,
+                               __PHYSFS_EnumerateStatCallback callback,
+                               const char *origdir, void *callbackdata)
+{
+    /* the DIR archiver stats each child itself. */
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+} /* __PHYSFS_platformEnumerateStat */
+
+
+void *__PHYSFS_platformOpenAt(void *dirhandle, const char *path,
+                              const int mode)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* no resolve dir to be relative to. */
+} /* __PHYSFS_platformOpenAt */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateAt(void *dirhandle,
+                               const char *path,
+                               PHYSFS_EnumerateCallback callback,
+                               __PHYSFS_EnumerateStatCallback statcallback,
+                               const char *origdir, void *callbackdata)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+} /* __PHYSFS_platformEnumerateAt */
+
+
+void *__PHYSFS_platformOpenResolveDir(const char *dir)
+{
+    return NULL;  /* no one-step resolve here; verifyPath() stats instead. */
+} /* __PHYSFS_platformOpenResolveDir */
+
+
+int __PHYSFS_platformCheckNoSymlinks(void *dirhandle, const char *path,
+                                     int *exists)
+{
+    return -1;
+} /* __PHYSFS_platformCheckNoSymlinks */
+
+
+void __PHYSFS_platformCloseResolveDir(void *dirhandle)
+{
+} /* __PHYSFS_platformCloseResolveDir */
+
+
+void *__PHYSFS_platformOpenStatDir(void *resolvedir, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* PHYSFS_statMany() stats each. */
+} /* __PHYSFS_platformOpenStatDir */
+
+
+int __PHYSFS_platformStatAt(void *dirhandle, const char *name,
+                            PHYSFS_Stat *st)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformStatAt */
+
+
+void __PHYSFS_platformCloseStatDir(void *dirhandle)
+{
+} /* __PHYSFS_platformCloseStatDir */
+
+
+void *__PHYSFS_platformCreateDirWatcher(void)
+{
+    return NULL;  /* no change notification; DIR mounts aren't cached. */
+} /* __PHYSFS_platformCreateDirWatcher */
+
+
+int __PHYSFS_platformAddDirWatch(void *watcher, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, -1);
+} /* __PHYSFS_platformAddDirWatch */
+
+
+void __PHYSFS_platformRemoveDirWatch(void *watcher, int id)
+{
+} /* __PHYSFS_platformRemoveDirWatch */
+
+
+int __PHYSFS_platformPollDirWatcher(void *watcher,
+                                    __PHYSFS_DirWatchCallback cb, void *data)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformPollDirWatcher */
+
+
+void __PHYSFS_platformDestroyDirWatcher(void *watcher)
+{
+} /* __PHYSFS_platformDestroyDirWatcher */
+
+
 void *__PHYSFS_platformGetThreadID(void)
 {
     return (void *) LWP_GetSelf();
@@ -377,6 +482,23 @@ void __PHYSFS_platformReleaseMutex(void *mutex)
 } /* __PHYSFS_platformReleaseMutex */
 
 
+void *__PHYSFS_platformCreateThread(void (*fn)(void *), void *data)
+{
+    return NULL;  /* !!! FIXME: implement this; callers fall back to one thread. */
+} /* __PHYSFS_platformCreateThread */
+
+
+void __PHYSFS_platformJoinThread(void *thread)
+{
+} /* __PHYSFS_platformJoinThread */
+
+
+int __PHYSFS_platformCPUCount(void)
+{
+    return 1;
+} /* __PHYSFS_platformCPUCount */
+
+
 
 int __PHYSFS_platformInit(const char *argv0)
 {
@@ -721,6 +721,20 @@ static PHYSFS_sint64 os2TimeToUnixTime(const FDATE *date, const FTIME *time)
 } /* os2TimeToUnixTime */
 
 
+int __PHYSFS_platformFileId(void *opaque, __PHYSFS_FileId *id)
+{
+    FILESTATUS3 fs;
+    HFILE hfile = (HFILE) opaque;
+    const APIRET rc = DosQueryFileInfo(hfile, FIL_STANDARD, &fs, sizeof (fs));
+    BAIL_IF(rc != NO_ERROR, errcodeFromAPIRET(rc), 0);
+    id->device = 0;
+    id->inode = 0;
+    id->modtime = (PHYSFS_uint64) os2TimeToUnixTime(&fs.fdateLastWrite, &fs.ftimeLastWrite);
+    id->size = (PHYSFS_uint64) fs.cbFile;
+    return 1;
+} /* __PHYSFS_platformFileId */
+
+
 int __PHYSFS_platformStat(const char *filename, PHYSFS_Stat *stat, const int follow)
 {
     char *cpfname = cvtUtf8ToCodepage(filename);
@@ -765,6 +779,98 @@ done:
 } /* __PHYSFS_platformStat */
 
 
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateStat(
+                               const char *dirname,
+                               __PHYSFS_EnumerateStatCallback callback,
+                               const char *origdir, void *callbackdata)
+{
+    /* the DIR archiver stats each child itself. */
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+} /* __PHYSFS_platformEnumerateStat */
+
+
+void *__PHYSFS_platformOpenAt(void *dirhandle, const char *path,
+                              const int mode)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* no resolve dir to be relative to. */
+} /* __PHYSFS_platformOpenAt */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateAt(void *dirhandle,
+                               const char *path,
+                               PHYSFS_EnumerateCallback callback,
+                               __PHYSFS_EnumerateStatCallback statcallback,
+                               const char *origdir, void *callbackdata)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+} /* __PHYSFS_platformEnumerateAt */
+
+
+void *__PHYSFS_platformOpenResolveDir(const char *dir)
+{
+    return NULL;  /* no one-step resolve here; verifyPath() stats instead. */
+} /* __PHYSFS_platformOpenResolveDir */
+
+
+int __PHYSFS_platformCheckNoSymlinks(void *dirhandle, const char *path,
+                                     int *exists)
+{
+    return -1;
+} /* __PHYSFS_platformCheckNoSymlinks */
+
+
+void __PHYSFS_platformCloseResolveDir(void *dirhandle)
+{
+} /* __PHYSFS_platformCloseResolveDir */
+
+
+void *__PHYSFS_platformOpenStatDir(void *resolvedir, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* PHYSFS_statMany() stats each. */
+} /* __PHYSFS_platformOpenStatDir */
+
+
+int __PHYSFS_platformStatAt(void *dirhandle, const char *name,
+                            PHYSFS_Stat *st)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformStatAt */
+
+
+void __PHYSFS_platformCloseStatDir(void *dirhandle)
+{
+} /* __PHYSFS_platformCloseStatDir */
+
+
+void *__PHYSFS_platformCreateDirWatcher(void)
+{
+    return NULL;  /* no change notification; DIR mounts aren't cached. */
+} /* __PHYSFS_platformCreateDirWatcher */
+
+
+int __PHYSFS_platformAddDirWatch(void *watcher, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, -1);
+} /* __PHYSFS_platformAddDirWatch */
+
+
+void __PHYSFS_platformRemoveDirWatch(void *watcher, int id)
+{
+} /* __PHYSFS_platformRemoveDirWatch */
+
+
+int __PHYSFS_platformPollDirWatcher(void *watcher,
+                                    __PHYSFS_DirWatchCallback cb, void *data)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformPollDirWatcher */
+
+
+void __PHYSFS_platformDestroyDirWatcher(void *watcher)
+{
+} /* __PHYSFS_platformDestroyDirWatcher */
+
+
 void *__PHYSFS_platformGetThreadID(void)
 {
     PTIB ptib;
@@ -807,6 +913,23 @@ void __PHYSFS_platformReleaseMutex(void *mutex)
     DosReleaseMutexSem((HMTX) mutex);
 } /* __PHYSFS_platformReleaseMutex */
 
+
+void *__PHYSFS_platformCreateThread(void (*fn)(void *), void *data)
+{
+    return NULL;  /* !!! FIXME: implement this; callers fall back to one thread. */
+} /* __PHYSFS_platformCreateThread */
+
+
+void __PHYSFS_platformJoinThread(void *thread)
+{
+} /* __PHYSFS_platformJoinThread */
+
+
+int __PHYSFS_platformCPUCount(void)
+{
+    return 1;
+} /* __PHYSFS_platformCPUCount */
+
 #endif  /* PHYSFS_PLATFORM_OS2 */
 
 /* end of physfs_platform_os2.c ... */
@@ -199,6 +199,19 @@ PHYSFS_sint64 __PHYSFS_platformFileLength(void *opaque)
     return (PHYSFS_sint64) retval;
 }
 
+int __PHYSFS_platformFileId(void *opaque, __PHYSFS_FileId *id)
+{
+    /* no fstat() here; the length is the best we can do. */
+    const PHYSFS_sint64 len = __PHYSFS_platformFileLength(opaque);
+    BAIL_IF_ERRPASS(len < 0, 0);
+    id->device = 0;
+    id->inode = 0;
+    id->modtime = 0;
+    id->size = (PHYSFS_uint64) len;
+    return 1;
+}
+
+
 int __PHYSFS_platformFlush(void *opaque)
 {
     BAIL_IF(playdate->file->flush((SDFile *) opaque) == -1, PHYSFS_ERR_OS_ERROR, 0);
@@ -238,6 +251,72 @@ int __PHYSFS_platformStat(const char *filename, PHYSFS_Stat *st, const int follo
     return 1;
 }
 
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateStat(const char *dirname, __PHYSFS_EnumerateStatCallback callback, const char *origdir, void *callbackdata)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+}
+
+void *__PHYSFS_platformOpenAt(void *dirhandle, const char *path, const int mode)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);
+}
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateAt(void *dirhandle, const char *path, PHYSFS_EnumerateCallback callback, __PHYSFS_EnumerateStatCallback statcallback, const char *origdir, void *callbackdata)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+}
+
+void *__PHYSFS_platformOpenResolveDir(const char *dir)
+{
+    return NULL;  /* no symlinks here anyhow. */
+}
+
+int __PHYSFS_platformCheckNoSymlinks(void *dirhandle, const char *path, int *exists)
+{
+    return -1;
+}
+
+void __PHYSFS_platformCloseResolveDir(void *dirhandle)
+{
+}
+
+void *__PHYSFS_platformOpenStatDir(void *resolvedir, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);
+}
+
+int __PHYSFS_platformStatAt(void *dirhandle, const char *name, PHYSFS_Stat *st)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+}
+
+void __PHYSFS_platformCloseStatDir(void *dirhandle)
+{
+}
+
+void *__PHYSFS_platformCreateDirWatcher(void)
+{
+    return NULL;
+}
+
+int __PHYSFS_platformAddDirWatch(void *watcher, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, -1);
+}
+
+void __PHYSFS_platformRemoveDirWatch(void *watcher, int id)
+{
+}
+
+int __PHYSFS_platformPollDirWatcher(void *watcher, __PHYSFS_DirWatchCallback cb, void *data)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+}
+
+void __PHYSFS_platformDestroyDirWatcher(void *watcher)
+{
+}
+
 void *__PHYSFS_platformGetThreadID(void)
 {
     return (void *) (size_t) 0x1;  /* !!! FIXME: does Playdate have threads? */
@@ -261,6 +340,20 @@ void __PHYSFS_platformReleaseMutex(void *mutex)
 {
 }
 
+void *__PHYSFS_platformCreateThread(void (*fn)(void *), void *data)
+{
+    return NULL;  /* !!! FIXME: does Playdate have threads? */
+}
+
+void __PHYSFS_platformJoinThread(void *thread)
+{
+}
+
+int __PHYSFS_platformCPUCount(void)
+{
+    return 1;
+}
+
 
 #undef realloc
 
@@ -6,6 +6,10 @@
  *  This file written by Ryan C. Gordon.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE 1  /* for O_PATH. */
+#endif
+
 #define __PHYSICSFS_INTERNAL__
 #include "physfs_platforms.h"
 
@@ -21,6 +25,11 @@
 #include <fcntl.h>
 #include <pthread.h>
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/inotify.h>
+#endif
+
 #include "physfs_internal.h"
 
 
@@ -116,17 +125,50 @@ char *__PHYSFS_platformCalcUserDir(void)
 } /* __PHYSFS_platformCalcUserDir */
 
 
-PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerate(const char *dirname,
+static void statbufToPhysfsStat(const struct stat *statbuf, PHYSFS_Stat *st)
+{
+    if (S_ISREG(statbuf->st_mode))
+    {
+        st->filetype = PHYSFS_FILETYPE_REGULAR;
+        st->filesize = statbuf->st_size;
+    } /* if */
+
+    else if(S_ISDIR(statbuf->st_mode))
+    {
+        st->filetype = PHYSFS_FILETYPE_DIRECTORY;
+        st->filesize = 0;
+    } /* else if */
+
+    else if(S_ISLNK(statbuf->st_mode))
+    {
+        st->filetype = PHYSFS_FILETYPE_SYMLINK;
+        st->filesize = 0;
+    } /* else if */
+
+    else
+    {
+        st->filetype = PHYSFS_FILETYPE_OTHER;
+        st->filesize = statbuf->st_size;
+    } /* else */
+
+    st->modtime = statbuf->st_mtime;
+    st->createtime = statbuf->st_ctime;
+    st->accesstime = statbuf->st_atime;
+} /* statbufToPhysfsStat */
+
+
+/*
+ * Hand each child of (dir) to (callback), or to (statcallback) along with
+ *  what lstat() says about it, then close (dir).
+ */
+static PHYSFS_EnumerateCallbackResult doEnumerate(DIR *dir,
                                PHYSFS_EnumerateCallback callback,
+                               __PHYSFS_EnumerateStatCallback statcallback,
                                const char *origdir, void *callbackdata)
 {
-    DIR *dir;
     struct dirent *ent;
     PHYSFS_EnumerateCallbackResult retval = PHYSFS_ENUM_OK;
 
-    dir = opendir(dirname);
-    BAIL_IF(dir == NULL, errcodeFromErrno(), PHYSFS_ENUM_ERROR);
-
     while ((retval == PHYSFS_ENUM_OK) && ((ent = readdir(dir)) != NULL))
     {
         const char *name = ent->d_name;
@@ -136,7 +178,32 @@ PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerate(const char *dirname,
                 continue;
         } /* if */
 
-        retval = callback(callbackdata, origdir, name);
+        if (statcallback == NULL)
+            retval = callback(callbackdata, origdir, name);
+
+        #ifdef AT_SYMLINK_NOFOLLOW
+        else
+        {
+            const int fd = dirfd(dir);
+            struct stat statbuf;
+            PHYSFS_Stat st;
+
+            /* relative to the open dir, so the kernel doesn't walk the path. */
+            if (fstatat(fd, name, &statbuf, AT_SYMLINK_NOFOLLOW) == -1)
+            {
+                if (errno == ENOENT)
+                    continue;  /* deleted since readdir() saw it. */
+                PHYSFS_setErrorCode(errcodeFromErrno());
+                retval = PHYSFS_ENUM_ERROR;
+                break;
+            } /* if */
+
+            statbufToPhysfsStat(&statbuf, &st);
+            st.readonly = (faccessat(fd, name, W_OK, 0) == -1);
+            retval = statcallback(callbackdata, origdir, name, &st);
+        } /* else */
+        #endif
+
         if (retval == PHYSFS_ENUM_ERROR)
             PHYSFS_setErrorCode(PHYSFS_ERR_APP_CALLBACK);
     } /* while */
@@ -144,6 +211,16 @@ PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerate(const char *dirname,
     closedir(dir);
 
     return retval;
+} /* doEnumerate */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerate(const char *dirname,
+                               PHYSFS_EnumerateCallback callback,
+                               const char *origdir, void *callbackdata)
+{
+    DIR *dir = opendir(dirname);
+    BAIL_IF(dir == NULL, errcodeFromErrno(), PHYSFS_ENUM_ERROR);
+    return doEnumerate(dir, callback, NULL, origdir, callbackdata);
 } /* __PHYSFS_platformEnumerate */
 
 
@@ -165,7 +242,7 @@ static inline void set_CLOEXEC(int fildes)
 }
 #endif
 
-static void *doOpen(const char *filename, int mode)
+static void *doOpen(const int *rootfd, const char *filename, int mode)
 {
     const int appending = (mode & O_APPEND);
     int fd;
@@ -182,6 +259,11 @@ static void *doOpen(const char *filename, int mode)
 #endif
 
     do {
+        #ifdef AT_SYMLINK_NOFOLLOW
+        if (rootfd != NULL)
+            fd = openat(*rootfd, filename, mode, S_IRUSR | S_IWUSR);
+        else
+        #endif
         fd = open(filename, mode, S_IRUSR | S_IWUSR);
     } while ((fd < 0) && (errno == EINTR));
     BAIL_IF(fd < 0, errcodeFromErrno(), NULL);
@@ -214,22 +296,44 @@ static void *doOpen(const char *filename, int mode)
 
 void *__PHYSFS_platformOpenRead(const char *filename)
 {
-    return doOpen(filename, O_RDONLY);
+    return doOpen(NULL, filename, O_RDONLY);
 } /* __PHYSFS_platformOpenRead */
 
 
 void *__PHYSFS_platformOpenWrite(const char *filename)
 {
-    return doOpen(filename, O_WRONLY | O_CREAT | O_TRUNC);
+    return doOpen(NULL, filename, O_WRONLY | O_CREAT | O_TRUNC);
 } /* __PHYSFS_platformOpenWrite */
 
 
 void *__PHYSFS_platformOpenAppend(const char *filename)
 {
-    return doOpen(filename, O_WRONLY | O_CREAT | O_APPEND);
+    return doOpen(NULL, filename, O_WRONLY | O_CREAT | O_APPEND);
 } /* __PHYSFS_platformOpenAppend */
 
 
+void *__PHYSFS_platformOpenAt(void *dirhandle, const char *path,
+                              const int mode)
+{
+#ifdef AT_SYMLINK_NOFOLLOW
+    const int *rootfd = (const int *) dirhandle;
+    if (*path == '\0')
+        path = ".";
+
+    if (mode == 'r')
+        return doOpen(rootfd, path, O_RDONLY);
+    else if (mode == 'w')
+        return doOpen(rootfd, path, O_WRONLY | O_CREAT | O_TRUNC);
+    return doOpen(rootfd, path, O_WRONLY | O_CREAT | O_APPEND);
+#else
+    (void) dirhandle;
+    (void) path;
+    (void) mode;
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);
+#endif
+} /* __PHYSFS_platformOpenAt */
+
+
 PHYSFS_sint64 __PHYSFS_platformRead(void *opaque, void *buffer,
                                     PHYSFS_uint64 len)
 {
@@ -296,6 +400,19 @@ PHYSFS_sint64 __PHYSFS_platformFileLength(void *opaque)
 } /* __PHYSFS_platformFileLength */
 
 
+int __PHYSFS_platformFileId(void *opaque, __PHYSFS_FileId *id)
+{
+    const int fd = *((int *) opaque);
+    struct stat statbuf;
+    BAIL_IF(fstat(fd, &statbuf) == -1, errcodeFromErrno(), 0);
+    id->device = (PHYSFS_uint64) statbuf.st_dev;
+    id->inode = (PHYSFS_uint64) statbuf.st_ino;
+    id->modtime = (PHYSFS_uint64) statbuf.st_mtime;
+    id->size = (PHYSFS_uint64) statbuf.st_size;
+    return 1;
+} /* __PHYSFS_platformFileId */
+
+
 int __PHYSFS_platformFlush(void *opaque)
 {
     const int fd = *((int *) opaque);
@@ -333,38 +450,382 @@ int __PHYSFS_platformStat(const char *fname, PHYSFS_Stat *st, const int follow)
     struct stat statbuf;
     const int rc = follow ? stat(fname, &statbuf) : lstat(fname, &statbuf);
     BAIL_IF(rc == -1, errcodeFromErrno(), 0);
+    statbufToPhysfsStat(&statbuf, st);
+    st->readonly = (access(fname, W_OK) == -1);
+    return 1;
+} /* __PHYSFS_platformStat */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateStat(
+                               const char *dirname,
+                               __PHYSFS_EnumerateStatCallback callback,
+                               const char *origdir, void *callbackdata)
+{
+#ifdef AT_SYMLINK_NOFOLLOW
+    DIR *dir = opendir(dirname);
+    BAIL_IF(dir == NULL, errcodeFromErrno(), PHYSFS_ENUM_ERROR);
+    return doEnumerate(dir, NULL, callback, origdir, callbackdata);
+#else
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+#endif
+} /* __PHYSFS_platformEnumerateStat */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateAt(void *dirhandle,
+                               const char *path,
+                               PHYSFS_EnumerateCallback callback,
+                               __PHYSFS_EnumerateStatCallback statcallback,
+                               const char *origdir, void *callbackdata)
+{
+#ifdef AT_SYMLINK_NOFOLLOW
+    const int rootfd = *((int *) dirhandle);
+    int flags = O_RDONLY | O_DIRECTORY;
+    DIR *dir;
+    int fd;
+
+    #ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+    #endif
+
+    do {
+        fd = openat(rootfd, *path ? path : ".", flags);
+    } while ((fd == -1) && (errno == EINTR));
+    BAIL_IF(fd == -1, errcodeFromErrno(), PHYSFS_ENUM_ERROR);
 
-    if (S_ISREG(statbuf.st_mode))
+    dir = fdopendir(fd);
+    if (dir == NULL)
     {
-        st->filetype = PHYSFS_FILETYPE_REGULAR;
-        st->filesize = statbuf.st_size;
+        const int err = errno;
+        close(fd);
+        BAIL(errcodeFromErrnoError(err), PHYSFS_ENUM_ERROR);
     } /* if */
 
-    else if(S_ISDIR(statbuf.st_mode))
+    return doEnumerate(dir, callback, statcallback, origdir, callbackdata);
+#else
+    (void) dirhandle;
+    (void) path;
+    (void) callback;
+    (void) statcallback;
+    (void) origdir;
+    (void) callbackdata;
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+#endif
+} /* __PHYSFS_platformEnumerateAt */
+
+
+#if defined(__linux__) && defined(SYS_openat2) && defined(O_PATH)
+#define PHYSFS_HAVE_OPENAT2 1
+
+/* older headers have the syscall number but not <linux/openat2.h>. */
+typedef struct
+{
+    PHYSFS_uint64 flags;
+    PHYSFS_uint64 mode;
+    PHYSFS_uint64 resolve;
+} PosixOpenHow;
+
+#define POSIX_RESOLVE_NO_SYMLINKS 0x04
+#define POSIX_RESOLVE_BENEATH 0x08
+#endif
+
+
+void *__PHYSFS_platformOpenResolveDir(const char *dir)
+{
+#ifdef AT_SYMLINK_NOFOLLOW
+    #ifdef O_PATH
+    int flags = O_PATH | O_DIRECTORY;  /* don't need read permission. */
+    #else
+    int flags = O_RDONLY | O_DIRECTORY;
+    #endif
+    int *retval;
+    int fd;
+
+    #ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+    #endif
+
+    do {
+        fd = open(dir, flags);
+    } while ((fd == -1) && (errno == EINTR));
+
+    if (fd == -1)
+        return NULL;
+
+    retval = (int *) allocator.Malloc(sizeof (int));
+    if (!retval)
     {
-        st->filetype = PHYSFS_FILETYPE_DIRECTORY;
-        st->filesize = 0;
-    } /* else if */
+        close(fd);
+        return NULL;
+    } /* if */
+
+    *retval = fd;
+    return retval;
+#else
+    (void) dir;
+    return NULL;
+#endif
+} /* __PHYSFS_platformOpenResolveDir */
+
+
+int __PHYSFS_platformCheckNoSymlinks(void *dirhandle, const char *path,
+                                     int *exists)
+{
+#ifdef PHYSFS_HAVE_OPENAT2
+    const int dirfd = *((int *) dirhandle);
+    PosixOpenHow how;
+    long fd;
+
+    *exists = 1;
+    if (*path == '\0')
+        return 1;
+
+    memset(&how, '\0', sizeof (how));
+    how.flags = O_PATH | O_CLOEXEC;
+    how.resolve = POSIX_RESOLVE_NO_SYMLINKS | POSIX_RESOLVE_BENEATH;
+
+    /* the kernel walks every element and refuses any symlink, in one call. */
+    do {
+        fd = syscall(SYS_openat2, dirfd, path, &how, sizeof (how));
+    } while ((fd == -1) && (errno == EINTR));
 
-    else if(S_ISLNK(statbuf.st_mode))
+    if (fd != -1)
     {
-        st->filetype = PHYSFS_FILETYPE_SYMLINK;
-        st->filesize = 0;
-    } /* else if */
+        close((int) fd);
+        return 1;
+    } /* if */
+
+    switch (errno)
+    {
+        case ENOENT: case ENOTDIR: *exists = 0; return 1;
+        case ELOOP: return 0;
+        default: return -1;  /* ENOSYS, seccomp, etc: check the slow way. */
+    } /* switch */
+#else
+    (void) dirhandle;
+    (void) path;
+    (void) exists;
+    return -1;
+#endif
+} /* __PHYSFS_platformCheckNoSymlinks */
+
+
+void __PHYSFS_platformCloseResolveDir(void *dirhandle)
+{
+    if (dirhandle != NULL)
+    {
+        close(*((int *) dirhandle));
+        allocator.Free(dirhandle);
+    } /* if */
+} /* __PHYSFS_platformCloseResolveDir */
+
+
+void *__PHYSFS_platformOpenStatDir(void *resolvedir, const char *path)
+{
+#ifdef AT_SYMLINK_NOFOLLOW
+    int *retval;
+    long fd;
+
+    if (resolvedir != NULL)
+    {
+#ifdef PHYSFS_HAVE_OPENAT2
+        const int dirfd = *((int *) resolvedir);
+        PosixOpenHow how;
+
+        memset(&how, '\0', sizeof (how));
+        how.flags = O_PATH | O_DIRECTORY | O_CLOEXEC;
+        how.resolve = POSIX_RESOLVE_NO_SYMLINKS | POSIX_RESOLVE_BENEATH;
+
+        do {
+            fd = syscall(SYS_openat2, dirfd, *path ? path : ".",
+                         &how, sizeof (how));
+        } while ((fd == -1) && (errno == EINTR));
+
+        if ((fd == -1) && (errno == ELOOP))
+            BAIL(PHYSFS_ERR_SYMLINK_FORBIDDEN, NULL);
+        else if ((fd == -1) && (errno == ENOSYS))
+            BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);
+#else
+        BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* can't refuse symlinks here. */
+#endif
+    } /* if */
 
     else
     {
-        st->filetype = PHYSFS_FILETYPE_OTHER;
-        st->filesize = statbuf.st_size;
+        #ifdef O_PATH
+        int flags = O_PATH | O_DIRECTORY;
+        #else
+        int flags = O_RDONLY | O_DIRECTORY;
+        #endif
+        #ifdef O_CLOEXEC
+        flags |= O_CLOEXEC;
+        #endif
+        do {
+            fd = open(path, flags);
+        } while ((fd == -1) && (errno == EINTR));
     } /* else */
 
-    st->modtime = statbuf.st_mtime;
-    st->createtime = statbuf.st_ctime;
-    st->accesstime = statbuf.st_atime;
+    BAIL_IF(fd == -1, errcodeFromErrno(), NULL);
 
-    st->readonly = (access(fname, W_OK) == -1);
+    retval = (int *) allocator.Malloc(sizeof (int));
+    if (!retval)
+    {
+        close((int) fd);
+        BAIL(PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    } /* if */
+
+    *retval = (int) fd;
+    return retval;
+#else
+    (void) resolvedir;
+    (void) path;
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);
+#endif
+} /* __PHYSFS_platformOpenStatDir */
+
+
+int __PHYSFS_platformStatAt(void *dirhandle, const char *name,
+                            PHYSFS_Stat *st)
+{
+#ifdef AT_SYMLINK_NOFOLLOW
+    const int fd = *((int *) dirhandle);
+    struct stat statbuf;
+
+    /* relative to the open dir, so the kernel doesn't walk the path. */
+    BAIL_IF(fstatat(fd, name, &statbuf, AT_SYMLINK_NOFOLLOW) == -1,
+            errcodeFromErrno(), 0);
+    statbufToPhysfsStat(&statbuf, st);
+    st->readonly = (faccessat(fd, name, W_OK, 0) == -1);
     return 1;
-} /* __PHYSFS_platformStat */
+#else
+    (void) dirhandle;
+    (void) name;
+    (void) st;
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+#endif
+} /* __PHYSFS_platformStatAt */
+
+
+void __PHYSFS_platformCloseStatDir(void *dirhandle)
+{
+    __PHYSFS_platformCloseResolveDir(dirhandle);  /* it's just an fd, too. */
+} /* __PHYSFS_platformCloseStatDir */
+
+
+#ifdef __linux__
+#define PHYSFS_HAVE_INOTIFY 1
+
+#ifndef IN_EXCL_UNLINK  /* older headers. */
+#define IN_EXCL_UNLINK 0
+#endif
+#endif
+
+
+void *__PHYSFS_platformCreateDirWatcher(void)
+{
+#ifdef PHYSFS_HAVE_INOTIFY
+    int *retval;
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (fd == -1)
+        return NULL;  /* no inotify in this kernel, or out of instances. */
+
+    retval = (int *) allocator.Malloc(sizeof (int));
+    if (!retval)
+    {
+        close(fd);
+        return NULL;
+    } /* if */
+
+    *retval = fd;
+    return retval;
+#else
+    return NULL;
+#endif
+} /* __PHYSFS_platformCreateDirWatcher */
+
+
+int __PHYSFS_platformAddDirWatch(void *watcher, const char *path)
+{
+#ifdef PHYSFS_HAVE_INOTIFY
+    const PHYSFS_uint32 mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                               IN_MOVED_TO | IN_MODIFY | IN_ATTRIB |
+                               IN_CLOSE_WRITE | IN_DELETE_SELF |
+                               IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+    const int rc = inotify_add_watch(*((int *) watcher), path, mask);
+    BAIL_IF(rc == -1, errcodeFromErrno(), -1);
+    return rc;
+#else
+    (void) watcher;
+    (void) path;
+    BAIL(PHYSFS_ERR_UNSUPPORTED, -1);
+#endif
+} /* __PHYSFS_platformAddDirWatch */
+
+
+void __PHYSFS_platformRemoveDirWatch(void *watcher, int id)
+{
+#ifdef PHYSFS_HAVE_INOTIFY
+    inotify_rm_watch(*((int *) watcher), id);  /* fails if it's gone; fine. */
+#else
+    (void) watcher;
+    (void) id;
+#endif
+} /* __PHYSFS_platformRemoveDirWatch */
+
+
+int __PHYSFS_platformPollDirWatcher(void *watcher,
+                                    __PHYSFS_DirWatchCallback cb, void *data)
+{
+#ifdef PHYSFS_HAVE_INOTIFY
+    const int fd = *((int *) watcher);
+    union { struct inotify_event event; char buf[4096]; } u;
+
+    while (1)
+    {
+        ssize_t br;
+        char *ptr;
+
+        do {
+            br = read(fd, u.buf, sizeof (u.buf));
+        } while ((br == -1) && (errno == EINTR));
+
+        if (br == -1)
+        {
+            BAIL_IF(errno != EAGAIN, errcodeFromErrno(), 0);
+            return 1;  /* nothing else queued. */
+        } /* if */
+
+        for (ptr = u.buf; ptr < u.buf + br; )
+        {
+            const struct inotify_event *ev = (const struct inotify_event *) ptr;
+            const char *name = (ev->len > 0) ? ev->name : NULL;
+            ptr += sizeof (struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW)
+                cb(data, -1, __PHYSFS_DIRWATCH_OVERFLOW, NULL);
+            else if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF |
+                                 IN_IGNORED | IN_UNMOUNT))
+                cb(data, ev->wd, __PHYSFS_DIRWATCH_GONE, NULL);
+            else if (ev->mask & (IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO))
+                cb(data, ev->wd, __PHYSFS_DIRWATCH_RENAMED, name);
+            else
+                cb(data, ev->wd, __PHYSFS_DIRWATCH_CHANGED, name);
+        } /* for */
+    } /* while */
+#else
+    (void) watcher;
+    (void) cb;
+    (void) data;
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+#endif
+} /* __PHYSFS_platformPollDirWatcher */
+
+
+void __PHYSFS_platformDestroyDirWatcher(void *watcher)
+{
+    close(*((int *) watcher));  /* closing it drops every watch. */
+    allocator.Free(watcher);
+} /* __PHYSFS_platformDestroyDirWatcher */
 
 
 typedef struct
@@ -443,6 +904,56 @@ void __PHYSFS_platformReleaseMutex(void *mutex)
     } /* if */
 } /* __PHYSFS_platformReleaseMutex */
 
+
+typedef struct
+{
+    pthread_t thread;
+    void (*fn)(void *);
+    void *data;
+} PthreadThread;
+
+static void *pthreadThreadEntry(void *arg)
+{
+    PthreadThread *t = (PthreadThread *) arg;
+    t->fn(t->data);
+    return NULL;
+} /* pthreadThreadEntry */
+
+
+void *__PHYSFS_platformCreateThread(void (*fn)(void *), void *data)
+{
+    PthreadThread *t = (PthreadThread *) allocator.Malloc(sizeof (PthreadThread));
+    BAIL_IF(!t, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    t->fn = fn;
+    t->data = data;
+    if (pthread_create(&t->thread, NULL, pthreadThreadEntry, t) != 0)
+    {
+        allocator.Free(t);
+        BAIL(PHYSFS_ERR_OS_ERROR, NULL);
+    } /* if */
+
+    return t;
+} /* __PHYSFS_platformCreateThread */
+
+
+void __PHYSFS_platformJoinThread(void *thread)
+{
+    PthreadThread *t = (PthreadThread *) thread;
+    pthread_join(t->thread, NULL);
+    allocator.Free(t);
+} /* __PHYSFS_platformJoinThread */
+
+
+int __PHYSFS_platformCPUCount(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    const long rc = sysconf(_SC_NPROCESSORS_ONLN);
+    if (rc > 1)
+        return (rc > 0x7FFF) ? 0x7FFF : (int) rc;
+#endif
+    return 1;
+} /* __PHYSFS_platformCPUCount */
+
 #endif  /* PHYSFS_PLATFORM_POSIX */
 
 /* end of physfs_platform_posix.c ... */
@@ -834,6 +834,34 @@ PHYSFS_sint64 __PHYSFS_platformFileLength(void *opaque)
 } /* __PHYSFS_platformFileLength */
 
 
+int __PHYSFS_platformFileId(void *opaque, __PHYSFS_FileId *id)
+{
+    HANDLE h = (HANDLE) opaque;
+    #ifdef PHYSFS_PLATFORM_WINRT
+    FILE_BASIC_INFO info;
+    const PHYSFS_sint64 len = winGetFileSize(h);
+    BAIL_IF(len < 0, errcodeFromWinApi(), 0);
+    if (!GetFileInformationByHandleEx(h, FileBasicInfo, &info, sizeof (info)))
+        BAIL(errcodeFromWinApi(), 0);
+    id->device = 0;  /* !!! FIXME: FileIdInfo has these on Windows 8+. */
+    id->inode = 0;
+    id->modtime = (PHYSFS_uint64) info.LastWriteTime.QuadPart;
+    id->size = (PHYSFS_uint64) len;
+    #else
+    BY_HANDLE_FILE_INFORMATION info;
+    BAIL_IF(!GetFileInformationByHandle(h, &info), errcodeFromWinApi(), 0);
+    id->device = (PHYSFS_uint64) info.dwVolumeSerialNumber;
+    id->inode = (((PHYSFS_uint64) info.nFileIndexHigh) << 32) |
+                ((PHYSFS_uint64) info.nFileIndexLow);
+    id->modtime = (((PHYSFS_uint64) info.ftLastWriteTime.dwHighDateTime) << 32) |
+                  ((PHYSFS_uint64) info.ftLastWriteTime.dwLowDateTime);
+    id->size = (((PHYSFS_uint64) info.nFileSizeHigh) << 32) |
+               ((PHYSFS_uint64) info.nFileSizeLow);
+    #endif
+    return 1;
+} /* __PHYSFS_platformFileId */
+
+
 int __PHYSFS_platformFlush(void *opaque)
 {
     HANDLE h = (HANDLE) opaque;
@@ -912,6 +940,59 @@ void __PHYSFS_platformReleaseMutex(void *mutex)
 } /* __PHYSFS_platformReleaseMutex */
 
 
+typedef struct
+{
+    HANDLE handle;
+    void (*fn)(void *);
+    void *data;
+} WinThread;
+
+static DWORD WINAPI winThreadEntry(LPVOID arg)
+{
+    WinThread *t = (WinThread *) arg;
+    t->fn(t->data);
+    return 0;
+} /* winThreadEntry */
+
+
+void *__PHYSFS_platformCreateThread(void (*fn)(void *), void *data)
+{
+#ifdef PHYSFS_PLATFORM_WINRT
+    return NULL;  /* !!! FIXME: use the WinRT thread pool? */
+#else
+    WinThread *t = (WinThread *) allocator.Malloc(sizeof (WinThread));
+    BAIL_IF(!t, PHYSFS_ERR_OUT_OF_MEMORY, NULL);
+    t->fn = fn;
+    t->data = data;
+    t->handle = CreateThread(NULL, 0, winThreadEntry, t, 0, NULL);
+    if (t->handle == NULL)
+    {
+        allocator.Free(t);
+        BAIL(errcodeFromWinApi(), NULL);
+    } /* if */
+
+    return t;
+#endif
+} /* __PHYSFS_platformCreateThread */
+
+
+void __PHYSFS_platformJoinThread(void *thread)
+{
+    WinThread *t = (WinThread *) thread;
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+    allocator.Free(t);
+} /* __PHYSFS_platformJoinThread */
+
+
+int __PHYSFS_platformCPUCount(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors > 1) ? (int) info.dwNumberOfProcessors : 1;
+} /* __PHYSFS_platformCPUCount */
+
+
 static PHYSFS_sint64 FileTimeToPhysfsTime(const FILETIME *ft)
 {
     SYSTEMTIME st_utc;
@@ -1023,6 +1104,98 @@ int __PHYSFS_platformStat(const char *filename, PHYSFS_Stat *st, const int follo
     return 1;
 } /* __PHYSFS_platformStat */
 
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateStat(
+                               const char *dirname,
+                               __PHYSFS_EnumerateStatCallback callback,
+                               const char *origdir, void *callbackdata)
+{
+    /* the DIR archiver stats each child itself. */
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+} /* __PHYSFS_platformEnumerateStat */
+
+
+void *__PHYSFS_platformOpenAt(void *dirhandle, const char *path,
+                              const int mode)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* no resolve dir to be relative to. */
+} /* __PHYSFS_platformOpenAt */
+
+
+PHYSFS_EnumerateCallbackResult __PHYSFS_platformEnumerateAt(void *dirhandle,
+                               const char *path,
+                               PHYSFS_EnumerateCallback callback,
+                               __PHYSFS_EnumerateStatCallback statcallback,
+                               const char *origdir, void *callbackdata)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, PHYSFS_ENUM_ERROR);
+} /* __PHYSFS_platformEnumerateAt */
+
+
+void *__PHYSFS_platformOpenResolveDir(const char *dir)
+{
+    return NULL;  /* no one-step resolve here; verifyPath() stats instead. */
+} /* __PHYSFS_platformOpenResolveDir */
+
+
+int __PHYSFS_platformCheckNoSymlinks(void *dirhandle, const char *path,
+                                     int *exists)
+{
+    return -1;
+} /* __PHYSFS_platformCheckNoSymlinks */
+
+
+void __PHYSFS_platformCloseResolveDir(void *dirhandle)
+{
+} /* __PHYSFS_platformCloseResolveDir */
+
+
+void *__PHYSFS_platformOpenStatDir(void *resolvedir, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, NULL);  /* PHYSFS_statMany() stats each. */
+} /* __PHYSFS_platformOpenStatDir */
+
+
+int __PHYSFS_platformStatAt(void *dirhandle, const char *name,
+                            PHYSFS_Stat *st)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformStatAt */
+
+
+void __PHYSFS_platformCloseStatDir(void *dirhandle)
+{
+} /* __PHYSFS_platformCloseStatDir */
+
+
+void *__PHYSFS_platformCreateDirWatcher(void)
+{
+    return NULL;  /* no change notification; DIR mounts aren't cached. */
+} /* __PHYSFS_platformCreateDirWatcher */
+
+
+int __PHYSFS_platformAddDirWatch(void *watcher, const char *path)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, -1);
+} /* __PHYSFS_platformAddDirWatch */
+
+
+void __PHYSFS_platformRemoveDirWatch(void *watcher, int id)
+{
+} /* __PHYSFS_platformRemoveDirWatch */
+
+
+int __PHYSFS_platformPollDirWatcher(void *watcher,
+                                    __PHYSFS_DirWatchCallback cb, void *data)
+{
+    BAIL(PHYSFS_ERR_UNSUPPORTED, 0);
+} /* __PHYSFS_platformPollDirWatcher */
+
+
+void __PHYSFS_platformDestroyDirWatcher(void *watcher)
+{
+} /* __PHYSFS_platformDestroyDirWatcher */
+
 #endif  /* PHYSFS_PLATFORM_WINDOWS */
 
 /* end of physfs_platform_windows.c ... */
@@ -1,3 +1,12 @@
+/* the intrinsics headers may use malloc(), so get them in first. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define PHYSFS_HAVE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define PHYSFS_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
 #define __PHYSICSFS_INTERNAL__
 #include "physfs_internal.h"
 
@@ -522,6 +531,141 @@ int PHYSFS_caseFold(const PHYSFS_uint32 from, PHYSFS_uint32 *to)
 } /* PHYSFS_caseFold */
 
 
+/*
+ * Nearly every path is all ASCII, and PHYSFS_caseFold() only has to lower
+ *  'A' to 'Z' for those, so check 16 bytes at a time for a high bit and
+ *  fold them all at once. Anything else goes through PHYSFS_caseFold().
+ */
+int __PHYSFS_utf8LowerAscii16(const char *src, char *dst)
+{
+#if PHYSFS_HAVE_SSE2
+    __m128i v = _mm_loadu_si128((const __m128i *) src);
+    __m128i upper;
+    if (_mm_movemask_epi8(v) != 0)
+        return 0;
+    /* move 'A' to -128, so 'A' to 'Z' are the only bytes less than -102. */
+    upper = _mm_add_epi8(v, _mm_set1_epi8((char) (0x80 - 'A')));
+    upper = _mm_cmplt_epi8(upper, _mm_set1_epi8((char) (0x80 + 26)));
+    v = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128((__m128i *) dst, v);
+    return 1;
+#elif PHYSFS_HAVE_NEON
+    uint8x16_t v = vld1q_u8((const PHYSFS_uint8 *) src);
+    const uint64x2_t high = vreinterpretq_u64_u8(vandq_u8(v, vdupq_n_u8(0x80)));
+    uint8x16_t upper;
+    if ((vgetq_lane_u64(high, 0) | vgetq_lane_u64(high, 1)) != 0)
+        return 0;
+    upper = vcleq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8(25));
+    v = vorrq_u8(v, vandq_u8(upper, vdupq_n_u8(0x20)));
+    vst1q_u8((PHYSFS_uint8 *) dst, v);
+    return 1;
+#else
+    int i;
+    for (i = 0; i < 16; i++)
+    {
+        const char ch = src[i];
+        if (((PHYSFS_uint8) ch) & 0x80)
+            return 0;
+        dst[i] = ((ch >= 'A') && (ch <= 'Z')) ? (ch - ('A' - 'a')) : ch;
+    } /* for */
+    return 1;
+#endif
+} /* __PHYSFS_utf8LowerAscii16 */
+
+
+size_t __PHYSFS_utf8AsciiMatchLen(const char *str1, const char *str2,
+                                  const size_t len)
+{
+    size_t retval = 0;
+
+#if PHYSFS_HAVE_SSE2
+    const __m128i bias = _mm_set1_epi8((char) (0x80 - 'A'));
+    const __m128i limit = _mm_set1_epi8((char) (0x80 + 26));
+    const __m128i bit = _mm_set1_epi8(0x20);
+    while ((len - retval) >= 16)
+    {
+        __m128i v1 = _mm_loadu_si128((const __m128i *) (str1 + retval));
+        __m128i v2 = _mm_loadu_si128((const __m128i *) (str2 + retval));
+        if (_mm_movemask_epi8(_mm_or_si128(v1, v2)) != 0)
+            break;  /* not ASCII; PHYSFS_caseFold() decides. */
+        v1 = _mm_or_si128(v1, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(v1, bias), limit), bit));
+        v2 = _mm_or_si128(v2, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(v2, bias), limit), bit));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2)) != 0xFFFF)
+            break;
+        retval += 16;
+    } /* while */
+#else
+    char lower1[16], lower2[16];
+    while ((len - retval) >= 16)
+    {
+        if (!__PHYSFS_utf8LowerAscii16(str1 + retval, lower1))
+            break;
+        else if (!__PHYSFS_utf8LowerAscii16(str2 + retval, lower2))
+            break;
+        else if (memcmp(lower1, lower2, 16) != 0)
+            break;
+        retval += 16;
+    } /* while */
+#endif
+
+    return retval;
+} /* __PHYSFS_utf8AsciiMatchLen */
+
+
+/*
+ * Compare (*_str1) and (*_str2), ignoring case, for as long as they're both
+ *  ASCII. Returns non-zero with the result in (*rc) if that settles it, or
+ *  zero with both pointers moved up to where the full case fold has to go on.
+ */
+static int utf8AsciiStricmp(const char **_str1, const char **_str2, int *rc)
+{
+    const char *str1 = *_str1;
+    const char *str2 = *_str2;
+    size_t checked = 0;
+
+    while (1)
+    {
+        PHYSFS_uint8 ch1 = (PHYSFS_uint8) *str1;
+        PHYSFS_uint8 ch2 = (PHYSFS_uint8) *str2;
+        if ((ch1 | ch2) & 0x80)
+            break;
+        if ((ch1 >= 'A') && (ch1 <= 'Z'))
+            ch1 += 'a' - 'A';
+        if ((ch2 >= 'A') && (ch2 <= 'Z'))
+            ch2 += 'a' - 'A';
+
+        if (ch1 != ch2)
+        {
+            *rc = (ch1 < ch2) ? -1 : 1;
+            return 1;
+        } /* if */
+        else if (ch1 == 0)
+        {
+            *rc = 0;  /* complete match. */
+            return 1;
+        } /* else if */
+
+        str1++;
+        str2++;
+
+        /* still the same this far? Then it's worth 16 bytes at a time. */
+        if (++checked == 16)
+        {
+            const size_t len1 = strlen(str1);
+            const size_t len2 = strlen(str2);
+            const size_t skip = __PHYSFS_utf8AsciiMatchLen(str1, str2,
+                                                (len1 < len2) ? len1 : len2);
+            str1 += skip;
+            str2 += skip;
+        } /* if */
+    } /* while */
+
+    *_str1 = str1;
+    *_str2 = str2;
+    return 0;
+} /* utf8AsciiStricmp */
+
+
 #define UTFSTRICMP(bits) \
     PHYSFS_uint32 folded1[3], folded2[3]; \
     int head1 = 0, tail1 = 0, head2 = 0, tail2 = 0; \
@@ -553,7 +697,13 @@ int PHYSFS_caseFold(const PHYSFS_uint32 from, PHYSFS_uint32 *to)
 
 int PHYSFS_utf8stricmp(const char *str1, const char *str2)
 {
-    UTFSTRICMP(8);
+    int rc;
+    if (utf8AsciiStricmp(&str1, &str2, &rc))
+        return rc;
+    else
+    {
+        UTFSTRICMP(8);
+    } /* else */
 } /* PHYSFS_utf8stricmp */
 
 int PHYSFS_utf16stricmp(const PHYSFS_uint16 *str1, const PHYSFS_uint16 *str2)
@@ -335,6 +335,30 @@ static int cmd_setroot(char *args)
 } /* cmd_setroot */
 
 
+static void PHYSFS_CALL verifyArchiveBadFile(void *data, const char *str)
+{
+    printf(" * %s\n", str);
+} /* verifyArchiveBadFile */
+
+
+static int cmd_verifyarchive(char *args)
+{
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    printf("Checking [%s]...\n", args);
+    if (PHYSFS_verifyArchive(args, verifyArchiveBadFile, NULL))
+        printf("Successful.\n");
+    else
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+
+    return 1;
+} /* cmd_verifyarchive */
+
+
 static int cmd_removearchive(char *args)
 {
     if (*args == '\"')
@@ -380,6 +404,151 @@ static int cmd_enumerate(char *args)
     return 1;
 } /* cmd_enumerate */
 
+
+static PHYSFS_EnumerateCallbackResult enumStatCallback(void *data,
+                                const char *origdir, const char *fname,
+                                const PHYSFS_Stat *stat, const char *realdir)
+{
+    const char *type = "?";
+    if (stat->filetype == PHYSFS_FILETYPE_REGULAR)
+        type = "file";
+    else if (stat->filetype == PHYSFS_FILETYPE_DIRECTORY)
+        type = "dir";
+    else if (stat->filetype == PHYSFS_FILETYPE_SYMLINK)
+        type = "symlink";
+
+    printf("%s [%s, %ld bytes%s] in %s\n", fname, type, (long) stat->filesize,
+           stat->readonly ? ", read-only" : "", realdir);
+    (*((int *) data))++;
+    return PHYSFS_ENUM_OK;
+} /* enumStatCallback */
+
+
+static int cmd_enumeratestat(char *args)
+{
+    int file_count = 0;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    if (!PHYSFS_enumerateWithStat(args, enumStatCallback, &file_count))
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+    else
+        printf("\n total (%d) files.\n", file_count);
+
+    return 1;
+} /* cmd_enumeratestat */
+
+
+static PHYSFS_WalkCallbackResult walkCallback(void *data, const char *path,
+                                              const PHYSFS_Stat *stat,
+                                              const char *realdir)
+{
+    const char *type = "?";
+    if (stat->filetype == PHYSFS_FILETYPE_REGULAR)
+        type = "file";
+    else if (stat->filetype == PHYSFS_FILETYPE_DIRECTORY)
+        type = "dir";
+    else if (stat->filetype == PHYSFS_FILETYPE_SYMLINK)
+        type = "symlink";
+
+    printf("%s [%s, %ld bytes] in %s\n", path, type, (long) stat->filesize,
+           realdir);
+    (*((int *) data))++;
+    return PHYSFS_WALK_OK;
+} /* walkCallback */
+
+
+static int cmd_walk(char *args)
+{
+    int count = 0;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    if (!PHYSFS_walk(args, PHYSFS_WALK_DEPTH_FIRST, walkCallback, &count))
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+    else
+        printf("\n total (%d) items.\n", count);
+
+    return 1;
+} /* cmd_walk */
+
+
+static int cmd_diriter(char *args)
+{
+    PHYSFS_DirIter *iter;
+    const char *name;
+    char **list;
+    char *seen = NULL;
+    int list_count = 0;
+    int file_count = 0;
+    int rc;
+    int i;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    /* the iterator should list exactly what PHYSFS_enumerateFiles() does. */
+    list = PHYSFS_enumerateFiles(args);
+    if (list != NULL)
+    {
+        while (list[list_count] != NULL)
+            list_count++;
+        seen = (char *) calloc(list_count + 1, 1);
+    } /* if */
+
+    iter = PHYSFS_openDirIter(args);
+    if (iter == NULL)
+    {
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+        PHYSFS_freeList(list);
+        free(seen);
+        return 1;
+    } /* if */
+
+    while ((rc = PHYSFS_nextDirEntry(iter, &name)) == 1)
+    {
+        printf("%s\n", name);
+        file_count++;
+        for (i = 0; (seen != NULL) && (i < list_count); i++)
+        {
+            if (strcmp(list[i], name) == 0)
+                break;
+        } /* for */
+
+        if ((seen != NULL) && (i < list_count))
+            seen[i] = 1;
+        else if (seen != NULL)
+            printf(" (but PHYSFS_enumerateFiles() doesn't list it!)\n");
+    } /* while */
+
+    if (rc < 0)
+        printf("Failure. reason: %s.\n", PHYSFS_getLastError());
+    else
+        printf("\n total (%d) files.\n", file_count);
+
+    for (i = 0; (seen != NULL) && (i < list_count); i++)
+    {
+        if (!seen[i])
+            printf(" missing %s, which PHYSFS_enumerateFiles() lists!\n", list[i]);
+    } /* for */
+
+    PHYSFS_freeList(list);
+    free(seen);
+    PHYSFS_closeDirIter(iter);
+    return 1;
+} /* cmd_diriter */
+
 #define STR_BOX_VERTICAL_RIGHT  "\xe2\x94\x9c"
 #define STR_BOX_VERTICAL        "\xe2\x94\x82"
 #define STR_BOX_HORIZONTAL      "\xe2\x94\x80"
@@ -585,6 +754,173 @@ static int cmd_permitsyms(char *args)
 } /* cmd_permitsyms */
 
 
+static int cmd_verifychecksums(char *args)
+{
+    int num;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    num = atoi(args);
+    PHYSFS_setChecksumVerification(num);
+    printf("Checksums are now %s.\n", num ? "verified" : "ignored");
+    return 1;
+} /* cmd_verifychecksums */
+
+
+static int cmd_dircaching(char *args)
+{
+    int num;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    num = atoi(args);
+    PHYSFS_setDirCaching(num);
+    printf("Directories mounted from now on are %s.\n",
+           num ? "cached" : "not cached");
+    return 1;
+} /* cmd_dircaching */
+
+
+static int cmd_ignorecase(char *args)
+{
+    int num;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    num = atoi(args);
+    PHYSFS_setIgnoreCase(num);
+    printf("Archives mounted from now on %s.\n",
+           num ? "ignore case" : "match case exactly");
+    return 1;
+} /* cmd_ignorecase */
+
+
+static int cmd_indexingmode(char *args)
+{
+    static const char *names[] = { "at mount", "on first use", "in background" };
+    int num;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    num = atoi(args);
+    if ((num < 0) || (num > 2))
+    {
+        printf("Indexing mode must be 0, 1, or 2.\n");
+        return 1;
+    } /* if */
+
+    PHYSFS_setIndexingMode((PHYSFS_IndexingMode) num);
+    printf("Archives mounted from now on are indexed %s.\n", names[num]);
+    return 1;
+} /* cmd_indexingmode */
+
+
+static int cmd_handlelimit(char *args)
+{
+    int num;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    num = atoi(args);
+    if (num < 0)
+        num = 0;
+
+    PHYSFS_setNativeHandleLimit((PHYSFS_uint32) num);
+    if (num == 0)
+        printf("Native read handles are no longer pooled.\n");
+    else
+        printf("Pooling native read handles, at most %d open.\n", num);
+    return 1;
+} /* cmd_handlelimit */
+
+
+static int cmd_handlestats(char *args)
+{
+    PHYSFS_NativeHandleStats stats;
+
+    if (!PHYSFS_getNativeHandleStats(&stats))
+    {
+        printf("failed to get stats. Reason [%s].\n",
+               PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode()));
+        return 1;
+    } /* if */
+
+    printf("limit %u, pooled %u, open %u, peak open %u\n",
+           (unsigned int) PHYSFS_getNativeHandleLimit(),
+           (unsigned int) stats.pooled, (unsigned int) stats.open,
+           (unsigned int) stats.peakopen);
+    printf("evictions %lu, reopens %lu, mismatches %lu\n",
+           (unsigned long) stats.evictions,
+           (unsigned long) stats.reopens,
+           (unsigned long) stats.mismatches);
+    return 1;
+} /* cmd_handlestats */
+
+
+static int cmd_lookupfilter(char *args)
+{
+    int num;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    num = atoi(args);
+    if (num < 0)
+        num = 0;
+
+    PHYSFS_setLookupFilterBits((PHYSFS_uint32) num);
+    if (num == 0)
+        printf("Lookup filters are off.\n");
+    else
+        printf("Using lookup filters, %u bits per path.\n",
+               (unsigned int) PHYSFS_getLookupFilterBits());
+    return 1;
+} /* cmd_lookupfilter */
+
+
+static int cmd_filterstats(char *args)
+{
+    PHYSFS_LookupFilterStats stats;
+
+    if (!PHYSFS_getLookupFilterStats(&stats))
+    {
+        printf("failed to get stats. Reason [%s].\n",
+               PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode()));
+        return 1;
+    } /* if */
+
+    printf("bits per path %u, filters %u, bytes %lu\n",
+           (unsigned int) PHYSFS_getLookupFilterBits(),
+           (unsigned int) stats.filters, (unsigned long) stats.bytes);
+    printf("skipped %lu, checked %lu\n",
+           (unsigned long) stats.skipped, (unsigned long) stats.checked);
+    return 1;
+} /* cmd_filterstats */
+
+
 static int cmd_setbuffer(char *args)
 {
     if (*args == '\"')
@@ -1197,6 +1533,72 @@ static int cmd_crc32(char *args)
 } /* cmd_crc32 */
 
 
+/* read a file in one call, like an app loading an asset, then in chunks. */
+static int cmd_readall(char *args)
+{
+    PHYSFS_File *f;
+
+    if (*args == '\"')
+    {
+        args++;
+        args[strlen(args) - 1] = '\0';
+    } /* if */
+
+    f = PHYSFS_openRead(args);
+    if (f == NULL)
+        printf("failed to open. Reason: [%s].\n", PHYSFS_getLastError());
+    else
+    {
+        const PHYSFS_sint64 len = PHYSFS_fileLength(f);
+        PHYSFS_uint8 *buffer = (PHYSFS_uint8 *) malloc((size_t) (len > 0 ? len : 1));
+        PHYSFS_sint64 rc;
+
+        if ((len < 0) || (buffer == NULL))
+        {
+            printf("can't read the whole file at once.\n");
+            free(buffer);
+            PHYSFS_close(f);
+            return 1;
+        } /* if */
+
+        rc = PHYSFS_readBytes(f, buffer, (PHYSFS_uint64) len);
+        if (rc < 0)
+            printf("one read: error. Reason: [%s].\n", PHYSFS_getLastError());
+        else
+        {
+            printf("one read: %lld of %lld bytes, eof %d.\n",
+                   (long long) rc, (long long) len, PHYSFS_eof(f));
+        } /* else */
+
+        if (!PHYSFS_seek(f, 0))
+            printf("seek failed. Reason: [%s].\n", PHYSFS_getLastError());
+        else
+        {
+            PHYSFS_uint8 chunk[CRC32_BUFFERSIZE];
+            PHYSFS_sint64 total = 0;
+            while ((rc = PHYSFS_readBytes(f, chunk, sizeof (chunk))) > 0)
+                total += rc;
+
+            if (rc < 0)
+            {
+                printf("chunks: error after %lld bytes. Reason: [%s].\n",
+                       (long long) total, PHYSFS_getLastError());
+            } /* if */
+            else
+            {
+                printf("chunks: %lld of %lld bytes.\n",
+                       (long long) total, (long long) len);
+            } /* else */
+        } /* else */
+
+        free(buffer);
+        PHYSFS_close(f);
+    } /* else */
+
+    return 1;
+} /* cmd_readall */
+
+
 static int cmd_filelength(char *args)
 {
     PHYSFS_File *f;
@@ -1449,7 +1851,10 @@ static const command_info commands[] =
     { "unmount",        cmd_removearchive,  1, "<archiveLocation>"          },
     { "enumerate",      cmd_enumerate,      1, "<dirToEnumerate>"           },
     { "ls",             cmd_enumerate,      1, "<dirToEnumerate>"           },
+    { "lsstat",         cmd_enumeratestat,  1, "<dirToEnumerate>"           },
     { "tree",           cmd_tree,           1, "<dirToEnumerate>"           },
+    { "walk",           cmd_walk,           1, "<dirToWalk>"                },
+    { "lsiter",         cmd_diriter,        1, "<dirToEnumerate>"           },
     { "getlasterror",   cmd_getlasterror,   0, NULL                         },
     { "getdirsep",      cmd_getdirsep,      0, NULL                         },
     { "getcdromdirs",   cmd_getcdromdirs,   0, NULL                         },
@@ -1460,6 +1865,14 @@ static const command_info commands[] =
     { "getwritedir",    cmd_getwritedir,    0, NULL                         },
     { "setwritedir",    cmd_setwritedir,    1, "<newWriteDir>"              },
     { "permitsymlinks", cmd_permitsyms,     1, "<1or0>"                     },
+    { "verifychecksums", cmd_verifychecksums, 1, "<1or0>"                   },
+    { "dircaching",     cmd_dircaching,     1, "<1or0>"                     },
+    { "ignorecase",     cmd_ignorecase,     1, "<1or0>"                     },
+    { "indexingmode",   cmd_indexingmode,   1, "<0, 1, or 2>"               },
+    { "handlelimit",    cmd_handlelimit,    1, "<maxOpenOr0>"               },
+    { "handlestats",    cmd_handlestats,    0, NULL                         },
+    { "lookupfilter",   cmd_lookupfilter,   1, "<bitsPerPathOr0>"           },
+    { "filterstats",    cmd_filterstats,    0, NULL                         },
     { "setsaneconfig",  cmd_setsaneconfig,  5, "<org> <appName> <arcExt> <includeCdRoms> <archivesFirst>" },
     { "mkdir",          cmd_mkdir,          1, "<dirToMk>"                  },
     { "delete",         cmd_delete,         1, "<dirToDelete>"              },
@@ -1477,8 +1890,10 @@ static const command_info commands[] =
     { "setbuffer",      cmd_setbuffer,      1, "<bufferSize>"               },
     { "stressbuffer",   cmd_stressbuffer,   1, "<bufferSize>"               },
     { "crc32",          cmd_crc32,          1, "<fileToHash>"               },
+    { "readall",        cmd_readall,        1, "<fileToRead>"               },
     { "getmountpoint",  cmd_getmountpoint,  1, "<dir>"                      },
     { "setroot",        cmd_setroot,        2, "<archiveLocation> <root>"   },
+    { "verifyarchive",  cmd_verifyarchive,  1, "<archiveLocation>"          },
     { NULL,             NULL,              -1, NULL                         }
 };
 